@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Fallback command layer for targets that do not link the fastboot
+ * command handlers (dev/usb/device/fastboot), such as qemu-virt. It is
+ * enough to bring up the transport and measure it from the host:
+ *
+ *   fastboot -s tcp:<ip> getvar max-download-size
+ *   fastboot -s tcp:<ip> stage <file>        (download:)
+ *   fastboot -s tcp:<ip> get_staged <file>   (upload)
+ *
+ * The handlers in fastboot-cmd.c override these weak symbols.
+ */
+
+#include <compiler.h>
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <usb-def.h>
+#include <dev/usb/fastboot.h>
+
+#ifndef FASTBOOT_TCP_STUB_BUF_SIZE
+#define FASTBOOT_TCP_STUB_BUF_SIZE	(32 * 1024 * 1024)
+#endif
+
+static unsigned char *stub_buf;
+static unsigned int stub_downloaded;
+
+__WEAK void fb_cmd_set_downloaded_sz(unsigned int sz)
+{
+	stub_downloaded += sz;
+}
+
+__WEAK int rx_handler(const unsigned char *buffer, unsigned int buffer_size)
+{
+	const char *cmd = (const char *)buffer;
+	char response[64];
+	unsigned int size;
+
+	if (!strncmp(cmd, "getvar:", 7)) {
+		if (!strcmp(cmd + 7, "version"))
+			sprintf(response, "OKAY%s", FASTBOOT_VERSION);
+		else if (!strcmp(cmd + 7, "max-download-size"))
+			sprintf(response, "OKAY0x%08x", FASTBOOT_TCP_STUB_BUF_SIZE);
+		else
+			sprintf(response, "OKAY");
+	} else if (!strncmp(cmd, "download:", 9)) {
+		size = strtoul(cmd + 9, NULL, 16);
+		if (!stub_buf)
+			stub_buf = malloc(FASTBOOT_TCP_STUB_BUF_SIZE);
+
+		if (!stub_buf || size > FASTBOOT_TCP_STUB_BUF_SIZE) {
+			sprintf(response, "FAILdata too large");
+		} else {
+			stub_downloaded = 0;
+			fastboot_set_payload_data(USBDIR_OUT, stub_buf, size);
+			sprintf(response, "DATA%08x", size);
+		}
+	} else if (!strcmp(cmd, "upload")) {
+		sprintf(response, "DATA%08x", stub_downloaded);
+		fastboot_send_info(response, strlen(response));
+		if (stub_downloaded)
+			fastboot_send_payload(stub_buf, stub_downloaded);
+		sprintf(response, "OKAY");
+	} else {
+		sprintf(response, "FAILunknown command");
+	}
+
+	fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+
+	return 0;
+}
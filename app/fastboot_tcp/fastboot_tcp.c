@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Fastboot over TCP
+ *
+ * Implements the network transport of the fastboot protocol on top of
+ * minip: after a "FB01" handshake in both directions, every command,
+ * response and data phase is a packet prefixed by its length as a
+ * 64-bit big-endian integer. Commands go through the same rx_handler()
+ * as USB. The session holds the fastboot transport from the handshake
+ * until the host disconnects, so USB commands wait for it to end.
+ */
+
+#include <app.h>
+#include <debug.h>
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <trace.h>
+#include <sys/types.h>
+#include <kernel/thread.h>
+#include <lib/minip.h>
+#include <platform.h>
+#include <usb-def.h>
+#include <dev/usb/fastboot.h>
+
+#define LOCAL_TRACE 0
+
+#define FASTBOOT_TCP_PORT	5554
+#define FASTBOOT_TCP_HANDSHAKE	"FB01"
+#define FASTBOOT_TCP_CMD_MAX	4096
+#define FASTBOOT_TCP_MSG_MAX	256
+
+static struct fastboot_tcp {
+	tcp_socket_t *s;
+	int err;
+
+	/* Data phase set up by the command layer */
+	int payload_dir;
+	void *payload_buf;
+	unsigned int payload_len;
+
+	/* Bytes of the download data phase received so far */
+	unsigned int download_done;
+	lk_bigtime_t download_start;
+
+	/* Bytes left in the current upload packet */
+	unsigned long long upload_left;
+
+	unsigned long long rx_bytes;
+	unsigned long long tx_bytes;
+
+	unsigned char cmd[FASTBOOT_TCP_CMD_MAX + 1];
+} fb_tcp;
+
+static int fb_tcp_read_full(void *buf, size_t len)
+{
+	u8 *p = buf;
+	ssize_t ret;
+
+	while (len) {
+		ret = tcp_read(fb_tcp.s, p, len);
+		if (ret <= 0)
+			return ret ? ret : ERR_CHANNEL_CLOSED;
+		p += ret;
+		len -= ret;
+		fb_tcp.rx_bytes += ret;
+	}
+
+	return 0;
+}
+
+static int fb_tcp_write(const void *buf, size_t len)
+{
+	ssize_t ret;
+
+	if (fb_tcp.err)
+		return fb_tcp.err;
+
+	ret = tcp_write(fb_tcp.s, buf, len);
+	if (ret < 0) {
+		LTRACEF("write failed %ld\n", ret);
+		fb_tcp.err = ret;
+		return ret;
+	}
+	fb_tcp.tx_bytes += len;
+
+	return 0;
+}
+
+static void fb_tcp_put_len(u8 *p, unsigned long long len)
+{
+	int i;
+
+	for (i = 7; i >= 0; i--) {
+		p[i] = len & 0xff;
+		len >>= 8;
+	}
+}
+
+static unsigned long long fb_tcp_get_len(const u8 *p)
+{
+	unsigned long long len = 0;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		len = (len << 8) | p[i];
+
+	return len;
+}
+
+static int fb_tcp_write_packet(const void *buf, unsigned long long len)
+{
+	u8 hdr[8];
+
+	fb_tcp_put_len(hdr, len);
+	if (fb_tcp_write(hdr, sizeof(hdr)))
+		return fb_tcp.err;
+
+	return fb_tcp_write(buf, len);
+}
+
+static void fb_tcp_send_info(char *response, unsigned int len)
+{
+	/* Short messages go out as one segment */
+	u8 msg[8 + FASTBOOT_TCP_MSG_MAX];
+
+	len = MIN(len, (unsigned int)FASTBOOT_TCP_MSG_MAX);
+	fb_tcp_put_len(msg, len);
+	memcpy(msg + 8, response, len);
+	fb_tcp_write(msg, 8 + len);
+}
+
+static void fb_tcp_send_status(char *response, unsigned int len, int sync)
+{
+	fb_tcp_send_info(response, len);
+
+	/* Upload that was set up before the status, e.g. ramdump */
+	if (fb_tcp.payload_buf && fb_tcp.payload_dir == USBDIR_IN) {
+		fb_tcp_write_packet(fb_tcp.payload_buf, fb_tcp.payload_len);
+		fb_tcp.payload_buf = NULL;
+	}
+}
+
+static void fb_tcp_set_payload_data(int dir, void *buf, unsigned int len)
+{
+	fb_tcp.payload_dir = dir;
+	fb_tcp.payload_buf = buf;
+	fb_tcp.payload_len = len;
+}
+
+static void fb_tcp_set_upload_len(unsigned long long len)
+{
+	u8 hdr[8];
+
+	fb_tcp_put_len(hdr, len);
+	if (!fb_tcp_write(hdr, sizeof(hdr)))
+		fb_tcp.upload_left = len;
+}
+
+/*
+ * tcp_write() only blocks until the data is in the socket's tx buffer,
+ * so the caller still overlaps preparing the next chunk with the wire.
+ */
+static void fb_tcp_send_payload_async(void *buf, unsigned int len)
+{
+	if (fb_tcp.upload_left) {
+		len = MIN((unsigned long long)len, fb_tcp.upload_left);
+		if (!fb_tcp_write(buf, len))
+			fb_tcp.upload_left -= len;
+	} else {
+		fb_tcp_write_packet(buf, len);
+	}
+}
+
+static void fb_tcp_wait_payload(void)
+{
+}
+
+static const struct fastboot_transport tcp_transport = {
+	.name = "tcp",
+	.send_info = fb_tcp_send_info,
+	.send_status = fb_tcp_send_status,
+	.set_payload_data = fb_tcp_set_payload_data,
+	.send_payload_async = fb_tcp_send_payload_async,
+	.wait_payload = fb_tcp_wait_payload,
+	.set_upload_len = fb_tcp_set_upload_len,
+};
+
+/*
+ * Host to device data phase of "download:". The host may split the data
+ * into several packets; they are appended until payload_len bytes are in.
+ */
+static int fb_tcp_download(unsigned long long len)
+{
+	u8 *buf = fb_tcp.payload_buf;
+	unsigned int total = fb_tcp.payload_len;
+	lk_bigtime_t elapsed;
+	int ret;
+
+	if (!fb_tcp.download_done)
+		fb_tcp.download_start = current_time_hires();
+
+	if (len > total - fb_tcp.download_done) {
+		printf("fastboot tcp: data packet of %llu bytes, %u left to receive\n",
+				len, total - fb_tcp.download_done);
+		fb_tcp.payload_buf = NULL;
+		return ERR_BAD_LEN;
+	}
+
+	ret = fb_tcp_read_full(buf + fb_tcp.download_done, len);
+	if (ret)
+		return ret;
+	fb_tcp.download_done += len;
+
+	if (fb_tcp.download_done < total)
+		return 0;
+
+	fb_tcp.payload_buf = NULL;
+	fb_tcp.download_done = 0;
+
+	elapsed = current_time_hires() - fb_tcp.download_start;
+	printf("fastboot tcp: received %u bytes in %llu ms, %llu KB/s\n",
+			total, elapsed / 1000,
+			elapsed ? ((unsigned long long)total * 1000000 / elapsed) >> 10 : 0);
+
+	fb_cmd_set_downloaded_sz(total);
+	fb_tcp_send_info((char *)"OKAY", 4);
+
+	return 0;
+}
+
+static int fb_tcp_session(void)
+{
+	unsigned long long len;
+	u8 hdr[8];
+	int ret;
+
+	ret = fb_tcp_read_full(hdr, 4);
+	if (ret)
+		return ret;
+	if (memcmp(hdr, FASTBOOT_TCP_HANDSHAKE, 2)) {
+		printf("fastboot tcp: bad handshake\n");
+		return ERR_NOT_VALID;
+	}
+	ret = fb_tcp_write(FASTBOOT_TCP_HANDSHAKE, 4);
+	if (ret)
+		return ret;
+
+	for (;;) {
+		ret = fb_tcp_read_full(hdr, sizeof(hdr));
+		if (ret)
+			return ret;
+		len = fb_tcp_get_len(hdr);
+
+		if (fb_tcp.payload_buf && fb_tcp.payload_dir == USBDIR_OUT) {
+			ret = fb_tcp_download(len);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (len > FASTBOOT_TCP_CMD_MAX) {
+			printf("fastboot tcp: command too long (%llu)\n", len);
+			return ERR_BAD_LEN;
+		}
+
+		ret = fb_tcp_read_full(fb_tcp.cmd, len);
+		if (ret)
+			return ret;
+		fb_tcp.cmd[len] = '\0';
+
+		rx_handler(fb_tcp.cmd, len);
+		memset(fb_tcp.cmd, 0, len);
+
+		if (fb_tcp.err)
+			return fb_tcp.err;
+	}
+}
+
+static int fb_tcp_server(void *arg)
+{
+	tcp_socket_t *listen_socket;
+	tcp_socket_t *s;
+	lk_bigtime_t start;
+	lk_bigtime_t elapsed;
+	status_t err;
+
+	err = tcp_open_listen(&listen_socket, FASTBOOT_TCP_PORT);
+	if (err < 0) {
+		printf("fastboot tcp: cannot listen on port %d: %d\n",
+				FASTBOOT_TCP_PORT, err);
+		return err;
+	}
+
+	printf("fastboot tcp: listening on port %d\n", FASTBOOT_TCP_PORT);
+
+	for (;;) {
+		/* Sessions are served one at a time, like the USB gadget */
+		err = tcp_accept(listen_socket, &s);
+		if (err < 0)
+			continue;
+
+		fb_tcp.s = s;
+		fb_tcp.err = 0;
+		fb_tcp.payload_buf = NULL;
+		fb_tcp.download_done = 0;
+		fb_tcp.upload_left = 0;
+		fb_tcp.rx_bytes = 0;
+		fb_tcp.tx_bytes = 0;
+		start = current_time_hires();
+
+		fastboot_acquire_transport(&tcp_transport);
+		printf("fastboot tcp: session started\n");
+		err = fb_tcp_session();
+		fastboot_release_transport();
+
+		elapsed = current_time_hires() - start;
+		printf("fastboot tcp: session closed (%d), rx %llu tx %llu bytes in %llu ms\n",
+				err, fb_tcp.rx_bytes, fb_tcp.tx_bytes, elapsed / 1000);
+
+		tcp_close(s);
+		fb_tcp.s = NULL;
+	}
+
+	return 0;
+}
+
+static void fastboot_tcp_entry(const struct app_descriptor *app, void *args)
+{
+	thread_detach_and_resume(thread_create("fastboot tcp", &fb_tcp_server,
+				NULL, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE));
+}
+
+APP_START(fastboot_tcp)
+	.entry = fastboot_tcp_entry,
+	.flags = 0,
+APP_END
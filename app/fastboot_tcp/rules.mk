@@ -0,0 +1,13 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/fastboot_tcp.c \
+	$(LOCAL_DIR)/fastboot_stub.c
+
+MODULE_DEPS += \
+	lib/fastboot \
+	lib/minip
+
+include make/module.mk
@@ -34,6 +34,7 @@
 #include <trace.h>
 #include <pow2.h>
 
+#include <kernel/event.h>
 #include <kernel/thread.h>
 #include <kernel/vm.h>
 
@@ -54,6 +55,9 @@
 
 #define LOCAL_TRACE 0
 
+/* flash payloads are received and written in chunks of at least this */
+#define FLASH_CHUNK_SIZE (256 * 1024)
+
 struct lkb_command {
     struct lkb_command *next;
     const char *name;
@@ -275,6 +279,145 @@ status_t do_flash_boot(void)
     return NO_ERROR;
 }
 
+/*
+ * Writes one chunk of a flash payload while the next one is received.
+ * Every chunk covers whole erase blocks and is erased just before it is
+ * written, so erasing overlaps the transfer as well.
+ */
+struct flash_writer {
+    bdev_t *bdev;
+    thread_t *thread;
+    event_t start;
+    event_t done;
+    bool quit;
+
+    off_t offset;
+    const void *buf;
+    size_t len;
+    size_t erase_len;
+
+    const char *error;
+};
+
+static int flash_writer_thread(void *arg)
+{
+    struct flash_writer *w = arg;
+
+    for (;;) {
+        event_wait(&w->start);
+        if (w->quit)
+            break;
+
+        if (!w->error) {
+            if (bio_erase(w->bdev, w->offset, w->erase_len) != (ssize_t)w->erase_len)
+                w->error = "bio_erase failed";
+            else if (bio_write(w->bdev, w->buf, w->offset, w->len) != (ssize_t)w->len)
+                w->error = "bio_write failed";
+        }
+
+        event_signal(&w->done, true);
+    }
+
+    return 0;
+}
+
+static int do_flash(lkb_t *lkb, bdev_t *bdev, const struct ptable_entry *entry,
+                    size_t len, const char **result)
+{
+    struct flash_writer w;
+    size_t unit = MAX(bdev->erase_size, bdev->block_size);
+    size_t chunk = ((FLASH_CHUNK_SIZE + unit - 1) / unit) * unit;
+    lk_time_t t = current_time();
+    void *buf[2];
+    size_t pos = 0;
+    int cur = 0;
+    bool busy = false;
+
+    LTRACEF("len %zu, chunk %zu\n", len, chunk);
+
+    buf[0] = malloc(chunk);
+    buf[1] = malloc(chunk);
+    if (!buf[0] || !buf[1]) {
+        *result = "memory allocation failed";
+        goto out_free;
+    }
+
+    memset(&w, 0, sizeof(w));
+    w.bdev = bdev;
+    event_init(&w.start, false, EVENT_FLAG_AUTOUNSIGNAL);
+    event_init(&w.done, false, EVENT_FLAG_AUTOUNSIGNAL);
+    w.thread = thread_create("lkboot_flash", &flash_writer_thread, &w,
+                             DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (!w.thread) {
+        *result = "thread_create failed";
+        goto out_events;
+    }
+    thread_resume(w.thread);
+
+    printf("lkboot: writing %zu bytes to partition\n", len);
+
+    while (pos < len) {
+        size_t toread = MIN(len - pos, chunk);
+
+        if (lkb_read(lkb, buf[cur], toread)) {
+            *result = "io error";
+            break;
+        }
+
+        /* the previous chunk has to be out of the other buffer */
+        if (busy) {
+            event_wait(&w.done);
+            busy = false;
+            if (w.error)
+                break;
+        }
+
+        w.offset = entry->offset + pos;
+        w.buf = buf[cur];
+        w.len = toread;
+        w.erase_len = MIN(chunk, entry->length - pos);
+        event_signal(&w.start, true);
+        busy = true;
+
+        pos += toread;
+        cur ^= 1;
+    }
+
+    if (busy)
+        event_wait(&w.done);
+    w.quit = true;
+    event_signal(&w.start, true);
+    thread_join(w.thread, NULL, INFINITE_TIME);
+
+    if (!*result)
+        *result = w.error;
+
+    /* erase whatever the payload did not cover */
+    if (!*result) {
+        uint64_t tail = (((uint64_t)pos + chunk - 1) / chunk) * chunk;
+
+        if (tail < entry->length) {
+            size_t erase_len = entry->length - tail;
+            ssize_t err = bio_erase(bdev, entry->offset + tail, erase_len);
+
+            if (err < 0 || (size_t)err != erase_len)
+                *result = "bio_erase failed";
+        }
+    }
+
+    if (!*result)
+        printf("lkboot: wrote %zu bytes in %u ms\n", len, (uint)(current_time() - t));
+
+out_events:
+    event_destroy(&w.start);
+    event_destroy(&w.done);
+out_free:
+    free(buf[0]);
+    free(buf[1]);
+
+    return *result ? -1 : 0;
+}
+
 // return NULL for success, error string for failure
 int lkb_handle_command(lkb_t *lkb, const char *cmd, const char *arg, size_t len, const char **result)
 {
@@ -315,44 +458,14 @@ int lkb_handle_command(lkb_t *lkb, const char *cmd, const char *arg, size_t len,
             return -1;
         }
 
+        if (!strcmp(cmd, "flash"))
+            return do_flash(lkb, bdev, &entry, len, result);
+
         printf("lkboot: erasing partition of size %llu\n", entry.length);
         if (bio_erase(bdev, entry.offset, entry.length) != (ssize_t)entry.length) {
             *result = "bio_erase failed";
             return -1;
         }
-
-        if (!strcmp(cmd, "flash")) {
-            printf("lkboot: writing to partition\n");
-
-            void *buf = malloc(bdev->block_size);
-            if (!buf) {
-                *result = "memory allocation failed";
-                return -1;
-            }
-
-            size_t pos = 0;
-            while (pos < len) {
-                size_t toread = MIN(len - pos, bdev->block_size);
-
-                LTRACEF("offset %zu, toread %zu\n", pos, toread);
-
-                if (lkb_read(lkb, buf, toread)) {
-                    *result = "io error";
-                    free(buf);
-                    return -1;
-                }
-
-                if (bio_write(bdev, buf, entry.offset + pos, toread) != (ssize_t)toread) {
-                    *result = "bio_write failed";
-                    free(buf);
-                    return -1;
-                }
-
-                pos += toread;
-            }
-
-            free(buf);
-        }
     } else if (!strcmp(cmd, "remove")) {
         if (ptable_remove(arg) < 0) {
             *result = "remove failed";
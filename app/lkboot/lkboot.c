@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <trace.h>
 
+#include <lib/lz4.h>
 #include <lib/sysparam.h>
 
 #include <kernel/thread.h>
@@ -64,6 +65,9 @@
 #define STATE_DONE 3
 #define STATE_ERROR 4
 
+/* largest payload of one MSG_SEND_DATA, decoded or not */
+#define LKB_CHUNK_MAX 65536
+
 typedef struct LKB {
     lkb_read_hook *read;
     lkb_write_hook *write;
@@ -72,6 +76,11 @@ typedef struct LKB {
 
     int state;
     size_t avail;
+
+    /* lz4 chunk in the first half, what it decodes to in the second */
+    u8 *zbuf;
+    size_t zpos;
+    size_t zlen;
 } lkb_t;
 
 lkb_t *lkboot_create_lkb(void *cookie, lkb_read_hook *read, lkb_write_hook *write) {
@@ -84,10 +93,21 @@ lkb_t *lkboot_create_lkb(void *cookie, lkb_read_hook *read, lkb_write_hook *writ
     lkb->avail = 0;
     lkb->read = read;
     lkb->write = write;
+    lkb->zbuf = NULL;
+    lkb->zpos = 0;
+    lkb->zlen = 0;
 
     return lkb;
 }
 
+void lkboot_free_lkb(lkb_t *lkb) {
+    if (!lkb)
+        return;
+
+    free(lkb->zbuf);
+    free(lkb);
+}
+
 static int lkb_send(lkb_t *lkb, u8 opcode, const void *data, size_t len) {
     msg_hdr_t hdr;
 
@@ -121,9 +141,9 @@ static int lkb_send(lkb_t *lkb, u8 opcode, const void *data, size_t len) {
     }
 
     hdr.opcode = opcode;
-    hdr.extra = 0;
+    hdr.extra = (opcode == MSG_GO_AHEAD) ? MSG_GO_AHEAD_LZ4 : 0;
     hdr.length = (opcode == MSG_SEND_DATA) ? (len - 1) : len;
-    if (lkb->write(lkb->cookie, &hdr, sizeof(hdr)) != sizeof(&hdr)) {
+    if (lkb->write(lkb->cookie, &hdr, sizeof(hdr)) != sizeof(hdr)) {
         printf("xmit hdr fail\n");
         lkb->state = STATE_ERROR;
         return -1;
@@ -150,6 +170,30 @@ int lkb_write(lkb_t *lkb, const void *_data, size_t len) {
     return 0;
 }
 
+/* receive the lz4 block of the current message and decode it */
+static int lkb_read_lz4(lkb_t *lkb) {
+    int ret;
+
+    if (!lkb->zbuf) {
+        lkb->zbuf = malloc(2 * LKB_CHUNK_MAX);
+        if (!lkb->zbuf) return -1;
+    }
+
+    if (lkb->read(lkb->cookie, lkb->zbuf, lkb->avail)) return -1;
+
+    ret = lz4_decompress_block(lkb->zbuf, lkb->avail, lkb->zbuf + LKB_CHUNK_MAX,
+                               LKB_CHUNK_MAX, NULL);
+    lkb->avail = 0;
+    if (ret < 0) {
+        TRACEF("bad lz4 chunk, err %d\n", ret);
+        return -1;
+    }
+
+    lkb->zpos = 0;
+    lkb->zlen = ret;
+    return 0;
+}
+
 int lkb_read(lkb_t *lkb, void *_data, size_t len) {
     char *data = _data;
 
@@ -160,6 +204,14 @@ int lkb_read(lkb_t *lkb, void *_data, size_t len) {
         if (lkb_send(lkb, MSG_GO_AHEAD, NULL, 0)) return -1;
     }
     while (len > 0) {
+        if (lkb->zpos < lkb->zlen) {
+            size_t xfer = MIN(len, lkb->zlen - lkb->zpos);
+            memcpy(data, lkb->zbuf + LKB_CHUNK_MAX + lkb->zpos, xfer);
+            lkb->zpos += xfer;
+            data += xfer;
+            len -= xfer;
+            continue;
+        }
         if (lkb->avail == 0) {
             msg_hdr_t hdr;
             if (lkb->read(lkb->cookie, &hdr, sizeof(hdr))) goto fail;
@@ -169,6 +221,11 @@ int lkb_read(lkb_t *lkb, void *_data, size_t len) {
             }
             if (hdr.opcode != MSG_SEND_DATA) goto fail;
             lkb->avail = ((size_t) hdr.length) + 1;
+            if (hdr.extra == MSG_DATA_LZ4) {
+                if (lkb_read_lz4(lkb)) goto fail;
+                continue;
+            }
+            if (hdr.extra != 0) goto fail;
         }
         if (lkb->avail >= len) {
             if (lkb->read(lkb->cookie, data, len)) goto fail;
@@ -259,7 +316,7 @@ static status_t lkboot_server(lk_time_t timeout)
             /* handle the command and close it */
             lkb = lkboot_tcp_opened(s);
             lkboot_process_command(lkb);
-            free(lkb);
+            lkboot_free_lkb(lkb);
             tcp_close(s);
             handled_command = true;
         }
@@ -269,7 +326,7 @@ static status_t lkboot_server(lk_time_t timeout)
         lkb = lkboot_check_dcc_open();
         if (lkb) {
             lkboot_process_command(lkb);
-            free(lkb);
+            lkboot_free_lkb(lkb);
             handled_command = true;
         }
 
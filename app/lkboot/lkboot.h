@@ -36,6 +36,7 @@ typedef ssize_t lkb_read_hook(void *s, void *data, size_t len);
 typedef ssize_t lkb_write_hook(void *s, const void *data, size_t len);
 
 lkb_t *lkboot_create_lkb(void *cookie, lkb_read_hook *read, lkb_write_hook *write);
+void lkboot_free_lkb(lkb_t *lkb);
 status_t lkboot_process_command(lkb_t *);
 
 /* inet server */
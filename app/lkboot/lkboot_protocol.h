@@ -46,6 +46,9 @@ typedef struct {
 // length must be zero
 // server indicates that command was valid and it is ready for data
 // client should send MSG_SEND_DATA messages to transfer data
+// extra has MSG_GO_AHEAD_LZ4 set if the server accepts compressed data
+
+#define MSG_GO_AHEAD_LZ4    0x01
 
 #define MSG_CMD     0x40
 // length must be greater than zero
@@ -55,6 +58,11 @@ typedef struct {
 #define MSG_SEND_DATA   0x41
 // client sends data to server
 // length is datalen -1 (to allow for full 64k chunks)
+// extra is MSG_DATA_LZ4 if data is a single independent lz4 block that
+// decodes to at most 64k, only sent to servers that announced it. the
+// <decimal-datalen> of the command counts decoded bytes.
+
+#define MSG_DATA_LZ4    0x01
 
 #define MSG_END_DATA    0x42
 // client ends data stream
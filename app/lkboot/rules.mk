@@ -7,6 +7,7 @@ MODULE_DEPS += \
 	lib/bootargs \
 	lib/bootimage \
 	lib/cbuf \
+	lib/lz4 \
 	lib/ptable \
 	lib/sysparam
 
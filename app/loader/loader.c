@@ -28,6 +28,7 @@
 #include <stdlib.h>
 
 #include <lib/tftp.h>
+#include <lib/minip.h>
 #include <lib/cksum.h>
 #include <lib/elf.h>
 
@@ -152,6 +153,66 @@ int tftp_callback(void *data, size_t len, void *arg)
     return 0;
 }
 
+/* load bio [filename] [device] <offset> */
+static int load_bio(int argc, const cmd_args *argv)
+{
+    static tftp_bio_sink_t *bio_sink;
+    static char bio_name[FNAME_SIZE];
+    off_t offset = (argc > 4) ? (off_t)argv[4].u : 0;
+
+    if (argc < 4)
+        return -1;
+
+    /* only one file streams into a device at a time; the old job has to
+     * go before its sink does, once it is cleared no block of it is being
+     * handed to the sink and close can drain what is queued */
+    if (bio_sink) {
+        tftp_clear_write_client(bio_name);
+        tftp_bio_sink_close(bio_sink);
+        bio_sink = NULL;
+    }
+
+    bio_sink = tftp_bio_sink_open(argv[3].str, offset);
+    if (!bio_sink)
+        return 0;
+
+    /* the job keeps the name, argv goes away with the command */
+    strlcpy(bio_name, argv[2].str, sizeof(bio_name));
+    if (tftp_set_write_client(bio_name, &tftp_bio_sink_callback, bio_sink) < 0) {
+        tftp_bio_sink_close(bio_sink);
+        bio_sink = NULL;
+        return -1;
+    }
+    printf("ready for %s over tftp (to %s at 0x%llx)\n", argv[2].str, argv[3].str, offset);
+    return 0;
+}
+
+/* load fetch [host] [filename] [device] <offset> */
+static int load_fetch(int argc, const cmd_args *argv)
+{
+    tftp_bio_sink_t *sink;
+    off_t offset = (argc > 5) ? (off_t)argv[5].u : 0;
+    uint32_t host;
+    int ret;
+
+    if (argc < 5)
+        return -1;
+
+    host = minip_parse_ipaddr(argv[2].str, strlen(argv[2].str));
+    sink = tftp_bio_sink_open(argv[4].str, offset);
+    if (!sink)
+        return 0;
+
+    ret = tftp_get(host, argv[3].str, &tftp_bio_sink_callback, sink);
+    if (ret >= 0)
+        ret = tftp_bio_sink_result(sink);
+    tftp_bio_sink_close(sink);
+
+    if (ret < 0)
+        printf("fetch of %s failed: %d\n", argv[3].str, ret);
+    return 0;
+}
+
 static int loader(int argc, const cmd_args *argv)
 {
     static int any_slot = 0;
@@ -169,7 +230,19 @@ static int loader(int argc, const cmd_args *argv)
 usage:
         printf("load any [filename] <slot>\n"
                "load elf [filename] <slot>\n"
-               "protocol is tftp and <slot> is optional\n");
+               "load bio [filename] [device] <offset>\n"
+               "load fetch [host] [filename] [device] <offset>\n"
+               "protocol is tftp, <slot> and <offset> are optional\n");
+        return 0;
+    }
+
+    if (strcmp(argv[1].str, "bio") == 0) {
+        if (load_bio(argc, argv) < 0)
+            goto usage;
+        return 0;
+    } else if (strcmp(argv[1].str, "fetch") == 0) {
+        if (load_fetch(argc, argv) < 0)
+            goto usage;
         return 0;
     }
 
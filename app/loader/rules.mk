@@ -7,7 +7,9 @@ MODULE_SRCS += \
 
 
 MODULE_DEPS := \
+    lib/bio \
     lib/cksum \
+    lib/minip \
     lib/tftp  \
     lib/elf
 
@@ -20,7 +20,7 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-#if ARM_WITH_CACHE
+#if ARM_WITH_CACHE || ARCH_ARM64
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -30,6 +30,9 @@
 #include <arch/ops.h>
 #include <lib/console.h>
 #include <platform.h>
+#if ARCH_ARM64
+#include <arch/dma_sync.h>
+#endif
 
 static void bench_cache(size_t bufsize, uint8_t *buf)
 {
@@ -52,7 +55,7 @@ static void bench_cache(size_t bufsize, uint8_t *buf)
     arch_clean_cache_range((addr_t)buf, bufsize);
     t = current_time_hires() - t;
 
-    printf("took %llu usecs to clean %d bytes (cold)\n", t, bufsize);
+    printf("took %llu usecs to clean %zu bytes (cold)\n", t, bufsize);
 
     memset(buf, 0x99, bufsize);
 
@@ -63,7 +66,7 @@ static void bench_cache(size_t bufsize, uint8_t *buf)
     if (do_free)
         free(buf);
 
-    printf("took %llu usecs to clean %d bytes (hot)\n", t, bufsize);
+    printf("took %llu usecs to clean %zu bytes (hot)\n", t, bufsize);
 }
 
 static int cache_tests(int argc, const cmd_args *argv)
@@ -81,8 +84,84 @@ static int cache_tests(int argc, const cmd_args *argv)
     return 0;
 }
 
+#if ARCH_ARM64
+enum {
+    SYNC_CLEAN_RANGE,
+    SYNC_CLEAN_INV_RANGE,
+    SYNC_SETWAY,
+    SYNC_AUTO,
+    SYNC_STRATEGIES,
+};
+
+static lk_bigtime_t time_sync(int strategy, uint8_t *buf, size_t len)
+{
+    lk_bigtime_t t;
+
+    /* every strategy starts from a buffer full of dirty lines */
+    memset(buf, 0x5a, len);
+
+    t = current_time_hires();
+    switch (strategy) {
+        case SYNC_CLEAN_RANGE:
+            arch_clean_cache_range((addr_t)buf, len);
+            break;
+        case SYNC_CLEAN_INV_RANGE:
+            arch_clean_invalidate_cache_range((addr_t)buf, len);
+            break;
+        case SYNC_SETWAY:
+            arch_clean_and_invalidate_dcache_all();
+            break;
+        case SYNC_AUTO:
+            dma_sync_for_device(buf, len, DMA_SYNC_BIDIRECTIONAL);
+            break;
+    }
+
+    return current_time_hires() - t;
+}
+
+static int dma_sync_bench(int argc, const cmd_args *argv)
+{
+    static const size_t sizes[] = {
+        64*1024, 256*1024, 1024*1024, 4*1024*1024, 16*1024*1024, 64*1024*1024,
+    };
+    lk_bigtime_t ns_per_mb[SYNC_STRATEGIES];
+
+    printf("ns per MB:\n");
+    printf("%10s %10s %10s %10s %10s\n", "size", "dc cvac", "dc civac", "set/way", "dma_sync");
+
+    for (unsigned int i = 0; i < countof(sizes); i++) {
+        size_t len = sizes[i];
+        uint8_t *buf = memalign(PAGE_SIZE, len);
+
+        if (!buf) {
+            printf("%8zuKB: no memory\n", len / 1024);
+            break;
+        }
+
+        for (int s = 0; s < SYNC_STRATEGIES; s++) {
+            lk_bigtime_t best = ~0ULL;
+
+            for (int round = 0; round < 3; round++)
+                best = MIN(best, time_sync(s, buf, len));
+            ns_per_mb[s] = best * 1000 * (1024 * 1024) / len;
+        }
+
+        printf("%8zuKB %10llu %10llu %10llu %10llu\n", len / 1024,
+               ns_per_mb[SYNC_CLEAN_RANGE], ns_per_mb[SYNC_CLEAN_INV_RANGE],
+               ns_per_mb[SYNC_SETWAY], ns_per_mb[SYNC_AUTO]);
+
+        free(buf);
+    }
+
+    return 0;
+}
+#endif
+
 STATIC_COMMAND_START
 STATIC_COMMAND("cache_tests", "test/bench the cpu cache", &cache_tests)
+#if ARCH_ARM64
+STATIC_COMMAND("dma_sync_bench", "bench the dma cache sync strategies", &dma_sync_bench)
+#endif
 STATIC_COMMAND_END(cache_tests);
 
 #endif
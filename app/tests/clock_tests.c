@@ -28,7 +28,66 @@
 #include <kernel/mutex.h>
 #include <kernel/semaphore.h>
 #include <kernel/event.h>
+#include <kernel/hrtimer.h>
 #include <platform.h>
+#include <platform/timer.h>
+
+#if PLATFORM_HAS_HIRES_TIMER
+#define HRTIMER_TEST_COUNT 16
+
+static uint64_t hrtimer_fired[HRTIMER_TEST_COUNT];
+static volatile int hrtimer_fired_count;
+
+static enum handler_return hrtimer_test_cb(hrtimer_t *t, uint64_t now, void *arg)
+{
+    hrtimer_fired[(uintptr_t)arg] = now;
+    hrtimer_fired_count++;
+
+    return INT_NO_RESCHEDULE;
+}
+
+static void hrtimer_tests(void)
+{
+    static hrtimer_t timers[HRTIMER_TEST_COUNT];
+    uint64_t start, late;
+    int i;
+
+    printf("hrtimer sleep latency\n");
+    for (uint64_t us = 10; us <= 10000; us *= 10) {
+        start = current_time_ns();
+        hrtimer_sleep_us(us);
+        late = current_time_ns() - start - us * 1000;
+        printf("\tsleep %llu us: %llu ns late\n", us, late);
+    }
+
+    printf("hrtimer ordering, odd timers canceled\n");
+    hrtimer_fired_count = 0;
+    start = current_time_ns();
+    for (i = 0; i < HRTIMER_TEST_COUNT; i++) {
+        hrtimer_initialize(&timers[i]);
+        hrtimer_fired[i] = 0;
+        /* armed in scrambled order */
+        hrtimer_set_deadline(&timers[i], start + 1000000 + ((i * 7) % HRTIMER_TEST_COUNT) * 50000,
+                             hrtimer_test_cb, (void *)(uintptr_t)i);
+    }
+    for (i = 1; i < HRTIMER_TEST_COUNT; i += 2)
+        hrtimer_cancel(&timers[i]);
+
+    thread_sleep(10);
+
+    for (i = 0; i < HRTIMER_TEST_COUNT; i++) {
+        uint64_t deadline = start + 1000000 + ((i * 7) % HRTIMER_TEST_COUNT) * 50000;
+
+        if (i & 1) {
+            if (hrtimer_fired[i])
+                printf("\tFAIL: canceled timer %d fired\n", i);
+        } else if (hrtimer_fired[i] < deadline) {
+            printf("\tFAIL: timer %d fired %llu ns early\n", i, deadline - hrtimer_fired[i]);
+        }
+    }
+    printf("\t%d of %d timers fired\n", hrtimer_fired_count, HRTIMER_TEST_COUNT / 2);
+}
+#endif
 
 int clock_tests(int argc, const cmd_args *argv)
 {
@@ -114,5 +173,9 @@ int clock_tests(int argc, const cmd_args *argv)
         printf("%u cycles per second\n", cycles);
     }
 
+#if PLATFORM_HAS_HIRES_TIMER
+    hrtimer_tests();
+#endif
+
     return NO_ERROR;
 }
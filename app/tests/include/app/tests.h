@@ -30,10 +30,14 @@ int fibo(int argc, const cmd_args *argv);
 int port_tests(int argc, const cmd_args *argv);
 int spinner(int argc, const cmd_args *argv);
 int thread_tests(int argc, const cmd_args *argv);
+int sched_bench(int argc, const cmd_args *argv);
 int benchmarks(int argc, const cmd_args *argv);
 int clock_tests(int argc, const cmd_args *argv);
 int printf_tests(int argc, const cmd_args *argv);
 int printf_tests_float(int argc, const cmd_args *argv);
+int workqueue_tests(int argc, const cmd_args *argv);
+int sysparam_tests(int argc, const cmd_args *argv);
+int sysparam_bench(int argc, const cmd_args *argv);
 
 #endif
 
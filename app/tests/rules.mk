@@ -13,14 +13,17 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/float_test_vec.c \
     $(LOCAL_DIR)/mem_tests.c \
     $(LOCAL_DIR)/printf_tests.c \
+    $(LOCAL_DIR)/sysparam_tests.c \
     $(LOCAL_DIR)/tests.c \
     $(LOCAL_DIR)/thread_tests.c \
     $(LOCAL_DIR)/port_tests.c \
+    $(LOCAL_DIR)/workqueue_tests.c \
 
 MODULE_ARM_OVERRIDE_SRCS := \
 
 MODULE_DEPS += \
-    lib/cbuf
+    lib/cbuf \
+    lib/unittest
 
 MODULE_COMPILEFLAGS += -Wno-format -fno-builtin
 
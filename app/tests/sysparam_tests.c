@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <app/tests.h>
+#include <platform.h>
+
+#if WITH_LIB_SYSPARAM
+#include <lib/bio.h>
+#include <lib/sysparam.h>
+#endif
+
+#if WITH_LIB_SYSPARAM && SYSPARAM_ALLOW_WRITE
+#include <unittest.h>
+
+#define SP_TEST_DEV "sysparam_test"
+#define SP_TEST_SIZE (64 * 1024)
+#define SP_TEST_PARAMS 32
+#define SP_TEST_DATALEN 32
+#define SP_BENCH_UPDATES 200
+#define SP_BENCH_LOOKUPS 10000
+
+/* the board's own parameters, scanned again once the tests are done */
+static struct {
+    bdev_t *dev;        /* the test device, open while sysparam uses it */
+    bool valid;
+    bdev_t *bdev;
+    off_t offset;
+    size_t len;
+} sp_saved;
+
+static bdev_t *sp_open_dev(void)
+{
+    static void *mem;
+    bdev_t *dev;
+
+    /* the memory device is created once and left registered */
+    dev = bio_open(SP_TEST_DEV);
+    if (dev)
+        return dev;
+
+    mem = malloc(SP_TEST_SIZE);
+    if (!mem)
+        return NULL;
+    create_membdev(SP_TEST_DEV, mem, SP_TEST_SIZE);
+
+    return bio_open(SP_TEST_DEV);
+}
+
+static void sp_name(char *name, int i)
+{
+    snprintf(name, 16, "param%02d", i);
+}
+
+static void sp_value(uint8_t *value, int i, int gen)
+{
+    for (int j = 0; j < SP_TEST_DATALEN; j++)
+        value[j] = i * 7 + gen * 13 + j;
+}
+
+static status_t sp_update(const char *name, const void *value, size_t len)
+{
+    status_t err = sysparam_remove(name);
+    if (err < 0 && err != ERR_NOT_FOUND)
+        return err;
+
+    return sysparam_add(name, value, len);
+}
+
+/* does param i hold the value of generation gen */
+static bool sp_check(int i, int gen)
+{
+    uint8_t value[SP_TEST_DATALEN], expected[SP_TEST_DATALEN];
+    char name[16];
+
+    sp_name(name, i);
+    sp_value(expected, i, gen);
+    if (sysparam_read(name, value, sizeof(value)) != SP_TEST_DATALEN)
+        return false;
+
+    return memcmp(value, expected, SP_TEST_DATALEN) == 0;
+}
+
+/* the tests take over the parameters until sp_restore() */
+static bool sp_populate(void)
+{
+    BEGIN_TEST;
+
+    /* still open after an earlier run with nothing to go back to */
+    if (!sp_saved.dev) {
+        sp_saved.dev = sp_open_dev();
+        ASSERT_NOT_NULL(sp_saved.dev);
+        sp_saved.valid = sysparam_get_area(&sp_saved.bdev, &sp_saved.offset,
+                                           &sp_saved.len) == NO_ERROR;
+    }
+
+    bdev_t *dev = sp_saved.dev;
+    uint8_t value[SP_TEST_DATALEN];
+    char name[16];
+
+    EXPECT_EQ(SP_TEST_SIZE, bio_erase(dev, 0, SP_TEST_SIZE), "erase");
+    EXPECT_EQ(NO_ERROR, sysparam_scan(dev, 0, SP_TEST_SIZE), "scan");
+
+    for (int i = 0; i < SP_TEST_PARAMS; i++) {
+        sp_name(name, i);
+        sp_value(value, i, 0);
+        EXPECT_EQ(NO_ERROR, sysparam_add(name, value, sizeof(value)), "add");
+    }
+    EXPECT_EQ(NO_ERROR, sysparam_write(), "write");
+    EXPECT_EQ(NO_ERROR, sysparam_reload(), "reload");
+    for (int i = 0; i < SP_TEST_PARAMS; i++)
+        EXPECT_TRUE(sp_check(i, 0), "value after reload");
+
+    END_TEST;
+}
+
+static bool sp_update_remove_lock(void)
+{
+    BEGIN_TEST;
+
+    uint8_t value[SP_TEST_DATALEN];
+
+    sp_value(value, 1, 1);
+    EXPECT_EQ(NO_ERROR, sp_update("param01", value, sizeof(value)), "update");
+    EXPECT_EQ(NO_ERROR, sysparam_remove("param02"), "remove");
+    EXPECT_EQ(NO_ERROR, sysparam_lock("param03"), "lock");
+    EXPECT_EQ(NO_ERROR, sysparam_add("scratch", "x", 1), "add");
+    EXPECT_EQ(NO_ERROR, sysparam_remove("scratch"), "remove unwritten");
+    EXPECT_EQ(NO_ERROR, sysparam_write(), "write");
+    EXPECT_EQ(NO_ERROR, sysparam_reload(), "reload");
+
+    EXPECT_TRUE(sp_check(0, 0), "untouched value");
+    EXPECT_TRUE(sp_check(1, 1), "updated value");
+    EXPECT_EQ(ERR_NOT_FOUND, sysparam_length("param02"), "removed");
+    EXPECT_EQ(ERR_NOT_FOUND, sysparam_length("scratch"), "never written");
+    EXPECT_EQ(ERR_NOT_ALLOWED, sysparam_remove("param03"), "locked");
+
+    END_TEST;
+}
+
+static bool sp_compaction(void)
+{
+    BEGIN_TEST;
+
+    uint8_t value[SP_TEST_DATALEN];
+    struct sysparam_stats before, after;
+    int gen;
+
+    /* update one key until the log is full and gets compacted */
+    sysparam_get_stats(&before);
+    after = before;
+    for (gen = 2; gen < 2 + SP_TEST_SIZE / SP_TEST_DATALEN; gen++) {
+        sp_value(value, 4, gen);
+        if (sp_update("param04", value, sizeof(value)) < 0 || sysparam_write() < 0)
+            break;
+        sysparam_get_stats(&after);
+        if (after.compactions != before.compactions)
+            break;
+    }
+    EXPECT_EQ(before.compactions + 1, after.compactions, "compactions");
+
+    EXPECT_EQ(NO_ERROR, sysparam_reload(), "reload");
+    EXPECT_TRUE(sp_check(4, gen), "last update");
+    EXPECT_TRUE(sp_check(1, 1), "earlier update");
+    EXPECT_EQ(ERR_NOT_FOUND, sysparam_length("param02"), "removed");
+    EXPECT_EQ(ERR_NOT_ALLOWED, sysparam_remove("param03"), "locked");
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(sysparam_log_tests);
+RUN_TEST(sp_populate);
+RUN_TEST(sp_update_remove_lock);
+RUN_TEST(sp_compaction);
+END_TEST_CASE(sysparam_log_tests);
+
+/* hand sysparam back the parameters it had before the tests */
+static void sp_restore(void)
+{
+    if (!sp_saved.dev || !sp_saved.valid)
+        return;
+
+    if (sysparam_scan(sp_saved.bdev, sp_saved.offset, sp_saved.len) < 0)
+        printf("sysparam tests: failed to scan the original parameters again\n");
+
+    bio_close(sp_saved.dev);
+    sp_saved.dev = NULL;
+}
+
+int sysparam_tests(int argc, const cmd_args *argv)
+{
+    bool passed = sysparam_log_tests();
+
+    sp_restore();
+    return passed ? NO_ERROR : ERR_GENERIC;
+}
+
+static void sysparam_bench_updates(const char *label, status_t (*commit)(void))
+{
+    uint8_t value[SP_TEST_DATALEN];
+    struct sysparam_stats before, after;
+    lk_bigtime_t t;
+
+    sysparam_get_stats(&before);
+    t = current_time_hires();
+    for (int gen = 0; gen < SP_BENCH_UPDATES; gen++) {
+        sp_value(value, 5, gen);
+        sp_update("param05", value, sizeof(value));
+        commit();
+    }
+    t = current_time_hires() - t;
+    sysparam_get_stats(&after);
+
+    printf("\t%s: %llu us per update, %llu bytes written and %llu erased per update, %u compactions\n",
+           label, t / SP_BENCH_UPDATES,
+           (after.bytes_written - before.bytes_written) / SP_BENCH_UPDATES,
+           (after.bytes_erased - before.bytes_erased) / SP_BENCH_UPDATES,
+           after.compactions - before.compactions);
+}
+
+int sysparam_bench(int argc, const cmd_args *argv)
+{
+    char name[16];
+    lk_bigtime_t t;
+
+    /* the parameters the tests leave behind */
+    if (!sysparam_log_tests()) {
+        sp_restore();
+        return ERR_GENERIC;
+    }
+
+    printf("benchmarks, %u params of %u bytes in %u KB\n",
+           SP_TEST_PARAMS, SP_TEST_DATALEN, SP_TEST_SIZE / 1024);
+
+    /* the whole area every time, as writes were before the log */
+    sysparam_bench_updates("full rewrite", sysparam_write_full);
+    sysparam_bench_updates("log append", sysparam_write);
+    if (sysparam_reload() < 0 || !sp_check(5, SP_BENCH_UPDATES - 1)) {
+        printf("sysparam bench: wrong value after reload\n");
+        sp_restore();
+        return ERR_GENERIC;
+    }
+
+    t = current_time_hires();
+    sysparam_reload();
+    t = current_time_hires() - t;
+    printf("\tscan: %llu us\n", t);
+
+    t = current_time_hires();
+    for (int i = 0; i < SP_BENCH_LOOKUPS; i++) {
+        sp_name(name, i % SP_TEST_PARAMS);
+        sysparam_length(name);
+    }
+    t = current_time_hires() - t;
+    printf("\tlookup: %llu ns\n", t * 1000 / SP_BENCH_LOOKUPS);
+
+    sp_restore();
+    return NO_ERROR;
+}
+
+#else
+
+int sysparam_tests(int argc, const cmd_args *argv)
+{
+    printf("needs lib/sysparam with SYSPARAM_ALLOW_WRITE\n");
+    return ERR_NOT_SUPPORTED;
+}
+
+int sysparam_bench(int argc, const cmd_args *argv)
+{
+    return sysparam_tests(argc, argv);
+}
+
+#endif
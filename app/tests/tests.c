@@ -32,12 +32,16 @@ STATIC_COMMAND_START
 STATIC_COMMAND("printf_tests", "test printf", &printf_tests)
 STATIC_COMMAND("printf_tests_float", "test printf with floating point", &printf_tests_float)
 STATIC_COMMAND("thread_tests", "test the scheduler", &thread_tests)
+STATIC_COMMAND("sched_bench", "scheduler microbenchmarks", &sched_bench)
 STATIC_COMMAND("port_tests", "test the ports", &port_tests)
 STATIC_COMMAND("clock_tests", "test clocks", &clock_tests)
 STATIC_COMMAND("bench", "miscellaneous benchmarks", &benchmarks)
 STATIC_COMMAND("fibo", "threaded fibonacci", &fibo)
 STATIC_COMMAND("spinner", "create a spinning thread", &spinner)
 STATIC_COMMAND("cbuf_tests", "test lib/cbuf", &cbuf_tests)
+STATIC_COMMAND("workqueue_tests", "test and benchmark lib/workqueue", &workqueue_tests)
+STATIC_COMMAND("sysparam_tests", "test lib/sysparam on a memory device", &sysparam_tests)
+STATIC_COMMAND("sysparam_bench", "benchmark lib/sysparam on a memory device", &sysparam_bench)
 STATIC_COMMAND_END(tests);
 
 #endif
@@ -25,12 +25,14 @@
 #include <rand.h>
 #include <err.h>
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <app/tests.h>
 #include <kernel/thread.h>
 #include <kernel/mutex.h>
 #include <kernel/semaphore.h>
 #include <kernel/event.h>
+#include <kernel/mp.h>
 #include <platform.h>
 
 static int sleep_thread(void *arg)
@@ -616,6 +618,180 @@ static void spinlock_test(void)
 #undef COUNT
 }
 
+/* scheduler microbenchmarks */
+#define PING_PONG_ITERS 10000
+#define WAKE_ITERS 1000
+#define THROUGHPUT_WORK 4096
+
+struct ping_pong {
+    event_t ping;
+    event_t pong;
+    lk_bigtime_t signaled;
+    lk_bigtime_t latency_total;
+    lk_bigtime_t latency_max;
+};
+
+static int pong_thread(void *arg)
+{
+    struct ping_pong *pp = arg;
+
+    for (int i = 0; i < PING_PONG_ITERS; i++) {
+        event_wait(&pp->ping);
+        event_signal(&pp->pong, true);
+    }
+
+    return 0;
+}
+
+static void ping_pong_bench(int ping_cpu, int pong_cpu)
+{
+    struct ping_pong pp;
+#if WITH_SMP
+    thread_t *me = get_current_thread();
+    int old_pin = thread_pinned_cpu(me);
+#endif
+
+    event_init(&pp.ping, false, EVENT_FLAG_AUTOUNSIGNAL);
+    event_init(&pp.pong, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+    thread_t *t = thread_create("pong", &pong_thread, &pp, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    thread_set_pinned_cpu(t, pong_cpu);
+#if WITH_SMP
+    thread_set_pinned_cpu(me, ping_cpu);
+#endif
+    thread_resume(t);
+    thread_yield();
+
+    lk_bigtime_t start = current_time_hires();
+    for (int i = 0; i < PING_PONG_ITERS; i++) {
+        event_signal(&pp.ping, true);
+        event_wait(&pp.pong);
+    }
+    lk_bigtime_t elapsed = current_time_hires() - start;
+
+    thread_join(t, NULL, INFINITE_TIME);
+#if WITH_SMP
+    thread_set_pinned_cpu(me, old_pin);
+#endif
+    event_destroy(&pp.ping);
+    event_destroy(&pp.pong);
+
+    printf("\tping-pong cpu %d <-> cpu %d: %llu ns per round trip\n",
+           ping_cpu, pong_cpu, elapsed * 1000 / PING_PONG_ITERS);
+}
+
+static int wake_thread(void *arg)
+{
+    struct ping_pong *pp = arg;
+
+    for (int i = 0; i < WAKE_ITERS; i++) {
+        event_wait(&pp->ping);
+
+        lk_bigtime_t latency = current_time_hires() - pp->signaled;
+        pp->latency_total += latency;
+        pp->latency_max = MAX(pp->latency_max, latency);
+
+        event_signal(&pp->pong, false);
+    }
+
+    return 0;
+}
+
+/* from event_signal() in one thread to running in the waiter */
+static void wake_latency_bench(void)
+{
+    struct ping_pong pp;
+
+    memset(&pp, 0, sizeof(pp));
+    event_init(&pp.ping, false, EVENT_FLAG_AUTOUNSIGNAL);
+    event_init(&pp.pong, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+    thread_t *t = thread_create("waker", &wake_thread, &pp, HIGH_PRIORITY, DEFAULT_STACK_SIZE);
+    thread_resume(t);
+
+    for (int i = 0; i < WAKE_ITERS; i++) {
+        /* let the waiter block first */
+        thread_sleep(1);
+        pp.signaled = current_time_hires();
+        event_signal(&pp.ping, true);
+        event_wait(&pp.pong);
+    }
+
+    thread_join(t, NULL, INFINITE_TIME);
+    event_destroy(&pp.ping);
+    event_destroy(&pp.pong);
+
+    printf("\twake latency: %llu us average, %llu us max\n",
+           pp.latency_total / WAKE_ITERS, pp.latency_max);
+}
+
+static volatile int throughput_left;
+
+static int throughput_thread(void *arg)
+{
+    volatile uint32_t x = 0;
+
+    /* units of cpu work, yielding in between to exercise the run queues */
+    while (atomic_add(&throughput_left, -1) > 0) {
+        for (int i = 0; i < 10000; i++)
+            x += i;
+        thread_yield();
+    }
+
+    return 0;
+}
+
+static void throughput_bench(void)
+{
+    thread_t *threads[SMP_MAX_CPUS * 2];
+    lk_bigtime_t base = 0;
+
+    for (uint n = 1; n <= SMP_MAX_CPUS * 2; n *= 2) {
+        throughput_left = THROUGHPUT_WORK;
+
+        lk_bigtime_t start = current_time_hires();
+        for (uint i = 0; i < n; i++) {
+            threads[i] = thread_create("throughput", &throughput_thread, NULL,
+                                       DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+            thread_resume(threads[i]);
+        }
+        for (uint i = 0; i < n; i++)
+            thread_join(threads[i], NULL, INFINITE_TIME);
+        lk_bigtime_t elapsed = current_time_hires() - start;
+
+        if (n == 1)
+            base = elapsed;
+        printf("\tthroughput, %u threads: %llu us, %llu.%02llu x one thread\n", n, elapsed,
+               base / elapsed, (base * 100 / elapsed) % 100);
+    }
+}
+
+int sched_bench(int argc, const cmd_args *argv)
+{
+    printf("scheduler benchmarks\n");
+
+    ping_pong_bench(0, 0);
+#if WITH_SMP
+    for (uint cpu = 1; cpu < SMP_MAX_CPUS; cpu++) {
+        if (mp_is_cpu_active(cpu)) {
+            ping_pong_bench(0, cpu);
+            break;
+        }
+    }
+#endif
+    wake_latency_bench();
+    throughput_bench();
+
+#if THREAD_STATS && WITH_SMP
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        if (mp_is_cpu_active(cpu))
+            printf("\tcpu %u: %lu steals\n", cpu, thread_stats[cpu].steals);
+    }
+#endif
+
+    return 0;
+}
+
 int thread_tests(int argc, const cmd_args *argv)
 {
     mutex_test();
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rand.h>
+#include <err.h>
+#include <app/tests.h>
+#include <arch/ops.h>
+#include <kernel/thread.h>
+#include <platform.h>
+
+#if WITH_LIB_WORKQUEUE
+#include <lib/workqueue.h>
+
+#define WQ_TEST_WORKS 64
+#define WQ_TEST_RANGE 4096
+#define WQ_BENCH_SIZE (16 * 1024 * 1024)
+
+static int wq_failures;
+
+#define EXPECT(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("\tFAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            wq_failures++; \
+        } \
+    } while (0)
+
+static volatile int wq_hits[WQ_TEST_RANGE];
+
+static int square(void *arg)
+{
+    int v = (int)(uintptr_t)arg;
+
+    /* long enough for the workers to overlap */
+    spin(10);
+
+    return v * v;
+}
+
+static void count_hits(void *arg, size_t start, size_t end)
+{
+    EXPECT(end > start);
+
+    for (size_t i = start; i < end; i++)
+        atomic_add(&wq_hits[i], 1);
+}
+
+static void nested_hits(void *arg, size_t start, size_t end)
+{
+    for (size_t i = start; i < end; i++)
+        parallel_for(i * 64, (i + 1) * 64, 5, count_hits, NULL);
+}
+
+static void check_hits(size_t start, size_t end)
+{
+    for (size_t i = 0; i < WQ_TEST_RANGE; i++)
+        EXPECT(wq_hits[i] == (i >= start && i < end));
+}
+
+static void workqueue_unit_tests(void)
+{
+    static struct work works[WQ_TEST_WORKS];
+    struct work_completion c;
+    int result;
+
+    printf("futures\n");
+    for (int i = 0; i < WQ_TEST_WORKS; i++) {
+        work_init(&works[i], square, (void *)(uintptr_t)i);
+        work_submit(&works[i]);
+    }
+    for (int i = 0; i < WQ_TEST_WORKS; i++) {
+        EXPECT(work_wait(&works[i], INFINITE_TIME, &result) == NO_ERROR);
+        EXPECT(result == i * i);
+        /* done, nothing left to take back */
+        EXPECT(!work_cancel(&works[i]));
+    }
+
+    printf("reuse\n");
+    work_submit(&works[0]);
+    EXPECT(work_wait(&works[0], INFINITE_TIME, &result) == NO_ERROR);
+    EXPECT(result == 0);
+    for (int i = 0; i < WQ_TEST_WORKS; i++)
+        work_destroy(&works[i]);
+
+    printf("completion\n");
+    work_completion_init(&c, 3);
+    EXPECT(work_completion_wait(&c, 0) == ERR_TIMED_OUT);
+    work_completion_signal(&c);
+    work_completion_signal(&c);
+    EXPECT(work_completion_wait(&c, 0) == ERR_TIMED_OUT);
+    work_completion_signal(&c);
+    EXPECT(work_completion_wait(&c, 0) == NO_ERROR);
+    work_completion_destroy(&c);
+
+    printf("parallel_for\n");
+    memset((void *)wq_hits, 0, sizeof(wq_hits));
+    parallel_for(10, 10, 1, count_hits, NULL);
+    parallel_for(20, 10, 1, count_hits, NULL);
+    check_hits(0, 0);
+
+    for (int i = 0; i < 100; i++) {
+        size_t end = rand() % (WQ_TEST_RANGE + 1);
+        size_t start = rand() % (end + 1);
+        size_t grain = rand() % 300;
+
+        memset((void *)wq_hits, 0, sizeof(wq_hits));
+        parallel_for(start, end, grain, count_hits, NULL);
+        check_hits(start, end);
+    }
+
+    printf("nested parallel_for\n");
+    memset((void *)wq_hits, 0, sizeof(wq_hits));
+    parallel_for(0, WQ_TEST_RANGE / 64, 1, nested_hits, NULL);
+    check_hits(0, WQ_TEST_RANGE);
+}
+
+static void fill_range(void *arg, size_t start, size_t end)
+{
+    memset((uint8_t *)arg + start, 0x5a, end - start);
+}
+
+static uint32_t wq_sums[SMP_MAX_CPUS];
+
+static void sum_range(void *arg, size_t start, size_t end)
+{
+    const uint32_t *p = arg;
+    uint32_t sum = 0;
+
+    for (size_t i = start; i < end; i++)
+        sum += p[i] * (uint32_t)i;
+
+    atomic_add((volatile int *)&wq_sums[arch_curr_cpu_num()], sum);
+}
+
+static int nop(void *arg)
+{
+    return 0;
+}
+
+static void workqueue_bench(void)
+{
+    uint8_t *buf = malloc(WQ_BENCH_SIZE);
+    static struct work w;
+    uint32_t serial = 0, parallel = 0;
+    lk_bigtime_t t;
+
+    if (!buf) {
+        printf("no memory for the benchmark\n");
+        return;
+    }
+
+    printf("benchmarks, concurrency %u\n", workqueue_concurrency());
+
+    t = current_time_hires();
+    for (int i = 0; i < 1000; i++) {
+        work_init(&w, nop, NULL);
+        work_submit(&w);
+        work_wait(&w, INFINITE_TIME, NULL);
+        work_destroy(&w);
+    }
+    /* us for 1000 works is ns for one */
+    printf("\tsubmit and wait: %llu ns per work\n", current_time_hires() - t);
+
+    t = current_time_hires();
+    memset(buf, 0x5a, WQ_BENCH_SIZE);
+    t = current_time_hires() - t;
+    printf("\tmemset %u MB: %llu us\n", WQ_BENCH_SIZE >> 20, t);
+
+    for (size_t grain = 64 * 1024; grain <= 4 * 1024 * 1024; grain *= 4) {
+        t = current_time_hires();
+        parallel_for(0, WQ_BENCH_SIZE, grain, fill_range, buf);
+        t = current_time_hires() - t;
+        printf("\tparallel memset, %zu KB chunks: %llu us\n", grain / 1024, t);
+    }
+
+    t = current_time_hires();
+    memset(wq_sums, 0, sizeof(wq_sums));
+    sum_range(buf, 0, WQ_BENCH_SIZE / 4);
+    t = current_time_hires() - t;
+    for (int i = 0; i < SMP_MAX_CPUS; i++)
+        serial += wq_sums[i];
+    printf("\tweighted sum: %llu us\n", t);
+
+    t = current_time_hires();
+    memset(wq_sums, 0, sizeof(wq_sums));
+    parallel_for(0, WQ_BENCH_SIZE / 4, 64 * 1024, sum_range, buf);
+    t = current_time_hires() - t;
+    for (int i = 0; i < SMP_MAX_CPUS; i++)
+        parallel += wq_sums[i];
+    printf("\tparallel weighted sum: %llu us\n", t);
+    EXPECT(serial == parallel);
+
+    free(buf);
+}
+
+int workqueue_tests(int argc, const cmd_args *argv)
+{
+    struct workqueue_stats stats;
+
+    wq_failures = 0;
+
+    workqueue_unit_tests();
+    if (argc < 2 || strcmp(argv[1].str, "nobench"))
+        workqueue_bench();
+
+    workqueue_get_stats(&stats);
+    printf("executed %llu, stolen %llu, inline %llu\n",
+           stats.executed, stats.stolen, stats.inline_runs);
+
+    if (wq_failures) {
+        printf("workqueue tests: %d failures\n", wq_failures);
+        return ERR_GENERIC;
+    }
+
+    printf("workqueue tests passed\n");
+    return NO_ERROR;
+}
+
+#else
+
+int workqueue_tests(int argc, const cmd_args *argv)
+{
+    printf("needs lib/workqueue\n");
+    return ERR_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  DMA cache synchronization
+ *
+ * Everything is maintained by VA. Set/way operations are local to one
+ * cpu and are not architecturally valid for coherency with other
+ * masters, so they are never used here even for large ranges. What is
+ * saved instead is redundant work: the op is picked from the direction,
+ * overlapping ranges of one transfer are merged, uncached regions are
+ * skipped and a batch ends with a single barrier.
+ */
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <stdlib.h>
+#include <arch/ops.h>
+#include <arch/arm64.h>
+#include <arch/dma_sync.h>
+
+#define LOCAL_TRACE 0
+
+#define DMA_SYNC_UNCACHED_MAX 8
+
+enum {
+    DMA_OP_NONE,
+    DMA_OP_CLEAN,
+    DMA_OP_CLEAN_INV,
+    DMA_OP_INV,
+};
+
+static struct {
+    addr_t start;
+    addr_t end;
+} dma_uncached[DMA_SYNC_UNCACHED_MAX];
+static unsigned int dma_uncached_count;
+
+#define DC_RANGE(op, start, end) \
+    do { \
+        for (addr_t _a = (start); _a < (end); _a += CACHE_LINE) \
+            __asm__ volatile("dc " #op ", %0" :: "r" (_a) : "memory"); \
+    } while (0)
+
+static int dma_sync_op(bool for_device, enum dma_sync_dir dir)
+{
+    if (for_device)
+        return dir == DMA_SYNC_TO_DEVICE ? DMA_OP_CLEAN : DMA_OP_CLEAN_INV;
+
+    /* nothing can have been pulled into the cache for a TO_DEVICE buffer */
+    return dir == DMA_SYNC_TO_DEVICE ? DMA_OP_NONE : DMA_OP_INV;
+}
+
+static bool dma_is_uncached(addr_t start, addr_t end)
+{
+    for (unsigned int i = 0; i < dma_uncached_count; i++) {
+        if (start >= dma_uncached[i].start && end <= dma_uncached[i].end)
+            return true;
+    }
+
+    return false;
+}
+
+/* [start, end) is cache line aligned, no barrier */
+static void dma_range_op(int op, addr_t start, addr_t end)
+{
+    switch (op) {
+        case DMA_OP_CLEAN:
+            DC_RANGE(cvac, start, end);
+            break;
+        case DMA_OP_CLEAN_INV:
+            DC_RANGE(civac, start, end);
+            break;
+        case DMA_OP_INV:
+            /*
+             * The first and last line may be shared with data the cpu
+             * wrote meanwhile, write those back instead of dropping them.
+             */
+            DC_RANGE(civac, start, start + CACHE_LINE);
+            if (end - start > CACHE_LINE)
+                DC_RANGE(civac, end - CACHE_LINE, end);
+            if (end - start > 2 * CACHE_LINE)
+                DC_RANGE(ivac, start + CACHE_LINE, end - CACHE_LINE);
+            break;
+    }
+}
+
+void dma_sync_batch_init(struct dma_sync_batch *batch, bool for_device, enum dma_sync_dir dir)
+{
+    batch->op = dma_sync_op(for_device, dir);
+    batch->count = 0;
+    batch->total = 0;
+}
+
+void dma_sync_batch_add(struct dma_sync_batch *batch, const void *ptr, size_t len)
+{
+    addr_t start = ROUNDDOWN((addr_t)ptr, CACHE_LINE);
+    addr_t end = ROUNDUP((addr_t)ptr + len, CACHE_LINE);
+    unsigned int i;
+
+    if (batch->op == DMA_OP_NONE || len == 0 || dma_is_uncached(start, end))
+        return;
+
+    for (i = 0; i < batch->count; i++) {
+        if (start <= batch->range[i].end && end >= batch->range[i].start) {
+            batch->total -= batch->range[i].end - batch->range[i].start;
+            batch->range[i].start = MIN(batch->range[i].start, start);
+            batch->range[i].end = MAX(batch->range[i].end, end);
+            batch->total += batch->range[i].end - batch->range[i].start;
+            return;
+        }
+    }
+
+    /* out of slots, syncing early is harmless as long as it is before the dma */
+    if (batch->count == DMA_SYNC_BATCH_MAX)
+        dma_sync_batch_commit(batch);
+
+    batch->range[batch->count].start = start;
+    batch->range[batch->count].end = end;
+    batch->count++;
+    batch->total += end - start;
+}
+
+void dma_sync_batch_commit(struct dma_sync_batch *batch)
+{
+    if (!batch->count)
+        return;
+
+    LTRACEF("op %d, %u ranges, %zu bytes\n", batch->op, batch->count, batch->total);
+
+    for (unsigned int i = 0; i < batch->count; i++)
+        dma_range_op(batch->op, batch->range[i].start, batch->range[i].end);
+    DSB;
+
+    batch->count = 0;
+    batch->total = 0;
+}
+
+static void dma_sync(bool for_device, const void *ptr, size_t len, enum dma_sync_dir dir)
+{
+    struct dma_sync_batch batch;
+
+    dma_sync_batch_init(&batch, for_device, dir);
+    dma_sync_batch_add(&batch, ptr, len);
+    dma_sync_batch_commit(&batch);
+}
+
+void dma_sync_for_device(const void *ptr, size_t len, enum dma_sync_dir dir)
+{
+    dma_sync(true, ptr, len, dir);
+}
+
+void dma_sync_for_cpu(const void *ptr, size_t len, enum dma_sync_dir dir)
+{
+    dma_sync(false, ptr, len, dir);
+}
+
+status_t dma_sync_add_uncached(addr_t start, size_t len)
+{
+    if (dma_uncached_count == DMA_SYNC_UNCACHED_MAX)
+        return ERR_NO_RESOURCES;
+
+    dma_uncached[dma_uncached_count].start = start;
+    dma_uncached[dma_uncached_count].end = start + len;
+    dma_uncached_count++;
+
+    return NO_ERROR;
+}
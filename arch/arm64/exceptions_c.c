@@ -25,6 +25,7 @@
 #include <bits.h>
 #include <arch/arch_ops.h>
 #include <arch/arm64.h>
+#include <kernel/thread.h>
 
 #define SHUTDOWN_ON_FATAL 1
 
@@ -119,6 +120,30 @@ void arm64_sync_exception(struct arm64_iframe_long *iframe)
     panic("die\n");
 }
 
+#if WITH_PROFILER
+/* frame of the irq each cpu is handling, for handlers that sample it */
+static struct arm64_iframe_short *irq_frames[SMP_MAX_CPUS];
+
+extern enum handler_return platform_irq(struct arm64_iframe_short *frame);
+
+enum handler_return arm64_irq(struct arm64_iframe_short *iframe)
+{
+    uint cpu = arch_curr_cpu_num();
+    enum handler_return ret;
+
+    irq_frames[cpu] = iframe;
+    ret = platform_irq(iframe);
+    irq_frames[cpu] = NULL;
+
+    return ret;
+}
+
+struct arm64_iframe_short *arm64_irq_frame(void)
+{
+    return irq_frames[arch_curr_cpu_num()];
+}
+#endif
+
 void arm64_invalid_exception(struct arm64_iframe_long *iframe, unsigned int which)
 {
     printf("invalid exception, which 0x%x\n", which);
@@ -85,5 +85,10 @@ static inline void arm64_fpu_pre_context_switch(struct thread *thread)
 /* overridable syscall handler */
 void arm64_syscall(struct arm64_iframe_long *iframe, bool is_64bit);
 
+#if WITH_PROFILER
+/* Frame of the interrupt being handled on this cpu, NULL outside of one */
+struct arm64_iframe_short *arm64_irq_frame(void);
+#endif
+
 __END_CDECLS
 
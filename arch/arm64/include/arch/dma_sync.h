@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <compiler.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS;
+
+/*
+ * Cache maintenance for buffers shared with bus masters
+ *
+ * Buffers are maintained by VA, one dc op per line, with the op picked
+ * from the direction. Buffers inside a region registered with
+ * dma_sync_add_uncached() are skipped.
+ */
+
+enum dma_sync_dir {
+    DMA_SYNC_TO_DEVICE,         /* cpu wrote, device reads */
+    DMA_SYNC_FROM_DEVICE,       /* device writes, cpu reads */
+    DMA_SYNC_BIDIRECTIONAL,
+};
+
+/* Before handing the buffer to the device */
+void dma_sync_for_device(const void *ptr, size_t len, enum dma_sync_dir dir);
+/* After the device is done with it, before the cpu looks at it */
+void dma_sync_for_cpu(const void *ptr, size_t len, enum dma_sync_dir dir);
+
+/*
+ * Several buffers of one transfer, e.g. descriptors and data. Adjacent
+ * or overlapping ranges are merged and the size threshold applies to
+ * the total, with a single barrier at the end.
+ */
+#define DMA_SYNC_BATCH_MAX 16
+
+struct dma_sync_batch {
+    int op;
+    unsigned int count;
+    size_t total;
+    struct {
+        addr_t start;
+        addr_t end;
+    } range[DMA_SYNC_BATCH_MAX];
+};
+
+void dma_sync_batch_init(struct dma_sync_batch *batch, bool for_device, enum dma_sync_dir dir);
+void dma_sync_batch_add(struct dma_sync_batch *batch, const void *ptr, size_t len);
+void dma_sync_batch_commit(struct dma_sync_batch *batch);
+
+/* Memory mapped non-cacheable, never needs maintenance */
+status_t dma_sync_add_uncached(addr_t start, size_t len);
+
+__END_CDECLS;
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <compiler.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS;
+
+/*
+ * Sampling profiler, built with WITH_PROFILER=1
+ *
+ * A PMU counter of every active cpu is loaded so that it overflows
+ * after a period of events, the overflow interrupt records the pc and
+ * lr it interrupted. Platforms name their PMU interrupt, a PPI, with
+ * ARM_PMU_INT. Without it the samples are taken from a periodic timer
+ * and only time based sampling is available.
+ *
+ * The report symbolizes the samples with a symbol blob generated by the
+ * build next to lk.elf (lk.elf.syms), after it was loaded to memory and
+ * registered with profiler_set_symbols(). Otherwise the raw samples are
+ * dumped for scripts/lkprof.py to symbolize on the host.
+ */
+
+enum profiler_event {
+    PROFILER_CYCLES,
+    PROFILER_INSTRUCTIONS,
+    PROFILER_L1D_MISSES,
+    PROFILER_L2D_MISSES,
+    PROFILER_BRANCH_MISSES,
+    PROFILER_TIMER,         /* no PMU, period is in us */
+};
+
+struct profiler_sample {
+    uint64_t pc;
+    uint64_t lr;
+};
+
+/* Samples kept per cpu, sampling stops on a cpu once they are used up */
+#ifndef PROFILER_SAMPLES
+#define PROFILER_SAMPLES 16384
+#endif
+
+/* Start sampling on every active cpu, one sample every period events */
+status_t profiler_start(enum profiler_event event, uint32_t period);
+void profiler_stop(void);
+
+/* A symbol blob in memory, checked and used until it is replaced */
+status_t profiler_set_symbols(const void *blob, size_t len);
+
+/* Flat profile of the top entries, by pc and by caller */
+void profiler_report(uint top);
+/* Raw samples for scripts/lkprof.py */
+void profiler_dump(void);
+
+__END_CDECLS;
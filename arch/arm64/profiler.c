@@ -0,0 +1,599 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  PMU sampling profiler
+ *
+ * Every sampled cpu programs one PMUv3 counter, the cycle counter for
+ * cycles and event counter 0 for anything else, to overflow after the
+ * sampling period. The overflow interrupt takes the interrupted pc and lr
+ * from the irq frame and reloads the counter. Samples go to a buffer of
+ * the cpu that took them, nothing is shared between cpus while sampling.
+ */
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arch/ops.h>
+#include <arch/arm64.h>
+#include <arch/profiler.h>
+#include <kernel/hrtimer.h>
+#include <kernel/mp.h>
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <platform.h>
+#include <platform/interrupts.h>
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+#endif
+
+#define LOCAL_TRACE 0
+
+#define PROFILER_SYMBLOB_MAGIC      0x59534b4c  /* "LKSY" */
+#define PROFILER_SYMBLOB_VERSION    1
+
+#define PROFILER_DEFAULT_TOP        20
+
+/* PMUv3 */
+#define PMCR_E                      (1 << 0)
+#define PMU_CYCLE_COUNTER           (1U << 31)
+#define PMU_EVENT_COUNTER0          (1U << 0)
+
+/* Layout of lk.elf.syms, see scripts/lkprof.py, symbols sorted by address */
+struct profiler_sym {
+    uint64_t addr;
+    uint32_t size;
+    uint32_t name;              /* offset into the string table */
+};
+
+struct profiler_symblob {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t strtab_size;
+    struct profiler_sym syms[];
+    /* followed by the string table */
+};
+
+static const struct {
+    const char *name;
+    uint16_t pmu_event;
+    uint32_t default_period;
+} profiler_events[] = {
+    [PROFILER_CYCLES]           = { "cycles",           0x11, 100000 },
+    [PROFILER_INSTRUCTIONS]     = { "instructions",     0x08, 100000 },
+    [PROFILER_L1D_MISSES]       = { "l1d-misses",       0x03, 1000 },
+    [PROFILER_L2D_MISSES]       = { "l2d-misses",       0x17, 1000 },
+    [PROFILER_BRANCH_MISSES]    = { "branch-misses",    0x10, 1000 },
+    [PROFILER_TIMER]            = { "timer",            0,    1000 },
+};
+
+struct profiler_cpu {
+    struct profiler_sample *samples;
+    uint count;
+    uint dropped;
+    hrtimer_t hrtimer;
+    timer_t timer;
+} __CPU_ALIGN;
+
+static struct profiler_cpu prof_cpus[SMP_MAX_CPUS];
+
+static struct {
+    enum profiler_event event;
+    uint32_t period;
+    volatile bool running;
+    lk_bigtime_t start;
+    lk_bigtime_t elapsed;
+} prof;
+
+static const struct profiler_symblob *prof_syms;
+static mutex_t prof_lock = MUTEX_INITIAL_VALUE(prof_lock);
+
+static inline uint32_t profiler_counter(void)
+{
+    return prof.event == PROFILER_CYCLES ? PMU_CYCLE_COUNTER : PMU_EVENT_COUNTER0;
+}
+
+/* Called in interrupt context on the cpu that is sampled */
+static void profiler_take_sample(void)
+{
+    struct arm64_iframe_short *frame = arm64_irq_frame();
+    struct profiler_cpu *c = &prof_cpus[arch_curr_cpu_num()];
+
+    if (!frame || !prof.running)
+        return;
+
+    if (c->count == PROFILER_SAMPLES) {
+        c->dropped++;
+        return;
+    }
+
+    c->samples[c->count].pc = frame->elr;
+    c->samples[c->count].lr = frame->lr;
+    c->count++;
+}
+
+#ifdef ARM_PMU_INT
+
+/* The counters overflow when their low 32 bits wrap */
+static void profiler_pmu_load(void)
+{
+    uint64_t count = (uint32_t)(0 - prof.period);
+
+    if (prof.event == PROFILER_CYCLES)
+        ARM64_WRITE_SYSREG(pmccntr_el0, count);
+    else
+        ARM64_WRITE_SYSREG(pmevcntr0_el0, count);
+}
+
+static enum handler_return profiler_pmu_irq(void *arg)
+{
+    uint32_t counter = profiler_counter();
+    uint32_t ovs = ARM64_READ_SYSREG(pmovsclr_el0);
+
+    ARM64_WRITE_SYSREG(pmovsclr_el0, (uint64_t)ovs);
+
+    if (ovs & counter) {
+        profiler_take_sample();
+        profiler_pmu_load();
+    }
+
+    return INT_NO_RESCHEDULE;
+}
+
+static void profiler_pmu_start(void)
+{
+    uint64_t counter = profiler_counter();
+
+    ARM64_WRITE_SYSREG(pmcntenclr_el0, counter);
+
+    /* count at EL1 and EL0 */
+    if (prof.event == PROFILER_CYCLES)
+        ARM64_WRITE_SYSREG(pmccfiltr_el0, 0UL);
+    else
+        ARM64_WRITE_SYSREG(pmevtyper0_el0, (uint64_t)profiler_events[prof.event].pmu_event);
+
+    profiler_pmu_load();
+    ARM64_WRITE_SYSREG(pmovsclr_el0, counter);
+    ARM64_WRITE_SYSREG(pmintenset_el1, counter);
+    ARM64_WRITE_SYSREG(pmcr_el0, ARM64_READ_SYSREG(pmcr_el0) | PMCR_E);
+
+    /* a PPI, its handler and enable are banked per cpu */
+    register_int_handler(ARM_PMU_INT, profiler_pmu_irq, NULL);
+    unmask_interrupt(ARM_PMU_INT);
+
+    ARM64_WRITE_SYSREG(pmcntenset_el0, counter);
+}
+
+static void profiler_pmu_stop(void)
+{
+    uint64_t counter = profiler_counter();
+
+    ARM64_WRITE_SYSREG(pmcntenclr_el0, counter);
+    ARM64_WRITE_SYSREG(pmintenclr_el1, counter);
+    ARM64_WRITE_SYSREG(pmovsclr_el0, counter);
+    mask_interrupt(ARM_PMU_INT);
+}
+
+#endif // ARM_PMU_INT
+
+static enum handler_return profiler_hrtimer_cb(hrtimer_t *t, uint64_t now, void *arg)
+{
+    profiler_take_sample();
+
+    return INT_NO_RESCHEDULE;
+}
+
+static enum handler_return profiler_timer_cb(timer_t *t, lk_time_t now, void *arg)
+{
+    profiler_take_sample();
+
+    return INT_NO_RESCHEDULE;
+}
+
+static int profiler_cpu_thread(void *arg)
+{
+    struct profiler_cpu *c = &prof_cpus[arch_curr_cpu_num()];
+    bool start = arg != NULL;
+
+    if (prof.event == PROFILER_TIMER) {
+        if (!start) {
+            hrtimer_cancel(&c->hrtimer);
+            timer_cancel(&c->timer);
+        } else if (hrtimer_set_periodic(&c->hrtimer, (uint64_t)prof.period * 1000,
+                                        profiler_hrtimer_cb, NULL) != NO_ERROR) {
+            /* no hires timer, ms resolution */
+            timer_set_periodic(&c->timer, MAX(prof.period / 1000, 1U), profiler_timer_cb, NULL);
+        }
+        return 0;
+    }
+
+#ifdef ARM_PMU_INT
+    if (start)
+        profiler_pmu_start();
+    else
+        profiler_pmu_stop();
+#endif
+
+    return 0;
+}
+
+/* PMU and timers are per cpu, set them up from a thread pinned there */
+static void profiler_on_each_cpu(bool start)
+{
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        thread_t *t;
+
+        if (!mp_is_cpu_active(cpu) || !prof_cpus[cpu].samples)
+            continue;
+
+        t = thread_create("profiler", profiler_cpu_thread, start ? (void *)1 : NULL,
+                          HIGH_PRIORITY, DEFAULT_STACK_SIZE);
+        if (!t)
+            continue;
+        thread_set_pinned_cpu(t, cpu);
+        thread_resume(t);
+        thread_join(t, NULL, INFINITE_TIME);
+    }
+}
+
+status_t profiler_start(enum profiler_event event, uint32_t period)
+{
+    if (event > PROFILER_TIMER || period == 0)
+        return ERR_INVALID_ARGS;
+
+#ifndef ARM_PMU_INT
+    if (event != PROFILER_TIMER)
+        return ERR_NOT_SUPPORTED;
+#endif
+
+    mutex_acquire(&prof_lock);
+
+    if (prof.running) {
+        mutex_release(&prof_lock);
+        return ERR_BUSY;
+    }
+
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        struct profiler_cpu *c = &prof_cpus[cpu];
+
+        if (!c->samples) {
+            c->samples = malloc(PROFILER_SAMPLES * sizeof(struct profiler_sample));
+            if (!c->samples) {
+                mutex_release(&prof_lock);
+                return ERR_NO_MEMORY;
+            }
+            hrtimer_initialize(&c->hrtimer);
+            timer_initialize(&c->timer);
+        }
+        c->count = 0;
+        c->dropped = 0;
+    }
+
+    prof.event = event;
+    prof.period = period;
+    prof.start = current_time_hires();
+    prof.running = true;
+
+    profiler_on_each_cpu(true);
+
+    mutex_release(&prof_lock);
+
+    LTRACEF("sampling %s every %u\n", profiler_events[event].name, period);
+
+    return NO_ERROR;
+}
+
+void profiler_stop(void)
+{
+    mutex_acquire(&prof_lock);
+
+    if (prof.running) {
+        profiler_on_each_cpu(false);
+        prof.running = false;
+        prof.elapsed = current_time_hires() - prof.start;
+    }
+
+    mutex_release(&prof_lock);
+}
+
+status_t profiler_set_symbols(const void *blob, size_t len)
+{
+    const struct profiler_symblob *b = blob;
+    size_t size;
+
+    if (len < sizeof(*b) || b->magic != PROFILER_SYMBLOB_MAGIC ||
+            b->version != PROFILER_SYMBLOB_VERSION)
+        return ERR_BAD_STATE;
+
+    size = sizeof(*b) + (size_t)b->count * sizeof(struct profiler_sym) + b->strtab_size;
+    if (size > len || b->strtab_size == 0 ||
+            ((const char *)&b->syms[b->count])[b->strtab_size - 1] != '\0')
+        return ERR_BAD_LEN;
+
+    prof_syms = b;
+
+    return NO_ERROR;
+}
+
+/* index of the symbol containing addr, -1 for none */
+static int profiler_lookup(uint64_t addr)
+{
+    const struct profiler_symblob *b = prof_syms;
+    int lo = 0, hi = (int)b->count - 1, found = -1;
+
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (b->syms[mid].addr <= addr) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    if (found >= 0 && b->syms[found].size &&
+            addr >= b->syms[found].addr + b->syms[found].size)
+        return -1;
+
+    return found;
+}
+
+static const char *profiler_sym_name(int i)
+{
+    const char *strtab = (const char *)&prof_syms->syms[prof_syms->count];
+
+    return strtab + prof_syms->syms[i].name;
+}
+
+static int profiler_cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+struct profiler_entry {
+    uint64_t key;               /* symbol index, or address without symbols */
+    uint count;
+};
+
+/*
+ * Collapse the sorted addresses into entries per symbol, or per address
+ * when there are no symbols. Sorted input keeps every symbol contiguous.
+ */
+static uint profiler_collapse(uint64_t *addrs, uint n, struct profiler_entry *entries,
+                              uint *unknown)
+{
+    uint count = 0;
+
+    *unknown = 0;
+    for (uint i = 0; i < n; i++) {
+        uint64_t key = addrs[i];
+
+        if (prof_syms) {
+            int sym = profiler_lookup(key);
+
+            if (sym < 0) {
+                (*unknown)++;
+                continue;
+            }
+            key = sym;
+        }
+
+        if (count && entries[count - 1].key == key) {
+            entries[count - 1].count++;
+        } else {
+            entries[count].key = key;
+            entries[count].count = 1;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void profiler_print_top(const char *title, uint64_t *addrs, uint n, uint top)
+{
+    struct profiler_entry *entries;
+    uint count, unknown;
+
+    entries = malloc(n * sizeof(*entries));
+    if (!entries) {
+        printf("no memory for the report\n");
+        return;
+    }
+
+    qsort(addrs, n, sizeof(*addrs), profiler_cmp_u64);
+    count = profiler_collapse(addrs, n, entries, &unknown);
+
+    printf("\n%s\n  samples      %%  %s\n", title, prof_syms ? "symbol" : "address");
+
+    /* selection of the top entries, top is small */
+    for (uint i = 0; i < top && i < count; i++) {
+        uint best = i;
+
+        for (uint j = i + 1; j < count; j++) {
+            if (entries[j].count > entries[best].count)
+                best = j;
+        }
+
+        struct profiler_entry e = entries[best];
+        entries[best] = entries[i];
+        entries[i] = e;
+
+        printf("  %7u %3u.%02u  ", e.count, e.count * 100 / n, e.count * 10000 / n % 100);
+        if (prof_syms)
+            printf("%s\n", profiler_sym_name(e.key));
+        else
+            printf("0x%llx\n", e.key);
+    }
+    if (unknown)
+        printf("  %7u %3u.%02u  (no symbol)\n", unknown, unknown * 100 / n,
+               unknown * 10000 / n % 100);
+
+    free(entries);
+}
+
+void profiler_report(uint top)
+{
+    uint64_t *addrs;
+    uint total = 0, dropped = 0, n;
+
+    mutex_acquire(&prof_lock);
+
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        total += prof_cpus[cpu].count;
+        dropped += prof_cpus[cpu].dropped;
+    }
+
+    printf("%s, period %u, %u samples over %llu ms",
+           profiler_events[prof.event].name, prof.period, total,
+           (prof.running ? current_time_hires() - prof.start : prof.elapsed) / 1000);
+    if (dropped)
+        printf(", %u lost to full buffers", dropped);
+    printf("\n");
+
+    if (prof.running) {
+        printf("stop the profiler first\n");
+        goto out;
+    }
+    if (!total)
+        goto out;
+
+    addrs = malloc(total * sizeof(*addrs));
+    if (!addrs) {
+        printf("no memory for the report\n");
+        goto out;
+    }
+
+    n = 0;
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        for (uint i = 0; i < prof_cpus[cpu].count; i++)
+            addrs[n++] = prof_cpus[cpu].samples[i].pc;
+    }
+    profiler_print_top("flat profile", addrs, n, top);
+
+    n = 0;
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        for (uint i = 0; i < prof_cpus[cpu].count; i++)
+            addrs[n++] = prof_cpus[cpu].samples[i].lr;
+    }
+    profiler_print_top("callers (lr)", addrs, n, top);
+
+    free(addrs);
+
+out:
+    mutex_release(&prof_lock);
+}
+
+void profiler_dump(void)
+{
+    mutex_acquire(&prof_lock);
+
+    printf("prof: begin %s %u\n", profiler_events[prof.event].name, prof.period);
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        struct profiler_cpu *c = &prof_cpus[cpu];
+
+        for (uint i = 0; i < c->count; i++)
+            printf("%u %llx %llx\n", cpu, c->samples[i].pc, c->samples[i].lr);
+    }
+    printf("prof: end\n");
+
+    mutex_release(&prof_lock);
+}
+
+#if WITH_LIB_CONSOLE
+
+static int cmd_prof(int argc, const cmd_args *argv)
+{
+    status_t err;
+
+    if (argc < 2) {
+usage:
+        printf("usage:\n");
+        printf("%s start [event] [period] : sample every period events, cycles by default\n",
+               argv[0].str);
+        printf("%s stop                   : stop sampling\n", argv[0].str);
+        printf("%s report [top]           : flat profile of the top functions\n", argv[0].str);
+        printf("%s dump                   : raw samples for scripts/lkprof.py\n", argv[0].str);
+        printf("%s syms <address> <len>   : use the lk.elf.syms loaded at address\n", argv[0].str);
+        printf("events:");
+        for (uint i = 0; i < countof(profiler_events); i++)
+            printf(" %s", profiler_events[i].name);
+        printf("\n");
+        return ERR_INVALID_ARGS;
+    }
+
+    if (!strcmp(argv[1].str, "start")) {
+        enum profiler_event event = PROFILER_CYCLES;
+
+        if (argc > 2) {
+            for (event = 0; event < countof(profiler_events); event++) {
+                if (!strcmp(argv[2].str, profiler_events[event].name))
+                    break;
+            }
+            if (event == countof(profiler_events)) {
+                printf("unknown event %s\n", argv[2].str);
+                goto usage;
+            }
+        }
+
+        err = profiler_start(event, argc > 3 ? argv[3].u : profiler_events[event].default_period);
+        if (err == ERR_NOT_SUPPORTED)
+            printf("no PMU interrupt on this platform, only timer sampling\n");
+        else if (err)
+            printf("error %d starting the profiler\n", err);
+        return err;
+    } else if (!strcmp(argv[1].str, "stop")) {
+        profiler_stop();
+    } else if (!strcmp(argv[1].str, "report")) {
+        profiler_report(argc > 2 ? argv[2].u : PROFILER_DEFAULT_TOP);
+    } else if (!strcmp(argv[1].str, "dump")) {
+        profiler_dump();
+    } else if (!strcmp(argv[1].str, "syms")) {
+        if (argc < 4)
+            goto usage;
+        err = profiler_set_symbols(argv[2].p, argv[3].u);
+        if (err)
+            printf("not a symbol blob: %d\n", err);
+        return err;
+    } else {
+        printf("unknown command\n");
+        goto usage;
+    }
+
+    return NO_ERROR;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("prof", "sampling profiler", &cmd_prof)
+STATIC_COMMAND_END(profiler);
+
+#endif // WITH_LIB_CONSOLE
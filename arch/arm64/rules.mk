@@ -17,6 +17,7 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/spinlock.S \
 	$(LOCAL_DIR)/start.S \
 	$(LOCAL_DIR)/cache-ops.S \
+	$(LOCAL_DIR)/dma_sync.c \
 
 #	$(LOCAL_DIR)/arm/start.S \
 	$(LOCAL_DIR)/arm/cache.c \
@@ -48,6 +49,17 @@ endif
 
 ARCH_OPTFLAGS := -O2
 
+# sampling profiler, the "prof" command
+WITH_PROFILER ?= 0
+
+ifeq ($(WITH_PROFILER),1)
+GLOBAL_DEFINES += \
+    WITH_PROFILER=1
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/profiler.c
+endif
+
 # we have a mmu and want the vmm/pmm
 WITH_KERNEL_VM ?= 1
 
@@ -122,4 +134,15 @@ $(BUILDDIR)/system-onesegment.ld: $(LOCAL_DIR)/system-onesegment.ld $(wildcard a
 linkerscript.phony:
 .PHONY: linkerscript.phony
 
+ifeq ($(WITH_PROFILER),1)
+# symbol blob for the profiler report, load it to memory and run 'prof syms'
+PROFILER_SYMBLOB := $(OUTELF).syms
+EXTRA_BUILDDEPS += $(PROFILER_SYMBLOB)
+GENERATED += $(PROFILER_SYMBLOB)
+
+$(PROFILER_SYMBLOB): $(OUTELF) scripts/lkprof.py
+	@echo generating profiler symbols: $@
+	$(NOECHO)scripts/lkprof.py symblob --nm $(NM) $< $@
+endif
+
 include make/module.mk
@@ -29,6 +29,7 @@
 #include <reg.h>
 #include <kernel/thread.h>
 #include <kernel/debug.h>
+#include <kernel/ktrace.h>
 #include <lk/init.h>
 #include <platform/interrupts.h>
 #include <arch/ops.h>
@@ -382,6 +383,7 @@ enum handler_return __platform_irq(struct iframe *frame)
 
     THREAD_STATS_INC(interrupts);
     KEVLOG_IRQ_ENTER(vector);
+    KTRACE_IRQ_ENTER(vector);
 
     uint cpu = arch_curr_cpu_num();
 
@@ -400,6 +402,7 @@ enum handler_return __platform_irq(struct iframe *frame)
 
     LTRACEF_LEVEL(2, "cpu %u exit %d\n", cpu, ret);
 
+    KTRACE_IRQ_EXIT(vector);
     KEVLOG_IRQ_EXIT(vector);
 
     return ret;
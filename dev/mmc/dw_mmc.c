@@ -11,12 +11,19 @@
  *
  */
 
+#include <arch/ops.h>
 #include <dev/dw_mmc.h>
 #include <dev/boot.h>
+#include <kernel/event.h>
+#include <platform.h>
 #include <platform/delay.h>
+#include <platform/interrupts.h>
 
 #define MAX_DIV 0xFF
 
+#define DWMCI_DATA_IRQS		(INTMSK_DTO | DATA_ERR | DATA_TOUT)
+#define DWMCI_DATA_TIMEOUT_MS	10000
+
 //#define DEBUG_DWMCI
 #ifdef DEBUG_DWMCI
 #define dbg(x...)       printf(x)
@@ -673,6 +680,69 @@ static void dwmci_end_data(struct dw_mci *host)
 	dwmci_writel(host, reg, DWMCI_BMOD);
 }
 
+/*
+ * Data phase status stays in RINTSTS for dwmci_data_transfer(), the
+ * handler only masks the source again and wakes up the waiter.
+ */
+static enum handler_return dwmci_irq_handler(void *arg)
+{
+	struct dw_mci *host = arg;
+
+	if (!(dwmci_readl(host, DWMCI_MINTSTS) & DWMCI_DATA_IRQS))
+		return INT_NO_RESCHEDULE;
+
+	dwmci_writel(host, 0, DWMCI_INTMSK);
+	event_signal(&host->data_event, false);
+
+	return INT_RESCHEDULE;
+}
+
+static void dwmci_irq_init(struct dw_mci *host)
+{
+	if (!host->irq)
+		return;
+
+	if (!host->irq_registered) {
+		event_init(&host->data_event, false, EVENT_FLAG_AUTOUNSIGNAL);
+		register_int_handler(host->irq, &dwmci_irq_handler, host);
+		unmask_interrupt(host->irq);
+		host->irq_registered = 1;
+	}
+
+	/* Sources are unmasked only while a data phase is waited for */
+	dwmci_writel(host, 0, DWMCI_INTMSK);
+	dwmci_set(host, INT_ENABLE, DWMCI_CTRL);
+}
+
+/* Sleeping needs a thread that can be woken up, e.g. not from a halt path */
+static bool dwmci_irq_usable(struct dw_mci *host)
+{
+	return host->irq_registered && !arch_ints_disabled();
+}
+
+/*
+ * Sleep until the data phase ends, other threads run meanwhile. Unmasking
+ * raises the interrupt right away if the transfer is already over.
+ */
+static int dwmci_wait_data_irq(struct dw_mci *host)
+{
+	lk_time_t start = current_time();
+	lk_time_t elapsed;
+
+	while (!(dwmci_readl(host, DWMCI_RINTSTS) & DWMCI_DATA_IRQS)) {
+		elapsed = current_time() - start;
+		if (elapsed >= DWMCI_DATA_TIMEOUT_MS) {
+			dwmci_writel(host, 0, DWMCI_INTMSK);
+			return ERR_TIMED_OUT;
+		}
+		dwmci_writel(host, DWMCI_DATA_IRQS, DWMCI_INTMSK);
+		event_wait_timeout(&host->data_event, DWMCI_DATA_TIMEOUT_MS - elapsed);
+	}
+	dwmci_writel(host, 0, DWMCI_INTMSK);
+
+	return NO_ERROR;
+}
+
 /*
  * Transfer data and check error
  */
@@ -681,6 +751,13 @@ static int dwmci_data_transfer(struct dw_mci *host)
 	unsigned int mask;
 	unsigned int timeout = 10000000;
 
+	if (dwmci_irq_usable(host) && dwmci_wait_data_irq(host)) {
+		dwmci_end_data(host);
+		dwmci_writel(host, 0x0, DWMCI_IDINTEN);
+		printf("dwmci : data transfer sw timeout\n");
+		return ERR_TIMED_OUT;
+	}
+
 	while (timeout--) {
 		mask = dwmci_readl(host, DWMCI_RINTSTS);
 		if (mask & (DATA_ERR | DATA_TOUT)) {
@@ -840,6 +917,8 @@ static void dwmci_host_init(struct mmc *mmc)
 
 	/* set max timeout */
 	dwmci_writel(host, 0xffffffff, DWMCI_TMOUT);
+
+	dwmci_irq_init(host);
 }
 
 /*
@@ -940,6 +1019,7 @@ int dwmci_init(struct mmc *mmc, int channel)
 	host->bus_clock = 0;
 	host->sd_voltage_switch = 0;
 	host->fifo_depth = 0;
+	host->irq = 0;
 
 	/* get host data from platform */
 	err = dwmci_board_get_host(host, channel);
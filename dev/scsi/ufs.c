@@ -13,15 +13,29 @@
 
 #include <reg.h>
 #include <stdlib.h>
+#include <arch/ops.h>
+#include <kernel/event.h>
+#include <kernel/thread.h>
+#include <kernel/hrtimer.h>
+#include <kernel/ktrace.h>
+#include <platform/interrupts.h>
 #include <dev/ufs.h>
 #include <dev/ufs_provision.h>
 #include <platform/delay.h>
+#include <platform.h>
 
 #define	SCSI_MAX_INITIATOR	1
 #define	SCSI_MAX_DEVICE		8
 
+/* Upper bound of explicit WriteBooster buffer flush, in msec */
+#ifndef UFS_WB_FLUSH_TIMEOUT_MS
+#define	UFS_WB_FLUSH_TIMEOUT_MS	10000
+#endif
+
 static int send_uic_cmd(struct ufs_host *ufs);
 static int ufs_bootlun_enable(int enable);
+static void ufs_hpb_show_stats(void);
+struct ufs_host *get_cur_ufs_host(void);
 
 /*
 	Multiple UFS host : cmd_scsi should be changed
@@ -46,6 +60,19 @@ typedef enum {
 	ATTR_R_BOOTLUNEN,
 	ATTR_W_REFCLKFREQ,
 	ATTR_R_REFCLKFREQ,
+
+	FLAG_W_WB_EN,
+	FLAG_C_WB_EN,
+	FLAG_W_WB_FLUSH_EN,
+	FLAG_C_WB_FLUSH_EN,
+	FLAG_W_WB_FLUSH_DURING_H8,
+	FLAG_C_WB_FLUSH_DURING_H8,
+	ATTR_R_WB_FLUSH_STATUS,
+	ATTR_R_AVAIL_WB_BUFF_SIZE,
+	ATTR_R_WB_BUFF_LIFE_TIME_EST,
+
+	FLAG_W_HPB_EN,
+	ATTR_R_MAX_HPB_SINGLE_CMD,
 } query_index;
 
 /*	Query Function		OPCODE				IDN				INDEX	SELECTOR	*/
@@ -73,6 +100,23 @@ static u8 ufs_query_params[][5] = {
 	{UFS_STD_READ_REQ	,UPIU_QUERY_OPCODE_READ_ATTR	,UPIU_ATTR_ID_BOOTLUNEN		,0	,0},
 	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_WRITE_ATTR	,UPIU_ATTR_ID_REFCLKFREQ	,0	,0},
 	{UFS_STD_READ_REQ	,UPIU_QUERY_OPCODE_READ_ATTR	,UPIU_ATTR_ID_REFCLKFREQ	,0	,0},
+
+	/*
+	 * INDEX of WriteBooster flags and attributes means target LUN
+	 * for LU dedicated buffer, so this driver will override the value.
+	 */
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_SET_FLAG	,UPIU_FLAG_ID_WB_EN		,0	,0},
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_CLEAR_FLAG	,UPIU_FLAG_ID_WB_EN		,0	,0},
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_SET_FLAG	,UPIU_FLAG_ID_WB_BUFF_FLUSH_EN	,0	,0},
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_CLEAR_FLAG	,UPIU_FLAG_ID_WB_BUFF_FLUSH_EN	,0	,0},
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_SET_FLAG	,UPIU_FLAG_ID_WB_BUFF_FLUSH_DURING_H8	,0	,0},
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_CLEAR_FLAG	,UPIU_FLAG_ID_WB_BUFF_FLUSH_DURING_H8	,0	,0},
+	{UFS_STD_READ_REQ	,UPIU_QUERY_OPCODE_READ_ATTR	,UPIU_ATTR_ID_WB_FLUSH_STATUS	,0	,0},
+	{UFS_STD_READ_REQ	,UPIU_QUERY_OPCODE_READ_ATTR	,UPIU_ATTR_ID_AVAIL_WB_BUFF_SIZE	,0	,0},
+	{UFS_STD_READ_REQ	,UPIU_QUERY_OPCODE_READ_ATTR	,UPIU_ATTR_ID_WB_BUFF_LIFE_TIME_EST	,0	,0},
+
+	{UFS_STD_WRITE_REQ	,UPIU_QUERY_OPCODE_SET_FLAG	,UPIU_FLAG_ID_HPB_EN		,0	,0},
+	{UFS_STD_READ_REQ	,UPIU_QUERY_OPCODE_READ_ATTR	,UPIU_ATTR_ID_MAX_HPB_SINGLE_CMD	,0	,0},
 	{},
 };
 
@@ -97,6 +141,41 @@ usage:
         if (argc < 3) goto notenoughargs;
 
 	return ufs_bootlun_enable((int) argv[2].u);
+    } else if (!strcmp(argv[1].str, "wb")) {
+	char buf[64];
+
+	if (argc < 3) {
+		rc = ufs_wb_getvar(buf);
+		if (!rc)
+			printf("WriteBooster: %s\n", buf);
+	} else if (!strcmp(argv[2].str, "flush")) {
+		rc = ufs_wb_flush();
+	} else {
+		rc = ufs_wb_enable((int) argv[2].u);
+	}
+	return rc;
+    } else if (!strcmp(argv[1].str, "hpb")) {
+	struct ufs_host *ufs = get_cur_ufs_host();
+
+	if (!ufs || !ufs->hpb) {
+		printf("HPB is not supported\n");
+		return -1;
+	}
+
+	if (argc < 3) {
+		ufs_hpb_show_stats();
+	} else if (!strcmp(argv[2].str, "reset")) {
+		memset(&ufs->hpb->stats, 0, sizeof(ufs->hpb->stats));
+	} else if (!strcmp(argv[2].str, "drop")) {
+		ufs->hpb->nr_srgns = 0;
+	} else if (!strcmp(argv[2].str, "load")) {
+		if (argc < 6) goto notenoughargs;
+		rc = ufs_hpb_load(argv[3].u, argv[4].u, argv[5].u);
+	} else {
+		printf("unrecognized subcommand\n");
+		goto usage;
+	}
+	return rc;
     } else {
         printf("unrecognized subcommand\n");
         goto usage;
@@ -282,9 +361,13 @@ void ufs_lld_udelay(u32 val)
 	u_delay(val);
 }
 
+/* The CAL allows sleeping here, give the CPU away when we can */
 void ufs_lld_usleep_delay(u32 min, u32 max)
 {
-	u_delay(max);
+	if (arch_ints_disabled())
+		u_delay(max);
+	else
+		hrtimer_sleep_us(min);
 }
 
 unsigned long ufs_lld_get_time_count(unsigned long offset)
@@ -594,6 +677,86 @@ static int handle_ufs_int(struct ufs_host *ufs, int is_uic)
 	return ret;
 }
 
+/*
+ * The handler only latches and acks the enabled status bits and wakes up
+ * the waiter, decoding stays in handle_ufs_utp_int() as for polling.
+ */
+static enum handler_return ufs_irq_handler(void *arg)
+{
+	struct ufs_host *ufs = arg;
+	u32 intr_stat;
+
+	intr_stat = readl(ufs->ioaddr + REG_INTERRUPT_STATUS) & ufs->int_enable_mask;
+	if (!intr_stat)
+		return INT_NO_RESCHEDULE;
+
+	writel(intr_stat, ufs->ioaddr + REG_INTERRUPT_STATUS);
+	atomic_or(&ufs->irq_stat, intr_stat);
+	event_signal(&ufs->utp_event, false);
+
+	return INT_RESCHEDULE;
+}
+
+/*
+ * Only UTP requests complete by interrupt. UIC commands are issued
+ * during link setup and keep polling, their status bits are not enabled.
+ * Must be called again after every host reset, which clears IE.
+ */
+static void ufs_irq_init(struct ufs_host *ufs)
+{
+	if (!ufs->irq)
+		return;
+
+	ufs->int_enable_mask = UTP_TRANSFER_REQ_COMPL | INT_FATAL_ERRORS;
+
+	if (!ufs->irq_registered) {
+		event_init(&ufs->utp_event, false, EVENT_FLAG_AUTOUNSIGNAL);
+		register_int_handler(ufs->irq, &ufs_irq_handler, ufs);
+		unmask_interrupt(ufs->irq);
+		ufs->irq_registered = 1;
+	}
+
+	ufs->irq_stat = 0;
+	writel(ufs->int_enable_mask, ufs->ioaddr + REG_INTERRUPT_ENABLE);
+}
+
+/* Sleeping needs a thread that can be woken up, e.g. not from a halt path */
+static int ufs_irq_usable(struct ufs_host *ufs)
+{
+	return ufs->irq_registered && !arch_ints_disabled();
+}
+
+static int ufs_wait_utp_irq(struct ufs_host *ufs)
+{
+	lk_time_t deadline = current_time() + (ufs->timeout + 999) / 1000;
+	u32 intr_stat;
+	int ret;
+
+	for (;;) {
+		intr_stat = atomic_swap(&ufs->irq_stat, 0);
+		intr_stat |= readl(ufs->ioaddr + REG_INTERRUPT_STATUS);
+
+		ret = handle_ufs_utp_int(ufs, intr_stat);
+		if (intr_stat & INT_FATAL_ERRORS) {
+			printf("UFS: FATAL ERROR 0x%08x\n", intr_stat);
+			ret = UFS_ERROR;
+		}
+		if (ret != UFS_IN_PROGRESS)
+			return ret;
+
+		if (TIME_GTE(current_time(), deadline) ||
+				event_wait_timeout(&ufs->utp_event,
+					deadline - current_time()) == ERR_TIMED_OUT) {
+			/* Last look, the completion may race with the timeout */
+			if (handle_ufs_utp_int(ufs, atomic_swap(&ufs->irq_stat, 0) |
+					readl(ufs->ioaddr + REG_INTERRUPT_STATUS)) == UFS_NO_ERROR)
+				return UFS_NO_ERROR;
+			printf("UFS: TIMEOUT\n");
+			return UFS_TIMEOUT;
+		}
+	}
+}
+
 static int send_uic_cmd(struct ufs_host *ufs)
 {
 	int err = 0, error_code;
@@ -671,8 +834,13 @@ static int __utp_wait_for_response(struct ufs_host *ufs, u32 type)
 	/* FORMAT_UNIT should have longer timeout, 10 min */
 	if (type == UPIU_TRANSACTION_COMMAND && ufs->scsi_cmd->cdb[0] == SCSI_OP_FORMAT_UNIT)
 		ufs->timeout = 10 * 60 * 1000 * 1000;
-	while (UFS_IN_PROGRESS == (err = handle_ufs_int(ufs, 0)))
-		;
+
+	/* Other threads get the CPU while the request is in flight */
+	if (ufs_irq_usable(ufs))
+		err = ufs_wait_utp_irq(ufs);
+	else
+		while (UFS_IN_PROGRESS == (err = handle_ufs_int(ufs, 0)))
+			;
 	writel(readl(ufs->ioaddr + REG_INTERRUPT_STATUS),
 			ufs->ioaddr + REG_INTERRUPT_STATUS);
 
@@ -746,6 +914,7 @@ static void __utp_query_get_data(struct ufs_host *ufs, query_index qry)
 		ufs->flags.arry[ufs_query_params[qry][2]] = val;
 		break;
 	case UPIU_QUERY_OPCODE_SET_FLAG:
+	case UPIU_QUERY_OPCODE_CLEAR_FLAG:
 	case UPIU_QUERY_OPCODE_WRITE_DESC:
 	case UPIU_QUERY_OPCODE_WRITE_ATTR:
 		break;
@@ -828,10 +997,25 @@ static void __utp_get_scsi_cxt(struct ufs_host *ufs, scm * pscm) {
  * wait for and check RESPONSE UPIU. And then it reports
  * the result to the upper layer.
  */
+static const char *ufs_trace_name(u8 opcode)
+{
+	switch (opcode) {
+	case SCSI_OP_READ_10:
+		return "ufs_read";
+	case SCSI_OP_WRITE_10:
+		return "ufs_write";
+	default:
+		return "ufs_cmd";
+	}
+}
+
 static int ufs_utp_cmd_process(struct ufs_host *ufs, scm * pscm)
 {
 	int r;
 	u32 type = UPIU_TRANSACTION_COMMAND;
+	const char *trace_name = ufs_trace_name(pscm->cdb[0]);
+
+	KTRACE_BEGIN(KTRACE_UFS, trace_name, pscm->datalen);
 
 	/* Init context */
 	__utp_init(ufs, 0);
@@ -857,6 +1041,7 @@ static int ufs_utp_cmd_process(struct ufs_host *ufs, scm * pscm)
 	if (r != 0)
 		goto end;
 end:
+	KTRACE_END(KTRACE_UFS, trace_name);
 	return r;
 }
 
@@ -929,6 +1114,331 @@ end:
 	return r;
 }
 
+/*
+ * HPB (Host Performance Booster)
+ *
+ * L2P map entries of some sub-regions are fetched with HPB READ BUFFER
+ * and kept in host memory. A READ (10) hitting a cached sub-region is
+ * converted to HPB READ with the entry, so the device doesn't need to
+ * load its own L2P map for scattered reads. Writes to a cached range
+ * make the entries stale, thus the sub-region is dropped.
+ */
+static scsi_device_t ufs_hpb_sdev;
+
+#define get_be32(p)	(((u32)(p)[0] << 24) | ((u32)(p)[1] << 16) | \
+			 ((u32)(p)[2] << 8) | (u32)(p)[3])
+#define get_be16(p)	(((u32)(p)[0] << 8) | (u32)(p)[1])
+
+static int ufs_hpb_probe(struct ufs_host *ufs)
+{
+	struct ufs_hpb *hpb;
+	u32 version, lu_mask = 0;
+	u32 srgn_mem;
+	int i;
+	int res;
+
+	res = ufs_utp_query_process(ufs, DESC_R_DEVICE_DESC, 0);
+	if (res)
+		goto end;
+
+	if (ufs->device_desc.bLength <= offsetof(struct ufs_device_desc, bHPBControl) ||
+	    !(ufs->device_desc.bUFSFeaturesSupport & UFS_DEV_HPB_SUPPORT))
+		goto end;
+
+	version = be16_to_cpu(ufs->device_desc.wHPBVersion);
+	if (version != UFS_HPB_VER_1_0 && version != UFS_HPB_VER_2_0) {
+		printf("UFS: HPB version 0x%x is not supported\n", version);
+		goto end;
+	}
+
+	res = ufs_utp_query_process(ufs, DESC_R_GEOMETRY_DESC, 0);
+	if (res)
+		goto end;
+
+	/* Unit descriptors are read in ufs_identify_bootlun() */
+	for (i = 0; i < 8; i++) {
+		if (ufs->unit_desc[i].bLUEnable == UFS_LU_HPB_ENABLE &&
+				ufs->unit_desc[i].bLogicalBlockSize == UFS_SG_BLOCK_SIZE_BIT)
+			lu_mask |= 1 << i;
+	}
+	if (!lu_mask)
+		goto end;
+
+	/* Region sizes are 512B * 2^n and an entry covers 4KB */
+	if (ufs->geometry_desc.bHPBSubRegionSize < 3 ||
+			ufs->geometry_desc.bHPBRegionSize < ufs->geometry_desc.bHPBSubRegionSize) {
+		printf("UFS: HPB invalid region size\n");
+		goto end;
+	}
+
+	hpb = calloc(1, sizeof(struct ufs_hpb));
+	if (!hpb)
+		goto end;
+
+	hpb->version = version;
+	hpb->lu_mask = lu_mask;
+	hpb->rgn_shift = ufs->geometry_desc.bHPBRegionSize - 3;
+	hpb->srgn_shift = ufs->geometry_desc.bHPBSubRegionSize - 3;
+
+	/* A sub-region map should be fetched with one command */
+	srgn_mem = (1 << hpb->srgn_shift) * UFS_HPB_ENTRY_SIZE;
+	if (srgn_mem > SCSI_MAX_SG_SEGMENTS * UFS_SG_BLOCK_SIZE) {
+		printf("UFS: HPB sub-region map %u bytes is too large\n", srgn_mem);
+		free(hpb);
+		goto end;
+	}
+	hpb->max_srgns = MIN(UFS_HPB_MAX_SRGNS, UFS_HPB_MAP_MEM_MAX / srgn_mem);
+
+	/* HPB 1.0 can carry only one block in HPB READ */
+	hpb->max_single_cmd = 1;
+	if (version == UFS_HPB_VER_2_0) {
+		if (!ufs_utp_query_process(ufs, ATTR_R_MAX_HPB_SINGLE_CMD, 0))
+			hpb->max_single_cmd = MIN(ufs->attributes.attr.bMaxDataSizeHPBSingleCmd + 1, 255);
+		ufs->flags.arry[UPIU_FLAG_ID_HPB_EN] = 1;
+		if (ufs_utp_query_process(ufs, FLAG_W_HPB_EN, 0))
+			printf("UFS: HPB fHPBEn setting failed\n");
+	}
+
+	ufs->hpb = hpb;
+
+	printf("UFS: HPB %d.%d %s mode, LU mask 0x%02x, sub-region %u KB, %u sub-regions at most\n",
+			version >> 8, (version >> 4) & 0xf,
+			ufs->device_desc.bHPBControl ? "device" : "host",
+			lu_mask, (1 << hpb->srgn_shift) * 4, hpb->max_srgns);
+end:
+	/* Not having HPB is not an error */
+	return 0;
+}
+
+static struct ufs_hpb_srgn *ufs_hpb_lookup(struct ufs_hpb *hpb, u32 lun,
+						u32 lba, u32 count)
+{
+	u32 start = lba & ~((1 << hpb->srgn_shift) - 1);
+	u32 i;
+
+	if (count > hpb->max_single_cmd)
+		return NULL;
+
+	/* Entry of the first block is used for all blocks in HPB READ */
+	if (((lba + count - 1) >> hpb->srgn_shift) != (lba >> hpb->srgn_shift))
+		return NULL;
+
+	for (i = 0; i < hpb->nr_srgns; i++) {
+		if (hpb->srgn[i].lun == lun && hpb->srgn[i].start == start)
+			return &hpb->srgn[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Drop cached sub-regions of a LU overlapping the range.
+ * The last one fills the hole, so that map slots stay packed.
+ */
+static void ufs_hpb_drop(struct ufs_hpb *hpb, u32 lun, u32 lba, u32 count)
+{
+	u32 srgn_blks = 1 << hpb->srgn_shift;
+	u64 end = (u64)lba + count;
+	struct ufs_hpb_srgn *srgn;
+	u32 i = 0;
+	u8 *map;
+
+	while (i < hpb->nr_srgns) {
+		srgn = &hpb->srgn[i];
+		if (srgn->lun != lun || srgn->start >= end ||
+				lba >= srgn->start + srgn_blks) {
+			i++;
+			continue;
+		}
+
+		map = srgn->map;
+		hpb->nr_srgns--;
+		if (i != hpb->nr_srgns) {
+			*srgn = hpb->srgn[hpb->nr_srgns];
+			memcpy(map, srgn->map, srgn_blks * UFS_HPB_ENTRY_SIZE);
+			srgn->map = map;
+		}
+	}
+}
+
+static int ufs_hpb_read_buffer(struct ufs_host *ufs, u32 lun, u32 lba, u8 *buf)
+{
+	struct ufs_hpb *hpb = ufs->hpb;
+	scm cmd;
+	u32 rgn = lba >> hpb->rgn_shift;
+	u32 srgn = (lba >> hpb->srgn_shift) & ((1 << (hpb->rgn_shift - hpb->srgn_shift)) - 1);
+	u32 len = (1 << hpb->srgn_shift) * UFS_HPB_ENTRY_SIZE;
+	int r;
+
+	memset(&cmd, 0, sizeof(cmd));
+	ufs_hpb_sdev.lun = lun;
+	cmd.sdev = &ufs_hpb_sdev;
+	cmd.buf = buf;
+	cmd.datalen = len;
+
+	cmd.cdb[0] = SCSI_OP_HPB_READ_BUFFER;
+	cmd.cdb[1] = UFS_HPB_READ_BUF_ID;
+	cmd.cdb[2] = (rgn >> 8) & 0xff;
+	cmd.cdb[3] = rgn & 0xff;
+	cmd.cdb[4] = (srgn >> 8) & 0xff;
+	cmd.cdb[5] = srgn & 0xff;
+	cmd.cdb[6] = (len >> 16) & 0xff;
+	cmd.cdb[7] = (len >> 8) & 0xff;
+	cmd.cdb[8] = len & 0xff;
+
+	r = ufs_utp_cmd_process(ufs, &cmd);
+	if (!r && cmd.status)
+		r = ERR_IO;
+
+	return r;
+}
+
+/*
+ * Fetch L2P map of all sub-regions covering [start, start + count)
+ * of a LU, in logical blocks. It stops when the cache is full.
+ */
+int ufs_hpb_load(u32 lun, u32 start, u32 count)
+{
+	struct ufs_host *ufs = get_cur_ufs_host();
+	struct ufs_hpb *hpb;
+	struct ufs_hpb_srgn *srgn;
+	u32 srgn_blks;
+	u64 lba, end;
+	int r = NO_ERROR;
+
+	if (!ufs || !ufs->hpb)
+		return ERR_NOT_SUPPORTED;
+
+	hpb = ufs->hpb;
+	if (lun >= 8 || !(hpb->lu_mask & (1 << lun)) || !count)
+		return ERR_INVALID_ARGS;
+
+	srgn_blks = 1 << hpb->srgn_shift;
+	if (!hpb->map_mem) {
+		hpb->map_mem = memalign(0x1000, hpb->max_srgns * srgn_blks * UFS_HPB_ENTRY_SIZE);
+		if (!hpb->map_mem)
+			return ERR_NO_MEMORY;
+	}
+
+	end = (u64)start + count;
+	for (lba = start & ~(srgn_blks - 1); lba < end; lba += srgn_blks) {
+		if (ufs_hpb_lookup(hpb, lun, (u32)lba, 1))
+			continue;
+
+		if (hpb->nr_srgns >= hpb->max_srgns) {
+			r = ERR_NO_MEMORY;
+			break;
+		}
+
+		srgn = &hpb->srgn[hpb->nr_srgns];
+		srgn->map = hpb->map_mem + hpb->nr_srgns * srgn_blks * UFS_HPB_ENTRY_SIZE;
+		r = ufs_hpb_read_buffer(ufs, lun, (u32)lba, srgn->map);
+		if (r) {
+			printf("UFS: HPB READ BUFFER failed at LU%u, 0x%llx: %d\n", lun, lba, r);
+			break;
+		}
+		srgn->lun = lun;
+		srgn->start = (u32)lba;
+		hpb->nr_srgns++;
+		hpb->stats.map_load++;
+	}
+
+	return r;
+}
+
+/*
+ * This function replaces ufs_utp_cmd_process() for SCSI commands
+ * when HPB is available.
+ */
+static int ufs_hpb_cmd_process(struct ufs_host *ufs, scm *pscm)
+{
+	struct ufs_hpb *hpb = ufs->hpb;
+	struct ufs_hpb_srgn *srgn;
+	u32 lun = pscm->sdev->lun;
+	u8 cdb[MAX_CDB_SIZE];
+	lk_bigtime_t t;
+	u32 lba, count;
+	int r;
+
+	if (lun >= 8 || !(hpb->lu_mask & (1 << lun)))
+		return ufs_utp_cmd_process(ufs, pscm);
+
+	lba = get_be32(&pscm->cdb[2]);
+	count = get_be16(&pscm->cdb[7]);
+
+	switch (pscm->cdb[0]) {
+	case SCSI_OP_READ_10:
+		break;
+	case SCSI_OP_WRITE_10:
+		ufs_hpb_drop(hpb, lun, lba, count);
+		return ufs_utp_cmd_process(ufs, pscm);
+	case SCSI_OP_UNMAP:
+	case SCSI_OP_FORMAT_UNIT:
+	case SCSI_OP_WRITE_BUFFER:
+		ufs_hpb_drop(hpb, lun, 0, 0xFFFFFFFF);
+		return ufs_utp_cmd_process(ufs, pscm);
+	default:
+		return ufs_utp_cmd_process(ufs, pscm);
+	}
+
+	t = current_time_hires();
+
+	srgn = ufs_hpb_lookup(hpb, lun, lba, count);
+	if (srgn) {
+		memcpy(cdb, pscm->cdb, MAX_CDB_SIZE);
+
+		/* LBA in cdb[2..5] stays */
+		pscm->cdb[0] = SCSI_OP_HPB_READ;
+		pscm->cdb[1] = 0;
+		memcpy(&pscm->cdb[6], srgn->map + (lba - srgn->start) * UFS_HPB_ENTRY_SIZE,
+				UFS_HPB_ENTRY_SIZE);
+		pscm->cdb[14] = (u8)count;
+		pscm->cdb[15] = 0;
+
+		r = ufs_utp_cmd_process(ufs, pscm);
+		if (!r && !pscm->status) {
+			hpb->stats.hit++;
+			hpb->stats.hit_us += current_time_hires() - t;
+			return r;
+		}
+
+		/* Stale entry or the device rejects it, retry with READ (10) */
+		ufs_hpb_drop(hpb, lun, lba, count);
+		memcpy(pscm->cdb, cdb, MAX_CDB_SIZE);
+
+		r = ufs_utp_cmd_process(ufs, pscm);
+		hpb->stats.fallback++;
+		hpb->stats.fallback_us += current_time_hires() - t;
+		return r;
+	}
+
+	r = ufs_utp_cmd_process(ufs, pscm);
+	hpb->stats.miss++;
+	hpb->stats.miss_us += current_time_hires() - t;
+
+	return r;
+}
+
+static void ufs_hpb_show_stats(void)
+{
+	struct ufs_hpb *hpb = get_cur_ufs_host()->hpb;
+	struct ufs_hpb_stats *st = &hpb->stats;
+	u64 reads = st->hit + st->miss + st->fallback;
+
+	printf("HPB version\t\t0x%x\n", hpb->version);
+	printf("HPB LU mask\t\t0x%02x\n", hpb->lu_mask);
+	printf("Max blocks per HPB READ\t%u\n", hpb->max_single_cmd);
+	printf("Cached sub-regions\t%u / %u\n", hpb->nr_srgns, hpb->max_srgns);
+	printf("Map loads\t\t%llu\n", st->map_load);
+	printf("Hit\t\t\t%llu (avg %llu us)\n", st->hit,
+			st->hit ? st->hit_us / st->hit : 0);
+	printf("Miss\t\t\t%llu (avg %llu us)\n", st->miss,
+			st->miss ? st->miss_us / st->miss : 0);
+	printf("Fallback\t\t%llu (avg %llu us)\n", st->fallback,
+			st->fallback ? st->fallback_us / st->fallback : 0);
+	printf("Hit rate\t\t%llu%%\n", reads ? st->hit * 100 / reads : 0);
+}
+
 /*
  * CALLBACK FUNCTION: scsi_exec
  *
@@ -947,6 +1457,9 @@ static status_t scsi_exec(scm * pscm)
 	print_ufs_upiu(ufs, UFS_DEBUG_UPIU);
 #endif
 
+	if (ufs->hpb)
+		return ufs_hpb_cmd_process(ufs, pscm);
+
 	return ufs_utp_cmd_process(ufs, pscm);
 }
 
@@ -1578,6 +2091,243 @@ end:
 	return res;
 }
 
+/*
+ * WriteBooster
+ *
+ * Host writes land in an SLC buffer and are migrated to normal
+ * storage by the device later on. This driver never configures
+ * the buffer, it only uses one that is provisioned already.
+ */
+static int ufs_wb_query(struct ufs_host *ufs, query_index qry)
+{
+	ufs_query_params[qry][3] = ufs->wb_index;
+	return ufs_utp_query_process(ufs, qry, 0);
+}
+
+static int ufs_wb_probe(struct ufs_host *ufs)
+{
+	u32 alloc_units = 0;
+	u64 alloc_unit_in_byte;
+	int i;
+	int res;
+
+	ufs->wb_support = 0;
+	ufs->wb_enabled = 0;
+
+	res = ufs_utp_query_process(ufs, DESC_R_DEVICE_DESC, 0);
+	if (res)
+		goto end;
+
+	/* Devices before UFS 3.1 or 2.2 with extension don't have these fields */
+	if (ufs->device_desc.bLength < sizeof(struct ufs_device_desc) ||
+	    !(be32_to_cpu(ufs->device_desc.dExtendedUFSFeaturesSupport) &
+					UFS_DEV_WRITE_BOOSTER_SUP))
+		goto end;
+
+	res = ufs_utp_query_process(ufs, DESC_R_GEOMETRY_DESC, 0);
+	if (res)
+		goto end;
+
+	if (!ufs->geometry_desc.dWriteBoosterBufferMaxNAllocUnits)
+		goto end;
+
+	if (ufs->device_desc.bWriteBoosterBufferType == UFS_WB_BUF_SHARED) {
+		ufs->wb_index = 0;
+		alloc_units = be32_to_cpu(ufs->device_desc.dNumSharedWriteBoosterBufferAllocUnits);
+	} else {
+		/* Unit descriptors are read in ufs_identify_bootlun() */
+		for (i = 0; i < 8; i++) {
+			alloc_units = be32_to_cpu(ufs->unit_desc[i].dLUNumWriteBoosterBufferAllocUnits);
+			if (alloc_units) {
+				ufs->wb_index = i;
+				break;
+			}
+		}
+	}
+
+	if (!alloc_units) {
+		printf("UFS: WriteBooster supported, but no buffer is configured\n");
+		goto end;
+	}
+
+	alloc_unit_in_byte = (u64)ufs->geometry_desc.bAllocationUnitSize *
+			be32_to_cpu(ufs->geometry_desc.dSegmentSize) * 512;
+	ufs->wb_buf_size = alloc_units * alloc_unit_in_byte;
+	ufs->wb_support = 1;
+
+	printf("UFS: WriteBooster %s buffer, %llu MB\n",
+			ufs->device_desc.bWriteBoosterBufferType == UFS_WB_BUF_SHARED ?
+			"shared" : "LU dedicated", ufs->wb_buf_size >> 20);
+end:
+	/* Not having WriteBooster is not an error */
+	return 0;
+}
+
+int ufs_wb_enable(int enable)
+{
+	struct ufs_host *ufs = get_cur_ufs_host();
+	int res;
+
+	if (!ufs || !ufs->wb_support)
+		return ERR_NOT_SUPPORTED;
+
+	if (!!enable == ufs->wb_enabled)
+		return NO_ERROR;
+
+	res = ufs_wb_query(ufs, enable ? FLAG_W_WB_EN : FLAG_C_WB_EN);
+	if (res) {
+		printf("UFS: WriteBooster %s failed with %d\n",
+				enable ? "enable" : "disable", res);
+		return res;
+	}
+
+	/*
+	 * Let the device migrate the buffer whenever the link
+	 * enters hibern8 in the kernel.
+	 */
+	res = ufs_wb_query(ufs, enable ? FLAG_W_WB_FLUSH_DURING_H8 :
+				FLAG_C_WB_FLUSH_DURING_H8);
+	if (res)
+		printf("UFS: WriteBooster flush during hibern8 failed with %d\n", res);
+
+	ufs->wb_enabled = !!enable;
+
+	return NO_ERROR;
+}
+
+/*
+ * Enable WriteBooster for a bulk write and return the state to hand
+ * to ufs_wb_end() afterwards, or a negative error without it.
+ */
+int ufs_wb_begin(void)
+{
+	struct ufs_host *ufs = get_cur_ufs_host();
+	int prev;
+	int res;
+
+	if (!ufs || !ufs->wb_support)
+		return ERR_NOT_SUPPORTED;
+
+	prev = ufs->wb_enabled;
+	res = ufs_wb_enable(1);
+	if (res)
+		return res;
+
+	return prev;
+}
+
+/*
+ * Restore the state from before ufs_wb_begin(). The buffer is
+ * flushed before WriteBooster is turned back off.
+ */
+void ufs_wb_end(int prev)
+{
+	if (prev != 0)
+		return;
+
+	ufs_wb_flush();
+	ufs_wb_enable(0);
+}
+
+/*
+ * Migrate everything in WriteBooster buffer to normal storage.
+ * This is called before reset not to lose data on power removal
+ * during the flush in the device, so it busy-waits rather than
+ * sleeping, bounded by UFS_WB_FLUSH_TIMEOUT_MS.
+ */
+int ufs_wb_flush(void)
+{
+	struct ufs_host *ufs = get_cur_ufs_host();
+	lk_time_t deadline;
+	bool timeout = false;
+	u32 status = UFS_WB_FLUSH_IDLE;
+	u32 avail;
+	int res;
+
+	if (!ufs || !ufs->wb_support)
+		return ERR_NOT_SUPPORTED;
+
+	res = ufs_wb_query(ufs, ATTR_R_AVAIL_WB_BUFF_SIZE);
+	if (res)
+		return res;
+
+	avail = ufs->attributes.attr.bAvailableWriteBoosterBufferSize;
+	if (avail >= UFS_WB_AVAIL_FULL)
+		return NO_ERROR;
+
+	res = ufs_wb_query(ufs, FLAG_W_WB_FLUSH_EN);
+	if (res)
+		return res;
+
+	printf("UFS: WriteBooster flush start (%d%% available)\n", avail * 10);
+	deadline = current_time() + UFS_WB_FLUSH_TIMEOUT_MS;
+	do {
+		u_delay(1000);
+		res = ufs_wb_query(ufs, ATTR_R_WB_FLUSH_STATUS);
+		if (res)
+			break;
+		status = ufs->attributes.attr.bWBBufferFlushStatus;
+		if (status != UFS_WB_FLUSH_IN_PROGRESS &&
+					status != UFS_WB_FLUSH_IDLE)
+			break;
+		res = ufs_wb_query(ufs, ATTR_R_AVAIL_WB_BUFF_SIZE);
+		if (res)
+			break;
+		avail = ufs->attributes.attr.bAvailableWriteBoosterBufferSize;
+		if (avail >= UFS_WB_AVAIL_FULL)
+			break;
+		timeout = TIME_GTE(current_time(), deadline);
+	} while (!timeout);
+
+	ufs_wb_query(ufs, FLAG_C_WB_FLUSH_EN);
+
+	if (res)
+		return res;
+
+	if (status == UFS_WB_FLUSH_FAILURE) {
+		printf("UFS: WriteBooster flush failed\n");
+		return ERR_IO;
+	}
+
+	if (timeout) {
+		printf("UFS: WriteBooster flush timeout (%d%% available)\n", avail * 10);
+		return ERR_TIMED_OUT;
+	}
+
+	printf("UFS: WriteBooster flush done\n");
+
+	return NO_ERROR;
+}
+
+/*
+ * Fill a fastboot getvar response like "on,avail:80%,size:0x40000000,life:1".
+ * Returns non-zero if the device doesn't support WriteBooster.
+ */
+int ufs_wb_getvar(char *response)
+{
+	struct ufs_host *ufs = get_cur_ufs_host();
+	int res;
+
+	if (!ufs || !ufs->wb_support)
+		return ERR_NOT_SUPPORTED;
+
+	res = ufs_wb_query(ufs, ATTR_R_AVAIL_WB_BUFF_SIZE);
+	if (res)
+		return res;
+
+	res = ufs_wb_query(ufs, ATTR_R_WB_BUFF_LIFE_TIME_EST);
+	if (res)
+		return res;
+
+	sprintf(response, "%s,avail:%d%%,size:0x%llx,life:%d",
+			ufs->wb_enabled ? "on" : "off",
+			ufs->attributes.attr.bAvailableWriteBoosterBufferSize * 10,
+			ufs->wb_buf_size,
+			ufs->attributes.attr.bWriteBoosterBufferLifeTimeEst);
+
+	return NO_ERROR;
+}
+
 static void ufs_disable_ufsp(struct ufs_host *ufs)
 {
 	writel(0x0, ufs->fmp_addr + UFSP_UPSBEGIN0);
@@ -2107,6 +2857,7 @@ status_t ufs_init(int mode)
 	int rst_cnt = 0;
 
 	printf("\nUFS: %s: START TO INIT --------------------------------------------- \n", __func__);
+	KTRACE_BEGIN(KTRACE_BOOT, "ufs_init", mode);
 
 	// TODO:
 #if 0
@@ -2138,11 +2889,23 @@ status_t ufs_init(int mode)
 		if (r)
 			goto out;
 
+		ufs_irq_init(_ufs[i]);
+
 		/* Check if boot LUs exist */
 		r = ufs_identify_bootlun(_ufs[i]);
 		if (r)
 			goto out;
 
+		/* Check if WriteBooster is available */
+		r = ufs_wb_probe(_ufs[i]);
+		if (r)
+			goto out;
+
+		/* Check if HPB is available */
+		r = ufs_hpb_probe(_ufs[i]);
+		if (r)
+			goto out;
+
 		/* SCSI device enumeration */
 		scsi_scan(ufs_dev[i], 0, ufs_number_of_lus, scsi_exec, NULL, 128);
 		if (r)
@@ -2162,6 +2925,7 @@ out:
 	 */
 	_ufs_curr_host = 0;
 
+	KTRACE_END(KTRACE_BOOT, "ufs_init");
 	return r;
 }
 
@@ -27,6 +27,7 @@
 #include <platform.h>
 #include <platform/interrupts.h>
 #include <platform/timer.h>
+#include <stdlib.h>
 #include <trace.h>
 
 #define LOCAL_TRACE 0
@@ -124,11 +125,28 @@
 
 
 static platform_timer_callback t_callback;
+static platform_hires_timer_callback hr_callback;
+static void *hr_callback_arg;
 static int timer_irq;
 
+/*
+ * The lk_time_t timer and the high resolution timer share the one
+ * comparator of each cpu. Each keeps its own absolute deadline in
+ * cntpct ticks (0 when stopped) and the comparator is programmed with
+ * the earliest of the two.
+ */
+struct timer_deadline {
+    uint64_t lk;
+    uint64_t hires;
+} __CPU_ALIGN;
+
+static struct timer_deadline deadlines[SMP_MAX_CPUS];
+
 struct fp_32_64 cntpct_per_ms;
 struct fp_32_64 ms_per_cntpct;
 struct fp_32_64 us_per_cntpct;
+struct fp_32_64 cntpct_per_ns;
+struct fp_32_64 ns_per_cntpct;
 
 static uint64_t lk_time_to_cntpct(lk_time_t lk_time)
 {
@@ -145,6 +163,16 @@ static lk_bigtime_t cntpct_to_lk_bigtime(uint64_t cntpct)
     return u64_mul_u64_fp32_64(cntpct, us_per_cntpct);
 }
 
+static uint64_t ns_to_cntpct(uint64_t ns)
+{
+    return u64_mul_u64_fp32_64(ns, cntpct_per_ns);
+}
+
+static uint64_t cntpct_to_ns(uint64_t cntpct)
+{
+    return u64_mul_u64_fp32_64(cntpct, ns_per_cntpct);
+}
+
 static uint32_t read_cntfrq(void)
 {
     uint32_t cntfrq;
@@ -174,12 +202,6 @@ static void write_cntp_cval(uint64_t cntp_cval)
     WRITE_TIMER_REG64(TIMER_REG_CVAL, cntp_cval);
 }
 
-static void write_cntp_tval(int32_t cntp_tval)
-{
-    LTRACEF_LEVEL(3, "cntp_tval: 0x%08x, %d\n", cntp_tval, cntp_tval);
-    WRITE_TIMER_REG32(TIMER_REG_TVAL, cntp_tval);
-}
-
 static uint64_t read_cntpct(void)
 {
     uint64_t cntpct;
@@ -189,35 +211,89 @@ static uint64_t read_cntpct(void)
     return cntpct;
 }
 
+/* Called with interrupts disabled */
+static void program_comparator(void)
+{
+    struct timer_deadline *d = &deadlines[arch_curr_cpu_num()];
+    uint64_t next;
+
+    if (d->lk && d->hires)
+        next = MIN(d->lk, d->hires);
+    else
+        next = d->lk | d->hires;
+
+    if (!next) {
+        write_cntp_ctl(0);
+        return;
+    }
+
+    write_cntp_cval(next);
+    write_cntp_ctl(1);
+}
+
 static enum handler_return platform_tick(void *arg)
 {
+    struct timer_deadline *d = &deadlines[arch_curr_cpu_num()];
+    enum handler_return ret = INT_NO_RESCHEDULE;
+    uint64_t now;
+
     write_cntp_ctl(0);
-    if (t_callback) {
-        return t_callback(arg, current_time());
-    } else {
-        return INT_NO_RESCHEDULE;
+    now = read_cntpct();
+
+    /* Callbacks re-arm their own deadline if they need to */
+    if (d->hires && d->hires <= now) {
+        d->hires = 0;
+        if (hr_callback && hr_callback(hr_callback_arg, cntpct_to_ns(now)) == INT_RESCHEDULE)
+            ret = INT_RESCHEDULE;
     }
+    if (d->lk && d->lk <= now) {
+        d->lk = 0;
+        if (t_callback && t_callback(arg, current_time()) == INT_RESCHEDULE)
+            ret = INT_RESCHEDULE;
+    }
+
+    program_comparator();
+
+    return ret;
 }
 
 status_t platform_set_oneshot_timer(platform_timer_callback callback, void *arg, lk_time_t interval)
 {
-    uint64_t cntpct_interval = lk_time_to_cntpct(interval);
-
     ASSERT(arg == NULL);
 
     t_callback = callback;
-    if (cntpct_interval <= INT_MAX)
-        write_cntp_tval(cntpct_interval);
-    else
-        write_cntp_cval(read_cntpct() + cntpct_interval);
-    write_cntp_ctl(1);
+    /* A deadline of 0 means stopped, make sure an expired one still fires */
+    deadlines[arch_curr_cpu_num()].lk = MAX(read_cntpct() + lk_time_to_cntpct(interval), 1ULL);
+    program_comparator();
 
     return 0;
 }
 
 void platform_stop_timer(void)
 {
-    write_cntp_ctl(0);
+    deadlines[arch_curr_cpu_num()].lk = 0;
+    program_comparator();
+}
+
+status_t platform_set_hires_timer(platform_hires_timer_callback callback, void *arg, uint64_t deadline_ns)
+{
+    hr_callback = callback;
+    hr_callback_arg = arg;
+    deadlines[arch_curr_cpu_num()].hires = MAX(ns_to_cntpct(deadline_ns), 1ULL);
+    program_comparator();
+
+    return 0;
+}
+
+void platform_stop_hires_timer(void)
+{
+    deadlines[arch_curr_cpu_num()].hires = 0;
+    program_comparator();
+}
+
+uint64_t current_time_ns(void)
+{
+    return cntpct_to_ns(read_cntpct());
 }
 
 lk_bigtime_t current_time_hires(void)
@@ -314,6 +390,8 @@ static void arm_generic_timer_init_conversion_factors(uint32_t cntfrq)
     fp_32_64_div_32_32(&cntpct_per_ms, cntfrq, 1000);
     fp_32_64_div_32_32(&ms_per_cntpct, 1000, cntfrq);
     fp_32_64_div_32_32(&us_per_cntpct, 1000 * 1000, cntfrq);
+    fp_32_64_div_32_32(&cntpct_per_ns, cntfrq, 1000 * 1000 * 1000);
+    fp_32_64_div_32_32(&ns_per_cntpct, 1000 * 1000 * 1000, cntfrq);
     LTRACEF("cntpct_per_ms: %08x.%08x%08x\n", cntpct_per_ms.l0, cntpct_per_ms.l32, cntpct_per_ms.l64);
     LTRACEF("ms_per_cntpct: %08x.%08x%08x\n", ms_per_cntpct.l0, ms_per_cntpct.l32, ms_per_cntpct.l64);
     LTRACEF("us_per_cntpct: %08x.%08x%08x\n", us_per_cntpct.l0, us_per_cntpct.l32, us_per_cntpct.l64);
@@ -368,8 +446,8 @@ LK_INIT_HOOK_FLAGS(arm_generic_timer_init_secondary_cpu,
 static void arm_generic_timer_resume_cpu(uint level)
 {
     /* Always trigger a timer interrupt on each cpu for now */
-    write_cntp_tval(0);
-    write_cntp_ctl(1);
+    deadlines[arch_curr_cpu_num()].lk = MAX(read_cntpct(), 1ULL);
+    program_comparator();
 }
 
 LK_INIT_HOOK_FLAGS(arm_generic_timer_resume_cpu, arm_generic_timer_resume_cpu,
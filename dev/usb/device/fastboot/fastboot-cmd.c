@@ -17,16 +17,19 @@
 #include <string.h>
 #include <stdlib.h>
 #include <err.h>
+#include <kernel/ktrace.h>
 #include <kernel/thread.h>
 #include <lib/console.h>
 #include <lib/sysparam.h>
 #include <lib/font_display.h>
+#include <lib/logo_display.h>
 #include <part.h>
 #include <platform/sfr.h>
 #include <platform/smc.h>
 #include <platform/ldfw.h>
 #include <lib/lock.h>
 #include <platform/ab_update.h>
+#include <platform/ab_state.h>
 #include <platform/environment.h>
 #include <platform/dfd.h>
 #include <platform/dss_store_ramdump.h>
@@ -35,6 +38,10 @@
 #include <dev/boot.h>
 #include <dev/rpmb.h>
 #include <dev/scsi.h>
+#include <dev/ufs.h>
+#include <lib/lz4.h>
+#include <lib/miniz.h>
+#include <platform.h>
 
 #include "usb-def.h"
 
@@ -47,20 +54,33 @@
 #define USB_RX_MAGIC_DELAY	50
 
 extern void fastboot_send_info(char *response, unsigned int len);
-extern void fastboot_send_payload(void *buf, unsigned int len);
+extern void fastboot_send_payload_async(void *buf, unsigned int len);
+extern void fastboot_wait_payload(void);
+extern void fastboot_set_upload_len(unsigned long long len);
 extern void fastboot_send_status(char *response, unsigned int len, int sync);
 extern void fastboot_set_payload_data(int dir, void *buf, unsigned int len);
 extern void fasboot_set_rx_sz(unsigned int prot_req_sz);
 
 #define FB_RESPONSE_BUFFER_SIZE 128
+#define FB_FETCH_MAX_SIZE	(0x40000000)
+#define FB_LZ4_STAGE_SIZE	(16 * 1024 * 1024)
 #define LOCAL_TRACE 0
 
 unsigned int download_size = 0;
 unsigned int downloaded_data_size;
 static unsigned int is_ramdump = 0;
+/* WriteBooster was turned on by a flash in this session */
+static bool fb_wb_on;
 unsigned int s_fb_on_diskdump = 0;
 static char resp_data[FB_RESPONSE_BUFFER_SIZE];
 
+/*
+ * Data for 'upload', 'fastboot get_staged' on the host. It lives in the
+ * transfer buffer, so every download drops it.
+ */
+static void *fb_staged_buf;
+static unsigned int fb_staged_size;
+
 /* cmd_fastboot_interface	in fastboot.h	*/
 struct cmd_fastboot_interface interface =
 {
@@ -213,6 +233,16 @@ int fb_do_getvar(const char *cmd_buffer, unsigned int rx_sz)
 		if (interface.transfer_buffer_size)
 			sprintf(response + 4, "%d", interface.transfer_buffer_size);
 	}
+	else if (!memcmp(cmd_buffer + 7, "flash-compression", strlen("flash-compression")))
+	{
+		LTRACEF("fast cmd:flash-compression\n");
+		sprintf(response + 4, "lz4");
+	}
+	else if (!memcmp(cmd_buffer + 7, "max-fetch-size", strlen("max-fetch-size")))
+	{
+		LTRACEF("fast cmd:max-fetch-size\n");
+		sprintf(response + 4, "%d", FB_FETCH_MAX_SIZE);
+	}
 	else if (!memcmp(cmd_buffer + 7, "partition-type", strlen("partition-type")))
 	{
 		char *key;
@@ -399,6 +429,12 @@ int fb_do_getvar(const char *cmd_buffer, unsigned int rx_sz)
 
 		sprintf(response + 4, uid_str);
 	}
+	else if (!memcmp(cmd_buffer + 7, "writebooster", strlen("writebooster")))
+	{
+		LTRACEF("fast cmd:writebooster\n");
+		if (ufs_wb_getvar(response + 4))
+			sprintf(response, "FAILnot support");
+	}
 	else if (!memcmp(cmd_buffer + 7, "str_ram", strlen("str_ram")))
 	{
 		debug_store_ramdump_getvar(cmd_buffer + 15, response + 4);
@@ -460,6 +496,10 @@ int fb_do_erase(const char *cmd_buffer, unsigned int rx_sz)
 		printf("erasing(formatting) '%s'\n", key);
 
 		status = part_erase(part);
+		if (!strcmp(key, AB_SLOTINFO_PART_NAME))
+			ab_state_invalidate();
+		else if (!strcmp(key, "logo"))
+			logo_cache_flush();
 	}
 
 	if (status) {
@@ -474,6 +514,103 @@ int fb_do_erase(const char *cmd_buffer, unsigned int rx_sz)
 	return 0;
 }
 
+struct fb_lz4_sink {
+	void *part;
+	u64 offset;
+	u64 length;
+	/* unit of the partition writes */
+	u32 block_size;
+};
+
+static int fb_lz4_flush(void *arg, const void *buf, size_t len)
+{
+	struct fb_lz4_sink *sink = (struct fb_lz4_sink *)arg;
+	size_t size = ROUNDUP(len, sink->block_size);
+
+	if (sink->length && sink->offset + len > sink->length) {
+		printf("lz4: decoded data exceeds partition (0x%llx)\n", sink->length);
+		return ERR_TOO_BIG;
+	}
+
+	/* Only the last flush can be unaligned, zero the rest of its block */
+	memset((u8 *)buf + len, 0, size - len);
+
+	if (part_write_partial(sink->part, (void *)buf, sink->offset, size))
+		return ERR_IO;
+
+	sink->offset += len;
+
+	return 0;
+}
+
+/*
+ * Flash an LZ4 framed image. Blocks are decoded into a staging area
+ * behind the downloaded data and written out whenever it fills up, so
+ * the decoded image never has to fit in memory.
+ */
+static void flash_lz4_using_part(char *key, char *response, void *part,
+		u64 length, u32 size, void *addr)
+{
+	struct fb_lz4_sink sink;
+	struct lz4_dec dec;
+	const char *type;
+	lk_bigtime_t start;
+	u64 stage;
+	u64 content_size;
+	int ret;
+
+	type = part_get_fs_type(part);
+	if (type && *type) {
+		sprintf(response, "FAILcompressed image not supported for %s", type);
+		return;
+	}
+
+	ret = lz4_frame_content_size(addr, size, &content_size);
+	if (ret == 0 && length && content_size > length) {
+		printf("lz4: '%s' image is 0x%llx bytes, partition is 0x%llx\n",
+				key, content_size, length);
+		sprintf(response, "FAILimage too large for partition");
+		return;
+	} else if (ret && ret != ERR_NOT_FOUND) {
+		sprintf(response, "FAILinvalid lz4 image (%d)", ret);
+		return;
+	}
+
+	sink.part = part;
+	sink.offset = 0;
+	sink.length = length;
+	sink.block_size = MAX(part_get_block_size(), (u32)PART_SECTOR_SIZE);
+
+	/* Staging area plus one block for padding the last write */
+	stage = ROUNDUP((u64)size, 0x1000);
+	if (stage + FB_LZ4_STAGE_SIZE + sink.block_size > interface.transfer_buffer_size) {
+		sprintf(response, "FAILno room to decode image");
+		return;
+	}
+
+	dec.buf = interface.transfer_buffer + stage;
+	dec.size = FB_LZ4_STAGE_SIZE;
+	dec.align = sink.block_size;
+	dec.flush = fb_lz4_flush;
+	dec.arg = &sink;
+
+	printf("lz4: flashing '%s' from 0x%x bytes\n", key, size);
+	start = current_time_hires();
+	ret = lz4_frame_decode(&dec, addr, size);
+	if (ret) {
+		printf("flashing '%s' failed: %d at 0x%llx\n", key, ret, dec.out_bytes);
+		print_lcd_update(FONT_RED, FONT_BLACK, "flashing '%s' failed", key);
+		sprintf(response, "FAILfailed to flash compressed image (%d)", ret);
+		return;
+	}
+
+	printf("lz4: 0x%x -> 0x%llx bytes in %llu ms\n", size, dec.out_bytes,
+			(current_time_hires() - start) / 1000);
+	printf("partition '%s' flashed\n\n", key);
+	print_lcd_update(FONT_GREEN, FONT_BLACK, "partition '%s' flashed", key);
+	sprintf(response, "OKAY");
+}
+
 static void flash_using_part(char *key, char *response,
 		u32 size, void *addr)
 {
@@ -503,6 +640,9 @@ static void flash_using_part(char *key, char *response,
 		sprintf(response, "FAILpartition does not exist");
 	} else if ((downloaded_data_size > length) && (length != 0)) {
 		sprintf(response, "FAILimage too large for partition");
+	} else if (lz4_is_frame(addr, downloaded_data_size)) {
+		flash_lz4_using_part(key, response, part, length,
+				downloaded_data_size, addr);
 	} else {
 		if ((length != 0) && (downloaded_data_size > length)) {
 			printf("flashing '%s' failed\n", key);
@@ -519,6 +659,12 @@ static void flash_using_part(char *key, char *response,
 		}
 	}
 
+	/* Slot info or logos were replaced under the cached copy */
+	if (!strcmp(key, AB_SLOTINFO_PART_NAME))
+		ab_state_invalidate();
+	else if (!strcmp(key, "logo"))
+		logo_cache_flush();
+
 	if (!strcmp(key, "ramdisk")) {
 		part = part_get("env");
 		env_val = memalign(0x1000, part_get_size_in_bytes(part));
@@ -554,6 +700,14 @@ int fb_do_flash(const char *cmd_buffer, unsigned int rx_sz)
 #endif
 	dprintf(ALWAYS, "flash\n");
 
+	/*
+	 * Flashing is a bulk write, go through WriteBooster buffer. It stays
+	 * on for the rest of the session and is flushed once, by
+	 * platform_prepare_reboot().
+	 */
+	if (!fb_wb_on)
+		fb_wb_on = ufs_wb_begin() >= 0;
+
 	strcpy(response,"OKAY");
 	flash_using_part((char *)cmd_buffer + 6, response,
 			downloaded_data_size, (void *)interface.transfer_buffer);
@@ -623,6 +777,7 @@ int fb_do_download(const char *cmd_buffer, unsigned int rx_sz)
 	/* Get download size */
 	download_size = (unsigned int)strtol(cmd_buffer + 9, NULL, 16);
 	downloaded_data_size = 0;
+	fb_staged_size = 0;
 
 	LTRACEF_LEVEL(INFO, "Downloaing. Download size is [%d, %d] bytes\n", download_size, interface.transfer_buffer_size);
 
@@ -676,6 +831,7 @@ int fb_do_ramdump(const char *cmd_buffer, unsigned int rx_sz)
 	/* Get download size */
 	download_size = (unsigned int)strtol(cmd_buffer + 8, NULL, 16);
 	downloaded_data_size = 0;
+	fb_staged_size = 0;
 
 	LTRACEF_LEVEL(INFO, "Downloaing. Download size is %d bytes\n", download_size);
 
@@ -706,6 +862,8 @@ int fb_do_set_active(const char *cmd_buffer, unsigned int rx_sz)
 		sprintf(response, "FAILnot support");
 	} else {
 		sprintf(response,"OKAY");
+		/* Start from what is on storage, the OS may have updated it */
+		ab_state_reload();
 		if (!strcmp(cmd_buffer + 11, "a")) {
 			printf("Set slot 'a' active.\n");
 			print_lcd_update(FONT_GREEN, FONT_BLACK, "Set slot 'a' active.");
@@ -766,6 +924,34 @@ int fb_do_flashing(const char *cmd_buffer, unsigned int rx_sz)
 	return 0;
 }
 
+/*
+ * oem ktrace
+ *
+ * Stage the kernel trace as Chrome trace event JSON, to be read with
+ * 'fastboot get_staged trace.json' and opened in Perfetto.
+ */
+static void fb_do_oem_ktrace(char *response)
+{
+#if WITH_KERNEL_TRACE
+	ssize_t len;
+
+	fb_staged_size = 0;
+	len = ktrace_export_buf(interface.transfer_buffer, interface.transfer_buffer_size);
+	if (len < 0) {
+		sprintf(response, "FAILtrace export failed: %d", (int)len);
+	} else {
+		fb_staged_buf = interface.transfer_buffer;
+		fb_staged_size = len;
+		sprintf(response, "INFO%u bytes of trace staged", fb_staged_size);
+		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+		sprintf(response, "OKAY");
+	}
+#else
+	sprintf(response, "FAILnot built with WITH_KERNEL_TRACE");
+#endif
+	fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+}
+
 int fb_do_oem(const char *cmd_buffer, unsigned int rx_sz)
 {
 	char buf[FB_RESPONSE_BUFFER_SIZE];
@@ -894,6 +1080,8 @@ int fb_do_oem(const char *cmd_buffer, unsigned int rx_sz)
 			sprintf(response, "FAILunsupported command");
 
 		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+	} else if (!strncmp(cmd_buffer + 4, "ktrace", 6)) {
+		fb_do_oem_ktrace(response);
 	} else if (!strncmp(cmd_buffer + 4, "edl", 3)) {
 		sprintf(response, "OKAY");
 		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
@@ -963,33 +1151,212 @@ int fb_do_partinfo(const char *cmd_buffer, unsigned int rx_sz)
 	return 0;
 }
 
-static u32 start_diskdump(void *buf, u32 start_in_secs, u32 size_in_bytes)
+/*
+ * Streaming upload for 'diskdump:' and 'fetch:'
+ *
+ * The range is sent in FB_STREAM_CHUNK_SIZE pieces using two slots in the
+ * transfer buffer. While chunk N is in flight on the bulk-in endpoint,
+ * chunk N+1 is read from storage (and deflated, if requested) into the
+ * other slot, so the size of the range is not limited by the transfer
+ * buffer and storage and USB run at the same time.
+ *
+ * With compression, every chunk is sent as a frame: a FB_STREAM_FRAME_ALIGN
+ * sized header block holding struct fb_stream_frame, followed by the payload
+ * padded up to FB_STREAM_FRAME_ALIGN. The payload is a zlib stream (RFC
+ * 1950, with its Adler-32), or the chunk itself when it does not compress.
+ * Keeping every transfer a multiple of the USB packet size lets the host
+ * read the frames as one byte stream. tools/fbunzip turns a captured
+ * stream back into the raw image.
+ */
+#ifndef FB_STREAM_CHUNK_SIZE
+#define FB_STREAM_CHUNK_SIZE	(4 * 1024 * 1024)
+#endif
+#define FB_STREAM_FRAME_ALIGN	512
+#define FB_STREAM_FRAME_MAGIC	0x46425a46	/* "FZBF" */
+#define FB_STREAM_SLOT_SIZE	(2 * (FB_STREAM_CHUNK_SIZE + FB_STREAM_FRAME_ALIGN))
+#define FB_STREAM_DEFLATE_FLAGS	(1 | TDEFL_GREEDY_PARSING_FLAG | TDEFL_WRITE_ZLIB_HEADER)
+
+enum {
+	FB_STREAM_FRAME_RAW = 0,
+	FB_STREAM_FRAME_ZLIB = 1,
+};
+
+struct fb_stream_frame {
+	u32 magic;
+	u32 type;
+	u32 raw_len;	/* bytes of storage data in this frame */
+	u32 len;	/* payload bytes following the header block */
+};
+
+struct fb_stream_slot {
+	u8 *raw;
+	u8 *zbuf;
+	void *tx;
+	u32 tx_len;
+};
+
+struct fb_stream {
+	/* Read len bytes at offset from the start of the stream */
+	int (*read)(struct fb_stream *s, void *buf, u64 offset, u32 len);
+	void *part;
+	u64 base;
+	u64 size;
+	u64 done;
+	int err;
+	tdefl_compressor *comp;
+	struct fb_stream_slot slot[2];
+	u64 raw_bytes;
+	u64 tx_bytes;
+};
+
+static int fb_stream_read_disk(struct fb_stream *s, void *buf, u64 offset, u32 len)
+{
+	u32 size_in_secs = len / PART_SECTOR_SIZE;
+
+	if (part_read_raw(buf, (u32)(s->base + offset / PART_SECTOR_SIZE), &size_in_secs))
+		return -1;
+
+	return (size_in_secs * PART_SECTOR_SIZE == len) ? 0 : -1;
+}
+
+static int fb_stream_read_part(struct fb_stream *s, void *buf, u64 offset, u32 len)
+{
+	return part_read_partial(s->part, buf, s->base + offset, len);
+}
+
+static void fb_stream_init(struct fb_stream *s, int compress)
+{
+	u8 *p = (u8 *)interface.transfer_buffer;
+	int i;
+
+	s->done = 0;
+	s->err = 0;
+	s->raw_bytes = 0;
+	s->tx_bytes = 0;
+	s->comp = NULL;
+
+	for (i = 0; i < 2; i++) {
+		s->slot[i].raw = p + FB_STREAM_FRAME_ALIGN;
+		s->slot[i].zbuf = p + FB_STREAM_CHUNK_SIZE + 2 * FB_STREAM_FRAME_ALIGN;
+		p += FB_STREAM_SLOT_SIZE;
+	}
+
+	if (compress) {
+		s->comp = malloc(sizeof(tdefl_compressor));
+		if (!s->comp)
+			printf("%s: no memory for compressor, sending raw\n", __func__);
+	}
+}
+
+static void fb_stream_exit(struct fb_stream *s)
 {
-	u32 size_in_secs = size_in_bytes / PART_SECTOR_SIZE;
+	free(s->comp);
+	s->comp = NULL;
+}
+
+static void fb_stream_frame(struct fb_stream *s, struct fb_stream_slot *slot, u32 len)
+{
+	struct fb_stream_frame *hdr;
+	size_t in_len = len;
+	size_t out_len = FB_STREAM_CHUNK_SIZE;
+	tdefl_status status;
+	u32 type = FB_STREAM_FRAME_RAW;
+	u8 *payload = slot->raw;
+	u32 payload_len = len;
+	u32 padded;
+
+	tdefl_init(s->comp, NULL, NULL, FB_STREAM_DEFLATE_FLAGS);
+	status = tdefl_compress(s->comp, slot->raw, &in_len,
+			slot->zbuf, &out_len, TDEFL_FINISH);
+	if (status == TDEFL_STATUS_DONE && in_len == len && out_len < len) {
+		type = FB_STREAM_FRAME_ZLIB;
+		payload = slot->zbuf;
+		payload_len = out_len;
+	}
+
+	padded = ROUNDUP(payload_len, FB_STREAM_FRAME_ALIGN);
+	memset(payload + payload_len, 0, padded - payload_len);
 
-	printf("\ndiskdump start: %p, 0x%x, 0x%x\n", buf, start_in_secs, size_in_bytes);
+	hdr = (struct fb_stream_frame *)(payload - FB_STREAM_FRAME_ALIGN);
+	memset(hdr, 0, FB_STREAM_FRAME_ALIGN);
+	hdr->magic = FB_STREAM_FRAME_MAGIC;
+	hdr->type = type;
+	hdr->raw_len = len;
+	hdr->len = payload_len;
 
-	/* Read disk */
-	if (part_read_raw(buf, start_in_secs, &size_in_secs)) {
-		/* Target disk read */
-		printf("Failed to read disk !\n");
-		return 0xFFFFFFFF;
+	slot->tx = hdr;
+	slot->tx_len = FB_STREAM_FRAME_ALIGN + padded;
+}
+
+/* Read (and compress) the chunk at offset into slot */
+static void fb_stream_prepare(struct fb_stream *s, struct fb_stream_slot *slot, u64 offset)
+{
+	u32 len = (u32)MIN((u64)FB_STREAM_CHUNK_SIZE, s->size - offset);
+
+	if (s->read(s, slot->raw, offset, len)) {
+		/* Keep the stream length the host expects, report in the status */
+		printf("%s: read failed at 0x%llx (0x%x bytes)\n", __func__,
+				s->base + offset, len);
+		memset(slot->raw, 0, len);
+		s->err = 1;
+	} else if (!s->err) {
+		s->done = offset + len;
+	}
+	s->raw_bytes += len;
+
+	if (s->comp) {
+		fb_stream_frame(s, slot, len);
+	} else {
+		slot->tx = slot->raw;
+		slot->tx_len = len;
 	}
+}
+
+static int fb_stream_run(struct fb_stream *s)
+{
+	lk_bigtime_t start = current_time_hires();
+	lk_bigtime_t elapsed;
+	struct fb_stream_slot *slot;
+	u64 offset = 0;
+	int cur = 0;
+
+	/* Raw uploads are one data phase, compressed frames are sent one by one */
+	if (!s->comp)
+		fastboot_set_upload_len(s->size);
+
+	fb_stream_prepare(s, &s->slot[cur], offset);
+
+	while (offset < s->size) {
+		slot = &s->slot[cur];
+		fastboot_send_payload_async(slot->tx, slot->tx_len);
+		s->tx_bytes += slot->tx_len;
 
-	/* Transfer data to host */
-	fastboot_send_payload(buf, size_in_secs * PART_SECTOR_SIZE);
+		offset += MIN((u64)FB_STREAM_CHUNK_SIZE, s->size - offset);
+		cur ^= 1;
+		if (offset < s->size)
+			fb_stream_prepare(s, &s->slot[cur], offset);
 
-	return size_in_secs;
+		fastboot_wait_payload();
+	}
+
+	elapsed = current_time_hires() - start;
+	printf("stream: 0x%llx bytes (0x%llx on wire) in %llu ms, %llu KB/s\n",
+			s->raw_bytes, s->tx_bytes, elapsed / 1000,
+			elapsed ? (s->raw_bytes * 1000000 / elapsed) >> 10 : 0);
+
+	return s->err ? -1 : 0;
 }
 
 int fb_do_diskdump(const char *cmd_buffer, unsigned int rx_sz)
 {
 	char buf[FB_RESPONSE_BUFFER_SIZE];
 	char *response = (char *)(((unsigned long)buf + 8) & ~0x07);
+	struct fb_stream s;
 
 	u32 start_in_secs;
 	u32 size_in_secs;
 	u32 done;
+	int compress;
 	int res = -1;
 	char *p = (char *)cmd_buffer;
 
@@ -1008,14 +1375,19 @@ int fb_do_diskdump(const char *cmd_buffer, unsigned int rx_sz)
 	*(resp_data + 8) = '\0';
 	size_in_secs = (u32)strtol(resp_data, NULL, 16);
 
-	printf("Starting download of %u blocks from start_in_secs %u\n", size_in_secs, start_in_secs);
+	/* 'diskdump:SSSSSSSSNNNNNNNN:z' requests zlib frames */
+	p += 8;
+	compress = !strcmp(p, ":z");
+
+	printf("Starting download of %u blocks from start_in_secs %u%s\n",
+			size_in_secs, start_in_secs, compress ? " (compressed)" : "");
+
+	/* Clip to the end of the disk so that the host knows what follows */
+	part_get_range_by_range(&start_in_secs, &size_in_secs);
 
 	/* Check */
 	if (0 == size_in_secs)
 		sprintf(response, "FAILdata invalid size");
-	else if (size_in_secs * PART_SECTOR_SIZE > interface.transfer_buffer_size)
-		sprintf(response, "FAILdata too large: %u > %u",
-				size_in_secs * PART_SECTOR_SIZE, interface.transfer_buffer_size);
 	else {
 		sprintf(response, "OKAY");
 		res = 0;
@@ -1027,7 +1399,19 @@ int fb_do_diskdump(const char *cmd_buffer, unsigned int rx_sz)
 	fastboot_send_info(response, strlen(response));
 
 	if (res == 0) {
-		done = start_diskdump((void *)CFG_FASTBOOT_TRANSFER_BUFFER, start_in_secs, size_in_secs * PART_SECTOR_SIZE);
+		printf("\ndiskdump start: 0x%x, 0x%x\n", start_in_secs, size_in_secs);
+
+		s.read = fb_stream_read_disk;
+		s.part = NULL;
+		s.base = start_in_secs;
+		s.size = (u64)size_in_secs * PART_SECTOR_SIZE;
+		fb_stream_init(&s, compress);
+		fb_stream_run(&s);
+		fb_stream_exit(&s);
+
+		done = (u32)(s.done / PART_SECTOR_SIZE);
+		if (!done)
+			done = 0xFFFFFFFF;
 
 		/* Return BLKCOUNT to host */
 		printf("BLKCOUNT%08x\n", done);
@@ -1041,6 +1425,126 @@ int fb_do_diskdump(const char *cmd_buffer, unsigned int rx_sz)
 	return 0;
 }
 
+/*
+ * fetch:<partition>[:<offset>[:<size>]]
+ *
+ * Upload part of a partition. offset and size are hexadecimal and
+ * default to the whole partition. The host splits larger reads into
+ * max-fetch-size requests.
+ */
+int fb_do_fetch(const char *cmd_buffer, unsigned int rx_sz)
+{
+	char buf[FB_RESPONSE_BUFFER_SIZE];
+	char *response = (char *)(((unsigned long)buf + 8) & ~0x07);
+	char name[FB_RESPONSE_BUFFER_SIZE];
+	struct fb_stream s;
+	const char *p = cmd_buffer + 6;
+	char *end;
+	void *part;
+	u64 part_size;
+	u64 offset = 0;
+	u64 size;
+	size_t len;
+	int res = -1;
+
+	len = strcspn(p, ":");
+	if (!len || len >= sizeof(name)) {
+		sprintf(response, "FAILinvalid partition");
+		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+		return 0;
+	}
+	memcpy(name, p, len);
+	name[len] = '\0';
+	p += len;
+
+	part = part_get(name);
+	if (!part) {
+		sprintf(response, "FAILpartition does not exist");
+		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+		return 0;
+	}
+	part_size = part_get_size_in_bytes(part);
+	size = part_size;
+
+	if (*p == ':') {
+		offset = strtoll(p + 1, &end, 16);
+		p = end;
+		size = (offset < part_size) ? part_size - offset : 0;
+	}
+	if (*p == ':')
+		size = strtoll(p + 1, &end, 16);
+
+	if (!size || offset >= part_size || size > part_size - offset) {
+		sprintf(response, "FAILinvalid range");
+	} else if (size > FB_FETCH_MAX_SIZE) {
+		sprintf(response, "FAILdata too large: 0x%llx > 0x%x", size, FB_FETCH_MAX_SIZE);
+	} else if (offset % PART_SECTOR_SIZE) {
+		sprintf(response, "FAILoffset not aligned to 0x%x", PART_SECTOR_SIZE);
+	} else if (size % PART_SECTOR_SIZE) {
+		sprintf(response, "FAILsize not aligned to 0x%x", PART_SECTOR_SIZE);
+	} else {
+		res = 0;
+	}
+	if (res) {
+		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+		return 0;
+	}
+
+	printf("fetch %s: 0x%llx@0x%llx\n", name, size, offset);
+
+	s_fb_on_diskdump = 1;
+
+	sprintf(response, "DATA%08x", (u32)size);
+	fastboot_send_info(response, strlen(response));
+
+	s.read = fb_stream_read_part;
+	s.part = part;
+	s.base = offset;
+	s.size = size;
+	fb_stream_init(&s, 0);
+	if (fb_stream_run(&s))
+		sprintf(response, "FAILread error at 0x%llx", offset + s.done);
+	else
+		sprintf(response, "OKAY");
+	fb_stream_exit(&s);
+
+	s_fb_on_diskdump = 0;
+	fastboot_send_status(response, strlen(response), FASTBOOT_TX_SYNC);
+
+	return 0;
+}
+
+/* Send what an earlier command staged */
+int fb_do_upload(const char *cmd_buffer, unsigned int rx_sz)
+{
+	char buf[FB_RESPONSE_BUFFER_SIZE];
+	char *response = (char *)(((unsigned long)buf + 8) & ~0x07);
+	unsigned int offset, len;
+
+	if (!fb_staged_size) {
+		sprintf(response, "FAILnothing staged");
+		fastboot_send_status(response, strlen(response), FASTBOOT_TX_ASYNC);
+		return 0;
+	}
+
+	sprintf(response, "DATA%08x", fb_staged_size);
+	fastboot_send_info(response, strlen(response));
+
+	fastboot_set_upload_len(fb_staged_size);
+	for (offset = 0; offset < fb_staged_size; offset += len) {
+		len = MIN(fb_staged_size - offset, FB_STREAM_CHUNK_SIZE);
+		fastboot_send_payload((u8 *)fb_staged_buf + offset, len);
+	}
+
+	/* the transfer buffer is reused by the next download */
+	fb_staged_size = 0;
+
+	sprintf(response, "OKAY");
+	fastboot_send_status(response, strlen(response), FASTBOOT_TX_SYNC);
+
+	return 0;
+}
+
 struct cmd_fastboot cmd_list[] = {
 	{"reboot", fb_do_reboot},
 	{"flash:", fb_do_flash},
@@ -1056,6 +1560,8 @@ struct cmd_fastboot cmd_list[] = {
 	{"diskinfo:", fb_do_diskinfo},
 	{"partinfo:", fb_do_partinfo},
 	{"diskdump:", fb_do_diskdump},
+	{"fetch:", fb_do_fetch},
+	{"upload", fb_do_upload},
 };
 
 int rx_handler(const unsigned char *buffer, unsigned int buffer_size)
@@ -1075,8 +1581,11 @@ int rx_handler(const unsigned char *buffer, unsigned int buffer_size)
 		start_ramdump((void *)buffer);
 	} else {
 		for (i = 0; i < (sizeof(cmd_list) / sizeof(struct cmd_fastboot)); i++) {
-			if(!memcmp(cmd_buffer, cmd_list[i].cmd_name, strlen(cmd_list[i].cmd_name)))
+			if(!memcmp(cmd_buffer, cmd_list[i].cmd_name, strlen(cmd_list[i].cmd_name))) {
+				KTRACE_BEGIN(KTRACE_USB, cmd_list[i].cmd_name, buffer_size);
 				cmd_list[i].handler(cmd_buffer, buffer_size);
+				KTRACE_END(KTRACE_USB, cmd_list[i].cmd_name);
+			}
 		}
 	}
 
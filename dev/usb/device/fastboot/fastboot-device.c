@@ -65,7 +65,7 @@ enum {
 
 extern unsigned int s_fb_on_diskdump;
 
-void fastboot_send_status(char *response, unsigned int len, int sync);
+static void usb_send_status(char *response, unsigned int len, int sync);
 
 static void ready_to_rx_cmd(void)
 {
@@ -115,7 +115,7 @@ static void check_payload_done(unsigned int xfer_sz)
 	if (fastboot_h.payload_req_len == 0) {
 		fastboot_h.payload_phase = FASTBOOT_PAYLOAD_NONE;
 		if (fastboot_h.payload_dir == USBDIR_OUT)
-			fastboot_send_status((char *) "OKAY", 4, FASTBOOT_TX_ASYNC);
+			usb_send_status((char *) "OKAY", 4, FASTBOOT_TX_ASYNC);
 		else
 			ready_to_rx_cmd();
 	} else {
@@ -155,7 +155,7 @@ static void tx_status_callback(void *handle)
 	LTRACE_EXIT;
 }
 
-void fastboot_set_payload_data(int dir, void *buf, unsigned int len)
+static void usb_set_payload_data(int dir, void *buf, unsigned int len)
 {
 	fastboot_h.payload_phase = FASTBOOT_PAYLOAD_START_MARK;
 	fastboot_h.payload_dir = dir;
@@ -163,12 +163,12 @@ void fastboot_set_payload_data(int dir, void *buf, unsigned int len)
 	fastboot_h.payload_req_len = len;
 }
 
-void fasboot_set_rx_sz(unsigned int prot_req_sz)
+static void usb_set_rx_sz(unsigned int prot_req_sz)
 {
 	fastboot_h.prot_req_rx_sz = prot_req_sz;
 }
 
-void fastboot_send_info(char *response, unsigned int len)
+static void usb_send_info(char *response, unsigned int len)
 {
 	LTRACE_ENTRY;
 
@@ -198,16 +198,27 @@ void fastboot_send_info(char *response, unsigned int len)
 	LTRACE_EXIT;
 }
 
-void fastboot_send_payload(void *buf, unsigned int len)
+/*
+ * Start bulk-in transfer of buf and return without waiting, so that
+ * the caller can prepare the next chunk while this one is on the bus.
+ * usb_wait_payload() must be called before the next transfer.
+ */
+static void usb_send_payload_async(void *buf, unsigned int len)
 {
 	LTRACE_ENTRY;
 
 	/* Mark for not trasiante state mahcine */
 	fastboot_h.just_info = 1;
-	//memcpy(fastboot_h.tx_response_buf, response, len);
 	gadget_ep_set_buf(fastboot_h.bulk_in_ep, buf, len, GADGET_BUF_LAST);
 	gadget_ep_start(fastboot_h.bulk_in_ep);
 
+	LTRACE_EXIT;
+}
+
+static void usb_wait_payload(void)
+{
+	LTRACE_ENTRY;
+
 	/* Check transfer done */
 	event_wait(&fastboot_h.tx_done_event);
 	event_unsignal(&fastboot_h.tx_done_event);
@@ -217,7 +228,7 @@ void fastboot_send_payload(void *buf, unsigned int len)
 	LTRACE_EXIT;
 }
 
-void fastboot_send_status(char *response, unsigned int len, int sync)
+static void usb_send_status(char *response, unsigned int len, int sync)
 {
 	LTRACE_ENTRY;
 
@@ -248,9 +259,20 @@ void fastboot_send_status(char *response, unsigned int len, int sync)
 	LTRACE_EXIT;
 }
 
+static const struct fastboot_transport usb_transport = {
+	.name = "usb",
+	.send_info = usb_send_info,
+	.send_status = usb_send_status,
+	.set_payload_data = usb_set_payload_data,
+	.send_payload_async = usb_send_payload_async,
+	.wait_payload = usb_wait_payload,
+	.set_rx_sz = usb_set_rx_sz,
+};
+
 static int wait_rx_done(void *arg)
 {
 	unsigned int rx_sz = 0;
+	bool locked = false;
 	int ret;
 
 	for (;;) {
@@ -267,6 +289,12 @@ static int wait_rx_done(void *arg)
 		}
 		LTRACEF("Receive size is %d\n", rx_sz);
 		LTRACEF("Payload Phase:%d\n", fastboot_h.payload_phase);
+
+		if (!locked) {
+			fastboot_acquire_transport(&usb_transport);
+			locked = true;
+		}
+
 		if (fastboot_h.payload_phase == FASTBOOT_PAYLOAD_IN_PROGRESS)
 			check_payload_done(rx_sz);
 		else {
@@ -274,6 +302,13 @@ static int wait_rx_done(void *arg)
 			rx_handler(fastboot_h.rx_cmd_buf, rx_sz);
 			memset(fastboot_h.rx_cmd_buf, '\0', rx_sz);
 		}
+
+		/* Keep other transports out until a download has landed */
+		if (fastboot_h.payload_phase == FASTBOOT_PAYLOAD_NONE ||
+				fastboot_h.payload_dir != USBDIR_OUT) {
+			fastboot_release_transport();
+			locked = false;
+		}
 		LTRACE_EXIT;
 	}
 	return 0;
@@ -369,6 +404,7 @@ static void fasboot_probe(uint level)
 
 	event_init(&fastboot_h.rx_done_event , false, 0);
 	event_init(&fastboot_h.tx_done_event , false, 0);
+	fastboot_register_default_transport(&usb_transport);
 	thread_resume(thread_create("fastboot rx handle", &wait_rx_done, NULL, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE));
 }
 LK_INIT_HOOK(fasboot_probe, &fasboot_probe, LK_INIT_LEVEL_KERNEL);
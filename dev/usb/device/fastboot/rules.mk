@@ -2,7 +2,11 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 
 MODULE := $(LOCAL_DIR)
 
-MODULE_DEPS += dev/usb/device
+MODULE_DEPS += \
+	dev/usb/device \
+	external/lib/miniz \
+	lib/fastboot \
+	lib/lz4
 
 MODULE_SRCS += \
 	$(LOCAL_DIR)/fastboot-device.c \
@@ -16,6 +16,8 @@
 #include <malloc.h>
 #include <lk/init.h>
 #include <list.h>
+#include <kernel/thread.h>
+#include <platform/delay.h>
 
 #include <usb-def.h>
 #include "dev/usb/gadget.h"
@@ -552,6 +554,19 @@ void stop_usb_gadget(void)
 	target_terminate_for_usb();
 }
 
+/*
+ * Controller state changes without a completion interrupt, e.g. waiting
+ * for the device to halt. Let other threads run unless called from the
+ * ISR or the halt path.
+ */
+void gadget_wait_ms(unsigned int ms)
+{
+	if (arch_ints_disabled())
+		mdelay(ms);
+	else
+		thread_sleep(ms);
+}
+
 void gadgeg_dev_polling_handle(void)
 {
 	struct gadget_dev_ops *dev_ops;
@@ -454,7 +454,7 @@ u8 dwc3_dev_WaitDevControlHalted(DWC3_DEV_HANDLER dwc3_dev_h)
 			bRet = true;
 			break;
 		}
-		mdelay(1);
+		gadget_wait_ms(1);
 	} while (sTimeOut-- > 0);
 	return bRet;
 }
@@ -646,7 +646,7 @@ u8 dwc3_dev_sw_reconn(DWC3_DEV_HANDLER dwc3_dev_h)
 	dwc3_glb_phy_dp_pullup_en(dwc3_dev_h->glb_dev_h, false);
 	/* Stop Link : Disconnect terminaion */
 	dwc3_dev_set_rs(dwc3_dev_h, 0);
-	mdelay(30);
+	gadget_wait_ms(30);
 	/* Wait control halted */
 	do {
 		oDSTS.data = DWC3_REG_RD32(rDSTS);
@@ -29,9 +29,11 @@
 #include <list.h>
 #include <err.h>
 #include <string.h>
+#include <stdlib.h>
 #include <kernel/thread.h>
 #include <kernel/event.h>
 #include <kernel/mutex.h>
+#include <kernel/spinlock.h>
 #include <kernel/vm.h>
 #include <dev/display.h>
 
@@ -39,6 +41,9 @@
 
 #define LOCAL_TRACE 0
 
+/* the resource is this many screens tall, the scanout pans over it */
+#define VIRTIO_GPU_PAN_SCREENS 2
+
 static enum handler_return virtio_gpu_irq_driver_callback(struct virtio_device *dev, uint ring, const struct vring_used_elem *e);
 static enum handler_return virtio_gpu_config_change_callback(struct virtio_device *dev);
 static int virtio_gpu_flush_thread(void *arg);
@@ -64,8 +69,17 @@ struct virtio_gpu_dev {
 
     event_t flush_event;
 
+    /* damage not yet sent to the host, empty when width is 0 */
+    spin_lock_t damage_lock;
+    struct virtio_gpu_rect damage;
+
+    /* first resource row of the scanout, requested and current */
+    uint32_t pan_y;
+    uint32_t scanout_y;
+
     /* framebuffer */
     void *fb;
+    uint32_t fb_height;
 };
 
 static struct virtio_gpu_dev *the_gdev;
@@ -246,11 +260,11 @@ static status_t attach_backing(struct virtio_gpu_dev *gdev, uint32_t resource_id
     return err;
 }
 
-static status_t set_scanout(struct virtio_gpu_dev *gdev, uint32_t scanout_id, uint32_t resource_id, uint32_t width, uint32_t height)
+static status_t set_scanout(struct virtio_gpu_dev *gdev, uint32_t scanout_id, uint32_t resource_id, uint32_t y, uint32_t width, uint32_t height)
 {
     status_t err;
 
-    LTRACEF("gdev %p, scanout_id %u, resource_id %u, width %u, height %u\n", gdev, scanout_id, resource_id, width, height);
+    LTRACEF("gdev %p, scanout_id %u, resource_id %u, y %u, width %u, height %u\n", gdev, scanout_id, resource_id, y, width, height);
 
     /* grab a lock to keep this single message at a time */
     mutex_acquire(&gdev->lock);
@@ -260,7 +274,8 @@ static status_t set_scanout(struct virtio_gpu_dev *gdev, uint32_t scanout_id, ui
     memset(&req, 0, sizeof(req));
 
     req.hdr.type = VIRTIO_GPU_CMD_SET_SCANOUT;
-    req.r.x = req.r.y = 0;
+    req.r.x = 0;
+    req.r.y = y;
     req.r.width = width;
     req.r.height = height;
     req.scanout_id = scanout_id;
@@ -281,11 +296,11 @@ static status_t set_scanout(struct virtio_gpu_dev *gdev, uint32_t scanout_id, ui
     return err;
 }
 
-static status_t flush_resource(struct virtio_gpu_dev *gdev, uint32_t resource_id, uint32_t width, uint32_t height)
+static status_t flush_resource(struct virtio_gpu_dev *gdev, uint32_t resource_id, const struct virtio_gpu_rect *r)
 {
     status_t err;
 
-    LTRACEF("gdev %p, resource_id %u, width %u, height %u\n", gdev, resource_id, width, height);
+    LTRACEF("gdev %p, resource_id %u, x %u, y %u, width %u, height %u\n", gdev, resource_id, r->x, r->y, r->width, r->height);
 
     /* grab a lock to keep this single message at a time */
     mutex_acquire(&gdev->lock);
@@ -295,9 +310,7 @@ static status_t flush_resource(struct virtio_gpu_dev *gdev, uint32_t resource_id
     memset(&req, 0, sizeof(req));
 
     req.hdr.type = VIRTIO_GPU_CMD_RESOURCE_FLUSH;
-    req.r.x = req.r.y = 0;
-    req.r.width = width;
-    req.r.height = height;
+    req.r = *r;
     req.resource_id = resource_id;
 
     /* send the command and get a response */
@@ -315,11 +328,11 @@ static status_t flush_resource(struct virtio_gpu_dev *gdev, uint32_t resource_id
     return err;
 }
 
-static status_t transfer_to_host_2d(struct virtio_gpu_dev *gdev, uint32_t resource_id, uint32_t width, uint32_t height)
+static status_t transfer_to_host_2d(struct virtio_gpu_dev *gdev, uint32_t resource_id, const struct virtio_gpu_rect *r)
 {
     status_t err;
 
-    LTRACEF("gdev %p, resource_id %u, width %u, height %u\n", gdev, resource_id, width, height);
+    LTRACEF("gdev %p, resource_id %u, x %u, y %u, width %u, height %u\n", gdev, resource_id, r->x, r->y, r->width, r->height);
 
     /* grab a lock to keep this single message at a time */
     mutex_acquire(&gdev->lock);
@@ -329,10 +342,9 @@ static status_t transfer_to_host_2d(struct virtio_gpu_dev *gdev, uint32_t resour
     memset(&req, 0, sizeof(req));
 
     req.hdr.type = VIRTIO_GPU_CMD_TRANSFER_TO_HOST_2D;
-    req.r.x = req.r.y = 0;
-    req.r.width = width;
-    req.r.height = height;
-    req.offset = 0;
+    req.r = *r;
+    /* where the rect starts in the backing store */
+    req.offset = ((uint64_t)r->y * gdev->pmode.r.width + r->x) * 4;
     req.resource_id = resource_id;
 
     /* send the command and get a response */
@@ -371,14 +383,15 @@ status_t virtio_gpu_start(struct virtio_device *dev)
     }
 
     /* allocate a resource */
-    err = allocate_2d_resource(gdev, &gdev->display_resource_id, gdev->pmode.r.width, gdev->pmode.r.height);
+    gdev->fb_height = gdev->pmode.r.height * VIRTIO_GPU_PAN_SCREENS;
+    err = allocate_2d_resource(gdev, &gdev->display_resource_id, gdev->pmode.r.width, gdev->fb_height);
     if (err < 0) {
         LTRACEF("failed to allocate 2d resource\n");
         return err;
     }
 
     /* attach a backing store to the resource */
-    size_t len = gdev->pmode.r.width * gdev->pmode.r.height * 4;
+    size_t len = gdev->pmode.r.width * gdev->fb_height * 4;
     gdev->fb = pmm_alloc_kpages(ROUNDUP(len, PAGE_SIZE) / PAGE_SIZE, NULL);
     if (!gdev->fb) {
         TRACEF("failed to allocate framebuffer, wanted 0x%zx bytes\n", len);
@@ -394,7 +407,7 @@ status_t virtio_gpu_start(struct virtio_device *dev)
     }
 
     /* attach this resource as a scanout */
-    err = set_scanout(gdev, gdev->pmode_id, gdev->display_resource_id, gdev->pmode.r.width, gdev->pmode.r.height);
+    err = set_scanout(gdev, gdev->pmode_id, gdev->display_resource_id, 0, gdev->pmode.r.width, gdev->pmode.r.height);
     if (err < 0) {
         LTRACEF("failed to set scanout\n");
         return err;
@@ -406,6 +419,9 @@ status_t virtio_gpu_start(struct virtio_device *dev)
     thread_detach_and_resume(t);
 
     /* kick it once */
+    gdev->damage.x = gdev->damage.y = 0;
+    gdev->damage.width = gdev->pmode.r.width;
+    gdev->damage.height = gdev->pmode.r.height;
     event_signal(&gdev->flush_event, true);
 
     LTRACE_EXIT;
@@ -434,6 +450,9 @@ status_t virtio_gpu_init(struct virtio_device *dev, uint32_t host_features)
     mutex_init(&gdev->lock);
     event_init(&gdev->io_event, false, EVENT_FLAG_AUTOUNSIGNAL);
     event_init(&gdev->flush_event, false, EVENT_FLAG_AUTOUNSIGNAL);
+    spin_lock_init(&gdev->damage_lock);
+    memset(&gdev->damage, 0, sizeof(gdev->damage));
+    gdev->pan_y = gdev->scanout_y = 0;
 
     gdev->dev = dev;
     dev->priv = gdev;
@@ -525,23 +544,89 @@ static enum handler_return virtio_gpu_config_change_callback(struct virtio_devic
     return INT_RESCHEDULE;
 }
 
+/* union a rect into the pending damage, caller holds damage_lock */
+static void virtio_gpu_merge_damage(struct virtio_gpu_dev *gdev, uint x, uint y, uint width, uint height)
+{
+    struct virtio_gpu_rect *d = &gdev->damage;
+
+    if (d->width == 0) {
+        d->x = x;
+        d->y = y;
+        d->width = width;
+        d->height = height;
+    } else {
+        uint32_t x2 = MAX(d->x + d->width, x + width);
+        uint32_t y2 = MAX(d->y + d->height, y + height);
+
+        d->x = MIN(d->x, x);
+        d->y = MIN(d->y, y);
+        d->width = x2 - d->x;
+        d->height = y2 - d->y;
+    }
+}
+
+/* hand a rect we failed to push back to the next round */
+static void virtio_gpu_requeue_damage(struct virtio_gpu_dev *gdev, const struct virtio_gpu_rect *damage)
+{
+    if (!damage->width)
+        return;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&gdev->damage_lock, state);
+    virtio_gpu_merge_damage(gdev, damage->x, damage->y, damage->width, damage->height);
+    spin_unlock_irqrestore(&gdev->damage_lock, state);
+}
+
 static int virtio_gpu_flush_thread(void *arg)
 {
     struct virtio_gpu_dev *gdev = (struct virtio_gpu_dev *)arg;
+    struct virtio_gpu_rect damage;
+    uint32_t pan_y;
     status_t err;
 
     for (;;) {
         event_wait(&gdev->flush_event);
 
+        /* take everything that piled up since the last round */
+        spin_lock_saved_state_t state;
+        spin_lock_irqsave(&gdev->damage_lock, state);
+        damage = gdev->damage;
+        gdev->damage.width = 0;
+        pan_y = gdev->pan_y;
+        spin_unlock_irqrestore(&gdev->damage_lock, state);
+
         /* transfer to host 2d */
-        err = transfer_to_host_2d(gdev, gdev->display_resource_id, gdev->pmode.r.width, gdev->pmode.r.height);
-        if (err < 0) {
-            LTRACEF("failed to flush resource\n");
-            continue;
+        if (damage.width) {
+            err = transfer_to_host_2d(gdev, gdev->display_resource_id, &damage);
+            if (err < 0) {
+                LTRACEF("failed to transfer resource\n");
+                virtio_gpu_requeue_damage(gdev, &damage);
+                continue;
+            }
         }
 
+        /* moving the scanout shows a different part of the resource */
+        if (pan_y != gdev->scanout_y) {
+            err = set_scanout(gdev, gdev->pmode_id, gdev->display_resource_id, pan_y,
+                              gdev->pmode.r.width, gdev->pmode.r.height);
+            if (err < 0) {
+                LTRACEF("failed to set scanout\n");
+                virtio_gpu_requeue_damage(gdev, &damage);
+                continue;
+            }
+            gdev->scanout_y = pan_y;
+
+            damage.x = 0;
+            damage.y = pan_y;
+            damage.width = gdev->pmode.r.width;
+            damage.height = gdev->pmode.r.height;
+        }
+
+        if (!damage.width)
+            continue;
+
         /* resource flush */
-        err = flush_resource(gdev, gdev->display_resource_id, gdev->pmode.r.width, gdev->pmode.r.height);
+        err = flush_resource(gdev, gdev->display_resource_id, &damage);
         if (err < 0) {
             LTRACEF("failed to flush resource\n");
             continue;
@@ -551,9 +636,44 @@ static int virtio_gpu_flush_thread(void *arg)
     return 0;
 }
 
+static void virtio_gpu_add_damage(uint x, uint y, uint width, uint height)
+{
+    struct virtio_gpu_dev *gdev = the_gdev;
+
+    if (width == 0 || height == 0)
+        return;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&gdev->damage_lock, state);
+    virtio_gpu_merge_damage(gdev, x, y, width, height);
+    spin_unlock_irqrestore(&gdev->damage_lock, state);
+
+    event_signal(&gdev->flush_event, !arch_ints_disabled());
+}
+
 void virtio_gpu_gfx_flush(uint starty, uint endy)
 {
-    event_signal(&the_gdev->flush_event, !arch_ints_disabled());
+    virtio_gpu_add_damage(0, starty, the_gdev->pmode.r.width, endy - starty + 1);
+}
+
+static void virtio_gpu_gfx_flush_rect(uint x, uint y, uint width, uint height)
+{
+    virtio_gpu_add_damage(x, y, width, height);
+}
+
+static void virtio_gpu_gfx_pan(uint y)
+{
+    struct virtio_gpu_dev *gdev = the_gdev;
+
+    if (y > gdev->fb_height - gdev->pmode.r.height)
+        y = gdev->fb_height - gdev->pmode.r.height;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&gdev->damage_lock, state);
+    gdev->pan_y = y;
+    spin_unlock_irqrestore(&gdev->damage_lock, state);
+
+    event_signal(&gdev->flush_event, !arch_ints_disabled());
 }
 
 status_t display_get_framebuffer(struct display_framebuffer *fb)
@@ -571,6 +691,9 @@ status_t display_get_framebuffer(struct display_framebuffer *fb)
     fb->image.stride = fb->image.width;
     fb->image.rowbytes = fb->image.width * 4;
     fb->flush = virtio_gpu_gfx_flush;
+    fb->flush_rect = virtio_gpu_gfx_flush_rect;
+    fb->pan_rows = the_gdev->fb_height;
+    fb->pan = virtio_gpu_gfx_pan;
     fb->format = DISPLAY_FORMAT_RGB_x888;
 
     return NO_ERROR;
@@ -47,6 +47,8 @@ struct virtio_device {
 
     void *priv; /* a place for the driver to put private data */
 
+    uint32_t features; /* negotiated with the device */
+
     enum handler_return (*irq_driver_callback)(struct virtio_device *dev, uint ring, const struct vring_used_elem *e);
     enum handler_return (*config_change_callback)(struct virtio_device *dev);
 
@@ -59,6 +61,9 @@ void virtio_reset_device(struct virtio_device *dev);
 void virtio_status_acknowledge_driver(struct virtio_device *dev);
 void virtio_status_driver_ok(struct virtio_device *dev);
 
+/* accept the features both the device and the driver support, returns them */
+uint32_t virtio_negotiate_features(struct virtio_device *dev, uint32_t host_features, uint32_t driver_features);
+
 /* api used by devices to interact with the virtio bus */
 status_t virtio_alloc_ring(struct virtio_device *dev, uint index, uint16_t len) __NONNULL();
 
@@ -82,6 +87,7 @@ void virtio_dump_desc(const struct vring_desc *desc);
 /* submit a chain to the avail list */
 void virtio_submit_chain(struct virtio_device *dev, uint ring_index, uint16_t desc_index);
 
+/* notify the device of new chains, skipped if it asked not to be with EVENT_IDX */
 void virtio_kick(struct virtio_device *dev, uint ring_idnex);
 
 
@@ -32,6 +32,7 @@
  * SUCH DAMAGE.
  *
  * Copyright Rusty Russell IBM Corporation 2007. */
+#include <stdbool.h>
 #include <stdint.h>
 #include <pow2.h>
 
@@ -99,7 +100,14 @@ struct vring {
     uint16_t free_list; /* head of a free list of descriptors per ring. 0xffff is NULL */
     uint16_t free_count;
 
-    uint16_t last_used;
+    uint16_t last_used; /* free running, mask with num_mask */
+    uint16_t kicked_avail; /* avail->idx the device was last notified of */
+
+    /*
+     * With EVENT_IDX, interrupt once this many more chains are used, or
+     * all outstanding ones if fewer. 0 interrupts for every chain.
+     */
+    uint16_t irq_batch;
 
     struct vring_desc *desc;
 
@@ -145,6 +153,8 @@ static inline void vring_init(struct vring *vr, unsigned int num, void *p,
     vr->free_list = 0xffff;
     vr->free_count = 0;
     vr->last_used = 0;
+    vr->kicked_avail = 0;
+    vr->irq_batch = 0;
     vr->desc = p;
     vr->avail = p + num*sizeof(struct vring_desc);
     vr->used = (void *)(((unsigned long)&vr->avail->ring[num] + sizeof(uint16_t)
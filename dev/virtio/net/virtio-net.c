@@ -27,6 +27,7 @@
 #include <trace.h>
 #include <compiler.h>
 #include <list.h>
+#include <stdlib.h>
 #include <string.h>
 #include <err.h>
 #include <kernel/thread.h>
@@ -51,9 +52,12 @@ struct virtio_net_hdr {
     uint16_t gso_size;
     uint16_t csum_start;
     uint16_t csum_offset;
-    uint16_t num_buffers; // unused in tx
+    uint16_t num_buffers; // only with MRG_RXBUF, unused in tx
 } __PACKED;
 
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM         (1<<0)
+#define VIRTIO_NET_HDR_F_DATA_VALID         (1<<1)
+
 #define VIRTIO_NET_F_CSUM                   (1<<0)
 #define VIRTIO_NET_F_GUEST_CSUM             (1<<1)
 #define VIRTIO_NET_F_CTRL_GUEST_OFFLOADS    (1<<2)
@@ -79,34 +83,61 @@ struct virtio_net_hdr {
 #define VIRTIO_NET_S_LINK_UP                (1<<0)
 #define VIRTIO_NET_S_ANNOUNCE               (1<<1)
 
-#define TX_RING_SIZE 16
-#define RX_RING_SIZE 16
+/* rings are shrunk to what the device supports */
+#ifndef VIRTIO_NET_TX_RING_SIZE
+#define VIRTIO_NET_TX_RING_SIZE 128
+#endif
+#ifndef VIRTIO_NET_RX_RING_SIZE
+#define VIRTIO_NET_RX_RING_SIZE 128
+#endif
+
+#define TX_RING_SIZE VIRTIO_NET_TX_RING_SIZE
+#define RX_RING_SIZE VIRTIO_NET_RX_RING_SIZE
+
+/* each posted rx pktbuf takes two objects of the shared pool, leave half of it to the stack */
+#define RX_POOL_BUFFERS (PKTBUF_POOL_SIZE / 4)
+/* tx completions reclaimed per interrupt, as a fraction of the ring */
+#define TX_IRQ_BATCH_SHIFT 3
+/* received packets handed to the stack before their buffers are reposted */
+#define RX_REFILL_BATCH 16
 
 #define RING_RX 0
 #define RING_TX 1
 
 #define VIRTIO_NET_MSS 1514
 
+#define VIRTIO_NET_DRIVER_FEATURES \
+    (VIRTIO_NET_F_MAC | VIRTIO_NET_F_MRG_RXBUF | VIRTIO_NET_F_CSUM | \
+     VIRTIO_NET_F_GUEST_CSUM | (1u << VIRTIO_RING_F_EVENT_IDX))
+
 struct virtio_net_dev {
     struct virtio_device *dev;
     bool started;
 
     struct virtio_net_config *config;
+    uint32_t features;
+    size_t hdr_len; /* the header lacks num_buffers without MRG_RXBUF */
 
     spin_lock_t lock;
     event_t rx_event;
 
-    /* list of active tx/rx packets to be freed at irq time */
+    /* list of active tx/rx packets to be freed at irq time, tx ones at the head descriptor */
     pktbuf_t *pending_tx_packet[TX_RING_SIZE];
     pktbuf_t *pending_rx_packet[RX_RING_SIZE];
 
+    /* tx headers, one per head descriptor so a packet needs no header pktbuf */
+    struct virtio_net_hdr *tx_hdr;
+    paddr_t tx_hdr_phys;
+
     uint tx_pending_count;
     struct list_node completed_rx_queue;
+
+    uint rx_skip; /* buffers left of a frame that was dropped */
 };
 
 static enum handler_return virtio_net_irq_driver_callback(struct virtio_device *dev, uint ring, const struct vring_used_elem *e);
 static int virtio_net_rx_worker(void *arg);
-static status_t virtio_net_queue_rx(struct virtio_net_dev *ndev, pktbuf_t *p);
+static void virtio_net_queue_rx(struct virtio_net_dev *ndev, struct list_node *list);
 
 // XXX remove need for this
 static struct virtio_net_dev *the_ndev;
@@ -157,11 +188,25 @@ status_t virtio_net_init(struct virtio_device *dev, uint32_t host_features)
 
     ndev->config = (struct virtio_net_config *)dev->config_ptr;
 
+    ndev->tx_hdr = memalign(CACHE_LINE, TX_RING_SIZE * sizeof(struct virtio_net_hdr));
+    if (!ndev->tx_hdr) {
+        free(ndev);
+        return ERR_NO_MEMORY;
+    }
+#if WITH_KERNEL_VM
+    ndev->tx_hdr_phys = vaddr_to_paddr(ndev->tx_hdr);
+#else
+    ndev->tx_hdr_phys = (paddr_t)ndev->tx_hdr;
+#endif
+
     /* ack and set the driver status bit */
     virtio_status_acknowledge_driver(dev);
 
-    // XXX check features bits and ack/nak them
     dump_feature_bits(host_features);
+    ndev->features = virtio_negotiate_features(dev, host_features, VIRTIO_NET_DRIVER_FEATURES);
+    ndev->hdr_len = sizeof(struct virtio_net_hdr);
+    if (!(ndev->features & VIRTIO_NET_F_MRG_RXBUF))
+        ndev->hdr_len -= sizeof(uint16_t);
 
     /* set our irq handler */
     dev->irq_driver_callback = &virtio_net_irq_driver_callback;
@@ -170,8 +215,20 @@ status_t virtio_net_init(struct virtio_device *dev, uint32_t host_features)
     virtio_status_driver_ok(dev);
 
     /* allocate a pair of virtio rings */
-    virtio_alloc_ring(dev, RING_RX, RX_RING_SIZE); // rx
-    virtio_alloc_ring(dev, RING_TX, TX_RING_SIZE); // tx
+    if (virtio_alloc_ring(dev, RING_RX, RX_RING_SIZE) < 0 ||
+            virtio_alloc_ring(dev, RING_TX, TX_RING_SIZE) < 0) {
+        TRACEF("failed to allocate rings\n");
+        dev->priv = NULL;
+        free(ndev->tx_hdr);
+        free(ndev);
+        return ERR_NO_MEMORY;
+    }
+
+    /*
+     * Completed transmits are reclaimed in batches, small enough that the
+     * ring never fills up with finished packets while it waits for one.
+     */
+    dev->ring[RING_TX].irq_batch = MAX(dev->ring[RING_TX].num >> TX_IRQ_BATCH_SHIFT, 1u);
 
     the_ndev = ndev;
 
@@ -185,74 +242,79 @@ status_t virtio_net_start(void)
 
     the_ndev->started = true;
 
+    /* let the stack leave checksums to the device */
+    if (the_ndev->features & VIRTIO_NET_F_CSUM)
+        minip_set_offloads(minip_get_offloads() | MINIP_OFFLOAD_TX_CKSUM);
+
     /* start the rx worker thread */
     thread_resume(thread_create("virtio_net_rx", &virtio_net_rx_worker, (void *)the_ndev, HIGH_PRIORITY, DEFAULT_STACK_SIZE));
 
-    /* queue up a bunch of rxes */
-    for (uint i = 0; i < RX_RING_SIZE - 1; i++) {
+    /* queue up a bunch of rxes, the ring may be shorter than asked for */
+    struct list_node list = LIST_INITIAL_VALUE(list);
+    uint rx_buffers = MIN(the_ndev->dev->ring[RING_RX].num, (uint)RX_POOL_BUFFERS);
+    for (uint i = 0; i < rx_buffers; i++) {
         pktbuf_t *p = pktbuf_alloc();
         if (p) {
-            virtio_net_queue_rx(the_ndev, p);
+            list_add_tail(&list, &p->list);
         }
     }
+    virtio_net_queue_rx(the_ndev, &list);
 
     return NO_ERROR;
 }
 
-static status_t virtio_net_queue_tx_pktbuf(struct virtio_net_dev *ndev, pktbuf_t *p2)
+static status_t virtio_net_queue_tx_pktbuf(struct virtio_net_dev *ndev, pktbuf_t *p)
 {
     struct virtio_device *vdev = ndev->dev;
 
     uint16_t i;
-    pktbuf_t *p;
 
     DEBUG_ASSERT(ndev);
 
-    p = pktbuf_alloc();
-    if (!p)
-        return ERR_NO_MEMORY;
-
-    /* point our header to the base of the first pktbuf */
-    struct virtio_net_hdr *hdr = pktbuf_append(p, sizeof(struct virtio_net_hdr) - 2);
-    memset(hdr, 0, p->dlen);
-
     spin_lock_saved_state_t state;
     spin_lock_irqsave(&ndev->lock, state);
 
     /* only queue if we have enough tx descriptors */
-    if (ndev->tx_pending_count + 2 > TX_RING_SIZE)
+    if (ndev->tx_pending_count + 2 > vdev->ring[RING_TX].num)
         goto nodesc;
 
     /* allocate a chain of descriptors for our transfer */
     struct vring_desc *desc = virtio_alloc_desc_chain(vdev, RING_TX, 2, &i);
     if (!desc) {
+nodesc:
         spin_unlock_irqrestore(&ndev->lock, state);
 
-nodesc:
         TRACEF("out of virtio tx descriptors, tx_pending_count %u\n", ndev->tx_pending_count);
-        pktbuf_free(p, true);
 
         return ERR_NO_MEMORY;
     }
 
     ndev->tx_pending_count += 2;
 
-    /* save a pointer to our pktbufs for the irq handler to free */
-    LTRACEF("saving pointer to pkt in index %u and %u\n", i, desc->next);
+    /* save a pointer to our pktbuf for the irq handler to free */
+    LTRACEF("saving pointer to pkt in index %u\n", i);
     DEBUG_ASSERT(ndev->pending_tx_packet[i] == NULL);
-    DEBUG_ASSERT(ndev->pending_tx_packet[desc->next] == NULL);
     ndev->pending_tx_packet[i] = p;
-    ndev->pending_tx_packet[desc->next] = p2;
+
+    /* fill in the header slot of the head descriptor */
+    struct virtio_net_hdr *hdr = &ndev->tx_hdr[i];
+    memset(hdr, 0, sizeof(*hdr));
+    if (p->flags & PKTBUF_FLAG_CKSUM_PARTIAL) {
+        DEBUG_ASSERT(ndev->features & VIRTIO_NET_F_CSUM);
+        hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        hdr->csum_start = p->csum_start - pktbuf_avail_head(p);
+        hdr->csum_offset = p->csum_offset;
+    }
 
     /* set up the descriptor pointing to the header */
-    desc->addr = pktbuf_data_phys(p);
-    desc->len = p->dlen;
+    desc->addr = ndev->tx_hdr_phys + i * sizeof(struct virtio_net_hdr);
+    desc->len = ndev->hdr_len;
     desc->flags |= VRING_DESC_F_NEXT;
 
     /* set up the descriptor pointing to the buffer */
     desc = virtio_desc_index_to_desc(vdev, RING_TX, desc->next);
-    desc->addr = pktbuf_data_phys(p2);
-    desc->len = p2->dlen;
+    desc->addr = pktbuf_data_phys(p);
+    desc->len = p->dlen;
     desc->flags = 0;
 
     /* submit the transfer */
@@ -290,46 +352,59 @@ static status_t virtio_net_queue_tx(struct virtio_net_dev *ndev, const void *buf
     return err;
 }
 
-static status_t virtio_net_queue_rx(struct virtio_net_dev *ndev, pktbuf_t *p)
+/* post a list of pktbufs as rx buffers with a single kick */
+static void virtio_net_queue_rx(struct virtio_net_dev *ndev, struct list_node *list)
 {
     struct virtio_device *vdev = ndev->dev;
+    pktbuf_t *p;
 
     DEBUG_ASSERT(ndev);
-    DEBUG_ASSERT(p);
-
-    /* point our header to the base of the pktbuf */
-    p->data = p->buffer;
-    struct virtio_net_hdr *hdr = (struct virtio_net_hdr *)p->data;
-    memset(hdr, 0, sizeof(struct virtio_net_hdr) - 2);
+    DEBUG_ASSERT(list);
 
-    p->dlen = sizeof(struct virtio_net_hdr) - 2 + VIRTIO_NET_MSS;
+    if (list_is_empty(list))
+        return;
 
     spin_lock_saved_state_t state;
     spin_lock_irqsave(&ndev->lock, state);
 
-    /* allocate a chain of descriptors for our transfer */
-    uint16_t i;
-    struct vring_desc *desc = virtio_alloc_desc_chain(vdev, RING_RX, 1, &i);
-    DEBUG_ASSERT(desc); /* shouldn't be possible not to have a descriptor ready */
+    while ((p = list_remove_head_type(list, pktbuf_t, list))) {
+        /* point our header to the base of the pktbuf */
+        p->data = p->buffer;
+        p->flags = PKTBUF_FLAG_EOF;
+        struct virtio_net_hdr *hdr = (struct virtio_net_hdr *)p->data;
+        memset(hdr, 0, ndev->hdr_len);
+
+        p->dlen = ndev->hdr_len + VIRTIO_NET_MSS;
+
+        /* allocate a chain of descriptors for our transfer */
+        uint16_t i;
+        struct vring_desc *desc = virtio_alloc_desc_chain(vdev, RING_RX, 1, &i);
+        if (!desc) {
+            /* the ring is full, the rest goes back to the pool */
+            list_add_head(list, &p->list);
+            break;
+        }
 
-    /* save a pointer to our pktbufs for the irq handler to use */
-    DEBUG_ASSERT(ndev->pending_rx_packet[i] == NULL);
-    ndev->pending_rx_packet[i] = p;
+        /* save a pointer to our pktbufs for the irq handler to use */
+        DEBUG_ASSERT(ndev->pending_rx_packet[i] == NULL);
+        ndev->pending_rx_packet[i] = p;
 
-    /* set up the descriptor pointing to the header */
-    desc->addr = pktbuf_data_phys(p);
-    desc->len = p->dlen;
-    desc->flags = VRING_DESC_F_WRITE;
+        /* set up the descriptor pointing to the header */
+        desc->addr = pktbuf_data_phys(p);
+        desc->len = p->dlen;
+        desc->flags = VRING_DESC_F_WRITE;
 
-    /* submit the transfer */
-    virtio_submit_chain(vdev, RING_RX, i);
+        /* submit the transfer */
+        virtio_submit_chain(vdev, RING_RX, i);
+    }
 
     /* kick it off */
     virtio_kick(vdev, RING_RX);
 
     spin_unlock_irqrestore(&ndev->lock, state);
 
-    return NO_ERROR;
+    while ((p = list_remove_head_type(list, pktbuf_t, list)))
+        pktbuf_free(p, true);
 }
 
 static enum handler_return virtio_net_irq_driver_callback(struct virtio_device *dev, uint ring, const struct vring_used_elem *e)
@@ -364,7 +439,7 @@ static enum handler_return virtio_net_irq_driver_callback(struct virtio_device *
             LTRACEF("rx pktbuf %p filled\n", p);
 
             /* trim the pktbuf according to the written length in the used element descriptor */
-            if (e->len > (sizeof(struct virtio_net_hdr) - 2 + VIRTIO_NET_MSS)) {
+            if (e->len > ndev->hdr_len + VIRTIO_NET_MSS) {
                 TRACEF("bad used len on RX %u\n", e->len);
                 p->dlen = 0;
             } else {
@@ -373,15 +448,15 @@ static enum handler_return virtio_net_irq_driver_callback(struct virtio_device *
 
             list_add_tail(&ndev->completed_rx_queue, &p->list);
         } else { // ring == RING_TX
-            /* free the pktbuf associated with the tx packet we just consumed */
+            /* free the pktbuf associated with the tx packet we just consumed, kept at its head */
             pktbuf_t *p = ndev->pending_tx_packet[i];
             ndev->pending_tx_packet[i] = NULL;
             ndev->tx_pending_count--;
 
-            DEBUG_ASSERT(p);
-            LTRACEF("freeing pktbuf %p\n", p);
-
-            pktbuf_free(p, false);
+            if (p) {
+                LTRACEF("freeing pktbuf %p\n", p);
+                pktbuf_free(p, false);
+            }
         }
 
         if (next < 0)
@@ -403,6 +478,9 @@ static int virtio_net_rx_worker(void *arg)
 {
     struct virtio_net_dev *ndev = (struct virtio_net_dev *)arg;
 
+    struct list_node refill = LIST_INITIAL_VALUE(refill);
+    uint refill_count = 0;
+
     for (;;) {
         event_wait(&ndev->rx_event);
 
@@ -421,15 +499,32 @@ static int virtio_net_rx_worker(void *arg)
             LTRACEF("got packet len %u\n", p->dlen);
 
             /* process our packet */
-            struct virtio_net_hdr *hdr = pktbuf_consume(p, sizeof(struct virtio_net_hdr) - 2);
-            if (hdr) {
-                /* call up into the stack */
+            struct virtio_net_hdr *hdr = pktbuf_consume(p, ndev->hdr_len);
+            if (ndev->rx_skip > 0) {
+                ndev->rx_skip--;
+            } else if (hdr && (ndev->features & VIRTIO_NET_F_MRG_RXBUF) && hdr->num_buffers > 1) {
+                /* frames only span buffers with GSO, which we don't negotiate */
+                TRACEF("dropping frame of %u buffers\n", hdr->num_buffers);
+                ndev->rx_skip = hdr->num_buffers - 1;
+            } else if (hdr) {
+                /* the device checked it, or it never left the host */
+                if (hdr->flags & (VIRTIO_NET_HDR_F_DATA_VALID | VIRTIO_NET_HDR_F_NEEDS_CSUM))
+                    p->flags |= PKTBUF_FLAG_CKSUM_TCP_GOOD | PKTBUF_FLAG_CKSUM_UDP_GOOD;
+
+                /* call up into the stack, the pktbuf is handed over as is */
                 minip_rx_driver_callback(p);
             }
 
-            /* requeue the pktbuf in the rx queue */
-            virtio_net_queue_rx(ndev, p);
+            /* requeue the pktbufs in the rx queue a batch at a time */
+            list_add_tail(&refill, &p->list);
+            if (++refill_count >= RX_REFILL_BATCH) {
+                virtio_net_queue_rx(ndev, &refill);
+                refill_count = 0;
+            }
         }
+
+        virtio_net_queue_rx(ndev, &refill);
+        refill_count = 0;
     }
     return 0;
 }
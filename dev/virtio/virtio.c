@@ -99,18 +99,33 @@ static enum handler_return virtio_mmio_irq(void *arg)
             struct vring *ring = &dev->ring[r];
             LTRACEF("ring %u: used flags 0x%hhx idx 0x%hhx last_used %u\n", r, ring->used->flags, ring->used->idx, ring->last_used);
 
-            uint cur_idx = ring->used->idx;
-            for (uint i = ring->last_used; i != (cur_idx & ring->num_mask); i = (i + 1) & ring->num_mask) {
-                LTRACEF("looking at idx %u\n", i);
-
-                // process chain
-                struct vring_used_elem *used_elem = &ring->used->ring[i];
-                LTRACEF("id %u, len %u\n", used_elem->id, used_elem->len);
-
-                DEBUG_ASSERT(dev->irq_driver_callback);
-                ret |= dev->irq_driver_callback(dev, r, used_elem);
-
-                ring->last_used = (ring->last_used + 1) & ring->num_mask;
+            for (;;) {
+                uint16_t cur_idx = ring->used->idx;
+                for (; ring->last_used != cur_idx; ring->last_used++) {
+                    LTRACEF("looking at idx %u\n", ring->last_used & ring->num_mask);
+
+                    // process chain
+                    struct vring_used_elem *used_elem = &ring->used->ring[ring->last_used & ring->num_mask];
+                    LTRACEF("id %u, len %u\n", used_elem->id, used_elem->len);
+
+                    DEBUG_ASSERT(dev->irq_driver_callback);
+                    ret |= dev->irq_driver_callback(dev, r, used_elem);
+                }
+
+                if (!(dev->features & (1u << VIRTIO_RING_F_EVENT_IDX)))
+                    break;
+
+                /* tell the device which used index to interrupt us at */
+                uint16_t event = ring->last_used;
+                uint16_t outstanding = ring->avail->idx - ring->last_used;
+                if (ring->irq_batch && outstanding)
+                    event = ring->last_used + MIN(outstanding, ring->irq_batch) - 1;
+                vring_used_event(ring) = event;
+                DSB;
+
+                /* chains that were used while we were publishing it won't interrupt */
+                if (ring->used->idx == cur_idx)
+                    break;
             }
         }
     }
@@ -318,6 +333,19 @@ void virtio_kick(struct virtio_device *dev, uint ring_index)
 {
     LTRACEF("dev %p, ring %u\n", dev, ring_index);
 
+    struct vring *ring = &dev->ring[ring_index];
+    uint16_t old_idx = ring->kicked_avail;
+    uint16_t new_idx = ring->avail->idx;
+
+    ring->kicked_avail = new_idx;
+
+    if (dev->features & (1u << VIRTIO_RING_F_EVENT_IDX)) {
+        /* the new avail index has to be visible before reading the device's event index */
+        DSB;
+        if (!vring_need_event(vring_avail_event(ring), new_idx, old_idx))
+            return;
+    }
+
     dev->mmio_config->queue_notify = ring_index;
     DSB;
 }
@@ -333,6 +361,14 @@ status_t virtio_alloc_ring(struct virtio_device *dev, uint index, uint16_t len)
     if (len == 0 || !ispow2(len))
         return ERR_INVALID_ARGS;
 
+    /* shrink the ring to what the device supports */
+    dev->mmio_config->queue_sel = index;
+    uint32_t max_len = dev->mmio_config->queue_num_max;
+    if (max_len == 0)
+        return ERR_NOT_FOUND;
+    while (len > max_len)
+        len /= 2;
+
     struct vring *ring = &dev->ring[index];
 
     /* allocate a ring */
@@ -406,6 +442,19 @@ void virtio_status_driver_ok(struct virtio_device *dev)
     dev->mmio_config->status |= VIRTIO_STATUS_DRIVER_OK;
 }
 
+uint32_t virtio_negotiate_features(struct virtio_device *dev, uint32_t host_features, uint32_t driver_features)
+{
+    uint32_t features = host_features & driver_features;
+
+    LTRACEF("dev %p, host 0x%x, driver 0x%x, accepted 0x%x\n", dev, host_features, driver_features, features);
+
+    dev->mmio_config->guest_features_sel = 0;
+    dev->mmio_config->guest_features = features;
+    dev->features = features;
+
+    return features;
+}
+
 void virtio_init(uint level)
 {
 }
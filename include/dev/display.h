@@ -81,6 +81,12 @@ struct display_framebuffer {
     struct display_image image;
     // Update function
     void (*flush)(uint starty, uint endy);
+    // Optional rectangle update, used instead of flush when set
+    void (*flush_rect)(uint x, uint y, uint width, uint height);
+    // Optional panning: image.pixels holds pan_rows rows, of which
+    // image.height starting at the row passed to pan are shown
+    uint pan_rows;
+    void (*pan)(uint y);
 };
 
 status_t display_get_framebuffer(struct display_framebuffer *fb)
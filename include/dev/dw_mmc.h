@@ -24,6 +24,7 @@
 #include <err.h>
 #include <string.h>
 #include <reg.h>
+#include <kernel/event.h>
 
 #define dwmci_readl(host, reg) readl(host->ioaddr + reg)
 #define dwmci_writel(host, value, reg) writel(value, host->ioaddr + reg)
@@ -439,6 +440,11 @@ struct dw_mci {
 	void (*set_clk)(unsigned int freq);
 	void (*sd_voltage_switch)(void);
 	void (*cache_flush)(void);
+
+	/* Data transfer completion by interrupt, polled when irq is 0 */
+	unsigned int irq;
+	int irq_registered;
+	event_t data_event;
 };
 int dwmci_init(struct mmc *mmc, int channel);
 int dwmci_board_get_host(struct dw_mci *host, int channel);
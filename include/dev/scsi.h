@@ -65,6 +65,8 @@ enum scsi_opcode {
 	SCSI_OP_FORMAT_UNIT		= 0x04,
 	SCSI_OP_START_STOP_UNIT		= 0x1B,
 	SCSI_OP_UNMAP			= 0x42,
+	SCSI_OP_HPB_READ		= 0xF8,
+	SCSI_OP_HPB_READ_BUFFER		= 0xF9,
 };
 
 /* External Functions */
@@ -13,6 +13,7 @@
 #define __UFS__
 
 #include <dev/scsi.h>
+#include <kernel/event.h>
 #include <platform/ufs-cal.h>
 
 #define RET_SUCCESS		0	/* 0 = Success */
@@ -322,6 +323,11 @@ enum {
 	UPIU_FLAG_ID_POW_WRITEPROTECT = 0x3,
 	UPIU_FLAG_ID_BG_OPERATRION = 0x4,
 	UPIU_FLAG_ID_PURGE_ENABLE = 0x6,
+	UPIU_FLAG_ID_WB_EN = 0xe,
+	UPIU_FLAG_ID_WB_BUFF_FLUSH_EN = 0xf,
+	UPIU_FLAG_ID_WB_BUFF_FLUSH_DURING_H8 = 0x10,
+	UPIU_FLAG_ID_HPB_RESET = 0x11,
+	UPIU_FLAG_ID_HPB_EN = 0x12,
 	UPIU_FLAG_ID_ALL = 0xff,
 };
 
@@ -344,6 +350,11 @@ enum {
 	UPIU_ATTR_ID_SECONDPASSED = 0xf,
 	UPIU_ATTR_ID_CONTEXTCONF = 0x10,
 	UPIU_ATTR_ID_CORRPRGBLKNUM = 0x11,
+	UPIU_ATTR_ID_WB_FLUSH_STATUS = 0x1c,
+	UPIU_ATTR_ID_AVAIL_WB_BUFF_SIZE = 0x1d,
+	UPIU_ATTR_ID_WB_BUFF_LIFE_TIME_EST = 0x1e,
+	UPIU_ATTR_ID_CURR_WB_BUFF_SIZE = 0x1f,
+	UPIU_ATTR_ID_MAX_HPB_SINGLE_CMD = 0x21,
 	UPIU_ATTR_ID_ALL = 0xff,
 };
 
@@ -530,8 +541,49 @@ struct ufs_device_desc {
 	u8 bUDConfigPlength;
 	u8 bDeviceRTTCap;
 	u16 wPeriodicRTCUpdate;
+	u8 bUFSFeaturesSupport;	/* offset : 0x1F */
+	u8 bFFUTimeout;
+	u8 bQueueDepth;
+	u16 wDeviceVersion;
+	u8 bNumSecureWPArea;
+	u32 dPSAMaxDataSize;
+	u8 bPSAStateTimeout;
+	u8 iProductRevisionLevel;
+	u8 reserved_2b[21];
+	u16 wHPBVersion;	/* offset : 0x40 */
+	u8 bHPBControl;
+	u8 reserved_43[12];
+	u32 dExtendedUFSFeaturesSupport;	/* offset : 0x4F */
+	u8 bWriteBoosterBufferPreserveUserSpaceEn;
+	u8 bWriteBoosterBufferType;
+	u32 dNumSharedWriteBoosterBufferAllocUnits;	/* offset : 0x55 */
 } __attribute__ ((__packed__));
 
+/* bUFSFeaturesSupport and dExtendedUFSFeaturesSupport */
+#define UFS_DEV_HPB_SUPPORT		UFS_BIT(7)
+#define UFS_DEV_WRITE_BOOSTER_SUP	UFS_BIT(8)
+
+/* bLUEnable of unit descriptor */
+#define UFS_LU_HPB_ENABLE		0x02
+
+/* bWriteBoosterBufferType */
+enum {
+	UFS_WB_BUF_LU_DEDICATED = 0x0,
+	UFS_WB_BUF_SHARED = 0x1,
+};
+
+/* bWBBufferFlushStatus */
+enum {
+	UFS_WB_FLUSH_IDLE = 0x0,
+	UFS_WB_FLUSH_IN_PROGRESS = 0x1,
+	UFS_WB_FLUSH_STOPPED = 0x2,
+	UFS_WB_FLUSH_COMPLETED = 0x3,
+	UFS_WB_FLUSH_FAILURE = 0x4,
+};
+
+/* bAvailableWriteBoosterBufferSize is reported in 10% steps */
+#define UFS_WB_AVAIL_FULL		0xa
+
 /*	Unit Descriptor	*/
 struct ufs_unit_desc {
 	u8 bLength;		/* offset : 0x00 */
@@ -555,6 +607,10 @@ struct ufs_unit_desc {
 	u32 qPhyMemResourceCount_l;
 	u16 wContextCapabilities;	/* offset : 0x20 */
 	u8 bLargeUnitSize_M1;
+	u16 wLUMaxActiveHPBRegions;
+	u16 wHPBPinnedRegionStartIdx;
+	u16 wNumHPBPinnedRegions;
+	u32 dLUNumWriteBoosterBufferAllocUnits;	/* offset : 0x29 */
 } __attribute__ ((__packed__));
 
 /*	Geometry Descriptor	*/
@@ -593,6 +649,18 @@ struct ufs_geometry_desc {
 	u16 wEnhanced3CapAdjFac;
 	u32 dEnhanced4MaxNAllocU;
 	u16 wEnhanced4CapAdjFac;	/* offset : 0x42 */
+	u16 wOptimalLogicalBlockSize;
+	u8 Reserved_46[2];
+	u8 bHPBRegionSize;		/* offset : 0x48 */
+	u8 bHPBNumberLU;
+	u8 bHPBSubRegionSize;
+	u16 wDeviceMaxActiveHPBRegions;
+	u8 Reserved_4d[2];
+	u32 dWriteBoosterBufferMaxNAllocUnits;	/* offset : 0x4F */
+	u8 bDeviceMaxWriteBoosterLUs;
+	u8 bWriteBoosterBufferCapAdjFac;
+	u8 bSupportedWriteBoosterBufferUserSpaceReductionTypes;
+	u8 bSupportedWriteBoosterBufferTypes;
 } __attribute__ ((__packed__));
 
 struct ufs_flag_bit {
@@ -606,7 +674,13 @@ struct ufs_flag_bit {
 	u8 reserved_7;		// bit[7] : Reserved
 	u8 fPhyResourceRemoval;	// bit[8] : Physical Resource Removal
 	u8 fBusyRTC;		// bit[9] : Busy Real Time Clock
-	u8 reserved_10_31[22];	// bit[31:10] : Reserved
+	u8 reserved_10_13[4];	// bit[13:10] : Reserved
+	u8 fWriteBoosterEn;	// bit[14] : WriteBooster Enable
+	u8 fWBBufferFlushEn;	// bit[15] : WriteBooster Buffer Flush Enable
+	u8 fWBBufferFlushDuringHibernate;	// bit[16] : WriteBooster Buffer Flush During Hibernate
+	u8 fHPBReset;		// bit[17] : HPB Reset
+	u8 fHPBEn;		// bit[18] : HPB Enable
+	u8 reserved_19_31[13];	// bit[31:19] : Reserved
 } __attribute__ ((__packed__));
 
 /*	Flags	*/
@@ -634,11 +708,18 @@ struct __ufs_attributes {
 	u32 dSecondsPassed;	// id : 15
 	u32 wContextConf;	// id : 16
 	u32 dCorrPrgBlkNum;	// id : 17
+	u32 reserved_18_27[10];	// id : 18 ~ 27
+	u32 bWBBufferFlushStatus;	// id : 28
+	u32 bAvailableWriteBoosterBufferSize;	// id : 29
+	u32 bWriteBoosterBufferLifeTimeEst;	// id : 30
+	u32 dCurrentWriteBoosterBufferSize;	// id : 31
+	u32 reserved_32;	// id : 32
+	u32 bMaxDataSizeHPBSingleCmd;	// id : 33
 };
 
 /*	Attributes		*/
 union ufs_attributes {
-	u32 arry[18];
+	u32 arry[34];
 	struct __ufs_attributes attr;
 };
 
@@ -646,6 +727,50 @@ union ufs_attributes {
 #define __iomem
 #endif
 
+/* HPB (Host Performance Booster) */
+#define UFS_HPB_ENTRY_SIZE	8		/* one L2P entry per 4KB block */
+#define UFS_HPB_READ_BUF_ID	0x01
+#define UFS_HPB_VER_1_0		0x100
+#define UFS_HPB_VER_2_0		0x200
+
+#ifndef UFS_HPB_MAX_SRGNS
+#define UFS_HPB_MAX_SRGNS	64
+#endif
+/* Upper bound of host memory for cached L2P map */
+#ifndef UFS_HPB_MAP_MEM_MAX
+#define UFS_HPB_MAP_MEM_MAX	(1024 * 1024)
+#endif
+
+/* Cached sub-region */
+struct ufs_hpb_srgn {
+	u32 lun;
+	u32 start;		/* first LBA of sub-region */
+	u8 *map;		/* HPB entries, as returned by the device */
+};
+
+struct ufs_hpb_stats {
+	u64 hit;
+	u64 miss;
+	u64 fallback;		/* stale entry, READ (10) after HPB READ */
+	u64 map_load;
+	u64 hit_us;
+	u64 miss_us;
+	u64 fallback_us;
+};
+
+struct ufs_hpb {
+	u32 version;
+	u32 lu_mask;		/* HPB enabled LUs */
+	u32 rgn_shift;		/* log2 of LBAs per region */
+	u32 srgn_shift;		/* log2 of LBAs per sub-region */
+	u32 max_single_cmd;	/* max LBAs of one HPB READ */
+	u32 max_srgns;
+	u32 nr_srgns;
+	u8 *map_mem;
+	struct ufs_hpb_srgn srgn[UFS_HPB_MAX_SRGNS];
+	struct ufs_hpb_stats stats;
+};
+
 #define UFS_GEAR		3
 #define UFS_RATE		2
 #define UFS_POWER_MODE	1
@@ -711,6 +836,20 @@ struct ufs_host {
 	u32 mclk_rate;
 	struct uic_pwr_mode pmd_cxt;
 	u32 dev_pwr_shift;
+
+	/* WriteBooster */
+	u32 wb_support;
+	u32 wb_enabled;
+	u8 wb_index;		/* query INDEX, LUN for LU dedicated buffer */
+	u64 wb_buf_size;	/* in bytes */
+
+	/* HPB, NULL if not supported */
+	struct ufs_hpb *hpb;
+
+	/* Interrupt driven UTP completion, polled when irq is 0 */
+	event_t utp_event;
+	volatile int irq_stat;	/* status bits latched by the handler */
+	int irq_registered;
 };
 
 int ufs_alloc_memory(void);
@@ -720,6 +859,14 @@ int ufs_board_init(int host_index, struct ufs_host *ufs);
 void ufs_pre_vendor_setup(struct ufs_host *ufs);
 int ufs_device_reset(void);
 
+int ufs_wb_enable(int enable);
+int ufs_wb_begin(void);
+void ufs_wb_end(int prev);
+int ufs_wb_flush(void);
+int ufs_wb_getvar(char *response);
+
+int ufs_hpb_load(u32 lun, u32 start, u32 count);
+
 void print_ufs_upiu(struct ufs_host *ufs, int print_level);
 void print_ufs_desc(u8 * desc);
 void print_ufs_device_desc(u8 * desc);
@@ -285,5 +285,49 @@ extern int fastboot_flash_write(fastboot_ptentry *ptn, unsigned extra_per_page,
 extern int rx_handler (const unsigned char *buffer, unsigned int buffer_size);
 extern void fb_cmd_set_downloaded_sz(unsigned int sz);
 
+/*
+ * Transport under the command layer (fastboot-cmd.c).
+ *
+ * USB registers itself as the default transport. A transport calls
+ * fastboot_acquire_transport() before it hands a command to rx_handler()
+ * and fastboot_release_transport() when it is done, so commands from USB
+ * and TCP never run at the same time or answer on the wrong link.
+ * Optional hooks may be NULL.
+ */
+struct fastboot_transport {
+	const char *name;
+
+	/* Send an INFO/OKAY/FAIL/DATA message */
+	void (*send_info)(char *response, unsigned int len);
+	void (*send_status)(char *response, unsigned int len, int sync);
+
+	/* Set up the data phase that follows the next status */
+	void (*set_payload_data)(int dir, void *buf, unsigned int len);
+
+	/* Upload a chunk, returning before it is sent if possible */
+	void (*send_payload_async)(void *buf, unsigned int len);
+	void (*wait_payload)(void);
+
+	/* Optional: total length of the following payload chunks */
+	void (*set_upload_len)(unsigned long long len);
+
+	/* Optional: size of the next command transfer */
+	void (*set_rx_sz)(unsigned int prot_req_sz);
+};
+
+extern void fastboot_register_default_transport(const struct fastboot_transport *t);
+extern void fastboot_acquire_transport(const struct fastboot_transport *t);
+extern void fastboot_release_transport(void);
+extern const struct fastboot_transport *fastboot_get_transport(void);
+
+extern void fastboot_send_info(char *response, unsigned int len);
+extern void fastboot_send_status(char *response, unsigned int len, int sync);
+extern void fastboot_set_payload_data(int dir, void *buf, unsigned int len);
+extern void fastboot_send_payload(void *buf, unsigned int len);
+extern void fastboot_send_payload_async(void *buf, unsigned int len);
+extern void fastboot_wait_payload(void);
+extern void fastboot_set_upload_len(unsigned long long len);
+extern void fasboot_set_rx_sz(unsigned int prot_req_sz);
+
 #endif /* FASTBOOT_H */
 
@@ -110,6 +110,7 @@ void probe_dev_api_ops(struct gadget_dev_ops *ops);
 void gadget_chg_state(enum usb_dev_state state);
 enum usb_dev_state gadget_get_state(void);
 void gadget_notify_disconnect(void);
+void gadget_wait_ms(unsigned int ms);
 /* APIs for application */
 int start_usb_gadget(void);
 void stop_usb_gadget(void);
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __KERNEL_HRTIMER_H
+#define __KERNEL_HRTIMER_H
+
+#include <compiler.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS;
+
+/*
+ * High resolution timers
+ *
+ * Same rules as kernel/timer.h (callbacks in interrupt context, may be
+ * re-armed or canceled from the callback), but deadlines are in ns of
+ * current_time_ns() and pending timers are kept in a per cpu binary
+ * heap, so arming and canceling are O(log n) instead of a list walk.
+ */
+
+struct hrtimer;
+typedef enum handler_return (*hrtimer_callback)(struct hrtimer *, uint64_t now_ns, void *arg);
+
+#define HRTIMER_MAGIC (0x68727469)  //'hrti'
+
+/* Pending timers per cpu */
+#ifndef HRTIMER_QUEUE_SIZE
+#define HRTIMER_QUEUE_SIZE 64
+#endif
+
+typedef struct hrtimer {
+    int magic;
+    int cpu;
+    int index;          /* position in the cpu heap, -1 when not queued */
+
+    uint64_t deadline;
+    uint64_t period;
+
+    hrtimer_callback callback;
+    void *arg;
+} hrtimer_t;
+
+#define HRTIMER_INITIAL_VALUE(t) \
+{ \
+    .magic = HRTIMER_MAGIC, \
+    .cpu = 0, \
+    .index = -1, \
+    .deadline = 0, \
+    .period = 0, \
+    .callback = NULL, \
+    .arg = NULL, \
+}
+
+void hrtimer_initialize(hrtimer_t *);
+status_t hrtimer_set_deadline(hrtimer_t *, uint64_t deadline_ns, hrtimer_callback, void *arg);
+status_t hrtimer_set_oneshot(hrtimer_t *, uint64_t delay_ns, hrtimer_callback, void *arg);
+status_t hrtimer_set_periodic(hrtimer_t *, uint64_t period_ns, hrtimer_callback, void *arg);
+void hrtimer_cancel(hrtimer_t *);
+
+/* Block the current thread, other threads run meanwhile */
+void hrtimer_sleep_ns(uint64_t ns);
+
+static inline void hrtimer_sleep_us(uint64_t us)
+{
+    hrtimer_sleep_ns(us * 1000);
+}
+
+__END_CDECLS;
+
+#endif
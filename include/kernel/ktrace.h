@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __KERNEL_KTRACE_H
+#define __KERNEL_KTRACE_H
+
+#include <compiler.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS;
+
+/*
+ * Kernel tracing
+ *
+ * Tracepoints append fixed size binary records to a ring of the cpu they
+ * run on. Writers only disable interrupts on their own cpu, there is no
+ * lock shared between cpus. Records are stamped with the architected
+ * counter where there is one, so stamps of different cpus compare.
+ *
+ * The rings are exported as Chrome trace event JSON, which Perfetto and
+ * chrome://tracing open directly. Spans of a thread are shown on a track
+ * of that thread, scheduler and interrupt events on a track per cpu.
+ *
+ * Build with WITH_KERNEL_TRACE=1, without it the tracepoints compile to
+ * nothing.
+ */
+
+/* categories, tracepoints of disabled categories are not recorded */
+enum {
+    KTRACE_SCHED    = (1 << 0),
+    KTRACE_IRQ      = (1 << 1),
+    KTRACE_BIO      = (1 << 2),
+    KTRACE_UFS      = (1 << 3),
+    KTRACE_USB      = (1 << 4),
+    KTRACE_AVB      = (1 << 5),
+    KTRACE_BOOT     = (1 << 6),
+    KTRACE_USER     = (1 << 7),
+    KTRACE_ALL      = 0xff,
+};
+
+enum {
+    KTRACE_PH_BEGIN,
+    KTRACE_PH_END,
+    KTRACE_PH_INSTANT,
+    KTRACE_PH_COUNTER,
+    KTRACE_PH_SWITCH,   /* arg is the thread switched to */
+};
+
+struct ktrace_record {
+    uint64_t ts;
+    const char *name;   /* must be a string that outlives the trace */
+    uintptr_t arg;
+    uintptr_t thread;
+    uint8_t cat;        /* bit number of the category */
+    uint8_t phase;
+};
+
+struct ktrace_stats {
+    uint64_t recorded;
+    uint64_t dropped;   /* overwritten before they were exported */
+};
+
+/* Records kept per cpu */
+#ifndef KERNEL_TRACE_RECORDS
+#define KERNEL_TRACE_RECORDS 4096
+#endif
+
+/* Called with a piece of the JSON output, returns < 0 to stop the export */
+typedef int (*ktrace_out_t)(void *ctx, const char *buf, size_t len);
+
+#if WITH_KERNEL_TRACE
+
+extern volatile uint ktrace_mask;
+
+void ktrace_init(void);
+void ktrace_record(uint cat, uint phase, const char *name, uintptr_t arg);
+
+/* Enabled categories, 0 stops recording */
+void ktrace_set_mask(uint mask);
+void ktrace_clear(void);
+void ktrace_get_stats(struct ktrace_stats *stats);
+
+/* Recording is paused while exporting */
+status_t ktrace_export(ktrace_out_t out, void *ctx);
+/* Returns the length of the JSON, ERR_NOT_ENOUGH_BUFFER if it did not fit */
+ssize_t ktrace_export_buf(void *buf, size_t len);
+
+#define KTRACE(cat, phase, name, arg) \
+    do { \
+        if (unlikely(ktrace_mask & (cat))) \
+            ktrace_record((cat), (phase), (name), (uintptr_t)(arg)); \
+    } while (0)
+
+#else // !WITH_KERNEL_TRACE
+
+static inline void ktrace_init(void) {}
+static inline void ktrace_set_mask(uint mask) {}
+static inline void ktrace_clear(void) {}
+
+#define KTRACE(cat, phase, name, arg) do { } while (0)
+
+#endif
+
+/* name of a span has to be the same string at its begin and end */
+#define KTRACE_BEGIN(cat, name, arg) KTRACE(cat, KTRACE_PH_BEGIN, name, arg)
+#define KTRACE_END(cat, name) KTRACE(cat, KTRACE_PH_END, name, 0)
+#define KTRACE_INSTANT(cat, name, arg) KTRACE(cat, KTRACE_PH_INSTANT, name, arg)
+#define KTRACE_COUNTER(cat, name, value) KTRACE(cat, KTRACE_PH_COUNTER, name, value)
+
+#define KTRACE_THREAD_SWITCH(to) KTRACE(KTRACE_SCHED, KTRACE_PH_SWITCH, "switch", to)
+#define KTRACE_IRQ_ENTER(irqn) KTRACE(KTRACE_IRQ, KTRACE_PH_BEGIN, "irq", irqn)
+#define KTRACE_IRQ_EXIT(irqn) KTRACE(KTRACE_IRQ, KTRACE_PH_END, "irq", irqn)
+
+__END_CDECLS;
+
+#endif
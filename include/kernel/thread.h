@@ -94,6 +94,7 @@ typedef struct thread {
 #if WITH_SMP
     int curr_cpu;
     int pinned_cpu; /* only run on pinned_cpu if >= 0 */
+    int last_cpu; /* where it last ran, its cache is likely still warm there */
 #endif
 #if WITH_KERNEL_VM
     vmm_aspace_t *aspace;
@@ -175,6 +176,9 @@ void dump_thread(thread_t *t);
 void arch_dump_thread(thread_t *t);
 void dump_all_threads(void);
 
+/* call cb for every thread, with the thread lock held */
+void thread_list_walk(void (*cb)(thread_t *t, void *arg), void *arg);
+
 /* scheduler routines */
 void thread_yield(void); /* give up the cpu voluntarily */
 void thread_preempt(void); /* get preempted (inserted into head of run queue) */
@@ -238,6 +242,7 @@ struct thread_stats {
 
 #if WITH_SMP
     ulong reschedule_ipis;
+    ulong steals; /* threads taken from the run queue of another cpu */
 #endif
 };
 
@@ -41,12 +41,23 @@ typedef enum {
     GFX_FORMAT_ARGB_8888,
     GFX_FORMAT_RGB_x888,
     GFX_FORMAT_MONO,
+    GFX_FORMAT_ARGB_8888_PREMUL, // ARGB 8888 with color premultiplied by alpha
 
     GFX_FORMAT_MAX
 } gfx_format;
 
 #define MAX_ALPHA 255
 
+// rectangles of damage a surface tracks between flushes, more are merged
+#define GFX_DIRTY_RECTS 4
+
+typedef struct gfx_rect {
+    uint x;
+    uint y;
+    uint width;
+    uint height;
+} gfx_rect;
+
 /**
  * @brief  Describe a graphics drawing surface
  *
@@ -73,6 +84,18 @@ typedef struct gfx_surface {
     void (*fillrect)(struct gfx_surface *, uint x, uint y, uint width, uint height, uint color);
     void (*putpixel)(struct gfx_surface *, uint x, uint y, uint color);
     void (*flush)(uint starty, uint endy);
+    // optional, preferred over flush when set
+    void (*flush_rect)(uint x, uint y, uint width, uint height);
+
+    // what was drawn since the last gfx_flush
+    gfx_rect dirty[GFX_DIRTY_RECTS];
+    uint dirty_count;
+
+    // row kernels for gfx_surface_blend
+    // blend count pixels of this (32 bit) surface onto dest
+    void (*blendrow)(uint32_t *dest, const uint32_t *src, uint count);
+    // convert count ARGB 8888 pixels to the format of this surface
+    void (*convertrow)(struct gfx_surface *, void *dest, const uint32_t *src, uint count);
 } gfx_surface;
 
 // copy a rect from x,y with width x height to x2, y2
@@ -87,22 +110,26 @@ void gfx_putpixel(gfx_surface *surface, uint x, uint y, uint color);
 // draw a single pixel line between x1,y1 and x2,y1
 void gfx_line(gfx_surface *surface, uint x1, uint y1, uint x2, uint y2, uint color);
 
-// clear the entire surface with a color
-static inline void gfx_clear(gfx_surface *surface, uint color)
-{
-    surface->fillrect(surface, 0, 0, surface->width, surface->height, color);
-
-    if (surface->flush)
-        surface->flush(0, surface->height-1);
-}
-
 // blend between two surfaces
 void gfx_surface_blend(struct gfx_surface *target, struct gfx_surface *source, uint destx, uint desty);
 
+// record a rect as modified, for drawing that bypasses the gfx_ routines
+void gfx_mark_dirty(struct gfx_surface *surface, uint x, uint y, uint width, uint height);
+
+// send everything drawn since the last flush to the display
 void gfx_flush(struct gfx_surface *surface);
 
 void gfx_flush_rows(struct gfx_surface *surface, uint start, uint end);
 
+// clear the entire surface with a color
+static inline void gfx_clear(gfx_surface *surface, uint color)
+{
+    surface->fillrect(surface, 0, 0, surface->width, surface->height, color);
+
+    gfx_mark_dirty(surface, 0, 0, surface->width, surface->height);
+    gfx_flush(surface);
+}
+
 // surface setup
 gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride, gfx_format format);
 
@@ -27,4 +27,9 @@
 #define LUT_COLOR_1	0xFFFFFFFF
 
 int show_boot_logo(void);
+
+/* Show an image of the logo container by name, e.g. "boot" or "charging" */
+int show_logo(const char *name);
+/* Drop decoded frames, for when the logo partition was rewritten */
+void logo_cache_flush(void);
 #endif /* __LOGO_DISPLAY_H__ */
@@ -33,6 +33,8 @@
 
 status_t sysparam_scan(bdev_t *bdev, off_t offset, size_t len);
 status_t sysparam_reload(void);
+/* the area the last scan was of, to go back to it later */
+status_t sysparam_get_area(bdev_t **bdev, off_t *offset, size_t *len);
 
 void sysparam_dump(bool show_all);
 
@@ -40,10 +42,25 @@ ssize_t sysparam_length(const char *name);
 ssize_t sysparam_read(const char *name, void *data, size_t len);
 status_t sysparam_get_ptr(const char *name, const void **ptr, size_t *len);
 
+struct sysparam_stats {
+    uint32_t appends;       /* writes that appended to the log */
+    uint32_t compactions;   /* writes that erased and rewrote the area */
+    uint64_t bytes_written;
+    uint64_t bytes_erased;
+    size_t log_used;
+    size_t log_size;
+};
+
 #if SYSPARAM_ALLOW_WRITE
 status_t sysparam_add(const char *name, const void *value, size_t len);
 status_t sysparam_remove(const char *name);
 status_t sysparam_lock(const char *name);
+/* appends the changes, compacts when the area is full */
 status_t sysparam_write(void);
+/* erases the area and writes only the live parameters */
+status_t sysparam_compact(void);
+/* the same without counting a compaction, as every write did before the log */
+status_t sysparam_write_full(void);
+void sysparam_get_stats(struct sysparam_stats *stats);
 #endif
 
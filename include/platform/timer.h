@@ -34,5 +34,18 @@ status_t platform_set_oneshot_timer (platform_timer_callback callback, void *arg
 void     platform_stop_timer(void);
 #endif
 
+#if PLATFORM_HAS_HIRES_TIMER
+/*
+ * Nanosecond one-shot timer, programmed with an absolute deadline of
+ * current_time_ns(). It runs next to the lk_time_t timer above and is
+ * owned by kernel/hrtimer.c.
+ */
+typedef enum handler_return (*platform_hires_timer_callback)(void *arg, uint64_t now_ns);
+
+uint64_t current_time_ns(void);
+status_t platform_set_hires_timer(platform_hires_timer_callback callback, void *arg, uint64_t deadline_ns);
+void     platform_stop_hires_timer(void);
+#endif
+
 #endif
 
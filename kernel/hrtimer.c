@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  High resolution kernel timers
+ *
+ * Nanosecond deadlines on top of the platform hires timer. Each cpu keeps
+ * its pending timers in a binary min-heap ordered by deadline, the head
+ * is what the hardware comparator is programmed with.
+ */
+#include <debug.h>
+#include <trace.h>
+#include <assert.h>
+#include <err.h>
+#include <stdlib.h>
+#include <kernel/thread.h>
+#include <kernel/event.h>
+#include <kernel/hrtimer.h>
+#include <kernel/spinlock.h>
+#include <platform/timer.h>
+#include <platform.h>
+
+#define LOCAL_TRACE 0
+
+/**
+ * @brief  Initialize a timer object
+ */
+void hrtimer_initialize(hrtimer_t *timer)
+{
+    *timer = (hrtimer_t)HRTIMER_INITIAL_VALUE(*timer);
+}
+
+#if PLATFORM_HAS_HIRES_TIMER
+
+static spin_lock_t hrtimer_lock = SPIN_LOCK_INITIAL_VALUE;
+
+struct hrtimer_queue {
+    hrtimer_t *heap[HRTIMER_QUEUE_SIZE];
+    int count;
+} __CPU_ALIGN;
+
+static struct hrtimer_queue hrtimer_queues[SMP_MAX_CPUS];
+
+static enum handler_return hrtimer_tick(void *arg, uint64_t now);
+
+static void heap_place(struct hrtimer_queue *q, int i, hrtimer_t *timer)
+{
+    q->heap[i] = timer;
+    timer->index = i;
+}
+
+static void heap_sift_up(struct hrtimer_queue *q, int i)
+{
+    hrtimer_t *timer = q->heap[i];
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+
+        if (q->heap[parent]->deadline <= timer->deadline)
+            break;
+        heap_place(q, i, q->heap[parent]);
+        i = parent;
+    }
+    heap_place(q, i, timer);
+}
+
+static void heap_sift_down(struct hrtimer_queue *q, int i)
+{
+    hrtimer_t *timer = q->heap[i];
+
+    for (;;) {
+        int child = 2 * i + 1;
+
+        if (child >= q->count)
+            break;
+        if (child + 1 < q->count && q->heap[child + 1]->deadline < q->heap[child]->deadline)
+            child++;
+        if (timer->deadline <= q->heap[child]->deadline)
+            break;
+        heap_place(q, i, q->heap[child]);
+        i = child;
+    }
+    heap_place(q, i, timer);
+}
+
+static status_t heap_insert(struct hrtimer_queue *q, hrtimer_t *timer)
+{
+    if (q->count == HRTIMER_QUEUE_SIZE)
+        return ERR_NO_RESOURCES;
+
+    heap_place(q, q->count++, timer);
+    heap_sift_up(q, timer->index);
+
+    return NO_ERROR;
+}
+
+static void heap_remove(struct hrtimer_queue *q, hrtimer_t *timer)
+{
+    int i = timer->index;
+    hrtimer_t *last;
+
+    DEBUG_ASSERT(i >= 0 && i < q->count && q->heap[i] == timer);
+
+    timer->index = -1;
+    last = q->heap[--q->count];
+    if (last == timer)
+        return;
+
+    heap_place(q, i, last);
+    if (i > 0 && q->heap[(i - 1) / 2]->deadline > last->deadline)
+        heap_sift_up(q, i);
+    else
+        heap_sift_down(q, i);
+}
+
+/* Called with hrtimer_lock held, on the cpu that owns the queue */
+static void hrtimer_program(struct hrtimer_queue *q)
+{
+    if (q->count)
+        platform_set_hires_timer(hrtimer_tick, NULL, q->heap[0]->deadline);
+    else
+        platform_stop_hires_timer();
+}
+
+static status_t hrtimer_set(hrtimer_t *timer, uint64_t deadline, uint64_t period,
+                            hrtimer_callback callback, void *arg)
+{
+    struct hrtimer_queue *q;
+    status_t err;
+
+    LTRACEF("timer %p, deadline %llu, period %llu, callback %p, arg %p\n",
+            timer, deadline, period, callback, arg);
+
+    DEBUG_ASSERT(timer->magic == HRTIMER_MAGIC);
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&hrtimer_lock, state);
+
+    /* Re-arming a pending timer moves it */
+    if (timer->index >= 0)
+        heap_remove(&hrtimer_queues[timer->cpu], timer);
+
+    timer->cpu = arch_curr_cpu_num();
+    timer->deadline = deadline;
+    timer->period = period;
+    timer->callback = callback;
+    timer->arg = arg;
+
+    q = &hrtimer_queues[timer->cpu];
+    err = heap_insert(q, timer);
+    if (err == NO_ERROR && q->heap[0] == timer) {
+        /* we just modified the head of the timer queue */
+        hrtimer_program(q);
+    }
+
+    spin_unlock_irqrestore(&hrtimer_lock, state);
+
+    if (err < 0)
+        TRACEF("timer queue of cpu %d is full\n", timer->cpu);
+
+    return err;
+}
+
+/**
+ * @brief  Set up a timer that fires once at an absolute time
+ *
+ * @param  timer The timer to use
+ * @param  deadline_ns  Value of current_time_ns() at which to fire
+ * @param  callback  The function to call when the timer expires
+ * @param  arg  The argument to pass to the callback
+ *
+ * @return NO_ERROR, or ERR_NO_RESOURCES if the queue of this cpu is full
+ */
+status_t hrtimer_set_deadline(hrtimer_t *timer, uint64_t deadline_ns,
+                              hrtimer_callback callback, void *arg)
+{
+    return hrtimer_set(timer, deadline_ns, 0, callback, arg);
+}
+
+/**
+ * @brief  Set up a timer that fires once after a delay in ns
+ */
+status_t hrtimer_set_oneshot(hrtimer_t *timer, uint64_t delay_ns,
+                             hrtimer_callback callback, void *arg)
+{
+    return hrtimer_set(timer, current_time_ns() + delay_ns, 0, callback, arg);
+}
+
+/**
+ * @brief  Set up a timer that fires every period_ns
+ *
+ * The first execution occurs one period after the timer is set. Missed
+ * periods are not made up for, the next deadline is never in the past.
+ */
+status_t hrtimer_set_periodic(hrtimer_t *timer, uint64_t period_ns,
+                              hrtimer_callback callback, void *arg)
+{
+    if (period_ns == 0)
+        period_ns = 1;
+
+    return hrtimer_set(timer, current_time_ns() + period_ns, period_ns, callback, arg);
+}
+
+/**
+ * @brief  Cancel a pending timer
+ */
+void hrtimer_cancel(hrtimer_t *timer)
+{
+    DEBUG_ASSERT(timer->magic == HRTIMER_MAGIC);
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&hrtimer_lock, state);
+
+    if (timer->index >= 0) {
+        struct hrtimer_queue *q = &hrtimer_queues[timer->cpu];
+        bool was_head = q->heap[0] == timer;
+
+        heap_remove(q, timer);
+
+        /*
+         * The comparator of another cpu cannot be reached from here, it
+         * fires early and its tick reprograms the new head.
+         */
+        if (was_head && timer->cpu == (int)arch_curr_cpu_num())
+            hrtimer_program(q);
+    }
+
+    /* to keep it from being reinserted into the queue if called from
+     * periodic timer callback.
+     */
+    timer->period = 0;
+    timer->callback = NULL;
+    timer->arg = NULL;
+
+    spin_unlock_irqrestore(&hrtimer_lock, state);
+}
+
+/* called at interrupt time to process any expired timers */
+static enum handler_return hrtimer_tick(void *arg, uint64_t now)
+{
+    struct hrtimer_queue *q = &hrtimer_queues[arch_curr_cpu_num()];
+    enum handler_return ret = INT_NO_RESCHEDULE;
+    hrtimer_t *timer;
+
+    DEBUG_ASSERT(arch_ints_disabled());
+
+    spin_lock(&hrtimer_lock);
+
+    while (q->count) {
+        timer = q->heap[0];
+        if (timer->deadline > now)
+            break;
+
+        DEBUG_ASSERT(timer->magic == HRTIMER_MAGIC);
+        heap_remove(q, timer);
+
+        /* we pulled it off the queue, release the lock to handle it */
+        spin_unlock(&hrtimer_lock);
+
+        bool periodic = timer->period > 0;
+        hrtimer_callback callback = timer->callback;
+
+        LTRACEF("timer %p firing callback %p, arg %p\n", timer, callback, timer->arg);
+        if (callback && callback(timer, now, timer->arg) == INT_RESCHEDULE)
+            ret = INT_RESCHEDULE;
+
+        spin_lock(&hrtimer_lock);
+
+        /* requeue periodic timers unless the callback did it or canceled */
+        if (periodic && timer->index < 0 && timer->period > 0) {
+            timer->deadline += timer->period;
+            if (timer->deadline <= now)
+                timer->deadline = now + timer->period;
+            heap_insert(q, timer);
+        }
+    }
+
+    hrtimer_program(q);
+
+    spin_unlock(&hrtimer_lock);
+
+    return ret;
+}
+
+#else
+
+/* No hires platform timer, hrtimers are not available */
+
+status_t hrtimer_set_deadline(hrtimer_t *timer, uint64_t deadline_ns,
+                              hrtimer_callback callback, void *arg)
+{
+    return ERR_NOT_SUPPORTED;
+}
+
+status_t hrtimer_set_oneshot(hrtimer_t *timer, uint64_t delay_ns,
+                             hrtimer_callback callback, void *arg)
+{
+    return ERR_NOT_SUPPORTED;
+}
+
+status_t hrtimer_set_periodic(hrtimer_t *timer, uint64_t period_ns,
+                              hrtimer_callback callback, void *arg)
+{
+    return ERR_NOT_SUPPORTED;
+}
+
+void hrtimer_cancel(hrtimer_t *timer)
+{
+}
+
+#endif
+
+static enum handler_return hrtimer_sleep_callback(hrtimer_t *timer, uint64_t now, void *arg)
+{
+    event_signal((event_t *)arg, false);
+
+    return INT_RESCHEDULE;
+}
+
+/**
+ * @brief  Sleep the current thread for ns
+ *
+ * Falls back to the ms resolution thread_sleep() when no hires timer
+ * can be armed.
+ */
+void hrtimer_sleep_ns(uint64_t ns)
+{
+    hrtimer_t timer = HRTIMER_INITIAL_VALUE(timer);
+    event_t done;
+
+    event_init(&done, false, 0);
+
+    if (hrtimer_set_oneshot(&timer, ns, hrtimer_sleep_callback, &done) == NO_ERROR)
+        event_wait(&done);
+    else
+        thread_sleep((ns + 1000 * 1000 - 1) / (1000 * 1000));
+
+    hrtimer_cancel(&timer);
+    event_destroy(&done);
+}
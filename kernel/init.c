@@ -23,6 +23,7 @@
 #include <compiler.h>
 #include <debug.h>
 #include <kernel/debug.h>
+#include <kernel/ktrace.h>
 #include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <kernel/mp.h>
@@ -33,6 +34,9 @@ void kernel_init(void)
     // if enabled, configure the kernel's event log
     kernel_evlog_init();
 
+    // if enabled, set up the per cpu trace buffers
+    ktrace_init();
+
     // initialize the threading system
     dprintf(SPEW, "initializing mp\n");
     mp_init();
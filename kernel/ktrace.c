@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  Per cpu trace buffers
+ *
+ * Every cpu owns a ring of KERNEL_TRACE_RECORDS records. A tracepoint
+ * disables interrupts on its cpu for the few stores of one record, the
+ * rings are never shared between writers. The exporter stops recording,
+ * waits for writers still inside a record and merges the rings by time.
+ */
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arch/ops.h>
+#include <kernel/ktrace.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <platform.h>
+
+#if ARCH_ARM64
+#include <arch/arm64.h>
+#endif
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+#endif
+
+#if WITH_KERNEL_TRACE
+
+#define LOCAL_TRACE 0
+
+#ifndef KERNEL_TRACE_MASK
+#define KERNEL_TRACE_MASK KTRACE_ALL
+#endif
+
+/* threads named in the export, others show up by address */
+#define KTRACE_THREAD_NAMES 64
+
+/* track of the per cpu scheduler and interrupt events */
+#define KTRACE_CPU_PID 1
+
+/* JSON numbers are doubles, threads go by the low bits of their address */
+#define KTRACE_TID(thread) ((uint32_t)(thread))
+
+/*
+ * busy and ktrace_mask are each stored by one side and loaded by the other,
+ * so the store has to be ordered before the load: a full fence, on any arch.
+ */
+#define ktrace_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+STATIC_ASSERT((KERNEL_TRACE_RECORDS & (KERNEL_TRACE_RECORDS - 1)) == 0);
+
+struct ktrace_cpu {
+    struct ktrace_record *ring;
+    uint64_t head;      /* records ever written */
+    uint64_t tail;      /* first record not cleared */
+    volatile int busy;
+} __CPU_ALIGN;
+
+static struct ktrace_cpu ktrace_cpus[SMP_MAX_CPUS];
+static uint64_t ktrace_freq;
+
+volatile uint ktrace_mask;
+
+static const char *ktrace_cat_names[] = {
+    "sched", "irq", "bio", "ufs", "usb", "avb", "boot", "user",
+};
+
+static inline uint64_t ktrace_now(void)
+{
+#if ARCH_ARM64
+    /* same rate on every cpu, unlike the pmu cycle counter */
+    return ARM64_READ_SYSREG(cntvct_el0);
+#else
+    return current_time_hires();
+#endif
+}
+
+void ktrace_init(void)
+{
+#if ARCH_ARM64
+    ktrace_freq = ARM64_READ_SYSREG(cntfrq_el0);
+#endif
+    if (!ktrace_freq)
+        ktrace_freq = 1000000;
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        ktrace_cpus[i].ring = malloc(KERNEL_TRACE_RECORDS * sizeof(struct ktrace_record));
+        if (!ktrace_cpus[i].ring) {
+            dprintf(CRITICAL, "ktrace: no memory for cpu %u\n", i);
+            return;
+        }
+    }
+
+    ktrace_mask = KERNEL_TRACE_MASK;
+}
+
+void ktrace_record(uint cat, uint phase, const char *name, uintptr_t arg)
+{
+    spin_lock_saved_state_t state;
+    struct ktrace_cpu *c;
+    struct ktrace_record *r;
+
+    arch_interrupt_save(&state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    c = &ktrace_cpus[arch_curr_cpu_num()];
+    c->busy = 1;
+    ktrace_fence();
+
+    /* the exporter may have stopped us after the check in the caller */
+    if (ktrace_mask & cat) {
+        r = &c->ring[c->head & (KERNEL_TRACE_RECORDS - 1)];
+        r->ts = ktrace_now();
+        r->name = name;
+        r->arg = arg;
+        r->thread = (uintptr_t)get_current_thread();
+        r->cat = __builtin_ctz(cat);
+        r->phase = phase;
+        c->head++;
+    }
+
+    ktrace_fence();
+    c->busy = 0;
+
+    arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+}
+
+/* Stop recording and wait for writers in the middle of a record */
+static uint ktrace_pause(void)
+{
+    uint mask = ktrace_mask;
+
+    ktrace_mask = 0;
+    ktrace_fence();
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        while (ktrace_cpus[i].busy)
+            ;
+    }
+
+    return mask;
+}
+
+void ktrace_set_mask(uint mask)
+{
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        if (!ktrace_cpus[i].ring)
+            return;
+    }
+
+    ktrace_mask = mask;
+}
+
+void ktrace_clear(void)
+{
+    uint mask = ktrace_pause();
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++)
+        ktrace_cpus[i].tail = ktrace_cpus[i].head;
+
+    ktrace_mask = mask;
+}
+
+static uint64_t ktrace_first(struct ktrace_cpu *c)
+{
+    if (c->head - c->tail > KERNEL_TRACE_RECORDS)
+        return c->head - KERNEL_TRACE_RECORDS;
+
+    return c->tail;
+}
+
+void ktrace_get_stats(struct ktrace_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        struct ktrace_cpu *c = &ktrace_cpus[i];
+
+        stats->recorded += c->head - c->tail;
+        stats->dropped += ktrace_first(c) - c->tail;
+    }
+}
+
+struct ktrace_thread_name {
+    uintptr_t thread;
+    char name[32];
+};
+
+struct ktrace_export_state {
+    ktrace_out_t out;
+    void *ctx;
+    status_t err;
+    struct ktrace_thread_name threads[KTRACE_THREAD_NAMES];
+    uint thread_count;
+    char line[256];
+};
+
+static void ktrace_collect_thread(thread_t *t, void *arg)
+{
+    struct ktrace_export_state *s = arg;
+    struct ktrace_thread_name *n;
+
+    if (s->thread_count == KTRACE_THREAD_NAMES)
+        return;
+
+    n = &s->threads[s->thread_count++];
+    n->thread = (uintptr_t)t;
+    strlcpy(n->name, t->name, sizeof(n->name));
+}
+
+static const char *ktrace_thread_name(struct ktrace_export_state *s, uintptr_t thread)
+{
+    for (uint i = 0; i < s->thread_count; i++) {
+        if (s->threads[i].thread == thread)
+            return s->threads[i].name;
+    }
+
+    return NULL;
+}
+
+static void ktrace_emit(struct ktrace_export_state *s, const char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    if (s->err)
+        return;
+
+    va_start(ap, fmt);
+    len = vsnprintf(s->line, sizeof(s->line), fmt, ap);
+    va_end(ap);
+
+    len = MIN(len, (int)sizeof(s->line) - 1);
+    if (s->out(s->ctx, s->line, len) < 0)
+        s->err = ERR_IO;
+}
+
+/* names are shown unquoted, keep them valid JSON strings */
+static void ktrace_sanitize(char *name)
+{
+    for (; *name; name++) {
+        if (*name == '"' || *name == '\\' || *name < ' ')
+            *name = '_';
+    }
+}
+
+/* timestamps are in us with ns fraction */
+static void ktrace_format_ts(char *buf, size_t len, uint64_t ts)
+{
+    uint64_t us = ts / ktrace_freq * 1000000 + (ts % ktrace_freq) * 1000000 / ktrace_freq;
+    uint64_t ns = (ts % ktrace_freq) * 1000000000 / ktrace_freq % 1000;
+
+    snprintf(buf, len, "%llu.%03llu", us, ns);
+}
+
+static void ktrace_emit_record(struct ktrace_export_state *s, uint cpu,
+                               const struct ktrace_record *r, bool *cpu_open)
+{
+    const char *cat = ktrace_cat_names[r->cat];
+    char ts[32];
+
+    ktrace_format_ts(ts, sizeof(ts), r->ts);
+
+    switch (r->phase) {
+        case KTRACE_PH_SWITCH: {
+            const char *name = ktrace_thread_name(s, r->arg);
+
+            if (*cpu_open)
+                ktrace_emit(s, ",\n{\"ph\":\"E\",\"ts\":%s,\"pid\":%d,\"tid\":%u}",
+                            ts, KTRACE_CPU_PID, cpu);
+            if (name)
+                ktrace_emit(s, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%s,"
+                            "\"pid\":%d,\"tid\":%u}", name, cat, ts, KTRACE_CPU_PID, cpu);
+            else
+                ktrace_emit(s, ",\n{\"name\":\"thread %lx\",\"cat\":\"%s\",\"ph\":\"B\",\"ts\":%s,"
+                            "\"pid\":%d,\"tid\":%u}", r->arg, cat, ts, KTRACE_CPU_PID, cpu);
+            *cpu_open = true;
+            break;
+        }
+        case KTRACE_PH_BEGIN:
+        case KTRACE_PH_END:
+        case KTRACE_PH_INSTANT: {
+            static const char ph[] = { 'B', 'E', 'i' };
+            bool on_cpu = (1U << r->cat) & (KTRACE_SCHED | KTRACE_IRQ);
+
+            ktrace_emit(s, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%s,"
+                        "\"pid\":%d,\"tid\":%u,%s\"args\":{\"arg\":%lu,\"cpu\":%u}}",
+                        r->name, cat, ph[r->phase], ts,
+                        on_cpu ? KTRACE_CPU_PID : 0, on_cpu ? cpu : KTRACE_TID(r->thread),
+                        r->phase == KTRACE_PH_INSTANT ? "\"s\":\"t\"," : "",
+                        r->arg, cpu);
+            break;
+        }
+        case KTRACE_PH_COUNTER:
+            ktrace_emit(s, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"C\",\"ts\":%s,"
+                        "\"pid\":0,\"args\":{\"value\":%lu}}", r->name, cat, ts, r->arg);
+            break;
+    }
+}
+
+status_t ktrace_export(ktrace_out_t out, void *ctx)
+{
+    struct ktrace_export_state *s;
+    uint64_t next[SMP_MAX_CPUS];
+    bool cpu_open[SMP_MAX_CPUS];
+    uint mask;
+
+    s = calloc(1, sizeof(*s));
+    if (!s)
+        return ERR_NO_MEMORY;
+
+    s->out = out;
+    s->ctx = ctx;
+
+    thread_list_walk(ktrace_collect_thread, s);
+
+    mask = ktrace_pause();
+
+    ktrace_emit(s, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"threads\"}},\n"
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"cpus\"}}",
+                KTRACE_CPU_PID);
+
+    for (uint i = 0; i < s->thread_count; i++) {
+        ktrace_sanitize(s->threads[i].name);
+        ktrace_emit(s, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+                    "\"args\":{\"name\":\"%s\"}}", KTRACE_TID(s->threads[i].thread),
+                    s->threads[i].name);
+    }
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        next[i] = ktrace_first(&ktrace_cpus[i]);
+        cpu_open[i] = false;
+
+        if (next[i] != ktrace_cpus[i].head)
+            ktrace_emit(s, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                        "\"args\":{\"name\":\"cpu %u\"}}", KTRACE_CPU_PID, i, i);
+    }
+
+    /* merge the rings, each of them is in time order */
+    while (!s->err) {
+        const struct ktrace_record *first = NULL;
+        uint cpu = 0;
+
+        for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+            struct ktrace_cpu *c = &ktrace_cpus[i];
+            const struct ktrace_record *r;
+
+            if (next[i] == c->head)
+                continue;
+
+            r = &c->ring[next[i] & (KERNEL_TRACE_RECORDS - 1)];
+            if (!first || r->ts < first->ts) {
+                first = r;
+                cpu = i;
+            }
+        }
+
+        if (!first)
+            break;
+
+        ktrace_emit_record(s, cpu, first, &cpu_open[cpu]);
+        next[cpu]++;
+    }
+
+    ktrace_emit(s, "\n]}\n");
+
+    ktrace_mask = mask;
+
+    status_t err = s->err;
+    free(s);
+
+    return err;
+}
+
+struct ktrace_buf {
+    char *buf;
+    size_t len;
+    size_t pos;
+};
+
+static int ktrace_buf_out(void *ctx, const char *buf, size_t len)
+{
+    struct ktrace_buf *b = ctx;
+
+    if (b->len - b->pos < len)
+        return -1;
+
+    memcpy(b->buf + b->pos, buf, len);
+    b->pos += len;
+
+    return 0;
+}
+
+ssize_t ktrace_export_buf(void *buf, size_t len)
+{
+    struct ktrace_buf b = { buf, len, 0 };
+    status_t err;
+
+    err = ktrace_export(ktrace_buf_out, &b);
+    if (err == ERR_IO)
+        return ERR_NOT_ENOUGH_BUFFER;
+    if (err)
+        return err;
+
+    return b.pos;
+}
+
+#if WITH_LIB_CONSOLE
+
+static int ktrace_console_out(void *ctx, const char *buf, size_t len)
+{
+    printf("%.*s", (int)len, buf);
+
+    return 0;
+}
+
+static int cmd_ktrace(int argc, const cmd_args *argv)
+{
+    struct ktrace_stats stats;
+
+    if (argc < 2) {
+usage:
+        printf("usage:\n");
+        printf("%s start [mask]  : record the categories in mask, all by default\n", argv[0].str);
+        printf("%s stop          : stop recording\n", argv[0].str);
+        printf("%s clear         : drop everything recorded\n", argv[0].str);
+        printf("%s stats         : show the state of the buffers\n", argv[0].str);
+        printf("%s dump          : print the trace as Chrome trace event JSON\n", argv[0].str);
+        return ERR_INVALID_ARGS;
+    }
+
+    if (!strcmp(argv[1].str, "start")) {
+        ktrace_set_mask(argc > 2 ? argv[2].u : KTRACE_ALL);
+    } else if (!strcmp(argv[1].str, "stop")) {
+        ktrace_pause();
+    } else if (!strcmp(argv[1].str, "clear")) {
+        ktrace_clear();
+    } else if (!strcmp(argv[1].str, "stats")) {
+        ktrace_get_stats(&stats);
+        printf("mask 0x%x, %d records per cpu, counter at %llu Hz\n",
+               ktrace_mask, KERNEL_TRACE_RECORDS, ktrace_freq);
+        printf("recorded %llu, overwritten %llu\n", stats.recorded, stats.dropped);
+        for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+            struct ktrace_cpu *c = &ktrace_cpus[i];
+
+            if (c->head != c->tail)
+                printf("cpu %u: %llu records\n", i, c->head - c->tail);
+        }
+    } else if (!strcmp(argv[1].str, "dump")) {
+        return ktrace_export(ktrace_console_out, NULL);
+    } else {
+        printf("unknown command\n");
+        goto usage;
+    }
+
+    return NO_ERROR;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("ktrace", "kernel trace buffers", &cmd_ktrace)
+STATIC_COMMAND_END(ktrace);
+
+#endif // WITH_LIB_CONSOLE
+
+#endif // WITH_KERNEL_TRACE
@@ -14,6 +14,8 @@ MODULE_SRCS := \
 	$(LOCAL_DIR)/mutex.c \
 	$(LOCAL_DIR)/thread.c \
 	$(LOCAL_DIR)/timer.c \
+	$(LOCAL_DIR)/hrtimer.c \
+	$(LOCAL_DIR)/ktrace.c \
 	$(LOCAL_DIR)/semaphore.c \
 	$(LOCAL_DIR)/mp.c \
 	$(LOCAL_DIR)/port.c
@@ -24,4 +26,8 @@ else
 MODULE_DEPS += kernel/novm
 endif
 
+ifeq ($(WITH_KERNEL_TRACE),1)
+GLOBAL_DEFINES += WITH_KERNEL_TRACE=1
+endif
+
 include make/module.mk
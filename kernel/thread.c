@@ -41,6 +41,7 @@
 #include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <kernel/debug.h>
+#include <kernel/ktrace.h>
 #include <kernel/mp.h>
 #include <platform.h>
 #include <target.h>
@@ -64,12 +65,27 @@ static struct list_node thread_list;
 /* master thread spinlock */
 spin_lock_t thread_lock = SPIN_LOCK_INITIAL_VALUE;
 
-/* the run queue */
-static struct list_node run_queue[NUM_PRIORITIES];
-static uint32_t run_queue_bitmap;
+/*
+ * One run queue per cpu. A thread that becomes ready is queued on the cpu
+ * chosen by select_run_queue(), a cpu that reschedules takes its own best
+ * thread unless another queue holds a better one it may run.
+ *
+ * All run queues are protected by thread_lock, not by a lock of their own:
+ * thread state, wait queues and timers live under it as well, so every
+ * path that touches a run queue already holds it. The split is for
+ * placement and stealing, it does not take the scheduler off the global
+ * lock.
+ */
+struct run_queue {
+    struct list_node queue[NUM_PRIORITIES];
+    uint32_t bitmap;
+    uint count;
+} __CPU_ALIGN;
+
+static struct run_queue run_queues[SMP_MAX_CPUS];
 
 /* make sure the bitmap is large enough to cover our number of priorities */
-STATIC_ASSERT(NUM_PRIORITIES <= sizeof(run_queue_bitmap) * 8);
+STATIC_ASSERT(NUM_PRIORITIES <= sizeof(run_queues[0].bitmap) * 8);
 
 /* the idle thread(s) (statically allocated) */
 #if WITH_SMP
@@ -89,20 +105,68 @@ static void idle_thread_routine(void) __NO_RETURN;
 static timer_t preempt_timer[SMP_MAX_CPUS];
 #endif
 
-/* run queue manipulation */
-static void insert_in_run_queue_head(thread_t *t)
+static inline int run_queue_top_priority(uint32_t bitmap)
 {
-    DEBUG_ASSERT(t->magic == THREAD_MAGIC);
-    DEBUG_ASSERT(t->state == THREAD_READY);
-    DEBUG_ASSERT(!list_in_list(&t->queue_node));
-    DEBUG_ASSERT(arch_ints_disabled());
-    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+    return sizeof(bitmap) * 8 - 1 - __builtin_clz(bitmap);
+}
 
-    list_add_head(&run_queue[t->priority], &t->queue_node);
-    run_queue_bitmap |= (1<<t->priority);
+#if WITH_SMP
+/* queued threads, plus the running one unless the cpu idles */
+static uint run_queue_load(uint cpu)
+{
+    return run_queues[cpu].count + (mp_is_cpu_idle(cpu) ? 0 : 1);
 }
+#endif
 
-static void insert_in_run_queue_tail(thread_t *t)
+/*
+ * Pick the cpu whose run queue t goes to. The running thread stays where
+ * it is, pinned threads go to their cpu, others prefer the cpu they last
+ * ran on unless another one idles or is less loaded.
+ */
+static uint select_run_queue(thread_t *t)
+{
+    uint cpu = arch_curr_cpu_num();
+
+#if WITH_SMP
+    if (t->pinned_cpu >= 0)
+        return t->pinned_cpu;
+    if (t == get_current_thread())
+        return cpu;
+
+    if (t->last_cpu >= 0 && mp_is_cpu_active(t->last_cpu))
+        cpu = t->last_cpu;
+
+    /* nothing else is up yet */
+    if (!mp_is_cpu_active(cpu))
+        return cpu;
+
+    uint best = cpu;
+    uint best_load = run_queue_load(cpu);
+
+    for (uint i = 1; i < SMP_MAX_CPUS && best_load > 0; i++) {
+        uint c = (cpu + i) % SMP_MAX_CPUS;
+
+        if (!mp_is_cpu_active(c) || (mp_get_realtime_mask() & (1U << c)))
+            continue;
+
+        uint load = run_queue_load(c);
+        if (load < best_load) {
+            best = c;
+            best_load = load;
+        }
+    }
+
+    return best;
+#else
+    return cpu;
+#endif
+}
+
+/*
+ * Run queue manipulation. Returns the cpu the thread was queued on as a
+ * mask for mp_reschedule().
+ */
+static mp_cpu_mask_t insert_in_run_queue(thread_t *t, bool head)
 {
     DEBUG_ASSERT(t->magic == THREAD_MAGIC);
     DEBUG_ASSERT(t->state == THREAD_READY);
@@ -110,8 +174,61 @@ static void insert_in_run_queue_tail(thread_t *t)
     DEBUG_ASSERT(arch_ints_disabled());
     DEBUG_ASSERT(spin_lock_held(&thread_lock));
 
-    list_add_tail(&run_queue[t->priority], &t->queue_node);
-    run_queue_bitmap |= (1<<t->priority);
+    uint cpu = select_run_queue(t);
+    struct run_queue *rq = &run_queues[cpu];
+
+    if (head)
+        list_add_head(&rq->queue[t->priority], &t->queue_node);
+    else
+        list_add_tail(&rq->queue[t->priority], &t->queue_node);
+    rq->bitmap |= (1<<t->priority);
+    rq->count++;
+
+    return 1U << cpu;
+}
+
+static mp_cpu_mask_t insert_in_run_queue_head(thread_t *t)
+{
+    return insert_in_run_queue(t, true);
+}
+
+static mp_cpu_mask_t insert_in_run_queue_tail(thread_t *t)
+{
+    return insert_in_run_queue(t, false);
+}
+
+/* the best thread of rq that may run on cpu, with at least min_priority */
+static thread_t *run_queue_peek(struct run_queue *rq, uint cpu, int min_priority)
+{
+    thread_t *t;
+    uint32_t bitmap = rq->bitmap;
+
+    while (bitmap) {
+        /* find the first (remaining) queue with a thread in it */
+        int next_queue = run_queue_top_priority(bitmap);
+
+        if (next_queue < min_priority)
+            break;
+
+        list_for_every_entry(&rq->queue[next_queue], t, thread_t, queue_node) {
+#if WITH_SMP
+            if (t->pinned_cpu < 0 || t->pinned_cpu == (int)cpu)
+#endif
+                return t;
+        }
+
+        bitmap &= ~(1<<next_queue);
+    }
+
+    return NULL;
+}
+
+static void run_queue_remove(struct run_queue *rq, thread_t *t)
+{
+    list_delete(&t->queue_node);
+    if (list_is_empty(&rq->queue[t->priority]))
+        rq->bitmap &= ~(1<<t->priority);
+    rq->count--;
 }
 
 static void init_thread_struct(thread_t *t, const char *name)
@@ -119,6 +236,9 @@ static void init_thread_struct(thread_t *t, const char *name)
     memset(t, 0, sizeof(thread_t));
     t->magic = THREAD_MAGIC;
     thread_set_pinned_cpu(t, -1);
+#if WITH_SMP
+    t->last_cpu = -1;
+#endif
     strlcpy(t->name, name, sizeof(t->name));
 }
 
@@ -291,15 +411,16 @@ status_t thread_resume(thread_t *t)
 
     bool resched = false;
     bool ints_disabled = arch_ints_disabled();
+    mp_cpu_mask_t target = 0;
     THREAD_LOCK(state);
     if (t->state == THREAD_SUSPENDED) {
         t->state = THREAD_READY;
-        insert_in_run_queue_head(t);
+        target = insert_in_run_queue_head(t);
         if (!ints_disabled) /* HACK, don't resced into bootstrap thread before idle thread is set up */
             resched = true;
     }
 
-    mp_reschedule(MP_CPU_ALL_BUT_LOCAL, 0);
+    mp_reschedule(target, 0);
 
     THREAD_UNLOCK(state);
 
@@ -448,29 +569,38 @@ static void idle_thread_routine(void)
 
 static thread_t *get_top_thread(int cpu)
 {
-    thread_t *newthread;
-    uint32_t local_run_queue_bitmap = run_queue_bitmap;
+    struct run_queue *rq = &run_queues[cpu];
+    thread_t *newthread = run_queue_peek(rq, cpu, 0);
 
-    while (local_run_queue_bitmap) {
-        /* find the first (remaining) queue with a thread in it */
-        uint next_queue = sizeof(run_queue_bitmap) * 8 - 1 - __builtin_clz(local_run_queue_bitmap);
-
-        list_for_every_entry(&run_queue[next_queue], newthread, thread_t, queue_node) {
 #if WITH_SMP
-            if (newthread->pinned_cpu < 0 || newthread->pinned_cpu == cpu)
-#endif
-            {
-                list_delete(&newthread->queue_node);
-
-                if (list_is_empty(&run_queue[next_queue]))
-                    run_queue_bitmap &= ~(1<<next_queue);
-
-                return newthread;
-            }
+    /* steal a thread that outranks everything queued here */
+    int min_priority = newthread ? newthread->priority + 1 : 0;
+    bool stolen = false;
+
+    for (uint i = 1; i < SMP_MAX_CPUS; i++) {
+        struct run_queue *other = &run_queues[(cpu + i) % SMP_MAX_CPUS];
+
+        if (!other->bitmap || run_queue_top_priority(other->bitmap) < min_priority)
+            continue;
+
+        thread_t *t = run_queue_peek(other, cpu, min_priority);
+        if (t) {
+            newthread = t;
+            rq = other;
+            min_priority = t->priority + 1;
+            stolen = true;
         }
+    }
 
-        local_run_queue_bitmap &= ~(1<<next_queue);
+    if (stolen)
+        THREAD_STATS_INC(steals);
+#endif
+
+    if (newthread) {
+        run_queue_remove(rq, newthread);
+        return newthread;
     }
+
     /* no threads to run, select the idle thread for this cpu */
     return idle_thread(cpu);
 }
@@ -518,6 +648,9 @@ void thread_resched(void)
     /* mark the cpu ownership of the threads */
     thread_set_curr_cpu(oldthread, -1);
     thread_set_curr_cpu(newthread, cpu);
+#if WITH_SMP
+    newthread->last_cpu = cpu;
+#endif
 
 #if WITH_SMP
     if (thread_is_idle(newthread)) {
@@ -546,6 +679,7 @@ void thread_resched(void)
 #endif
 
     KEVLOG_THREAD_SWITCH(oldthread, newthread);
+    KTRACE_THREAD_SWITCH(newthread);
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
     if (thread_is_real_time_or_idle(newthread)) {
@@ -720,8 +854,7 @@ void thread_unblock(thread_t *t, bool resched)
     DEBUG_ASSERT(!thread_is_idle(t));
 
     t->state = THREAD_READY;
-    insert_in_run_queue_head(t);
-    mp_reschedule(MP_CPU_ALL_BUT_LOCAL, 0);
+    mp_reschedule(insert_in_run_queue_head(t), 0);
     if (resched)
         thread_resched();
 }
@@ -752,7 +885,7 @@ static enum handler_return thread_sleep_handler(timer_t *timer, lk_time_t now, v
     THREAD_LOCK(state);
 
     t->state = THREAD_READY;
-    insert_in_run_queue_head(t);
+    mp_reschedule(insert_in_run_queue_head(t), 0);
 
     THREAD_UNLOCK(state);
 
@@ -800,8 +933,10 @@ void thread_init_early(void)
     DEBUG_ASSERT(arch_curr_cpu_num() == 0);
 
     /* initialize the run queues */
-    for (i=0; i < NUM_PRIORITIES; i++)
-        list_initialize(&run_queue[i]);
+    for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        for (i=0; i < NUM_PRIORITIES; i++)
+            list_initialize(&run_queues[cpu].queue[i]);
+    }
 
     /* initialize the thread list */
     list_initialize(&thread_list);
@@ -1043,6 +1178,17 @@ void dump_all_threads(void)
     THREAD_UNLOCK(state);
 }
 
+void thread_list_walk(void (*cb)(thread_t *t, void *arg), void *arg)
+{
+    thread_t *t;
+
+    THREAD_LOCK(state);
+    list_for_every_entry(&thread_list, t, thread_t, thread_list_node) {
+        cb(t, arg);
+    }
+    THREAD_UNLOCK(state);
+}
+
 /** @} */
 
 
@@ -1168,8 +1314,7 @@ int wait_queue_wake_one(wait_queue_t *wait, bool reschedule, status_t wait_queue
             current_thread->state = THREAD_READY;
             insert_in_run_queue_head(current_thread);
         }
-        insert_in_run_queue_head(t);
-        mp_reschedule(MP_CPU_ALL_BUT_LOCAL, 0);
+        mp_reschedule(insert_in_run_queue_head(t), 0);
         if (reschedule) {
             thread_resched();
         }
@@ -1216,6 +1361,7 @@ int wait_queue_wake_all(wait_queue_t *wait, bool reschedule, status_t wait_queue
     }
 
     /* pop all the threads off the wait queue into the run queue */
+    mp_cpu_mask_t target = 0;
     while ((t = list_remove_head_type(&wait->list, thread_t, queue_node))) {
         wait->count--;
         DEBUG_ASSERT(t->state == THREAD_BLOCKED);
@@ -1223,14 +1369,14 @@ int wait_queue_wake_all(wait_queue_t *wait, bool reschedule, status_t wait_queue
         t->wait_queue_block_ret = wait_queue_error;
         t->blocking_wait_queue = NULL;
 
-        insert_in_run_queue_head(t);
+        target |= insert_in_run_queue_head(t);
         ret++;
     }
 
     DEBUG_ASSERT(wait->count == 0);
 
     if (ret > 0) {
-        mp_reschedule(MP_CPU_ALL_BUT_LOCAL, 0);
+        mp_reschedule(target, 0);
         if (reschedule) {
             thread_resched();
         }
@@ -1284,8 +1430,7 @@ status_t thread_unblock_from_wait_queue(thread_t *t, status_t wait_queue_error)
     t->blocking_wait_queue = NULL;
     t->state = THREAD_READY;
     t->wait_queue_block_ret = wait_queue_error;
-    insert_in_run_queue_head(t);
-    mp_reschedule(MP_CPU_ALL_BUT_LOCAL, 0);
+    mp_reschedule(insert_in_run_queue_head(t), 0);
 
     return NO_ERROR;
 }
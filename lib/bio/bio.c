@@ -29,6 +29,7 @@
 #include <list.h>
 #include <pow2.h>
 #include <lib/bio.h>
+#include <kernel/ktrace.h>
 #include <kernel/mutex.h>
 #include <lk/init.h>
 
@@ -677,7 +678,11 @@ ssize_t bio_read(bdev_t *dev, void *buf, off_t offset, size_t len)
     if (len == 0)
         return 0;
 
-    return dev->read(dev, buf, offset, len);
+    KTRACE_BEGIN(KTRACE_BIO, "bio_read", len);
+    ssize_t ret = dev->read(dev, buf, offset, len);
+    KTRACE_END(KTRACE_BIO, "bio_read");
+
+    return ret;
 }
 
 ssize_t bio_read_block(bdev_t *dev, void *buf, bnum_t block, uint count)
@@ -692,7 +697,11 @@ ssize_t bio_read_block(bdev_t *dev, void *buf, bnum_t block, uint count)
     if (count == 0)
         return 0;
 
-    return dev->read_block(dev, buf, block, count);
+    KTRACE_BEGIN(KTRACE_BIO, "bio_read_block", count);
+    ssize_t ret = dev->read_block(dev, buf, block, count);
+    KTRACE_END(KTRACE_BIO, "bio_read_block");
+
+    return ret;
 }
 
 ssize_t bio_write(bdev_t *dev, const void *buf, off_t offset, size_t len)
@@ -707,7 +716,11 @@ ssize_t bio_write(bdev_t *dev, const void *buf, off_t offset, size_t len)
     if (len == 0)
         return 0;
 
-    return dev->write(dev, buf, offset, len);
+    KTRACE_BEGIN(KTRACE_BIO, "bio_write", len);
+    ssize_t ret = dev->write(dev, buf, offset, len);
+    KTRACE_END(KTRACE_BIO, "bio_write");
+
+    return ret;
 }
 
 ssize_t bio_write_block(bdev_t *dev, const void *buf, bnum_t block, uint count)
@@ -722,7 +735,11 @@ ssize_t bio_write_block(bdev_t *dev, const void *buf, bnum_t block, uint count)
     if (count == 0)
         return 0;
 
-    return dev->write_block(dev, buf, block, count);
+    KTRACE_BEGIN(KTRACE_BIO, "bio_write_block", count);
+    ssize_t ret = dev->write_block(dev, buf, block, count);
+    KTRACE_END(KTRACE_BIO, "bio_write_block");
+
+    return ret;
 }
 
 ssize_t bio_erase(bdev_t *dev, off_t offset, size_t len)
@@ -736,7 +753,11 @@ ssize_t bio_erase(bdev_t *dev, off_t offset, size_t len)
     if (len == 0)
         return 0;
 
-    return dev->erase(dev, offset, len);
+    KTRACE_BEGIN(KTRACE_BIO, "bio_erase", len);
+    ssize_t ret = dev->erase(dev, offset, len);
+    KTRACE_END(KTRACE_BIO, "bio_erase");
+
+    return ret;
 }
 
 int bio_ioctl(bdev_t *dev, int request, void *argp)
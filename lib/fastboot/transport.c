@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <debug.h>
+#include <sys/types.h>
+#include <kernel/mutex.h>
+#include <dev/usb/fastboot.h>
+
+static const struct fastboot_transport *fb_default_transport;
+static const struct fastboot_transport *fb_transport;
+
+/* Held by the transport whose command or session is running */
+static mutex_t fb_transport_lock = MUTEX_INITIAL_VALUE(fb_transport_lock);
+
+void fastboot_register_default_transport(const struct fastboot_transport *t)
+{
+	mutex_acquire(&fb_transport_lock);
+	if (fb_transport == fb_default_transport)
+		fb_transport = t;
+	fb_default_transport = t;
+	mutex_release(&fb_transport_lock);
+}
+
+void fastboot_acquire_transport(const struct fastboot_transport *t)
+{
+	mutex_acquire(&fb_transport_lock);
+	fb_transport = t;
+}
+
+void fastboot_release_transport(void)
+{
+	DEBUG_ASSERT(is_mutex_held(&fb_transport_lock));
+
+	fb_transport = fb_default_transport;
+	mutex_release(&fb_transport_lock);
+}
+
+const struct fastboot_transport *fastboot_get_transport(void)
+{
+	return fb_transport;
+}
+
+void fastboot_send_info(char *response, unsigned int len)
+{
+	if (fb_transport)
+		fb_transport->send_info(response, len);
+}
+
+void fastboot_send_status(char *response, unsigned int len, int sync)
+{
+	if (fb_transport)
+		fb_transport->send_status(response, len, sync);
+}
+
+void fastboot_set_payload_data(int dir, void *buf, unsigned int len)
+{
+	if (fb_transport)
+		fb_transport->set_payload_data(dir, buf, len);
+}
+
+void fastboot_send_payload_async(void *buf, unsigned int len)
+{
+	if (fb_transport)
+		fb_transport->send_payload_async(buf, len);
+}
+
+void fastboot_wait_payload(void)
+{
+	if (fb_transport)
+		fb_transport->wait_payload();
+}
+
+void fastboot_send_payload(void *buf, unsigned int len)
+{
+	fastboot_send_payload_async(buf, len);
+	fastboot_wait_payload();
+}
+
+void fastboot_set_upload_len(unsigned long long len)
+{
+	if (fb_transport && fb_transport->set_upload_len)
+		fb_transport->set_upload_len(len);
+}
+
+void fasboot_set_rx_sz(unsigned int prot_req_sz)
+{
+	if (fb_transport && fb_transport->set_rx_sz)
+		fb_transport->set_rx_sz(prot_req_sz);
+}
@@ -21,7 +21,14 @@
 
 #include <sys/types.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h> /* TODO : divide print_lcd function */
+#include <arch/ops.h>
+#include <kernel/thread.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
+#include <lk/init.h>
+#include <platform.h>
 
 #include "exynos_font.h"
 #include <dev/dpu/lcd_ctrl.h>
@@ -34,6 +41,30 @@ static u32 y_pos = 0;
 #define ALPHANUMERIC_OFFSET		32
 #define LENGTH_OF_A_CHAR_ARRAY		((FONT_Y) * 2)
 #define FONT_PTR_BIT			(((FONT_X) / 2) - 1)
+#define NUM_GLYPHS			(127 - ALPHANUMERIC_OFFSET)
+#define NUM_TEXT_LINES			(LCD_HEIGHT / FONT_Y + 1)
+
+/*
+ * Glyphs expanded to pixels for one (font, bg) colour pair, so a
+ * character row is a plain FONT_X pixel copy. Callers only ever use a
+ * handful of pairs.
+ */
+#define GLYPH_ATLAS_SLOTS		4
+#define GLYPH_ATLAS_PIXELS		(NUM_GLYPHS * FONT_Y * FONT_X)
+
+static struct glyph_atlas {
+	u32 font_color;
+	u32 bg_color;
+	u32 last_use;
+	u32 *pixels;
+} glyph_atlas[GLYPH_ATLAS_SLOTS];
+static u32 glyph_atlas_clock;
+
+/* Drawn extent of each text line, cleared instead of the whole fb */
+static struct {
+	u32 x_start;
+	u32 x_end;
+} text_line[NUM_TEXT_LINES];
 
 /* Fill the frame buffer one character at a time */
 static int fill_fb_one_char(u32 *fb_buf, u32 x_pos, u32 fb_width, char ascii,
@@ -85,9 +116,82 @@ static int fill_fb_one_char(u32 *fb_buf, u32 x_pos, u32 fb_width, char ascii,
 	return 0;
 }
 
-static void initialize_font_fb(void)
+static u32 *glyph_atlas_get(u32 font_color, u32 bg_color)
+{
+	struct glyph_atlas *atlas = NULL;
+	u32 *px;
+	u8 bits;
+	int i, c, row, k;
+
+	for (i = 0; i < GLYPH_ATLAS_SLOTS; i++) {
+		if (glyph_atlas[i].pixels && glyph_atlas[i].font_color == font_color &&
+				glyph_atlas[i].bg_color == bg_color) {
+			glyph_atlas[i].last_use = ++glyph_atlas_clock;
+			return glyph_atlas[i].pixels;
+		}
+		if (!atlas || glyph_atlas[i].last_use < atlas->last_use)
+			atlas = &glyph_atlas[i];
+	}
+
+	/* Reuse the least recently used pair */
+	if (!atlas->pixels)
+		atlas->pixels = malloc(GLYPH_ATLAS_PIXELS * sizeof(u32));
+	if (!atlas->pixels)
+		return NULL;
+
+	px = atlas->pixels;
+	for (c = 0; c < NUM_GLYPHS; c++) {
+		for (row = 0; row < FONT_Y * 2; row++) {
+			/* Two bytes per font row, MSB is the leftmost pixel */
+			bits = font[LENGTH_OF_A_CHAR_ARRAY * c + row];
+			for (k = 0; k < FONT_X / 2; k++)
+				*px++ = (bits & (0x80 >> k)) ? font_color : bg_color;
+		}
+	}
+
+	atlas->font_color = font_color;
+	atlas->bg_color = bg_color;
+	atlas->last_use = ++glyph_atlas_clock;
+
+	return atlas->pixels;
+}
+
+/* Copy a line of glyphs into the fb one pixel row at a time */
+static void blit_line(u32 *fb_buf, u32 x_pos, u32 fb_width, const u8 *str,
+		int cnt, u32 y_pos, const u32 *atlas)
+{
+	const u32 *glyph;
+	u32 *fb_ptr;
+	int i, row;
+
+	for (row = 0; row < FONT_Y; row++) {
+		fb_ptr = fb_buf + ((row + y_pos) * fb_width) + x_pos;
+		for (i = 0; i < cnt; i++, fb_ptr += FONT_X) {
+			if (str[i] < 32 || str[i] > 126)
+				continue;
+			glyph = atlas + ((str[i] - ALPHANUMERIC_OFFSET) * FONT_Y + row) * FONT_X;
+			memcpy(fb_ptr, glyph, FONT_X * sizeof(u32));
+		}
+	}
+}
+
+static void initialize_font_fb(u32 fb_width)
 {
-	memset((void *)CONFIG_DISPLAY_FONT_BASE_ADDRESS, 0, LCD_WIDTH * LCD_HEIGHT * 4);
+	u32 *fb = (u32 *)CONFIG_DISPLAY_FONT_BASE_ADDRESS;
+	u32 line, row;
+
+	/* Only what was drawn since the last wrap */
+	for (line = 0; line < NUM_TEXT_LINES; line++) {
+		if (text_line[line].x_end <= text_line[line].x_start)
+			continue;
+
+		for (row = line * FONT_Y; row < (line + 1) * FONT_Y && row < LCD_HEIGHT; row++)
+			memset(fb + row * fb_width + text_line[line].x_start, 0,
+				(text_line[line].x_end - text_line[line].x_start) * sizeof(u32));
+
+		text_line[line].x_start = 0;
+		text_line[line].x_end = 0;
+	}
 }
 
 /* Fill one line of the frame buffer with characters */
@@ -97,6 +201,8 @@ static int _fill_fb_string(u32 *fb_buf, u32 x_pos, u8 *str,
 	int i = 0;
 	int cnt = 0;
 	char ch = 0;
+	u32 line, x_end;
+	u32 *atlas;
 	struct exynos_panel_info *lcd_info = common_get_lcd_info();
 
 	if (lgth > MAX_NUM_CHAR_PER_LINE)
@@ -104,19 +210,34 @@ static int _fill_fb_string(u32 *fb_buf, u32 x_pos, u8 *str,
 	else
 		cnt = lgth;
 
-	if (y_pos > lcd_info->yres) {
+	if (y_pos + FONT_Y > lcd_info->yres) {
 		/* Rolling fb, y_pos and fb address reinit */
 		y_pos = 0;
 		fb_buf = (u32 *)CONFIG_DISPLAY_FONT_BASE_ADDRESS;
-		initialize_font_fb();
+		initialize_font_fb(lcd_info->xres);
 	}
 
+	line = y_pos / FONT_Y;
+	x_end = x_pos + cnt * FONT_X;
+	if (text_line[line].x_end <= text_line[line].x_start) {
+		text_line[line].x_start = x_pos;
+		text_line[line].x_end = x_end;
+	} else {
+		text_line[line].x_start = MIN(text_line[line].x_start, x_pos);
+		text_line[line].x_end = MAX(text_line[line].x_end, x_end);
+	}
+
+	atlas = glyph_atlas_get(font_color, bg_color);
+	if (atlas)
+		blit_line(fb_buf, x_pos, lcd_info->xres, str, cnt, y_pos, atlas);
+
 	for (i = 0; i < cnt; i++) {
 		ch = *(str++);
-		if (fill_fb_one_char(fb_buf, x_pos + (i * FONT_X), lcd_info->xres,
-			ch, y_pos, font_color, bg_color)) {
+		if (ch < 32 || ch > 126)
 			printf("This(%c) character is not supported\n", ch);
-		}
+		else if (!atlas)
+			fill_fb_one_char(fb_buf, x_pos + (i * FONT_X), lcd_info->xres,
+				ch, y_pos, font_color, bg_color);
 	}
 
 	y_pos += FONT_Y;
@@ -152,9 +273,98 @@ int fill_fb_string(u32 *fb_buf, u32 x_pos, u8 *str, u32 font_color, u32 bg_color
 #if defined(CONFIG_EXYNOS_BOOTLOADER_DISPLAY) && defined(CONFIG_DISPLAY_DRAWFONT)
 #define PRINT_BUF_SIZE 384
 #define TOP_MARGIN	40
+#define LCD_UPDATE_FPS	60
+
 extern u32 win_fb0;
 extern void decon_string_update(void);
 
+/*
+ * Every decon update pushes the whole frame to the panel, so updates
+ * asked for faster than the panel refreshes are merged. The first one
+ * after an idle period goes out right away, the rest of a burst is
+ * pushed by lcd_update_thread at the next frame time.
+ */
+static struct {
+	mutex_t lock;
+	event_t dirty;
+	thread_t *thread;
+	lk_time_t last_push;
+	volatile int pending;
+} lcd_update = {
+	.lock = MUTEX_INITIAL_VALUE(lcd_update.lock),
+	.dirty = EVENT_INITIAL_VALUE(lcd_update.dirty, false, EVENT_FLAG_AUTOUNSIGNAL),
+};
+
+static void lcd_update_push(void)
+{
+	mutex_acquire(&lcd_update.lock);
+	lcd_update.pending = 0;
+	lcd_update.last_push = current_time();
+	decon_string_update();
+	mutex_release(&lcd_update.lock);
+}
+
+static lk_time_t lcd_update_wait(void)
+{
+	lk_time_t elapsed = current_time() - lcd_update.last_push;
+
+	if (elapsed >= 1000 / LCD_UPDATE_FPS)
+		return 0;
+
+	return 1000 / LCD_UPDATE_FPS - elapsed;
+}
+
+static int lcd_update_thread(void *arg)
+{
+	lk_time_t wait;
+
+	for (;;) {
+		event_wait(&lcd_update.dirty);
+
+		wait = lcd_update_wait();
+		if (wait)
+			thread_sleep(wait);
+
+		if (lcd_update.pending)
+			lcd_update_push();
+	}
+
+	return 0;
+}
+
+static void lcd_update_request(void)
+{
+	/* Nothing to defer to, or not allowed to block */
+	if (!lcd_update.thread || arch_ints_disabled()) {
+		lcd_update.last_push = current_time();
+		decon_string_update();
+		return;
+	}
+
+	if (!lcd_update.pending && !lcd_update_wait()) {
+		lcd_update_push();
+		return;
+	}
+
+	lcd_update.pending = 1;
+	event_signal(&lcd_update.dirty, true);
+}
+
+static void lcd_update_init(uint level)
+{
+	thread_t *t;
+
+	t = thread_create("lcd_update", lcd_update_thread, NULL,
+			HIGH_PRIORITY, DEFAULT_STACK_SIZE);
+	if (!t)
+		return;
+
+	lcd_update.thread = t;
+	thread_detach_and_resume(t);
+}
+
+LK_INIT_HOOK(lcd_update, &lcd_update_init, LK_INIT_LEVEL_THREADING);
+
 int print_lcd(u32 font_color, u32 bg_color, const char *fmt, ...)
 {
 	va_list args;
@@ -196,7 +406,7 @@ int print_lcd_update(u32 font_color, u32 bg_color, const char *fmt, ...)
 		return -1;
 	}
 
-	decon_string_update();
+	lcd_update_request();
 
 	return 0;
 }
@@ -56,7 +56,7 @@ void font_draw_char(gfx_surface *surface, unsigned char c, int x, int y, uint32_
             line = line >> 1;
         }
     }
-    gfx_flush_rows(surface, y, y + FONT_Y);
+    gfx_flush(surface);
 }
 
 
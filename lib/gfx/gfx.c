@@ -34,6 +34,7 @@
 
 #include <debug.h>
 #include <trace.h>
+#include <err.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -41,6 +42,11 @@
 #include <sys/types.h>
 #include <lib/gfx.h>
 #include <dev/display.h>
+#include <platform.h>
+
+#if GFX_NEON
+#include "gfx_neon.h"
+#endif
 
 #define LOCAL_TRACE 0
 
@@ -123,6 +129,7 @@ void gfx_copyrect(gfx_surface *surface, uint x, uint y, uint width, uint height,
         height = surface->height - y2;
 
     surface->copyrect(surface, x, y, width, height, x2, y2);
+    gfx_mark_dirty(surface, x2, y2, width, height);
 }
 
 /**
@@ -148,6 +155,7 @@ void gfx_fillrect(gfx_surface *surface, uint x, uint y, uint width, uint height,
         height = surface->height - y;
 
     surface->fillrect(surface, x, y, width, height, color);
+    gfx_mark_dirty(surface, x, y, width, height);
 }
 
 /**
@@ -161,6 +169,7 @@ void gfx_putpixel(gfx_surface *surface, uint x, uint y, uint color)
         return;
 
     surface->putpixel(surface, x, y, color);
+    gfx_mark_dirty(surface, x, y, 1, 1);
 }
 
 static void putpixel16(gfx_surface *surface, uint x, uint y, uint color)
@@ -205,9 +214,9 @@ static void copyrect8(gfx_surface *surface, uint x, uint y, uint width, uint hei
             src += stride_diff;
         }
     } else {
-        // copy backwards
-        src += height * surface->stride + width;
-        dest += height * surface->stride + width;
+        // copy backwards, from the last pixel of the last row
+        src += (height - 1) * surface->stride + width - 1;
+        dest += (height - 1) * surface->stride + width - 1;
 
         uint i, j;
         for (i=0; i < height; i++) {
@@ -258,9 +267,9 @@ static void copyrect16(gfx_surface *surface, uint x, uint y, uint width, uint he
             src += stride_diff;
         }
     } else {
-        // copy backwards
-        src += height * surface->stride + width;
-        dest += height * surface->stride + width;
+        // copy backwards, from the last pixel of the last row
+        src += (height - 1) * surface->stride + width - 1;
+        dest += (height - 1) * surface->stride + width - 1;
 
         uint i, j;
         for (i=0; i < height; i++) {
@@ -311,9 +320,9 @@ static void copyrect32(gfx_surface *surface, uint x, uint y, uint width, uint he
             src += stride_diff;
         }
     } else {
-        // copy backwards
-        src += height * surface->stride + width;
-        dest += height * surface->stride + width;
+        // copy backwards, from the last pixel of the last row
+        src += (height - 1) * surface->stride + width - 1;
+        dest += (height - 1) * surface->stride + width - 1;
 
         uint i, j;
         for (i=0; i < height; i++) {
@@ -343,6 +352,55 @@ static void fillrect32(gfx_surface *surface, uint x, uint y, uint width, uint he
     }
 }
 
+#if GFX_NEON
+// the color repeated to 32 bits, for a byte pattern fill
+static uint32_t fill_pattern(gfx_surface *surface, uint color)
+{
+    switch (surface->pixelsize) {
+        case 1:
+            return (surface->translate_color(color) & 0xff) * 0x01010101;
+        case 2:
+            return (surface->translate_color(color) & 0xffff) * 0x00010001;
+        default:
+            return color;
+    }
+}
+
+static void fillrect_neon(gfx_surface *surface, uint x, uint y, uint width, uint height, uint color)
+{
+    uint runlen = surface->stride * surface->pixelsize;
+    uint8_t *dest = (uint8_t *)surface->ptr + y * runlen + x * surface->pixelsize;
+    uint32_t pattern = fill_pattern(surface, color);
+
+    for (uint i = 0; i < height; i++) {
+        gfx_neon_fill(dest, pattern, width * surface->pixelsize);
+        dest += runlen;
+    }
+}
+
+static void copyrect_neon(gfx_surface *surface, uint x, uint y, uint width, uint height, uint x2, uint y2)
+{
+    uint runlen = surface->stride * surface->pixelsize;
+    const uint8_t *src = (const uint8_t *)surface->ptr + y * runlen + x * surface->pixelsize;
+    uint8_t *dest = (uint8_t *)surface->ptr + y2 * runlen + x2 * surface->pixelsize;
+    uint len = width * surface->pixelsize;
+
+    // rows in the order that does not overwrite unread ones, each row is a memmove
+    if (y2 <= y) {
+        for (uint i = 0; i < height; i++)
+            gfx_neon_move(dest + i * runlen, src + i * runlen, len);
+    } else {
+        for (uint i = height; i > 0; i--)
+            gfx_neon_move(dest + (i - 1) * runlen, src + (i - 1) * runlen, len);
+    }
+}
+
+static void convertrow565_neon(gfx_surface *surface, void *dest, const uint32_t *src, uint count)
+{
+    gfx_neon_argb_to_rgb565(dest, src, count);
+}
+#endif
+
 void gfx_line(gfx_surface *surface, uint x1, uint y1, uint x2, uint y2, uint color)
 {
     if (unlikely(x1 >= surface->width))
@@ -364,6 +422,8 @@ void gfx_line(gfx_surface *surface, uint x1, uint y1, uint x2, uint y2, uint col
     uint dxabs = (dx > 0) ? dx : -dx;
     uint dyabs = (dy > 0) ? dy : -dy;
 
+    gfx_mark_dirty(surface, MIN(x1, x2), MIN(y1, y2), dxabs + 1, dyabs + 1);
+
     uint x = dyabs >> 1;
     uint y = dxabs >> 1;
 
@@ -432,15 +492,64 @@ uint32_t alpha32_add_ignore_destalpha(uint32_t dest, uint32_t src)
     return (srca << 24) | (cres[0] << 16) | (cres[1] << 8) | (cres[2]);
 }
 
+static void blendrow32(uint32_t *dest, const uint32_t *src, uint count)
+{
+    for (uint i = 0; i < count; i++) {
+        // XXX ignores destination alpha
+        dest[i] = alpha32_add_ignore_destalpha(dest[i], src[i]);
+    }
+}
+
+// dest = src + dest * (255 - src alpha) / 255, per channel
+static void blendrow32_premul(uint32_t *dest, const uint32_t *src, uint count)
+{
+    for (uint i = 0; i < count; i++) {
+        uint32_t s = src[i];
+        uint32_t ainv = 255 - (s >> 24);
+        uint32_t res = 0;
+
+        if (ainv == 255 && s == 0)
+            continue;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t t = ((dest[i] >> shift) & 0xff) * ainv + 128;
+
+            res |= ((((s >> shift) & 0xff) + ((t + (t >> 8)) >> 8)) & 0xff) << shift;
+        }
+        dest[i] = res;
+    }
+}
+
+static void convertrow16(gfx_surface *surface, void *dest, const uint32_t *src, uint count)
+{
+    uint16_t *d = dest;
+
+    for (uint i = 0; i < count; i++)
+        d[i] = (uint16_t)surface->translate_color(src[i]);
+}
+
+static void convertrow8(gfx_surface *surface, void *dest, const uint32_t *src, uint count)
+{
+    uint8_t *d = dest;
+
+    for (uint i = 0; i < count; i++)
+        d[i] = (uint8_t)surface->translate_color(src[i]);
+}
+
+static bool format_is_argb(gfx_format format)
+{
+    return format == GFX_FORMAT_ARGB_8888 || format == GFX_FORMAT_ARGB_8888_PREMUL;
+}
+
 /**
  * @brief  Copy pixels from source to dest.
  *
- * Currently does not support alpha channel.
+ * ARGB sources are alpha blended onto 32 bit targets, any 32 bit source
+ * is converted for 16 and 8 bit targets. Other combinations need the
+ * same format on both sides.
  */
 void gfx_surface_blend(struct gfx_surface *target, struct gfx_surface *source, uint destx, uint desty)
 {
-    DEBUG_ASSERT(target->format == source->format);
-
     LTRACEF("target %p, source %p, destx %u, desty %u\n", target, source, destx, desty);
 
     if (destx >= target->width)
@@ -456,6 +565,8 @@ void gfx_surface_blend(struct gfx_surface *target, struct gfx_surface *source, u
     if (desty + height > target->height)
         height = target->height - desty;
 
+    gfx_mark_dirty(target, destx, desty, width, height);
+
     // XXX total hack to deal with various blends
     if (source->format == GFX_FORMAT_RGB_565 && target->format == GFX_FORMAT_RGB_565) {
         // 16 bit to 16 bit
@@ -476,25 +587,30 @@ void gfx_surface_blend(struct gfx_surface *target, struct gfx_surface *source, u
             dest += dest_stride_diff;
             src += source_stride_diff;
         }
-    } else if (source->format == GFX_FORMAT_ARGB_8888 && target->format == GFX_FORMAT_ARGB_8888) {
-        // both are 32 bit modes, both alpha
+    } else if (format_is_argb(source->format) &&
+               (format_is_argb(target->format) || target->format == GFX_FORMAT_RGB_x888)) {
+        // 32 bit with alpha onto 32 bit
         const uint32_t *src = (const uint32_t *)source->ptr;
         uint32_t *dest = &((uint32_t *)target->ptr)[destx + desty * target->stride];
-        uint dest_stride_diff = target->stride - width;
-        uint source_stride_diff = source->stride - width;
 
-        LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, dest_stride_diff, source_stride_diff);
+        LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, target->stride, source->stride);
 
-        uint i, j;
-        for (i=0; i < height; i++) {
-            for (j=0; j < width; j++) {
-                // XXX ignores destination alpha
-                *dest = alpha32_add_ignore_destalpha(*dest, *src);
-                dest++;
-                src++;
-            }
-            dest += dest_stride_diff;
-            src += source_stride_diff;
+        for (uint i = 0; i < height; i++) {
+            source->blendrow(dest, src, width);
+            dest += target->stride;
+            src += source->stride;
+        }
+    } else if (source->pixelsize == 4 && target->pixelsize < 4) {
+        // 32 bit onto a smaller format, converted a row at a time
+        const uint32_t *src = (const uint32_t *)source->ptr;
+        uint8_t *dest = (uint8_t *)target->ptr + (destx + desty * target->stride) * target->pixelsize;
+
+        LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, target->stride, source->stride);
+
+        for (uint i = 0; i < height; i++) {
+            target->convertrow(target, dest, src, width);
+            dest += target->stride * target->pixelsize;
+            src += source->stride;
         }
     } else if (source->format == GFX_FORMAT_RGB_x888 && target->format == GFX_FORMAT_RGB_x888) {
         // both are 32 bit modes, no alpha
@@ -539,15 +655,116 @@ void gfx_surface_blend(struct gfx_surface *target, struct gfx_surface *source, u
     }
 }
 
+static void rect_union(gfx_rect *r, uint x, uint y, uint x2, uint y2)
+{
+    uint rx2 = MAX(r->x + r->width, x2);
+    uint ry2 = MAX(r->y + r->height, y2);
+
+    r->x = MIN(r->x, x);
+    r->y = MIN(r->y, y);
+    r->width = rx2 - r->x;
+    r->height = ry2 - r->y;
+}
+
+// pixels a rect would grow by when merged with x,y - x2,y2
+static size_t rect_union_growth(const gfx_rect *r, uint x, uint y, uint x2, uint y2)
+{
+    gfx_rect u = *r;
+
+    rect_union(&u, x, y, x2, y2);
+
+    return (size_t)u.width * u.height - (size_t)r->width * r->height;
+}
+
+/**
+ * @brief  Add a rectangle to the damage of a surface
+ *
+ * Touching or overlapping rects are merged, once all slots are taken the
+ * new one goes into the rect it grows the least.
+ */
+void gfx_mark_dirty(gfx_surface *surface, uint x, uint y, uint width, uint height)
+{
+    if (x >= surface->width || y >= surface->height)
+        return;
+    if (width == 0 || height == 0)
+        return;
+    if (x + width > surface->width)
+        width = surface->width - x;
+    if (y + height > surface->height)
+        height = surface->height - y;
+
+    uint x2 = x + width;
+    uint y2 = y + height;
+    uint i;
+
+    for (i = 0; i < surface->dirty_count; i++) {
+        gfx_rect *r = &surface->dirty[i];
+
+        if (x <= r->x + r->width && x2 >= r->x && y <= r->y + r->height && y2 >= r->y) {
+            rect_union(r, x, y, x2, y2);
+            return;
+        }
+    }
+
+    if (surface->dirty_count < GFX_DIRTY_RECTS) {
+        gfx_rect *r = &surface->dirty[surface->dirty_count++];
+
+        r->x = x;
+        r->y = y;
+        r->width = width;
+        r->height = height;
+        return;
+    }
+
+    uint best = 0;
+    size_t best_growth = SIZE_MAX;
+    for (i = 0; i < GFX_DIRTY_RECTS; i++) {
+        size_t growth = rect_union_growth(&surface->dirty[i], x, y, x2, y2);
+
+        if (growth < best_growth) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    rect_union(&surface->dirty[best], x, y, x2, y2);
+}
+
+static void clean_rect(gfx_surface *surface, const gfx_rect *r)
+{
+    size_t rowbytes = surface->stride * surface->pixelsize;
+    addr_t start = (addr_t)surface->ptr + r->y * rowbytes;
+
+    if (r->width * 2 >= surface->stride) {
+        // wide enough that one range over the full rows is cheaper
+        arch_clean_cache_range(start, r->height * rowbytes);
+        return;
+    }
+
+    start += r->x * surface->pixelsize;
+    for (uint i = 0; i < r->height; i++)
+        arch_clean_cache_range(start + i * rowbytes, r->width * surface->pixelsize);
+}
+
 /**
  * @brief  Ensure all graphics rendering is sent to display
+ *
+ * Only the damage recorded since the last flush is written back and
+ * handed to the display.
  */
 void gfx_flush(gfx_surface *surface)
 {
-    arch_clean_cache_range((addr_t)surface->ptr, surface->len);
+    for (uint i = 0; i < surface->dirty_count; i++) {
+        const gfx_rect *r = &surface->dirty[i];
 
-    if (surface->flush)
-        surface->flush(0, surface->height-1);
+        clean_rect(surface, r);
+
+        if (surface->flush_rect)
+            surface->flush_rect(r->x, r->y, r->width, r->height);
+        else if (surface->flush)
+            surface->flush(r->y, r->y + r->height - 1);
+    }
+
+    surface->dirty_count = 0;
 }
 
 /**
@@ -569,8 +786,21 @@ void gfx_flush_rows(struct gfx_surface *surface, uint start, uint end)
     uint32_t runlen = surface->stride * surface->pixelsize;
     arch_clean_cache_range((addr_t)surface->ptr + start * runlen, (end - start + 1) * runlen);
 
-    if (surface->flush)
+    if (surface->flush_rect)
+        surface->flush_rect(0, start, surface->width, end - start + 1);
+    else if (surface->flush)
         surface->flush(start, end);
+
+    // damage inside these rows went out with them
+    uint count = 0;
+    for (uint i = 0; i < surface->dirty_count; i++) {
+        const gfx_rect *r = &surface->dirty[i];
+
+        if (r->y >= start && r->y + r->height <= end + 1)
+            continue;
+        surface->dirty[count++] = *r;
+    }
+    surface->dirty_count = count;
 }
 
 
@@ -592,6 +822,11 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
     surface->height = height;
     surface->stride = stride;
     surface->alpha = MAX_ALPHA;
+    surface->flush = NULL;
+    surface->flush_rect = NULL;
+    surface->dirty_count = 0;
+    surface->blendrow = NULL;
+    surface->convertrow = NULL;
 
     // set up some function pointers
     switch (format) {
@@ -600,15 +835,21 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
             surface->copyrect = &copyrect16;
             surface->fillrect = &fillrect16;
             surface->putpixel = &putpixel16;
+            surface->convertrow = &convertrow16;
             surface->pixelsize = 2;
             surface->len = (surface->height * surface->stride * surface->pixelsize);
             break;
         case GFX_FORMAT_RGB_x888:
         case GFX_FORMAT_ARGB_8888:
+        case GFX_FORMAT_ARGB_8888_PREMUL:
             surface->translate_color = NULL;
             surface->copyrect = &copyrect32;
             surface->fillrect = &fillrect32;
             surface->putpixel = &putpixel32;
+            if (format == GFX_FORMAT_ARGB_8888_PREMUL)
+                surface->blendrow = &blendrow32_premul;
+            else
+                surface->blendrow = &blendrow32;
             surface->pixelsize = 4;
             surface->len = (surface->height * surface->stride * surface->pixelsize);
             break;
@@ -617,6 +858,7 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
             surface->copyrect = &copyrect8;
             surface->fillrect = &fillrect8;
             surface->putpixel = &putpixel8;
+            surface->convertrow = &convertrow8;
             surface->pixelsize = 1;
             surface->len = (surface->height * surface->stride * surface->pixelsize);
             break;
@@ -625,6 +867,7 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
             surface->copyrect = &copyrect8;
             surface->fillrect = &fillrect8;
             surface->putpixel = &putpixel8;
+            surface->convertrow = &convertrow8;
             surface->pixelsize = 1;
             surface->len = (surface->height * surface->stride * surface->pixelsize);
             break;
@@ -633,6 +876,7 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
             surface->copyrect = &copyrect8;
             surface->fillrect = &fillrect8;
             surface->putpixel = &putpixel8;
+            surface->convertrow = &convertrow8;
             surface->pixelsize = 1;
             surface->len = (surface->height * surface->stride * surface->pixelsize);
             break;
@@ -643,6 +887,18 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
             return NULL;
     }
 
+#if GFX_NEON
+    // vector kernels for everything that works on whole rows
+    surface->copyrect = &copyrect_neon;
+    surface->fillrect = &fillrect_neon;
+    if (surface->blendrow == &blendrow32)
+        surface->blendrow = &gfx_neon_blend_argb;
+    else if (surface->blendrow == &blendrow32_premul)
+        surface->blendrow = &gfx_neon_blend_premul;
+    if (format == GFX_FORMAT_RGB_565)
+        surface->convertrow = &convertrow565_neon;
+#endif
+
     if (ptr == NULL) {
         // allocate a buffer
         ptr = malloc(surface->len);
@@ -690,6 +946,7 @@ gfx_surface *gfx_create_surface_from_display(struct display_framebuffer *fb)
     surface = gfx_create_surface(fb->image.pixels, fb->image.width, fb->image.height, fb->image.stride, format);
 
     surface->flush = fb->flush;
+    surface->flush_rect = fb->flush_rect;
 
     return surface;
 }
@@ -836,8 +1093,152 @@ static int gfx_draw_rgb_bars(gfx_surface *surface)
     return 0;
 }
 
+#define GFX_BENCH_ROUNDS 8
+
+static lk_bigtime_t gfx_bench_fill(gfx_surface *surface)
+{
+    lk_bigtime_t t = current_time_hires();
+
+    for (uint i = 0; i < GFX_BENCH_ROUNDS; i++)
+        surface->fillrect(surface, 0, 0, surface->width, surface->height, 0xff000000 | (i * 0x203040));
+
+    return current_time_hires() - t;
+}
+
+static lk_bigtime_t gfx_bench_copy(gfx_surface *surface)
+{
+    lk_bigtime_t t = current_time_hires();
+
+    // overlapping, like a console scroll
+    for (uint i = 0; i < GFX_BENCH_ROUNDS; i++)
+        surface->copyrect(surface, 0, 1, surface->width, surface->height - 1, 0, 0);
+
+    return current_time_hires() - t;
+}
+
+static lk_bigtime_t gfx_bench_blend(gfx_surface *target, gfx_surface *source)
+{
+    lk_bigtime_t t = current_time_hires();
+
+    for (uint i = 0; i < GFX_BENCH_ROUNDS; i++)
+        gfx_surface_blend(target, source, 0, 0);
+
+    return current_time_hires() - t;
+}
+
+static void gfx_bench_report(const char *name, uint pixels, lk_bigtime_t c, lk_bigtime_t selected)
+{
+    uint64_t total = (uint64_t)pixels * GFX_BENCH_ROUNDS;
+
+    // pixels per us is Mpixels per second
+    printf("  %-24s C %5llu Mpix/s, selected %5llu Mpix/s\n", name,
+           c ? total / c : 0, selected ? total / selected : 0);
+}
+
+/*
+ * Fill rate of the kernels picked by gfx_create_surface() against the
+ * C ones, on offscreen surfaces so it works without a display.
+ */
+static int gfx_bench(uint width, uint height)
+{
+    static const struct {
+        const char *name;
+        gfx_format format;
+        void (*fillrect)(gfx_surface *, uint, uint, uint, uint, uint);
+        void (*copyrect)(gfx_surface *, uint, uint, uint, uint, uint, uint);
+    } formats[] = {
+        { "8 bpp",  GFX_FORMAT_MONO,      fillrect8,  copyrect8 },
+        { "16 bpp", GFX_FORMAT_RGB_565,   fillrect16, copyrect16 },
+        { "32 bpp", GFX_FORMAT_ARGB_8888, fillrect32, copyrect32 },
+    };
+    uint pixels = width * height;
+    gfx_surface *s, *src, *dst;
+    lk_bigtime_t c, sel;
+    char name[32];
+
+    printf("gfx bench %ux%u, %u rounds\n", width, height, GFX_BENCH_ROUNDS);
+
+    for (uint i = 0; i < countof(formats); i++) {
+        s = gfx_create_surface(NULL, width, height, width, formats[i].format);
+        if (!s || !s->ptr) {
+            printf("not enough memory\n");
+            if (s)
+                gfx_surface_destroy(s);
+            return ERR_NO_MEMORY;
+        }
+
+        void (*fillrect)(gfx_surface *, uint, uint, uint, uint, uint) = s->fillrect;
+        void (*copyrect)(gfx_surface *, uint, uint, uint, uint, uint, uint) = s->copyrect;
+
+        s->fillrect = formats[i].fillrect;
+        c = gfx_bench_fill(s);
+        s->fillrect = fillrect;
+        sel = gfx_bench_fill(s);
+        snprintf(name, sizeof(name), "fill %s", formats[i].name);
+        gfx_bench_report(name, pixels, c, sel);
+
+        s->copyrect = formats[i].copyrect;
+        c = gfx_bench_copy(s);
+        s->copyrect = copyrect;
+        sel = gfx_bench_copy(s);
+        snprintf(name, sizeof(name), "copy %s", formats[i].name);
+        gfx_bench_report(name, pixels, c, sel);
+
+        gfx_surface_destroy(s);
+    }
+
+    src = gfx_create_surface(NULL, width, height, width, GFX_FORMAT_ARGB_8888);
+    dst = gfx_create_surface(NULL, width, height, width, GFX_FORMAT_ARGB_8888);
+    s = gfx_create_surface(NULL, width, height, width, GFX_FORMAT_RGB_565);
+    if (!src || !src->ptr || !dst || !dst->ptr || !s || !s->ptr) {
+        printf("not enough memory\n");
+        goto out;
+    }
+
+    // mostly translucent, like antialiased text over a background
+    for (uint i = 0; i < pixels; i++)
+        ((uint32_t *)src->ptr)[i] = ((i * 7) & 0xff) << 24 | (i * 0x10101);
+
+    void (*blendrow)(uint32_t *, const uint32_t *, uint) = src->blendrow;
+    src->blendrow = &blendrow32;
+    c = gfx_bench_blend(dst, src);
+    src->blendrow = blendrow;
+    sel = gfx_bench_blend(dst, src);
+    gfx_bench_report("blend ARGB 8888", pixels, c, sel);
+
+    // the same memory reinterpreted as premultiplied, only speed matters
+    src->format = GFX_FORMAT_ARGB_8888_PREMUL;
+    src->blendrow = &blendrow32_premul;
+    c = gfx_bench_blend(dst, src);
+#if GFX_NEON
+    src->blendrow = &gfx_neon_blend_premul;
+#endif
+    sel = gfx_bench_blend(dst, src);
+    gfx_bench_report("blend premultiplied", pixels, c, sel);
+
+    void (*convertrow)(gfx_surface *, void *, const uint32_t *, uint) = s->convertrow;
+    s->convertrow = &convertrow16;
+    c = gfx_bench_blend(s, dst);
+    s->convertrow = convertrow;
+    sel = gfx_bench_blend(s, dst);
+    gfx_bench_report("convert to RGB 565", pixels, c, sel);
+
+out:
+    if (s)
+        gfx_surface_destroy(s);
+    if (dst)
+        gfx_surface_destroy(dst);
+    if (src)
+        gfx_surface_destroy(src);
+
+    return 0;
+}
+
 static int cmd_gfx(int argc, const cmd_args *argv)
 {
+    if (argc >= 2 && !strcmp(argv[1].str, "bench"))
+        return gfx_bench(argc > 2 ? argv[2].u : 1024, argc > 3 ? argv[3].u : 768);
+
     if (argc < 2) {
         printf("not enough arguments:\n");
         printf("%s display_info : output information bout the current display\n", argv[0].str);
@@ -845,6 +1246,7 @@ static int cmd_gfx(int argc, const cmd_args *argv)
         printf("%s test_pattern : Fill frame with test pattern\n", argv[0].str);
         printf("%s fill r g b   : Fill frame buffer with RGB888 value and force update\n", argv[0].str);
         printf("%s mandelbrot   : Fill frame buffer with Mandelbrot fractal\n", argv[0].str);
+        printf("%s bench [w h]  : Fill, copy, blend and convert rates\n", argv[0].str);
 
         return -1;
     }
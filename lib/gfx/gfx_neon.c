@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  NEON blitter kernels for lib/gfx
+ *
+ * 64 bytes per step for fill and copy, 16 pixels per step for blending
+ * and conversion, with scalar heads and tails.
+ */
+#include <string.h>
+#include <arm_neon.h>
+#include "gfx_neon.h"
+
+void gfx_neon_fill(void *dest, uint32_t pattern, size_t len)
+{
+    uint8_t *d = dest;
+    uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(pattern));
+    uint8_t tail[16];
+
+    for (; len >= 64; len -= 64, d += 64) {
+        vst1q_u8(d, v);
+        vst1q_u8(d + 16, v);
+        vst1q_u8(d + 32, v);
+        vst1q_u8(d + 48, v);
+    }
+    for (; len >= 16; len -= 16, d += 16)
+        vst1q_u8(d, v);
+
+    if (len) {
+        vst1q_u8(tail, v);
+        memcpy(d, tail, len);
+    }
+}
+
+void gfx_neon_move(void *dest, const void *src, size_t len)
+{
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    uint8x16_t a, b, c, e;
+
+    if (d == s || len == 0)
+        return;
+
+    if (d < s || d >= s + len) {
+        // forwards, all loads of a step happen before its stores
+        for (; len >= 64; len -= 64, d += 64, s += 64) {
+            a = vld1q_u8(s);
+            b = vld1q_u8(s + 16);
+            c = vld1q_u8(s + 32);
+            e = vld1q_u8(s + 48);
+            vst1q_u8(d, a);
+            vst1q_u8(d + 16, b);
+            vst1q_u8(d + 32, c);
+            vst1q_u8(d + 48, e);
+        }
+        for (; len >= 16; len -= 16, d += 16, s += 16)
+            vst1q_u8(d, vld1q_u8(s));
+        while (len--)
+            *d++ = *s++;
+    } else {
+        d += len;
+        s += len;
+        for (; len >= 64; len -= 64) {
+            d -= 64;
+            s -= 64;
+            a = vld1q_u8(s);
+            b = vld1q_u8(s + 16);
+            c = vld1q_u8(s + 32);
+            e = vld1q_u8(s + 48);
+            vst1q_u8(d, a);
+            vst1q_u8(d + 16, b);
+            vst1q_u8(d + 32, c);
+            vst1q_u8(d + 48, e);
+        }
+        for (; len >= 16; len -= 16) {
+            d -= 16;
+            s -= 16;
+            vst1q_u8(d, vld1q_u8(s));
+        }
+        while (len--)
+            *--d = *--s;
+    }
+}
+
+// (x * y) >> 8 per lane, both halves
+static inline uint8x16_t mul_shr8(uint8x16_t x, uint8x16_t y)
+{
+    return vcombine_u8(vshrn_n_u16(vmull_u8(vget_low_u8(x), vget_low_u8(y)), 8),
+                       vshrn_n_u16(vmull_u8(vget_high_u8(x), vget_high_u8(y)), 8));
+}
+
+// x * y / 255 rounded, exact for 8 bit inputs
+static inline uint8x8_t div255(uint16x8_t t)
+{
+    return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+static inline uint8x16_t mul_div255(uint8x16_t x, uint8x16_t y)
+{
+    return vcombine_u8(div255(vmull_u8(vget_low_u8(x), vget_low_u8(y))),
+                       div255(vmull_u8(vget_high_u8(x), vget_high_u8(y))));
+}
+
+void gfx_neon_blend_argb(uint32_t *dest, const uint32_t *src, uint count)
+{
+    uint i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t s = vld4q_u8((const uint8_t *)(src + i));
+        uint8x16_t a = s.val[3];
+
+        // whole step transparent or opaque
+        if (vmaxvq_u8(a) == 0)
+            continue;
+        if (vminvq_u8(a) == 255) {
+            vst4q_u8((uint8_t *)(dest + i), s);
+            continue;
+        }
+
+        uint8x16x4_t d = vld4q_u8((const uint8_t *)(dest + i));
+        uint8x16_t a1 = vaddq_u8(a, vdupq_n_u8(1));
+        uint8x16_t ainv = vsubq_u8(vdupq_n_u8(254), a);
+        uint8x16_t keep = vceqq_u8(a, vdupq_n_u8(0));
+        uint8x16_t opaque = vceqq_u8(a, vdupq_n_u8(255));
+        uint8x16x4_t r;
+
+        for (int c = 0; c < 3; c++) {
+            r.val[c] = vaddq_u8(mul_shr8(s.val[c], a1), mul_shr8(d.val[c], ainv));
+            r.val[c] = vbslq_u8(opaque, s.val[c], r.val[c]);
+            r.val[c] = vbslq_u8(keep, d.val[c], r.val[c]);
+        }
+        r.val[3] = vbslq_u8(opaque, a, a1);
+        r.val[3] = vbslq_u8(keep, d.val[3], r.val[3]);
+
+        vst4q_u8((uint8_t *)(dest + i), r);
+    }
+
+    for (; i < count; i++)
+        dest[i] = alpha32_add_ignore_destalpha(dest[i], src[i]);
+}
+
+void gfx_neon_blend_premul(uint32_t *dest, const uint32_t *src, uint count)
+{
+    uint i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint32x4_t any = vorrq_u32(vorrq_u32(vld1q_u32(src + i), vld1q_u32(src + i + 4)),
+                                   vorrq_u32(vld1q_u32(src + i + 8), vld1q_u32(src + i + 12)));
+
+        // nothing to add
+        if (vmaxvq_u32(any) == 0)
+            continue;
+
+        uint8x16x4_t s = vld4q_u8((const uint8_t *)(src + i));
+        if (vminvq_u8(s.val[3]) == 255) {
+            vst4q_u8((uint8_t *)(dest + i), s);
+            continue;
+        }
+
+        uint8x16x4_t d = vld4q_u8((const uint8_t *)(dest + i));
+        uint8x16_t ainv = vmvnq_u8(s.val[3]);
+
+        for (int c = 0; c < 4; c++)
+            d.val[c] = vaddq_u8(s.val[c], mul_div255(d.val[c], ainv));
+
+        vst4q_u8((uint8_t *)(dest + i), d);
+    }
+
+    for (; i < count; i++) {
+        uint32_t s = src[i];
+        uint32_t ainv = 255 - (s >> 24);
+        uint32_t res = 0;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t t = ((dest[i] >> shift) & 0xff) * ainv + 128;
+
+            res |= ((((s >> shift) & 0xff) + ((t + (t >> 8)) >> 8)) & 0xff) << shift;
+        }
+        dest[i] = res;
+    }
+}
+
+void gfx_neon_argb_to_rgb565(uint16_t *dest, const uint32_t *src, uint count)
+{
+    uint i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t s = vld4q_u8((const uint8_t *)(src + i));
+        uint16x8x2_t out;
+
+        // r:g:b 5:6:5 from the top bits of each channel
+        out.val[0] = vorrq_u16(vorrq_u16(
+                         vandq_u16(vshll_n_u8(vget_low_u8(s.val[2]), 8), vdupq_n_u16(0xf800)),
+                         vandq_u16(vshll_n_u8(vget_low_u8(s.val[1]), 3), vdupq_n_u16(0x07e0))),
+                         vshrq_n_u16(vmovl_u8(vget_low_u8(s.val[0])), 3));
+        out.val[1] = vorrq_u16(vorrq_u16(
+                         vandq_u16(vshll_n_u8(vget_high_u8(s.val[2]), 8), vdupq_n_u16(0xf800)),
+                         vandq_u16(vshll_n_u8(vget_high_u8(s.val[1]), 3), vdupq_n_u16(0x07e0))),
+                         vshrq_n_u16(vmovl_u8(vget_high_u8(s.val[0])), 3));
+        vst1q_u16(dest + i, out.val[0]);
+        vst1q_u16(dest + i + 8, out.val[1]);
+    }
+
+    for (; i < count; i++) {
+        uint32_t in = src[i];
+
+        dest[i] = ((in >> 3) & 0x1f) | (((in >> 10) & 0x3f) << 5) | (((in >> 19) & 0x1f) << 11);
+    }
+}
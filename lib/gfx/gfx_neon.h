@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+ * NEON row kernels behind the gfx_surface function pointers. They work
+ * on any alignment and produce the same pixels as the C versions in
+ * gfx.c.
+ */
+
+// store len bytes of a repeating 32 bit pattern, len is a whole number of pixels
+void gfx_neon_fill(void *dest, uint32_t pattern, size_t len);
+
+// memmove()
+void gfx_neon_move(void *dest, const void *src, size_t len);
+
+// from gfx.c
+uint32_t alpha32_add_ignore_destalpha(uint32_t dest, uint32_t src);
+
+// alpha32_add_ignore_destalpha() over a row
+void gfx_neon_blend_argb(uint32_t *dest, const uint32_t *src, uint count);
+
+// src + dest * (1 - src alpha) for premultiplied source pixels
+void gfx_neon_blend_premul(uint32_t *dest, const uint32_t *src, uint count);
+
+void gfx_neon_argb_to_rgb565(uint16_t *dest, const uint32_t *src, uint count);
@@ -5,4 +5,10 @@ MODULE := $(LOCAL_DIR)
 MODULE_SRCS += \
 	$(LOCAL_DIR)/gfx.c
 
+ifeq ($(ARCH),arm64)
+MODULE_SRCS += \
+	$(LOCAL_DIR)/gfx_neon.c
+MODULE_DEFINES += GFX_NEON=1
+endif
+
 include make/module.mk
@@ -55,8 +55,47 @@ static struct {
 
     uint32_t front_color;
     uint32_t back_color;
+
+    // on a display that pans the surface is taller than the screen and
+    // scrolling moves the shown window down by a line, top is its first row
+    void (*pan)(uint y);
+    uint screen_height;
+    uint top;
 } gfxconsole;
 
+static void gfxconsole_draw_char(char c)
+{
+    font_draw_char(gfxconsole.surface, c, gfxconsole.x * FONT_X,
+                   gfxconsole.top + gfxconsole.y * FONT_Y, gfxconsole.front_color);
+}
+
+static void gfxconsole_scroll(void)
+{
+    gfx_surface *surface = gfxconsole.surface;
+    uint text_height = gfxconsole.rows * FONT_Y;
+
+    if (!gfxconsole.pan) {
+        gfx_copyrect(surface, 0, FONT_Y, surface->width, text_height - FONT_Y, 0, 0);
+        gfx_fillrect(surface, 0, text_height - FONT_Y, surface->width, FONT_Y, gfxconsole.back_color);
+        gfx_flush(surface);
+        return;
+    }
+
+    if (gfxconsole.top + FONT_Y + gfxconsole.screen_height > surface->height) {
+        // out of rows below the window, copy it back to the start once
+        gfx_copyrect(surface, 0, gfxconsole.top + FONT_Y, surface->width, text_height - FONT_Y, 0, 0);
+        gfxconsole.top = 0;
+    } else {
+        gfxconsole.top += FONT_Y;
+    }
+
+    // whatever was below the old window becomes the new last line
+    gfx_fillrect(surface, 0, gfxconsole.top + text_height - FONT_Y, surface->width,
+                 FONT_Y + gfxconsole.extray, gfxconsole.back_color);
+    gfx_flush(surface);
+    gfxconsole.pan(gfxconsole.top);
+}
+
 static void gfxconsole_putc(char c)
 {
     static enum { NORMAL, ESCAPE } state = NORMAL;
@@ -71,7 +110,7 @@ static void gfxconsole_putc(char c)
                 p_num = 0;
                 state = ESCAPE;
             } else {
-                font_draw_char(gfxconsole.surface, c, gfxconsole.x * FONT_X, gfxconsole.y * FONT_Y, gfxconsole.front_color);
+                gfxconsole_draw_char(c);
                 gfxconsole.x++;
             }
             break;
@@ -87,7 +126,7 @@ static void gfxconsole_putc(char c)
             } else if (c == '[') {
                 // eat this character
             } else {
-                font_draw_char(gfxconsole.surface, c, gfxconsole.x * FONT_X, gfxconsole.y * FONT_Y, gfxconsole.front_color);
+                gfxconsole_draw_char(c);
                 gfxconsole.x++;
                 state = NORMAL;
             }
@@ -101,10 +140,8 @@ static void gfxconsole_putc(char c)
     }
     if (gfxconsole.y >= gfxconsole.rows) {
         // scroll up
-        gfx_copyrect(gfxconsole.surface, 0, FONT_Y, gfxconsole.surface->width, gfxconsole.surface->height - FONT_Y - gfxconsole.extray, 0, 0);
+        gfxconsole_scroll();
         gfxconsole.y--;
-        gfx_fillrect(gfxconsole.surface, 0, gfxconsole.surface->height - FONT_Y - gfxconsole.extray, gfxconsole.surface->width, FONT_Y, gfxconsole.back_color);
-        gfx_flush(gfxconsole.surface);
     }
 }
 
@@ -121,23 +158,20 @@ static print_callback_t cb = {
     .context = NULL
 };
 
-/**
- * @brief  Initialize graphics console on given drawing surface.
- *
- * The graphics console subsystem is initialized, and registered as
- * an output device for debug output.
- */
-void gfxconsole_start(gfx_surface *surface)
+static void gfxconsole_setup(gfx_surface *surface, uint screen_height, void (*pan)(uint y))
 {
     DEBUG_ASSERT(gfxconsole.surface == NULL);
 
     // set up the surface
     gfxconsole.surface = surface;
+    gfxconsole.pan = pan;
+    gfxconsole.screen_height = screen_height;
+    gfxconsole.top = 0;
 
     // calculate how many rows/columns we have
-    gfxconsole.rows = surface->height / FONT_Y;
+    gfxconsole.rows = screen_height / FONT_Y;
     gfxconsole.columns = surface->width / FONT_X;
-    gfxconsole.extray = surface->height - (gfxconsole.rows * FONT_Y);
+    gfxconsole.extray = screen_height - (gfxconsole.rows * FONT_Y);
 
     dprintf(SPEW, "gfxconsole: rows %d, columns %d, extray %d\n", gfxconsole.rows, gfxconsole.columns, gfxconsole.extray);
 
@@ -153,6 +187,17 @@ void gfxconsole_start(gfx_surface *surface)
     register_print_callback(&cb);
 }
 
+/**
+ * @brief  Initialize graphics console on given drawing surface.
+ *
+ * The graphics console subsystem is initialized, and registered as
+ * an output device for debug output.
+ */
+void gfxconsole_start(gfx_surface *surface)
+{
+    gfxconsole_setup(surface, surface->height, NULL);
+}
+
 /**
  * @brief  Initialize graphics console on default display
  */
@@ -168,8 +213,17 @@ void gfxconsole_start_on_display(void)
     if (display_get_framebuffer(&fb) < 0)
         return;
 
-    gfx_surface *s = gfx_create_surface_from_display(&fb);
-    gfxconsole_start(s);
+    if (fb.pan && fb.pan_rows >= fb.image.height + FONT_Y) {
+        uint screen_height = fb.image.height;
+
+        // draw on every row the display can pan over
+        fb.image.height = fb.pan_rows;
+        gfx_surface *s = gfx_create_surface_from_display(&fb);
+        gfxconsole_setup(s, screen_height, fb.pan);
+    } else {
+        gfx_surface *s = gfx_create_surface_from_display(&fb);
+        gfxconsole_start(s);
+    }
     started = true;
 }
 
@@ -888,7 +888,7 @@ static void gpt_sysparam_scan(GPT_MANAGER *mgr)
 	if (sts < 0)
 		LTRACEF("sysparam scan fail, error code:%d\n", sts);
 	else
-		LTRACEF("sysparam size:%d\n", sts);
+		LTRACEF("sysparam scanned, area size:0x%x\n", size_in_secs * SECTOR_SIZE);
 
 	gpt_close_dev(dev);
 }
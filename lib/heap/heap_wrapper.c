@@ -32,6 +32,7 @@
 #include <kernel/spinlock.h>
 #include <lib/console.h>
 #include <lib/page_alloc.h>
+#include <platform.h>
 
 #define LOCAL_TRACE 0
 
@@ -46,7 +47,37 @@ static bool heap_trace = false;
 struct list_node delayed_free_list = LIST_INITIAL_VALUE(delayed_free_list);
 spin_lock_t delayed_free_lock = SPIN_LOCK_INITIAL_VALUE;
 
-#if WITH_LIB_HEAP_MINIHEAP
+#if HEAP_USE_SIZECLASS
+/* size class implementation */
+#include <lib/miniheap.h>
+#include <lib/sizeclass.h>
+
+static inline void *HEAP_MALLOC(size_t s) { return sizeclass_alloc(s, 0); }
+static inline void *HEAP_REALLOC(void *ptr, size_t s) { return sizeclass_realloc(ptr, s); }
+static inline void *HEAP_MEMALIGN(size_t boundary, size_t s) { return sizeclass_alloc(s, boundary); }
+#define HEAP_FREE sizeclass_free
+static inline void *HEAP_CALLOC(size_t n, size_t s)
+{
+    size_t realsize = n * s;
+
+    void *ptr = sizeclass_alloc(realsize, 0);
+    if (likely(ptr))
+        memset(ptr, 0, realsize);
+    return ptr;
+}
+static inline void HEAP_INIT(void)
+{
+    /* miniheap serves the large blocks, start it off like below */
+    size_t len;
+    void *ptr = page_first_alloc(&len);
+    miniheap_init(ptr, len);
+    sizeclass_init();
+}
+#define HEAP_DUMP sizeclass_dump
+#define HEAP_TRIM sizeclass_trim
+
+/* end size class implementation */
+#elif HEAP_USE_MINIHEAP
 /* miniheap implementation */
 #include <lib/miniheap.h>
 
@@ -74,7 +105,7 @@ static inline void HEAP_INIT(void)
 #define HEAP_TRIM miniheap_trim
 
 /* end miniheap implementation */
-#elif WITH_LIB_HEAP_CMPCTMALLOC
+#elif HEAP_USE_CMPCTMALLOC
 /* cmpctmalloc implementation */
 #include <lib/cmpctmalloc.h>
 
@@ -96,7 +127,7 @@ static inline void *HEAP_CALLOC(size_t n, size_t s)
 }
 
 /* end cmpctmalloc implementation */
-#elif WITH_LIB_HEAP_DLMALLOC
+#elif HEAP_USE_DLMALLOC
 /* dlmalloc implementation */
 #include <lib/dlmalloc.h>
 
@@ -135,6 +166,234 @@ static inline void HEAP_TRIM(void) { dlmalloc_trim(0); }
 #error need to select valid heap implementation or provide wrapper
 #endif
 
+#if HEAP_BENCH
+/* allocations from heap_init() on are recorded for "heap bench" */
+#ifndef HEAP_BENCH_TRACE_LEN
+#define HEAP_BENCH_TRACE_LEN 4096
+#endif
+
+enum heap_op {
+    HEAP_OP_ALLOC,
+    HEAP_OP_REALLOC,
+    HEAP_OP_FREE,
+};
+
+struct heap_trace_op {
+    void *ptr;          /* block returned or freed */
+    void *old;          /* block passed to realloc */
+    uint32_t size;
+    uint32_t align;
+    uint32_t op;
+};
+
+static struct heap_trace_op heap_bench_trace[HEAP_BENCH_TRACE_LEN];
+static unsigned int heap_bench_count;
+static bool heap_bench_recording;
+static spin_lock_t heap_bench_lock = SPIN_LOCK_INITIAL_VALUE;
+
+static void heap_bench_record(enum heap_op op, void *ptr, void *old, size_t size, size_t align)
+{
+    if (likely(!heap_bench_recording))
+        return;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&heap_bench_lock, state);
+    if (heap_bench_count < HEAP_BENCH_TRACE_LEN) {
+        struct heap_trace_op *t = &heap_bench_trace[heap_bench_count++];
+
+        t->ptr = ptr;
+        t->old = old;
+        t->size = size;
+        t->align = align;
+        t->op = op;
+    } else {
+        /* keep the trace self-consistent, stop at the first drop */
+        heap_bench_recording = false;
+    }
+    spin_unlock_irqrestore(&heap_bench_lock, state);
+}
+#else
+#define heap_bench_record(op, ptr, old, size, align) do { } while (0)
+#endif
+
+#if HEAP_PROFILE
+#include <lk/init.h>
+
+/* live blocks are tagged in an open addressed table keyed by address */
+#ifndef HEAP_PROFILE_ENTRIES
+#define HEAP_PROFILE_ENTRIES 8192   /* power of 2 */
+#endif
+#define HEAP_PROFILE_STAGES 8
+#define HEAP_PROFILE_SITES 256
+#define HEAP_PROFILE_TOP 20
+
+struct heap_tag {
+    void *ptr;
+    void *caller;
+    uint32_t size;
+    lk_time_t time;
+};
+
+struct heap_stage {
+    const char *name;
+    size_t start;       /* live bytes when the stage began */
+    size_t peak;
+};
+
+static struct heap_profile {
+    struct heap_tag tags[HEAP_PROFILE_ENTRIES];
+    unsigned int count;
+    unsigned int untracked;
+    size_t live;
+    size_t peak;
+    struct heap_stage stages[HEAP_PROFILE_STAGES];
+    unsigned int nstages;
+} heap_prof;
+
+static spin_lock_t heap_prof_lock = SPIN_LOCK_INITIAL_VALUE;
+
+static inline unsigned int heap_tag_hash(const void *ptr)
+{
+    return (((uintptr_t)ptr >> 4) * 2654435761u) & (HEAP_PROFILE_ENTRIES - 1);
+}
+
+/* slot holding ptr, or the empty slot where it would go */
+static unsigned int heap_tag_find(const void *ptr)
+{
+    unsigned int i = heap_tag_hash(ptr);
+
+    while (heap_prof.tags[i].ptr && heap_prof.tags[i].ptr != ptr)
+        i = (i + 1) & (HEAP_PROFILE_ENTRIES - 1);
+
+    return i;
+}
+
+/* backward shift deletion, keeps the probe sequences intact */
+static void heap_tag_delete(unsigned int i)
+{
+    unsigned int j = i, k;
+
+    for (;;) {
+        j = (j + 1) & (HEAP_PROFILE_ENTRIES - 1);
+        if (!heap_prof.tags[j].ptr)
+            break;
+        k = heap_tag_hash(heap_prof.tags[j].ptr);
+        /* the entry can move to i unless its home lies cyclically in (i, j] */
+        if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+            heap_prof.tags[i] = heap_prof.tags[j];
+            i = j;
+        }
+    }
+    heap_prof.tags[i].ptr = NULL;
+    heap_prof.count--;
+}
+
+static void heap_profile_tag(void *ptr, size_t size, void *caller, lk_time_t time)
+{
+    struct heap_tag *t;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&heap_prof_lock, state);
+
+    t = &heap_prof.tags[heap_tag_find(ptr)];
+    if (t->ptr) {
+        /* freed behind our back by a racing realloc, reuse the tag */
+        heap_prof.live -= t->size;
+    } else if (heap_prof.count >= HEAP_PROFILE_ENTRIES * 3 / 4) {
+        heap_prof.untracked++;
+        goto out;
+    } else {
+        heap_prof.count++;
+    }
+
+    t->ptr = ptr;
+    t->caller = caller;
+    t->size = size;
+    t->time = time;
+
+    heap_prof.live += size;
+    heap_prof.peak = MAX(heap_prof.peak, heap_prof.live);
+    if (heap_prof.nstages) {
+        struct heap_stage *s = &heap_prof.stages[heap_prof.nstages - 1];
+
+        s->peak = MAX(s->peak, heap_prof.live);
+    }
+
+out:
+    spin_unlock_irqrestore(&heap_prof_lock, state);
+}
+
+static void heap_profile_alloc(void *ptr, size_t size, void *caller)
+{
+    heap_profile_tag(ptr, size, caller, current_time());
+}
+
+/* drop the tag of ptr, a copy goes to old; false if it had none */
+static bool heap_profile_untag(void *ptr, struct heap_tag *old)
+{
+    unsigned int i;
+    bool tagged = false;
+
+    if (!ptr)
+        return false;
+
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&heap_prof_lock, state);
+
+    i = heap_tag_find(ptr);
+    if (heap_prof.tags[i].ptr) {
+        *old = heap_prof.tags[i];
+        heap_prof.live -= heap_prof.tags[i].size;
+        heap_tag_delete(i);
+        tagged = true;
+    }
+
+    spin_unlock_irqrestore(&heap_prof_lock, state);
+
+    return tagged;
+}
+
+static void heap_profile_free(void *ptr)
+{
+    struct heap_tag old;
+
+    heap_profile_untag(ptr, &old);
+}
+
+void heap_profile_stage(const char *name)
+{
+    spin_lock_saved_state_t state;
+    spin_lock_irqsave(&heap_prof_lock, state);
+
+    if (heap_prof.nstages < HEAP_PROFILE_STAGES) {
+        struct heap_stage *s = &heap_prof.stages[heap_prof.nstages++];
+
+        s->name = name;
+        s->start = heap_prof.live;
+        s->peak = heap_prof.live;
+    }
+
+    spin_unlock_irqrestore(&heap_prof_lock, state);
+}
+
+static void heap_profile_init_stage(uint level)
+{
+    if (level == LK_INIT_LEVEL_PLATFORM - 1)
+        heap_profile_stage("platform");
+    else if (level == LK_INIT_LEVEL_TARGET - 1)
+        heap_profile_stage("target");
+    else
+        heap_profile_stage("apps");
+}
+
+LK_INIT_HOOK(heap_profile_platform, heap_profile_init_stage, LK_INIT_LEVEL_PLATFORM - 1);
+LK_INIT_HOOK(heap_profile_target, heap_profile_init_stage, LK_INIT_LEVEL_TARGET - 1);
+LK_INIT_HOOK(heap_profile_apps, heap_profile_init_stage, LK_INIT_LEVEL_APPS - 1);
+#else
+#define heap_profile_alloc(ptr, size, caller) do { } while (0)
+#define heap_profile_free(ptr) do { } while (0)
+#endif
+
 static void heap_free_delayed_list(void)
 {
     struct list_node list;
@@ -152,6 +411,7 @@ static void heap_free_delayed_list(void)
 
     while ((node = list_remove_head(&list))) {
         LTRACEF("freeing node %p\n", node);
+        heap_profile_free(node);
         HEAP_FREE(node);
     }
 }
@@ -159,6 +419,11 @@ static void heap_free_delayed_list(void)
 void heap_init(void)
 {
     HEAP_INIT();
+
+    heap_profile_stage("kernel");
+#if HEAP_BENCH
+    heap_bench_recording = true;
+#endif
 }
 
 void heap_trim(void)
@@ -181,6 +446,10 @@ void *malloc(size_t size)
     }
 
     void *ptr = HEAP_MALLOC(size);
+    if (ptr) {
+        heap_bench_record(HEAP_OP_ALLOC, ptr, NULL, size, 0);
+        heap_profile_alloc(ptr, size, __GET_CALLER());
+    }
     if (heap_trace)
         printf("caller %p malloc %zu -> %p\n", __GET_CALLER(), size, ptr);
     return ptr;
@@ -196,6 +465,10 @@ void *memalign(size_t boundary, size_t size)
     }
 
     void *ptr = HEAP_MEMALIGN(boundary, size);
+    if (ptr) {
+        heap_bench_record(HEAP_OP_ALLOC, ptr, NULL, size, boundary);
+        heap_profile_alloc(ptr, size, __GET_CALLER());
+    }
     if (heap_trace)
         printf("caller %p memalign %zu, %zu -> %p\n", __GET_CALLER(), boundary, size, ptr);
     return ptr;
@@ -211,6 +484,10 @@ void *calloc(size_t count, size_t size)
     }
 
     void *ptr = HEAP_CALLOC(count, size);
+    if (ptr) {
+        heap_bench_record(HEAP_OP_ALLOC, ptr, NULL, count * size, 0);
+        heap_profile_alloc(ptr, count * size, __GET_CALLER());
+    }
     if (heap_trace)
         printf("caller %p calloc %zu, %zu -> %p\n", __GET_CALLER(), count, size, ptr);
     return ptr;
@@ -225,7 +502,24 @@ void *realloc(void *ptr, size_t size)
         heap_free_delayed_list();
     }
 
+#if HEAP_PROFILE
+    /*
+     * Untag first: once HEAP_REALLOC releases ptr another thread can
+     * be handed the same address and tag it.
+     */
+    struct heap_tag old;
+    bool tagged = heap_profile_untag(ptr, &old);
+#endif
+
     void *ptr2 = HEAP_REALLOC(ptr, size);
+    if (ptr2 || size == 0)
+        heap_bench_record(HEAP_OP_REALLOC, ptr2, ptr, size, 0);
+    if (ptr2)
+        heap_profile_alloc(ptr2, size, __GET_CALLER());
+#if HEAP_PROFILE
+    else if (tagged && size != 0)
+        heap_profile_tag(old.ptr, old.size, old.caller, old.time); /* ptr is still live */
+#endif
     if (heap_trace)
         printf("caller %p realloc %p, %zu -> %p\n", __GET_CALLER(), ptr, size, ptr2);
     return ptr2;
@@ -236,6 +530,9 @@ void free(void *ptr)
     LTRACEF("ptr %p\n", ptr);
     if (heap_trace)
         printf("caller %p free %p\n", __GET_CALLER(), ptr);
+    if (ptr)
+        heap_bench_record(HEAP_OP_FREE, ptr, NULL, 0, 0);
+    heap_profile_free(ptr);
 
     HEAP_FREE(ptr);
 }
@@ -271,7 +568,7 @@ static void heap_dump(void)
 
 static void heap_test(void)
 {
-#if WITH_LIB_HEAP_CMPCTMALLOC
+#if HEAP_USE_CMPCTMALLOC
     cmpct_test();
 #else
     void *ptr[16];
@@ -325,6 +622,351 @@ static void heap_test(void)
 #endif
 }
 
+#if HEAP_BENCH
+#include <lib/miniheap.h>
+#include <lib/cmpctmalloc.h>
+#include <lib/sizeclass.h>
+#include <lib/dlmalloc.h>
+
+#define HEAP_BENCH_ROUNDS 8
+
+struct heap_bench_step {
+    uint32_t op;
+    uint32_t slot;
+    uint32_t size;
+    uint32_t align;
+};
+
+struct heap_bench_backend {
+    const char *name;
+    void (*init)(void);
+    void *(*alloc)(size_t size, unsigned int align);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*free)(void *ptr);
+};
+
+/* Backends other than the system heap are brought up on first use */
+static void bench_miniheap_init(void)
+{
+#if !HEAP_USE_MINIHEAP && !HEAP_USE_SIZECLASS
+    static bool done;
+
+    if (!done) {
+        miniheap_init(NULL, 0);
+        done = true;
+    }
+#endif
+}
+
+static void bench_cmpct_init(void)
+{
+#if !HEAP_USE_CMPCTMALLOC
+    static bool done;
+
+    if (!done) {
+        cmpct_init();
+        done = true;
+    }
+#endif
+}
+
+static void bench_sizeclass_init(void)
+{
+#if !HEAP_USE_SIZECLASS
+    static bool done;
+
+    if (!done) {
+        bench_miniheap_init();
+        sizeclass_init();
+        done = true;
+    }
+#endif
+}
+
+static void *bench_cmpct_alloc(size_t size, unsigned int align)
+{
+    return align ? cmpct_memalign(size, align) : cmpct_alloc(size);
+}
+
+/* dlmalloc gets its memory from page_alloc as it goes, no setup */
+static void bench_dlmalloc_init(void) {}
+
+static void *bench_dlmalloc_alloc(size_t size, unsigned int align)
+{
+    return align ? dlmemalign(align, size) : dlmalloc(size);
+}
+
+static const struct heap_bench_backend heap_bench_backends[] = {
+    { "miniheap", bench_miniheap_init, miniheap_alloc, miniheap_realloc, miniheap_free },
+    { "cmpctmalloc", bench_cmpct_init, bench_cmpct_alloc, cmpct_realloc, cmpct_free },
+    { "dlmalloc", bench_dlmalloc_init, bench_dlmalloc_alloc, dlrealloc, dlfree },
+    { "sizeclass", bench_sizeclass_init, sizeclass_alloc, sizeclass_realloc, sizeclass_free },
+};
+
+static int bench_find_slot(void **live, unsigned int nslots, void *ptr)
+{
+    for (unsigned int i = nslots; i > 0; i--) {
+        if (live[i - 1] == ptr)
+            return i - 1;
+    }
+    return -1;
+}
+
+/*
+ * Turn the recorded pointers into slot numbers so the trace can be
+ * replayed on any heap. Frees of blocks that were not allocated while
+ * recording are dropped.
+ */
+static unsigned int heap_bench_compile(struct heap_bench_step *steps, void **live, unsigned int *nslots)
+{
+    unsigned int n = 0;
+    int slot;
+
+    *nslots = 0;
+    for (unsigned int i = 0; i < heap_bench_count; i++) {
+        const struct heap_trace_op *t = &heap_bench_trace[i];
+        struct heap_bench_step *s = &steps[n];
+
+        s->size = t->size;
+        s->align = t->align;
+
+        slot = t->old ? bench_find_slot(live, *nslots, t->old) : -1;
+        if (t->op == HEAP_OP_FREE || (t->op == HEAP_OP_REALLOC && !t->ptr)) {
+            void *ptr = t->op == HEAP_OP_FREE ? t->ptr : t->old;
+
+            slot = ptr ? bench_find_slot(live, *nslots, ptr) : -1;
+            if (slot < 0)
+                continue;
+            s->op = HEAP_OP_FREE;
+            live[slot] = NULL;
+        } else if (t->op == HEAP_OP_REALLOC && slot >= 0) {
+            s->op = HEAP_OP_REALLOC;
+            live[slot] = t->ptr;
+        } else {
+            /* a realloc of an unknown block is an allocation as far as we know */
+            s->op = HEAP_OP_ALLOC;
+            slot = (*nslots)++;
+            live[slot] = t->ptr;
+        }
+        s->slot = slot;
+        n++;
+    }
+
+    return n;
+}
+
+static lk_bigtime_t heap_bench_run(const struct heap_bench_backend *b,
+                                   const struct heap_bench_step *steps, unsigned int nsteps,
+                                   void **slots, unsigned int nslots, unsigned int *failed)
+{
+    lk_bigtime_t start, elapsed;
+    void *ptr;
+
+    memset(slots, 0, nslots * sizeof(void *));
+
+    start = current_time_hires();
+    for (unsigned int i = 0; i < nsteps; i++) {
+        const struct heap_bench_step *s = &steps[i];
+
+        switch (s->op) {
+            case HEAP_OP_ALLOC:
+                slots[s->slot] = b->alloc(s->size, s->align);
+                if (!slots[s->slot])
+                    (*failed)++;
+                break;
+            case HEAP_OP_REALLOC:
+                if (!slots[s->slot])
+                    break;
+                ptr = b->realloc(slots[s->slot], s->size);
+                if (ptr)
+                    slots[s->slot] = ptr;
+                else
+                    (*failed)++;
+                break;
+            case HEAP_OP_FREE:
+                if (slots[s->slot])
+                    b->free(slots[s->slot]);
+                slots[s->slot] = NULL;
+                break;
+        }
+    }
+    elapsed = current_time_hires() - start;
+
+    /* what was still live at the end of the trace, not timed */
+    for (unsigned int i = 0; i < nslots; i++) {
+        if (slots[i])
+            b->free(slots[i]);
+    }
+
+    return elapsed;
+}
+
+static void heap_bench(void)
+{
+    struct heap_bench_step *steps;
+    void **slots;
+    unsigned int nsteps, nslots;
+
+    /* the bench itself allocates, freeze the trace */
+    heap_bench_recording = false;
+
+    steps = malloc(heap_bench_count * sizeof(*steps));
+    slots = calloc(heap_bench_count, sizeof(void *));
+    if (!steps || !slots) {
+        printf("not enough memory for the bench\n");
+        goto out;
+    }
+
+    nsteps = heap_bench_compile(steps, slots, &nslots);
+    printf("replaying %u recorded heap ops (%u blocks) x %d on each heap\n",
+           nsteps, nslots, HEAP_BENCH_ROUNDS);
+    if (!nsteps)
+        goto out;
+
+    for (unsigned int i = 0; i < countof(heap_bench_backends); i++) {
+        const struct heap_bench_backend *b = &heap_bench_backends[i];
+        lk_bigtime_t best = ~0ULL, t;
+        unsigned int failed = 0;
+
+        b->init();
+        for (int round = 0; round < HEAP_BENCH_ROUNDS; round++) {
+            t = heap_bench_run(b, steps, nsteps, slots, nslots, &failed);
+            best = MIN(best, t);
+        }
+        printf("\t%-12s best %6llu us, %5llu ns/op, %u failed\n", b->name,
+               best, best * 1000 / nsteps, failed);
+    }
+
+out:
+    free(slots);
+    free(steps);
+}
+#endif
+
+#if HEAP_PROFILE
+struct heap_site {
+    void *caller;
+    unsigned int blocks;
+    size_t bytes;
+    lk_time_t first;
+};
+
+/* 0 when all free memory is one block, towards 100 as it gets scattered */
+static void heap_profile_frag(const char *name, size_t total, size_t largest)
+{
+    printf("\t%-10s free %8zu, largest free block %8zu, fragmentation %3zu%%\n",
+           name, total, largest, total ? 100 - largest * 100 / total : 0);
+}
+
+/* tags copied per lock hold while dumping */
+#define HEAP_PROFILE_BATCH 64
+STATIC_ASSERT(HEAP_PROFILE_ENTRIES % HEAP_PROFILE_BATCH == 0);
+
+static void heap_profile_dump(void)
+{
+    static struct heap_site sites[HEAP_PROFILE_SITES];
+    struct heap_tag batch[HEAP_PROFILE_BATCH];
+    struct heap_stage stages[HEAP_PROFILE_STAGES];
+    unsigned int nsites = 0, other = 0;
+    unsigned int count, untracked, nstages;
+    size_t live, peak;
+    size_t other_bytes = 0;
+    spin_lock_saved_state_t state;
+
+    spin_lock_irqsave(&heap_prof_lock, state);
+    count = heap_prof.count;
+    untracked = heap_prof.untracked;
+    live = heap_prof.live;
+    peak = heap_prof.peak;
+    nstages = heap_prof.nstages;
+    memcpy(stages, heap_prof.stages, sizeof(stages));
+    spin_unlock_irqrestore(&heap_prof_lock, state);
+
+    /*
+     * The table is copied a batch at a time so that the lock is only held
+     * for short copies. Blocks freed or moved in between may be missed or
+     * seen twice, the totals above are exact.
+     */
+    for (unsigned int base = 0; base < HEAP_PROFILE_ENTRIES; base += HEAP_PROFILE_BATCH) {
+        spin_lock_irqsave(&heap_prof_lock, state);
+        memcpy(batch, &heap_prof.tags[base], sizeof(batch));
+        spin_unlock_irqrestore(&heap_prof_lock, state);
+
+        for (unsigned int i = 0; i < HEAP_PROFILE_BATCH; i++) {
+            const struct heap_tag *t = &batch[i];
+            unsigned int s;
+
+            if (!t->ptr)
+                continue;
+            for (s = 0; s < nsites; s++) {
+                if (sites[s].caller == t->caller)
+                    break;
+            }
+            if (s == nsites) {
+                if (nsites == HEAP_PROFILE_SITES) {
+                    other++;
+                    other_bytes += t->size;
+                    continue;
+                }
+                sites[nsites].caller = t->caller;
+                sites[nsites].blocks = 0;
+                sites[nsites].bytes = 0;
+                sites[nsites].first = t->time;
+                nsites++;
+            }
+            sites[s].blocks++;
+            sites[s].bytes += t->size;
+            sites[s].first = MIN(sites[s].first, t->time);
+        }
+    }
+
+    printf("%u live blocks, %zu bytes live, peak %zu bytes, %u blocks not tracked\n",
+           count, live, peak, untracked);
+
+    printf("peak live bytes by boot stage:\n");
+    for (unsigned int i = 0; i < nstages; i++) {
+        const struct heap_stage *s = &stages[i];
+
+        printf("\t%-10s start %8zu, peak %8zu\n", s->name, s->start, s->peak);
+    }
+
+    printf("top call sites by live bytes:\n");
+    for (unsigned int n = 0; n < HEAP_PROFILE_TOP && n < nsites; n++) {
+        unsigned int max = n;
+
+        for (unsigned int s = n + 1; s < nsites; s++) {
+            if (sites[s].bytes > sites[max].bytes)
+                max = s;
+        }
+        struct heap_site tmp = sites[n];
+        sites[n] = sites[max];
+        sites[max] = tmp;
+
+        printf("\tcaller %p: %8zu bytes in %5u blocks, oldest at %u ms\n",
+               sites[n].caller, sites[n].bytes, sites[n].blocks, sites[n].first);
+    }
+    if (other)
+        printf("\tother callers: %8zu bytes in %5u blocks\n", other_bytes, other);
+
+    printf("fragmentation:\n");
+#if HEAP_USE_SIZECLASS || HEAP_USE_MINIHEAP
+    struct miniheap_stats mstats;
+
+    miniheap_get_stats(&mstats);
+    heap_profile_frag("miniheap", mstats.heap_free, mstats.heap_max_chunk);
+#endif
+#if HEAP_USE_SIZECLASS
+    struct sizeclass_stats sstats;
+
+    sizeclass_get_stats(&sstats);
+    heap_profile_frag("dma arena", sstats.dma_arena_free, sstats.dma_max_run);
+#endif
+#if !HEAP_USE_SIZECLASS && !HEAP_USE_MINIHEAP
+    printf("\tnot reported by this heap\n");
+#endif
+}
+#endif
+
 
 #if LK_DEBUGLEVEL > 1
 #if WITH_LIB_CONSOLE
@@ -346,6 +988,12 @@ usage:
         printf("usage:\n");
         printf("\t%s info\n", argv[0].str);
         printf("\t%s trace\n", argv[0].str);
+#if HEAP_BENCH
+        printf("\t%s bench\n", argv[0].str);
+#endif
+#if HEAP_PROFILE
+        printf("\t%s profile\n", argv[0].str);
+#endif
         printf("\t%s trim\n", argv[0].str);
         printf("\t%s alloc <size> [alignment]\n", argv[0].str);
         printf("\t%s realloc <ptr> <size>\n", argv[0].str);
@@ -360,6 +1008,14 @@ usage:
     } else if (strcmp(argv[1].str, "trace") == 0) {
         heap_trace = !heap_trace;
         printf("heap trace is now %s\n", heap_trace ? "on" : "off");
+#if HEAP_BENCH
+    } else if (strcmp(argv[1].str, "bench") == 0) {
+        heap_bench();
+#endif
+#if HEAP_PROFILE
+    } else if (strcmp(argv[1].str, "profile") == 0) {
+        heap_profile_dump();
+#endif
     } else if (strcmp(argv[1].str, "trim") == 0) {
         heap_trim();
     } else if (strcmp(argv[1].str, "alloc") == 0) {
@@ -43,4 +43,11 @@ void heap_delayed_free(void *);
 /* tell the heap to return any free pages it can find */
 void heap_trim(void);
 
+/* start a new stage of the heap profile, peak usage is kept per stage */
+#if HEAP_PROFILE
+void heap_profile_stage(const char *name);
+#else
+static inline void heap_profile_stage(const char *name) {}
+#endif
+
 __END_CDECLS;
@@ -17,14 +17,37 @@ endif
 ifndef LK_HEAP_IMPLEMENTATION
 LK_HEAP_IMPLEMENTATION=miniheap
 endif
+ifeq ($(LK_HEAP_IMPLEMENTATION),sizeclass)
+MODULE_DEPS := lib/heap/sizeclass
+MODULE_DEFINES += HEAP_USE_SIZECLASS=1
+endif
 ifeq ($(LK_HEAP_IMPLEMENTATION),miniheap)
 MODULE_DEPS := lib/heap/miniheap
+MODULE_DEFINES += HEAP_USE_MINIHEAP=1
 endif
 ifeq ($(LK_HEAP_IMPLEMENTATION),dlmalloc)
 MODULE_DEPS := lib/heap/dlmalloc
+MODULE_DEFINES += HEAP_USE_DLMALLOC=1
 endif
 ifeq ($(LK_HEAP_IMPLEMENTATION),cmpctmalloc)
 MODULE_DEPS := lib/heap/cmpctmalloc
+MODULE_DEFINES += HEAP_USE_CMPCTMALLOC=1
+endif
+
+# "heap bench" records the boot allocations and replays them against
+# every heap implementation, so all of them get linked in
+ifeq ($(HEAP_BENCH),1)
+MODULE_DEPS += \
+	lib/heap/sizeclass \
+	lib/heap/miniheap \
+	lib/heap/cmpctmalloc \
+	lib/heap/dlmalloc
+MODULE_DEFINES += HEAP_BENCH=1
+endif
+
+# track live blocks by call site for "heap profile"
+ifeq ($(HEAP_PROFILE),1)
+GLOBAL_DEFINES += HEAP_PROFILE=1
 endif
 
 GLOBAL_DEFINES += LK_HEAP_IMPLEMENTATION=$(LK_HEAP_IMPLEMENTATION)
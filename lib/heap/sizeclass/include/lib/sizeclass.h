@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <compiler.h>
+#include <sys/types.h>
+
+__BEGIN_CDECLS;
+
+/*
+ * Segregated size class heap
+ *
+ * Blocks up to SIZECLASS_MAX_SMALL bytes come from slabs of a single
+ * size class, each class keeps a list of slabs with free objects so
+ * alloc and free are O(1). Page aligned requests are served from a
+ * separate page granular DMA arena, so a buffer handed to a device
+ * never shares a cache line with anything else. Everything else, and
+ * whatever does not fit in the arenas, goes to miniheap.
+ *
+ * Both arenas are reserved at init for the life of the heap. Targets
+ * with the RAM to spare raise them through GLOBAL_DEFINES.
+ */
+
+#ifndef SIZECLASS_SLAB_ARENA_SIZE
+#define SIZECLASS_SLAB_ARENA_SIZE (256 * 1024)
+#endif
+
+#ifndef SIZECLASS_DMA_ARENA_SIZE
+#define SIZECLASS_DMA_ARENA_SIZE (1024 * 1024)
+#endif
+
+#define SIZECLASS_MAX_SMALL 1024
+
+struct sizeclass_stats {
+    size_t slab_arena_size;
+    size_t slab_arena_used;     /* bytes in slabs that are handed out */
+    size_t small_inuse;         /* bytes of allocated small objects */
+    size_t dma_arena_size;
+    size_t dma_arena_free;
+    size_t dma_max_run;         /* largest free contiguous run in bytes */
+};
+
+void sizeclass_get_stats(struct sizeclass_stats *ptr);
+
+void *sizeclass_alloc(size_t, unsigned int alignment);
+void *sizeclass_realloc(void *, size_t);
+void sizeclass_free(void *);
+
+/* miniheap must have been initialized already */
+void sizeclass_init(void);
+void sizeclass_dump(void);
+void sizeclass_trim(void);
+
+__END_CDECLS;
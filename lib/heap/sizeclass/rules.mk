@@ -0,0 +1,13 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+GLOBAL_INCLUDES += $(LOCAL_DIR)/include
+
+MODULE := $(LOCAL_DIR)
+
+# large and odd-aligned blocks go to miniheap
+MODULE_DEPS += lib/heap/miniheap
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/sizeclass.c
+
+include make/module.mk
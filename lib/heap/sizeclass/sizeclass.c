@@ -0,0 +1,506 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  Segregated size class heap with a DMA arena
+ *
+ * The slab arena is one contiguous block of SC_SLAB_SIZE aligned slabs.
+ * A slab holds objects of a single class and starts with its header, so
+ * free() finds the class of a block by masking the address. Slabs that
+ * become empty go back to the arena and can be reused by any class.
+ *
+ * The DMA arena is a page bitmap with first fit. Every block is a whole
+ * number of pages, which keeps the cache maintenance done by drivers
+ * from touching neighbouring allocations.
+ */
+#include <debug.h>
+#include <trace.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <list.h>
+#include <kernel/mutex.h>
+#include <lib/page_alloc.h>
+#include <lib/miniheap.h>
+#include <lib/sizeclass.h>
+
+#define LOCAL_TRACE 0
+
+#define SC_SLAB_SHIFT 13
+#define SC_SLAB_SIZE (1UL << SC_SLAB_SHIFT)
+#define SC_SLAB_MAGIC (0x73636c62)  //'sclb'
+#define SC_GRANULE 16
+
+struct sc_object {
+    struct sc_object *next;
+};
+
+struct sc_slab {
+    uint32_t magic;
+    uint16_t cls;
+    uint16_t inuse;
+    uint16_t carved;            /* objects ever handed out of this slab */
+    uint16_t total;
+    struct sc_object *free;
+    struct list_node node;      /* class partial list or arena pool */
+};
+
+/* objects start on a cache line so that small DMA-ish buffers behave */
+#define SC_SLAB_HDR ROUNDUP(sizeof(struct sc_slab), 64)
+
+static const uint16_t sc_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024,
+};
+
+#define SC_NUM_CLASSES countof(sc_sizes)
+
+struct sc_class {
+    struct list_node partial;   /* slabs with at least one free object */
+    uint32_t slabs;
+    uint32_t inuse;
+};
+
+static struct sizeclass_heap {
+    mutex_t lock;
+
+    /* size to class lookup, one entry per granule */
+    uint8_t class_of[SIZECLASS_MAX_SMALL / SC_GRANULE + 1];
+    struct sc_class classes[SC_NUM_CLASSES];
+
+    /* slab arena */
+    uint8_t *slab_base;
+    size_t slab_len;
+    size_t slab_next;           /* offset of the first never used slab */
+    struct list_node slab_pool; /* empty slabs given back */
+    size_t slab_pool_count;
+
+    /* dma arena */
+    uint8_t *dma_base;
+    size_t dma_pages;
+    size_t dma_free;
+    uint32_t *dma_map;          /* one bit per page, set when in use */
+    uint32_t *dma_run;          /* length of the block starting at a page */
+} theheap;
+
+static inline bool in_slab_arena(const void *ptr)
+{
+    return (const uint8_t *)ptr >= theheap.slab_base &&
+           (const uint8_t *)ptr < theheap.slab_base + theheap.slab_len;
+}
+
+static inline bool in_dma_arena(const void *ptr)
+{
+    return (const uint8_t *)ptr >= theheap.dma_base &&
+           (const uint8_t *)ptr < theheap.dma_base + theheap.dma_pages * PAGE_SIZE;
+}
+
+static inline struct sc_slab *slab_of(const void *ptr)
+{
+    return (struct sc_slab *)((addr_t)ptr & ~(SC_SLAB_SIZE - 1));
+}
+
+/* slab arena, called with the lock held */
+
+static struct sc_slab *slab_get(unsigned int cls)
+{
+    struct sc_slab *slab;
+
+    slab = list_remove_head_type(&theheap.slab_pool, struct sc_slab, node);
+    if (slab) {
+        theheap.slab_pool_count--;
+    } else {
+        if (theheap.slab_next + SC_SLAB_SIZE > theheap.slab_len)
+            return NULL;
+        slab = (struct sc_slab *)(theheap.slab_base + theheap.slab_next);
+        theheap.slab_next += SC_SLAB_SIZE;
+    }
+
+    slab->magic = SC_SLAB_MAGIC;
+    slab->cls = cls;
+    slab->inuse = 0;
+    slab->carved = 0;
+    slab->total = (SC_SLAB_SIZE - SC_SLAB_HDR) / sc_sizes[cls];
+    slab->free = NULL;
+    list_add_head(&theheap.classes[cls].partial, &slab->node);
+    theheap.classes[cls].slabs++;
+
+    return slab;
+}
+
+static void slab_put(struct sc_slab *slab)
+{
+    list_delete(&slab->node);
+    theheap.classes[slab->cls].slabs--;
+    slab->magic = 0;
+    list_add_head(&theheap.slab_pool, &slab->node);
+    theheap.slab_pool_count++;
+}
+
+static void *small_alloc(size_t size)
+{
+    unsigned int cls = theheap.class_of[(size + SC_GRANULE - 1) / SC_GRANULE];
+    struct sc_class *c = &theheap.classes[cls];
+    struct sc_slab *slab;
+    struct sc_object *obj;
+
+    slab = list_peek_head_type(&c->partial, struct sc_slab, node);
+    if (!slab) {
+        slab = slab_get(cls);
+        if (!slab)
+            return NULL;
+    }
+
+    if (slab->free) {
+        obj = slab->free;
+        slab->free = obj->next;
+    } else {
+        /* carve lazily, a fresh slab costs nothing up front */
+        obj = (struct sc_object *)((uint8_t *)slab + SC_SLAB_HDR + slab->carved * sc_sizes[cls]);
+        slab->carved++;
+    }
+
+    slab->inuse++;
+    c->inuse++;
+    if (!slab->free && slab->carved == slab->total)
+        list_delete(&slab->node);
+
+    return obj;
+}
+
+static void small_free(void *ptr)
+{
+    struct sc_slab *slab = slab_of(ptr);
+    struct sc_class *c;
+    struct sc_object *obj = ptr;
+    bool was_full;
+
+    DEBUG_ASSERT(slab->magic == SC_SLAB_MAGIC);
+    DEBUG_ASSERT(((uint8_t *)ptr - ((uint8_t *)slab + SC_SLAB_HDR)) % sc_sizes[slab->cls] == 0);
+
+    c = &theheap.classes[slab->cls];
+    was_full = !slab->free && slab->carved == slab->total;
+
+    obj->next = slab->free;
+    slab->free = obj;
+    slab->inuse--;
+    c->inuse--;
+
+    if (was_full) {
+        list_add_head(&c->partial, &slab->node);
+    } else if (slab->inuse == 0 && c->slabs > 1) {
+        /* keep the last slab of a class around to avoid ping-pong */
+        slab_put(slab);
+    }
+}
+
+/* dma arena, called with the lock held */
+
+static inline bool dma_page_used(size_t page)
+{
+    return theheap.dma_map[page / 32] & (1U << (page % 32));
+}
+
+static void dma_mark(size_t page, size_t count, bool used)
+{
+    for (; count; page++, count--) {
+        if (used)
+            theheap.dma_map[page / 32] |= 1U << (page % 32);
+        else
+            theheap.dma_map[page / 32] &= ~(1U << (page % 32));
+    }
+}
+
+/* first page at or after page whose address is aligned */
+static size_t dma_align_page(size_t page, size_t alignment)
+{
+    addr_t addr = (addr_t)theheap.dma_base + page * PAGE_SIZE;
+
+    return (ROUNDUP(addr, alignment) - (addr_t)theheap.dma_base) / PAGE_SIZE;
+}
+
+static void *dma_alloc(size_t size, size_t alignment)
+{
+    size_t pages = ROUNDUP(size, PAGE_SIZE) / PAGE_SIZE;
+    size_t i, j;
+
+    if (pages == 0)
+        pages = 1;
+    if (pages > theheap.dma_free)
+        return NULL;
+
+    for (i = dma_align_page(0, alignment); i + pages <= theheap.dma_pages; ) {
+        for (j = 0; j < pages; j++) {
+            if (dma_page_used(i + j))
+                break;
+        }
+        if (j == pages) {
+            dma_mark(i, pages, true);
+            theheap.dma_run[i] = pages;
+            theheap.dma_free -= pages;
+            return theheap.dma_base + i * PAGE_SIZE;
+        }
+        /* restart past the page in use */
+        i = dma_align_page(i + j + 1, alignment);
+    }
+
+    return NULL;
+}
+
+static size_t dma_size(const void *ptr)
+{
+    return theheap.dma_run[((const uint8_t *)ptr - theheap.dma_base) / PAGE_SIZE] * PAGE_SIZE;
+}
+
+static void dma_free(void *ptr)
+{
+    size_t page = ((uint8_t *)ptr - theheap.dma_base) / PAGE_SIZE;
+    size_t pages = theheap.dma_run[page];
+
+    DEBUG_ASSERT(((addr_t)ptr % PAGE_SIZE) == 0);
+    DEBUG_ASSERT(pages > 0 && dma_page_used(page));
+
+    dma_mark(page, pages, false);
+    theheap.dma_run[page] = 0;
+    theheap.dma_free += pages;
+}
+
+static size_t dma_max_run(void)
+{
+    size_t i, run = 0, max = 0;
+
+    for (i = 0; i < theheap.dma_pages; i++) {
+        if (dma_page_used(i)) {
+            run = 0;
+        } else if (++run > max) {
+            max = run;
+        }
+    }
+
+    return max;
+}
+
+void *sizeclass_alloc(size_t size, unsigned int alignment)
+{
+    void *ptr = NULL;
+
+    LTRACEF("size %zu, align %u\n", size, alignment);
+
+    if (alignment >= PAGE_SIZE) {
+        mutex_acquire(&theheap.lock);
+        ptr = dma_alloc(size, alignment);
+        mutex_release(&theheap.lock);
+    } else if (size <= SIZECLASS_MAX_SMALL && alignment <= SC_GRANULE) {
+        mutex_acquire(&theheap.lock);
+        ptr = small_alloc(size);
+        mutex_release(&theheap.lock);
+    }
+
+    if (!ptr) {
+        /* the tail of a device buffer must not share a line either */
+        if (alignment >= CACHE_LINE)
+            size = ROUNDUP(size, CACHE_LINE);
+        ptr = miniheap_alloc(size, alignment);
+    }
+
+    LTRACEF("ptr %p\n", ptr);
+    return ptr;
+}
+
+void sizeclass_free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    LTRACEF("ptr %p\n", ptr);
+
+    if (in_slab_arena(ptr)) {
+        mutex_acquire(&theheap.lock);
+        small_free(ptr);
+        mutex_release(&theheap.lock);
+    } else if (in_dma_arena(ptr)) {
+        mutex_acquire(&theheap.lock);
+        dma_free(ptr);
+        mutex_release(&theheap.lock);
+    } else {
+        miniheap_free(ptr);
+    }
+}
+
+void *sizeclass_realloc(void *ptr, size_t size)
+{
+    size_t old_size;
+    void *ptr2;
+
+    if (!ptr)
+        return sizeclass_alloc(size, 0);
+    if (size == 0) {
+        sizeclass_free(ptr);
+        return NULL;
+    }
+
+    if (in_slab_arena(ptr)) {
+        old_size = sc_sizes[slab_of(ptr)->cls];
+    } else if (in_dma_arena(ptr)) {
+        old_size = dma_size(ptr);
+    } else {
+        return miniheap_realloc(ptr, size);
+    }
+
+    if (size <= old_size)
+        return ptr;
+
+    ptr2 = sizeclass_alloc(size, in_dma_arena(ptr) ? PAGE_SIZE : 0);
+    if (!ptr2)
+        return NULL;
+
+    memcpy(ptr2, ptr, old_size);
+    sizeclass_free(ptr);
+
+    return ptr2;
+}
+
+void sizeclass_get_stats(struct sizeclass_stats *ptr)
+{
+    unsigned int i;
+
+    mutex_acquire(&theheap.lock);
+
+    ptr->slab_arena_size = theheap.slab_len;
+    ptr->slab_arena_used = theheap.slab_next - theheap.slab_pool_count * SC_SLAB_SIZE;
+    ptr->small_inuse = 0;
+    for (i = 0; i < SC_NUM_CLASSES; i++)
+        ptr->small_inuse += theheap.classes[i].inuse * sc_sizes[i];
+    ptr->dma_arena_size = theheap.dma_pages * PAGE_SIZE;
+    ptr->dma_arena_free = theheap.dma_free * PAGE_SIZE;
+    ptr->dma_max_run = dma_max_run() * PAGE_SIZE;
+
+    mutex_release(&theheap.lock);
+}
+
+void sizeclass_dump(void)
+{
+    unsigned int i;
+
+    mutex_acquire(&theheap.lock);
+
+    printf("Size class heap dump:\n");
+    printf("\tslab arena %p, len 0x%zx, %zu slabs carved, %zu pooled\n",
+           theheap.slab_base, theheap.slab_len,
+           theheap.slab_next / SC_SLAB_SIZE, theheap.slab_pool_count);
+    for (i = 0; i < SC_NUM_CLASSES; i++) {
+        struct sc_class *c = &theheap.classes[i];
+
+        if (!c->slabs)
+            continue;
+        printf("\t\tclass %4u: %3u slabs, %6u objects in use\n",
+               sc_sizes[i], c->slabs, c->inuse);
+    }
+
+    printf("\tdma arena %p, len 0x%zx, free 0x%zx, largest free 0x%zx\n",
+           theheap.dma_base, theheap.dma_pages * PAGE_SIZE,
+           theheap.dma_free * PAGE_SIZE, dma_max_run() * PAGE_SIZE);
+
+    mutex_release(&theheap.lock);
+
+    miniheap_dump();
+}
+
+void sizeclass_trim(void)
+{
+    /* the arenas are kept for the life of the heap */
+    miniheap_trim();
+}
+
+static size_t arena_pages(size_t len, size_t alignment)
+{
+    return (len + alignment - PAGE_SIZE) / PAGE_SIZE;
+}
+
+/* *raw gets what page_alloc() returned, for arena_free() */
+static void *arena_alloc(size_t len, size_t alignment, void **raw)
+{
+    *raw = page_alloc(arena_pages(len, alignment), PAGE_ALLOC_ANY_ARENA);
+    if (!*raw)
+        return NULL;
+
+    /* the misaligned head is not used, it is less than one slab */
+    return (void *)ROUNDUP((addr_t)*raw, alignment);
+}
+
+static void arena_free(void *raw, size_t len, size_t alignment)
+{
+    if (raw)
+        page_free(raw, arena_pages(len, alignment));
+}
+
+void sizeclass_init(void)
+{
+    unsigned int i, cls;
+    size_t words;
+    void *raw;
+
+    LTRACE_ENTRY;
+
+    mutex_init(&theheap.lock);
+
+    for (i = 0, cls = 0; i < countof(theheap.class_of); i++) {
+        while (sc_sizes[cls] < i * SC_GRANULE)
+            cls++;
+        theheap.class_of[i] = cls;
+    }
+    for (i = 0; i < SC_NUM_CLASSES; i++)
+        list_initialize(&theheap.classes[i].partial);
+    list_initialize(&theheap.slab_pool);
+
+    theheap.slab_base = arena_alloc(SIZECLASS_SLAB_ARENA_SIZE, SC_SLAB_SIZE, &raw);
+    if (theheap.slab_base)
+        theheap.slab_len = SIZECLASS_SLAB_ARENA_SIZE;
+    else
+        dprintf(INFO, "sizeclass: no slab arena, small blocks from miniheap\n");
+
+    theheap.dma_pages = SIZECLASS_DMA_ARENA_SIZE / PAGE_SIZE;
+    words = (theheap.dma_pages + 31) / 32;
+    theheap.dma_map = miniheap_alloc(words * sizeof(uint32_t), 0);
+    theheap.dma_run = miniheap_alloc(theheap.dma_pages * sizeof(uint32_t), 0);
+    theheap.dma_base = arena_alloc(SIZECLASS_DMA_ARENA_SIZE, PAGE_SIZE, &raw);
+    if (theheap.dma_map && theheap.dma_run && theheap.dma_base) {
+        memset(theheap.dma_map, 0, words * sizeof(uint32_t));
+        memset(theheap.dma_run, 0, theheap.dma_pages * sizeof(uint32_t));
+        theheap.dma_free = theheap.dma_pages;
+    } else {
+        /* give back whatever part of the dma arena was set up */
+        dprintf(INFO, "sizeclass: no dma arena, aligned blocks from miniheap\n");
+        arena_free(theheap.dma_base ? raw : NULL, SIZECLASS_DMA_ARENA_SIZE, PAGE_SIZE);
+        miniheap_free(theheap.dma_map);
+        miniheap_free(theheap.dma_run);
+        theheap.dma_base = NULL;
+        theheap.dma_map = NULL;
+        theheap.dma_run = NULL;
+        theheap.dma_pages = 0;
+    }
+
+    LTRACEF("slab arena %p, dma arena %p\n", theheap.slab_base, theheap.dma_base);
+}
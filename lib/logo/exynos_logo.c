@@ -20,23 +20,413 @@
  * limitations under the License.
  */
 
+#include <string.h>
 #include <malloc.h>
 #include <part.h>
+#include <lib/lz4.h>
+#include <lib/logo_format.h>
+#include <lib/logo_display.h>
 #include <platform/ab_update.h>
 #include <platform/sfr.h>
 #include <dev/dpu/decon.h>
 #include <target/dpu_config.h>
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif
 
 #define BMP_HEADER_SIZE 54
 
+/* Room for the stored image at CONFIG_DISPLAY_TEMP_BASE_ADDRESS */
+#ifndef LOGO_TEMP_SIZE
+#define LOGO_TEMP_SIZE		(20 * 1024 * 1024)
+#endif
+
+/*
+ * Decoded frames can be kept so that switching between images, e.g. the
+ * charging animation, does not go to storage again. Each full screen
+ * frame costs LCD_WIDTH * LCD_HEIGHT * 4 bytes of heap, so the cache is
+ * off unless the target sets LOGO_CACHE_SIZE. Without it, images are
+ * decoded straight into the frame buffer.
+ */
+#define LOGO_CACHE_SLOTS	4
+#ifndef LOGO_CACHE_SIZE
+#define LOGO_CACHE_SIZE		0
+#endif
+
 int decon_resize_align(unsigned int xsize, unsigned int ysize);
 
+static struct logo_cache {
+	char name[LOGO_NAME_LEN];
+	unsigned int width;
+	unsigned int height;
+	unsigned int *pixels;
+	unsigned int last_use;
+} logo_cache[LOGO_CACHE_SLOTS];
+static unsigned int logo_cache_bytes;
+static unsigned int logo_cache_clock;
+
+/* Copy of the container directory */
+static struct {
+	struct logo_header hdr;
+	struct logo_entry entry[LOGO_MAX_IMAGES];
+} logo_dir;
+static int logo_dir_loaded;
+
+static unsigned int logo_bytes_per_pixel(unsigned int format)
+{
+	switch (format) {
+	case LOGO_FMT_BGR888:
+		return 3;
+	case LOGO_FMT_BGRA8888:
+	case LOGO_FMT_RGBA8888:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * The pixel converters may run in place as long as dst does not get
+ * ahead of src: each NEON step loads all its input before storing.
+ */
+static void logo_bgr_to_argb(unsigned int *dst, const u8 *src, size_t n)
+{
+	size_t i = 0;
+
+#if __ARM_NEON
+	uint8x16x4_t out;
+
+	out.val[3] = vdupq_n_u8(0xff);
+	for (; i + 16 <= n; i += 16) {
+		uint8x16x3_t in = vld3q_u8(src + i * 3);
+
+		out.val[0] = in.val[0];
+		out.val[1] = in.val[1];
+		out.val[2] = in.val[2];
+		vst4q_u8((u8 *)(dst + i), out);
+	}
+#endif
+	for (; i < n; i++)
+		dst[i] = (0xffU << 24) | (src[i * 3 + 2] << 16) | (src[i * 3 + 1] << 8) | src[i * 3];
+}
+
+static void logo_rgba_to_argb(unsigned int *dst, const u8 *src, size_t n)
+{
+	size_t i = 0;
+
+#if __ARM_NEON
+	for (; i + 16 <= n; i += 16) {
+		uint8x16x4_t in = vld4q_u8(src + i * 4);
+		uint8x16_t r = in.val[0];
+
+		in.val[0] = in.val[2];
+		in.val[2] = r;
+		vst4q_u8((u8 *)(dst + i), in);
+	}
+#endif
+	for (; i < n; i++)
+		dst[i] = ((unsigned int)src[i * 4 + 3] << 24) | (src[i * 4] << 16) |
+			(src[i * 4 + 1] << 8) | src[i * 4 + 2];
+}
+
+static void logo_fill(unsigned int *dst, unsigned int pixel, size_t n)
+{
+	size_t i = 0;
+
+#if __ARM_NEON
+	uint32x4_t v = vdupq_n_u32(pixel);
+
+	for (; i + 4 <= n; i += 4)
+		vst1q_u32(dst + i, v);
+#endif
+	for (; i < n; i++)
+		dst[i] = pixel;
+}
+
+static void logo_convert(unsigned int *dst, const u8 *src, unsigned int format, size_t n)
+{
+	switch (format) {
+	case LOGO_FMT_BGR888:
+		logo_bgr_to_argb(dst, src, n);
+		break;
+	case LOGO_FMT_BGRA8888:
+		if ((const u8 *)dst != src)
+			memmove(dst, src, n * 4);
+		break;
+	case LOGO_FMT_RGBA8888:
+		logo_rgba_to_argb(dst, src, n);
+		break;
+	}
+}
+
+static int logo_rle_decode(unsigned int *dst, size_t n, const u8 *src, size_t len,
+		unsigned int format)
+{
+	unsigned int bpp = logo_bytes_per_pixel(format);
+	const u8 *end = src + len;
+	unsigned int pixel;
+	size_t done = 0;
+	size_t count;
+	u8 c;
+
+	while (done < n) {
+		if (src == end)
+			return -1;
+
+		c = *src++;
+		count = (c & ~LOGO_RLE_RUN) + 1;
+		if (count > n - done)
+			return -1;
+
+		if (c & LOGO_RLE_RUN) {
+			if ((size_t)(end - src) < bpp)
+				return -1;
+			logo_convert(&pixel, src, format, 1);
+			logo_fill(dst + done, pixel, count);
+			src += bpp;
+		} else {
+			if ((size_t)(end - src) < count * bpp)
+				return -1;
+			logo_convert(dst + done, src, format, count);
+			src += count * bpp;
+		}
+		done += count;
+	}
+
+	return 0;
+}
+
+static int logo_decode(unsigned int *dst, const struct logo_entry *e, const u8 *src)
+{
+	size_t n = (size_t)e->width * e->height;
+	unsigned int bpp = logo_bytes_per_pixel(e->format);
+	u8 *packed;
+	int ret;
+
+	switch (e->compression) {
+	case LOGO_COMP_NONE:
+		if (e->size < n * bpp)
+			return -1;
+		logo_convert(dst, src, e->format, n);
+		return 0;
+	case LOGO_COMP_RLE:
+		return logo_rle_decode(dst, n, src, e->size, e->format);
+	case LOGO_COMP_LZ4:
+		/*
+		 * Unpack to the end of dst and expand forward from there,
+		 * which never overwrites packed pixels not yet converted.
+		 */
+		packed = (u8 *)dst + n * (4 - bpp);
+		ret = lz4_decompress_block(src, e->size, packed, n * bpp, packed);
+		if (ret < 0 || (size_t)ret != n * bpp)
+			return -1;
+		logo_convert(dst, packed, e->format, n);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+static int logo_dir_load(void *part)
+{
+	u8 *buf = (u8 *)(CONFIG_DISPLAY_TEMP_BASE_ADDRESS);
+	unsigned int i;
+
+	if (logo_dir_loaded)
+		return 0;
+
+	if (part_read_partial(part, buf, 0, (u64)LOGO_HEADER_SIZE))
+		return -1;
+	memcpy(&logo_dir, buf, sizeof(logo_dir));
+
+	if (memcmp(logo_dir.hdr.magic, LOGO_MAGIC, 4) ||
+			logo_dir.hdr.version != LOGO_VERSION ||
+			logo_dir.hdr.count > LOGO_MAX_IMAGES) {
+		printf("logo: bad container header\n");
+		return -1;
+	}
+
+	for (i = 0; i < logo_dir.hdr.count; i++) {
+		struct logo_entry *e = &logo_dir.entry[i];
+
+		e->name[LOGO_NAME_LEN - 1] = '\0';
+		if (!logo_bytes_per_pixel(e->format) ||
+				e->width > LCD_WIDTH || e->height > LCD_HEIGHT) {
+			printf("logo: skipping '%s', %ux%u format %u\n",
+					e->name, e->width, e->height, e->format);
+			e->name[0] = '\0';
+		}
+	}
+	logo_dir_loaded = 1;
+
+	return 0;
+}
+
+static const struct logo_entry *logo_dir_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < logo_dir.hdr.count; i++) {
+		if (!strncmp(logo_dir.entry[i].name, name, LOGO_NAME_LEN))
+			return &logo_dir.entry[i];
+	}
+
+	return NULL;
+}
+
+/* Only the sectors covering the stored image, into the temp area */
+static const u8 *logo_read_image(void *part, const struct logo_entry *e)
+{
+	u8 *buf = (u8 *)(CONFIG_DISPLAY_TEMP_BASE_ADDRESS);
+	u64 start = ((u64)e->offset / PART_SECTOR_SIZE) * PART_SECTOR_SIZE;
+	u64 end = (((u64)e->offset + e->size + PART_SECTOR_SIZE - 1) / PART_SECTOR_SIZE) * PART_SECTOR_SIZE;
+
+	if (end - start > LOGO_TEMP_SIZE || end > part_get_size_in_bytes(part)) {
+		printf("logo: '%s' is out of range\n", e->name);
+		return NULL;
+	}
+
+	if (part_read_partial(part, buf, start, end - start))
+		return NULL;
+
+	return buf + (e->offset - start);
+}
+
+static struct logo_cache *logo_cache_find(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < LOGO_CACHE_SLOTS; i++) {
+		if (logo_cache[i].pixels && !strncmp(logo_cache[i].name, name, LOGO_NAME_LEN)) {
+			logo_cache[i].last_use = ++logo_cache_clock;
+			return &logo_cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void logo_cache_drop(struct logo_cache *slot)
+{
+	if (!slot->pixels)
+		return;
+
+	logo_cache_bytes -= slot->width * slot->height * 4;
+	free(slot->pixels);
+	memset(slot, 0, sizeof(*slot));
+}
+
+/* A slot for e, evicting the least recently shown frames to make room */
+static struct logo_cache *logo_cache_get(const struct logo_entry *e)
+{
+	unsigned int bytes = e->width * e->height * 4;
+	struct logo_cache *slot, *lru;
+	unsigned int i;
+
+	if (bytes > LOGO_CACHE_SIZE)
+		return NULL;
+
+	for (;;) {
+		slot = NULL;
+		lru = NULL;
+		for (i = 0; i < LOGO_CACHE_SLOTS; i++) {
+			if (!logo_cache[i].pixels)
+				slot = &logo_cache[i];
+			else if (!lru || logo_cache[i].last_use < lru->last_use)
+				lru = &logo_cache[i];
+		}
+		if (slot && logo_cache_bytes + bytes <= LOGO_CACHE_SIZE)
+			break;
+		logo_cache_drop(lru);
+	}
+
+	slot->pixels = memalign(CACHE_LINE, bytes);
+	if (!slot->pixels)
+		return NULL;
+
+	/* named once decoded */
+	slot->name[0] = '\0';
+	slot->width = e->width;
+	slot->height = e->height;
+	slot->last_use = ++logo_cache_clock;
+	logo_cache_bytes += bytes;
+
+	return slot;
+}
+
+void logo_cache_flush(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < LOGO_CACHE_SLOTS; i++)
+		logo_cache_drop(&logo_cache[i]);
+	logo_dir_loaded = 0;
+}
+
+static int logo_show(const char *name, int cache)
+{
+#ifdef CONFIG_PIT
+	unsigned int *fb = (unsigned int *)(CONFIG_DISPLAY_LOGO_BASE_ADDRESS);
+	const struct logo_entry *e;
+	struct logo_cache *slot;
+	const u8 *src;
+	void *part;
+
+	slot = logo_cache_find(name);
+	if (slot)
+		goto show;
+
+	part = part_get("logo");
+	if (!part || logo_dir_load(part))
+		return -1;
+
+	e = logo_dir_find(name);
+	if (!e) {
+		printf("logo: no '%s' image\n", name);
+		return -1;
+	}
+
+	src = logo_read_image(part, e);
+	if (!src)
+		return -1;
+
+	/* Without a cache slot, decode straight into the frame buffer */
+	slot = cache ? logo_cache_get(e) : NULL;
+	if (logo_decode(slot ? slot->pixels : fb, e, src)) {
+		printf("logo: '%s' is corrupted\n", name);
+		if (slot)
+			logo_cache_drop(slot);
+		return -1;
+	}
+
+	if (!slot) {
+		decon_resize_align(e->width, e->height);
+		decon_string_update();
+		return 0;
+	}
+	strncpy(slot->name, name, LOGO_NAME_LEN - 1);
+
+show:
+	memcpy(fb, slot->pixels, slot->width * slot->height * 4);
+	decon_resize_align(slot->width, slot->height);
+	decon_string_update();
+
+	return 0;
+#else
+	return 0;
+#endif
+}
+
+int show_logo(const char *name)
+{
+	return logo_show(name, 1);
+}
+
 int show_boot_logo(void)
 {
 #ifdef CONFIG_PIT
 	unsigned char *file = (unsigned char *)(CONFIG_DISPLAY_TEMP_BASE_ADDRESS);
 	unsigned int *fb = (unsigned int *)(CONFIG_DISPLAY_LOGO_BASE_ADDRESS);
-	unsigned int i;
 
 	/* bmp header */
 	unsigned short type;
@@ -52,6 +442,10 @@ int show_boot_logo(void)
 		goto error;
 	part_read_partial(part, (void *)file, 0, (u64)512);
 
+	/* Shown once, not worth a cache slot */
+	if (!memcmp(file, LOGO_MAGIC, 4))
+		return logo_show("boot", 0);
+
 	type = ((unsigned short)*(file + 1) << 8) | (unsigned short)(*file);
 	printf("type : 0x%04x\n", type);
 
@@ -89,17 +483,7 @@ int show_boot_logo(void)
 
 		file+=BMP_HEADER_SIZE;
 
-		for (i = 0; i < img_width * img_height * 3; i += 24) {
-			*fb++ = (0xff << 24)|(*(file + i +  2) << 16)|(*(file + i +  1) << 8)|*(file + i);
-			*fb++ = (0xff << 24)|(*(file + i +  5) << 16)|(*(file + i +  4) << 8)|*(file + i +  3);
-			*fb++ = (0xff << 24)|(*(file + i +  8) << 16)|(*(file + i +  7) << 8)|*(file + i +  6);
-			*fb++ = (0xff << 24)|(*(file + i + 11) << 16)|(*(file + i + 10) << 8)|*(file + i +  9);
-
-			*fb++ = (0xff << 24)|(*(file + i + 14) << 16)|(*(file + i + 13) << 8)|*(file + i + 12);
-			*fb++ = (0xff << 24)|(*(file + i + 17) << 16)|(*(file + i + 16) << 8)|*(file + i + 15);
-			*fb++ = (0xff << 24)|(*(file + i + 20) << 16)|(*(file + i + 19) << 8)|*(file + i + 18);
-			*fb++ = (0xff << 24)|(*(file + i + 23) << 16)|(*(file + i + 22) << 8)|*(file + i + 21);
-		}
+		logo_bgr_to_argb(fb, file, img_width * img_height);
 
 		decon_resize_align(img_width, img_height);
 
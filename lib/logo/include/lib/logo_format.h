@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LOGO_FORMAT_H__
+#define __LOGO_FORMAT_H__
+
+#include <stdint.h>
+
+/*
+ * Logo partition container, shared with tools/mklogo.
+ *
+ * The first LOGO_HEADER_SIZE bytes hold a logo_header followed by
+ * count logo_entry, all little endian. Each entry points at its stored
+ * pixels, rows in BMP order (bottom row first) without padding.
+ *
+ * LOGO_COMP_RLE is a stream of packets over whole pixels: a control
+ * byte c, then either one pixel repeated (c & 0x7f) + 1 times when bit
+ * 7 is set, or c + 1 literal pixels. LOGO_COMP_LZ4 is a single LZ4
+ * block (not a frame) of the raw pixels.
+ */
+#define LOGO_MAGIC		"EXLG"
+#define LOGO_VERSION		1
+#define LOGO_HEADER_SIZE	4096
+#define LOGO_NAME_LEN		16
+#define LOGO_MAX_IMAGES \
+	((LOGO_HEADER_SIZE - sizeof(struct logo_header)) / sizeof(struct logo_entry))
+
+/* Images are placed at this alignment so each is read on its own */
+#define LOGO_ALIGN		4096
+
+enum logo_format {
+	LOGO_FMT_BGR888		= 0,	/* 24 bpp BMP byte order */
+	LOGO_FMT_BGRA8888	= 1,	/* framebuffer byte order */
+	LOGO_FMT_RGBA8888	= 2,
+};
+
+enum logo_compression {
+	LOGO_COMP_NONE		= 0,
+	LOGO_COMP_RLE		= 1,
+	LOGO_COMP_LZ4		= 2,
+};
+
+#define LOGO_RLE_RUN		0x80
+#define LOGO_RLE_MAX		128
+
+struct logo_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+} __attribute__((packed));
+
+struct logo_entry {
+	char name[LOGO_NAME_LEN];	/* "boot", "charging", ... */
+	uint32_t offset;		/* from the start of the partition */
+	uint32_t size;			/* stored bytes */
+	uint16_t width;
+	uint16_t height;
+	uint8_t format;
+	uint8_t compression;
+	uint16_t reserved;
+} __attribute__((packed));
+
+#endif	/* __LOGO_FORMAT_H__ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <sys/types.h>
+
+/*
+ * LZ4 block and frame decoder.
+ *
+ * Frame format: https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ * Dictionaries are not supported. Header, block and content checksums
+ * are verified when present.
+ */
+#define LZ4_FRAME_MAGIC         0x184D2204
+#define LZ4_SKIPPABLE_MAGIC     0x184D2A50
+#define LZ4_SKIPPABLE_MASK      0xFFFFFFF0
+
+/* Back-reference window of linked blocks */
+#define LZ4_HISTORY_SIZE        (64 * 1024)
+#define LZ4_BLOCK_MAX_SIZE      (4 * 1024 * 1024)
+
+/* Called with decoded data, in order. Non-zero return aborts decoding */
+typedef int (*lz4_flush_t)(void *arg, const void *buf, size_t len);
+
+struct lz4_dec {
+    /*
+     * Work buffer. It has to hold the largest block of the frame plus
+     * the history window and align, so LZ4_BLOCK_MAX_SIZE +
+     * LZ4_HISTORY_SIZE + align always works.
+     */
+    u8 *buf;
+    size_t size;
+
+    /* Every flush but the last is a multiple of align */
+    size_t align;
+
+    lz4_flush_t flush;
+    void *arg;
+
+    /* Out: total bytes passed to flush */
+    u64 out_bytes;
+};
+
+/*
+ * Decode one LZ4 block into dst. Matches may reference data down to
+ * base, which is dst for an independent block.
+ * Returns the decoded length or a negative error.
+ */
+int lz4_decompress_block(const void *src, size_t src_len,
+        void *dst, size_t dst_len, const void *base);
+
+/* Whether buf starts with an LZ4 frame (skippable frames included) */
+int lz4_is_frame(const void *buf, size_t len);
+
+/*
+ * Sum of the content sizes declared by the frames in src.
+ * Returns ERR_NOT_FOUND if any frame does not declare one.
+ */
+int lz4_frame_content_size(const void *src, size_t len, u64 *size);
+
+/* Decode all frames in src through dec->flush */
+int lz4_frame_decode(struct lz4_dec *dec, const void *src, size_t len);
+
+#endif /* __LZ4_H__ */
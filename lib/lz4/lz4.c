@@ -0,0 +1,531 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lib/lz4.h>
+
+/* Frame descriptor FLG bits */
+#define LZ4_FLG_VERSION(f)      (((f) >> 6) & 0x3)
+#define LZ4_FLG_BLOCK_INDEP     (1 << 5)
+#define LZ4_FLG_BLOCK_CSUM      (1 << 4)
+#define LZ4_FLG_CONTENT_SIZE    (1 << 3)
+#define LZ4_FLG_CONTENT_CSUM    (1 << 2)
+#define LZ4_FLG_RESERVED        (1 << 1)
+#define LZ4_FLG_DICT_ID         (1 << 0)
+
+/* Frame descriptor BD bits */
+#define LZ4_BD_BLOCK_MAX(b)     (((b) >> 4) & 0x7)
+#define LZ4_BD_RESERVED         0x8F
+
+#define LZ4_BLOCK_UNCOMPRESSED  0x80000000
+
+#define XXH_PRIME32_1   2654435761U
+#define XXH_PRIME32_2   2246822519U
+#define XXH_PRIME32_3   3266489917U
+#define XXH_PRIME32_4   668265263U
+#define XXH_PRIME32_5   374761393U
+
+struct xxh32 {
+    u32 v[4];
+    u64 total;
+    u8 mem[16];
+    u32 memsize;
+};
+
+struct lz4_frame_hdr {
+    u32 flg;
+    u32 block_max;
+    u64 content_size;
+    u32 size;
+};
+
+static inline u32 lz4_le32(const u8 *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline u64 lz4_le64(const u8 *p)
+{
+    return lz4_le32(p) | ((u64)lz4_le32(p + 4) << 32);
+}
+
+static inline u32 xxh32_rotl(u32 x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline u32 xxh32_round(u32 acc, u32 in)
+{
+    acc += in * XXH_PRIME32_2;
+    acc = xxh32_rotl(acc, 13);
+    return acc * XXH_PRIME32_1;
+}
+
+static void xxh32_init(struct xxh32 *s)
+{
+    /* Seed is always 0 for LZ4 */
+    s->v[0] = XXH_PRIME32_1 + XXH_PRIME32_2;
+    s->v[1] = XXH_PRIME32_2;
+    s->v[2] = 0;
+    s->v[3] = -XXH_PRIME32_1;
+    s->total = 0;
+    s->memsize = 0;
+}
+
+static void xxh32_stripe(struct xxh32 *s, const u8 *p)
+{
+    s->v[0] = xxh32_round(s->v[0], lz4_le32(p));
+    s->v[1] = xxh32_round(s->v[1], lz4_le32(p + 4));
+    s->v[2] = xxh32_round(s->v[2], lz4_le32(p + 8));
+    s->v[3] = xxh32_round(s->v[3], lz4_le32(p + 12));
+}
+
+static void xxh32_update(struct xxh32 *s, const u8 *p, size_t len)
+{
+    size_t fill;
+
+    s->total += len;
+
+    if (s->memsize + len < 16) {
+        memcpy(s->mem + s->memsize, p, len);
+        s->memsize += len;
+        return;
+    }
+
+    if (s->memsize) {
+        fill = 16 - s->memsize;
+        memcpy(s->mem + s->memsize, p, fill);
+        xxh32_stripe(s, s->mem);
+        p += fill;
+        len -= fill;
+        s->memsize = 0;
+    }
+
+    while (len >= 16) {
+        xxh32_stripe(s, p);
+        p += 16;
+        len -= 16;
+    }
+
+    if (len) {
+        memcpy(s->mem, p, len);
+        s->memsize = len;
+    }
+}
+
+static u32 xxh32_digest(struct xxh32 *s)
+{
+    const u8 *p = s->mem;
+    size_t len = s->memsize;
+    u32 h;
+
+    if (s->total >= 16)
+        h = xxh32_rotl(s->v[0], 1) + xxh32_rotl(s->v[1], 7) +
+            xxh32_rotl(s->v[2], 12) + xxh32_rotl(s->v[3], 18);
+    else
+        h = s->v[2] + XXH_PRIME32_5;
+
+    h += (u32)s->total;
+
+    while (len >= 4) {
+        h += lz4_le32(p) * XXH_PRIME32_3;
+        h = xxh32_rotl(h, 17) * XXH_PRIME32_4;
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        h += (*p++) * XXH_PRIME32_5;
+        h = xxh32_rotl(h, 11) * XXH_PRIME32_1;
+    }
+
+    h ^= h >> 15;
+    h *= XXH_PRIME32_2;
+    h ^= h >> 13;
+    h *= XXH_PRIME32_3;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static u32 xxh32(const void *buf, size_t len)
+{
+    struct xxh32 s;
+
+    xxh32_init(&s);
+    xxh32_update(&s, buf, len);
+
+    return xxh32_digest(&s);
+}
+
+static int lz4_read_len(const u8 **ip, const u8 *iend, size_t *len)
+{
+    u8 b;
+
+    do {
+        if (*ip >= iend)
+            return ERR_BAD_LEN;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+
+    return 0;
+}
+
+int lz4_decompress_block(const void *src, size_t src_len,
+        void *dst, size_t dst_len, const void *base)
+{
+    const u8 *ip = src;
+    const u8 *iend = ip + src_len;
+    u8 *op = dst;
+    u8 *oend = op + dst_len;
+    const u8 *lowest = base ? base : dst;
+    const u8 *match;
+    size_t lit, ml, off;
+    u8 token;
+    int ret;
+
+    for (;;) {
+        if (ip >= iend)
+            return ERR_BAD_LEN;
+        token = *ip++;
+
+        lit = token >> 4;
+        if (lit == 15) {
+            ret = lz4_read_len(&ip, iend, &lit);
+            if (ret)
+                return ret;
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op))
+            return ERR_BAD_LEN;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+
+        /* The last sequence has literals only */
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return ERR_BAD_LEN;
+        off = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (!off || off > (size_t)(op - lowest))
+            return ERR_NOT_VALID;
+
+        ml = token & 15;
+        if (ml == 15) {
+            ret = lz4_read_len(&ip, iend, &ml);
+            if (ret)
+                return ret;
+        }
+        ml += 4;
+        if (ml > (size_t)(oend - op))
+            return ERR_BAD_LEN;
+
+        match = op - off;
+        if (off >= 8 && ml + 8 <= (size_t)(oend - op)) {
+            /* No overlap within 8 bytes, may copy up to 7 bytes past the match */
+            u8 *cpy = op + ml;
+
+            do {
+                memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            } while (op < cpy);
+            op = cpy;
+        } else {
+            while (ml--)
+                *op++ = *match++;
+        }
+    }
+
+    return op - (u8 *)dst;
+}
+
+static int lz4_frame_header(const u8 *p, size_t len, struct lz4_frame_hdr *hdr)
+{
+    u32 desc_len;
+    u32 bd;
+
+    if (len < 7)
+        return ERR_BAD_LEN;
+    if (lz4_le32(p) != LZ4_FRAME_MAGIC)
+        return ERR_NOT_VALID;
+
+    hdr->flg = p[4];
+    bd = p[5];
+    if (LZ4_FLG_VERSION(hdr->flg) != 1)
+        return ERR_NOT_SUPPORTED;
+    if (hdr->flg & LZ4_FLG_DICT_ID)
+        return ERR_NOT_SUPPORTED;
+    if ((hdr->flg & LZ4_FLG_RESERVED) || (bd & LZ4_BD_RESERVED) ||
+            LZ4_BD_BLOCK_MAX(bd) < 4)
+        return ERR_NOT_VALID;
+
+    desc_len = 2;
+    hdr->content_size = 0;
+    if (hdr->flg & LZ4_FLG_CONTENT_SIZE) {
+        if (len < 4 + 2 + 8 + 1)
+            return ERR_BAD_LEN;
+        hdr->content_size = lz4_le64(p + 6);
+        desc_len += 8;
+    }
+
+    if (((xxh32(p + 4, desc_len) >> 8) & 0xff) != p[4 + desc_len])
+        return ERR_CHECKSUM_FAIL;
+
+    hdr->block_max = 1 << (2 * LZ4_BD_BLOCK_MAX(bd) + 8);
+    hdr->size = 4 + desc_len + 1;
+
+    return 0;
+}
+
+int lz4_is_frame(const void *buf, size_t len)
+{
+    u32 magic;
+
+    if (len < 4)
+        return 0;
+
+    magic = lz4_le32(buf);
+
+    return magic == LZ4_FRAME_MAGIC ||
+        (magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC;
+}
+
+/* Length of the skippable frame at p, 0 if p is not one */
+static ssize_t lz4_skippable_len(const u8 *p, size_t len)
+{
+    u32 size;
+
+    if ((lz4_le32(p) & LZ4_SKIPPABLE_MASK) != LZ4_SKIPPABLE_MAGIC)
+        return 0;
+    if (len < 8)
+        return ERR_BAD_LEN;
+
+    size = lz4_le32(p + 4);
+    if (size > len - 8)
+        return ERR_BAD_LEN;
+
+    return 8 + size;
+}
+
+int lz4_frame_content_size(const void *src, size_t len, u64 *size)
+{
+    const u8 *p = src;
+    const u8 *end = p + len;
+    struct lz4_frame_hdr hdr;
+    ssize_t skip;
+    u32 bsize;
+    int ret;
+
+    *size = 0;
+
+    while (end - p >= 4) {
+        skip = lz4_skippable_len(p, end - p);
+        if (skip < 0)
+            return skip;
+        if (skip) {
+            p += skip;
+            continue;
+        }
+
+        ret = lz4_frame_header(p, end - p, &hdr);
+        if (ret)
+            return ret;
+        if (!(hdr.flg & LZ4_FLG_CONTENT_SIZE))
+            return ERR_NOT_FOUND;
+        *size += hdr.content_size;
+        p += hdr.size;
+
+        /* Walk the block headers to the next frame */
+        for (;;) {
+            if (end - p < 4)
+                return ERR_BAD_LEN;
+            bsize = lz4_le32(p) & ~LZ4_BLOCK_UNCOMPRESSED;
+            p += 4;
+            if (!bsize)
+                break;
+            if (hdr.flg & LZ4_FLG_BLOCK_CSUM)
+                bsize += 4;
+            if (bsize > (size_t)(end - p))
+                return ERR_BAD_LEN;
+            p += bsize;
+        }
+        if (hdr.flg & LZ4_FLG_CONTENT_CSUM)
+            p += 4;
+    }
+
+    return (p == end) ? 0 : ERR_BAD_LEN;
+}
+
+/*
+ * Pass buf[*start, *pos) to the flush callback and make room for the
+ * next block. Only whole multiples of align are flushed unless last is
+ * set. The unflushed tail and up to LZ4_HISTORY_SIZE bytes of the current
+ * frame (from *hist) are moved to the front of the buffer.
+ */
+static int lz4_dec_flush(struct lz4_dec *dec, size_t *pos, size_t *start,
+        size_t *hist, int last)
+{
+    size_t len = *pos - *start;
+    size_t hist_from;
+    size_t keep;
+    int ret;
+
+    if (!last)
+        len -= len % dec->align;
+
+    if (len) {
+        ret = dec->flush(dec->arg, dec->buf + *start, len);
+        if (ret)
+            return (ret < 0) ? ret : ERR_IO;
+        *start += len;
+        dec->out_bytes += len;
+    }
+
+    if (last)
+        return 0;
+
+    hist_from = *hist;
+    if (*pos - hist_from > LZ4_HISTORY_SIZE)
+        hist_from = *pos - LZ4_HISTORY_SIZE;
+
+    keep = MIN(*start, hist_from);
+    if (keep) {
+        memmove(dec->buf, dec->buf + keep, *pos - keep);
+        *pos -= keep;
+        *start -= keep;
+        *hist = hist_from - keep;
+    }
+
+    return 0;
+}
+
+int lz4_frame_decode(struct lz4_dec *dec, const void *src, size_t len)
+{
+    const u8 *p = src;
+    const u8 *end = p + len;
+    struct lz4_frame_hdr hdr;
+    struct xxh32 xs;
+    size_t pos = 0, start = 0, hist = 0;
+    u64 frame_out;
+    ssize_t skip;
+    u32 bsize;
+    int raw;
+    int ret;
+
+    dec->out_bytes = 0;
+
+    if (!dec->align || !dec->flush || !lz4_is_frame(src, len))
+        return ERR_INVALID_ARGS;
+
+    while (end - p >= 4) {
+        skip = lz4_skippable_len(p, end - p);
+        if (skip < 0)
+            return skip;
+        if (skip) {
+            p += skip;
+            continue;
+        }
+
+        ret = lz4_frame_header(p, end - p, &hdr);
+        if (ret)
+            return ret;
+        if (dec->size < hdr.block_max + LZ4_HISTORY_SIZE + dec->align)
+            return ERR_NOT_ENOUGH_BUFFER;
+        p += hdr.size;
+
+        xxh32_init(&xs);
+        frame_out = 0;
+        hist = pos;
+
+        for (;;) {
+            if (end - p < 4)
+                return ERR_BAD_LEN;
+            bsize = lz4_le32(p);
+            p += 4;
+            if (!bsize)
+                break;
+
+            raw = !!(bsize & LZ4_BLOCK_UNCOMPRESSED);
+            bsize &= ~LZ4_BLOCK_UNCOMPRESSED;
+            if (bsize > hdr.block_max || bsize > (size_t)(end - p))
+                return ERR_BAD_LEN;
+
+            if (hdr.flg & LZ4_FLG_BLOCK_CSUM) {
+                if ((size_t)(end - p) - bsize < 4)
+                    return ERR_BAD_LEN;
+                if (xxh32(p, bsize) != lz4_le32(p + bsize))
+                    return ERR_CHECKSUM_FAIL;
+            }
+
+            if (dec->size - pos < hdr.block_max) {
+                ret = lz4_dec_flush(dec, &pos, &start, &hist, 0);
+                if (ret)
+                    return ret;
+            }
+
+            if (hdr.flg & LZ4_FLG_BLOCK_INDEP)
+                hist = pos;
+
+            if (raw) {
+                memcpy(dec->buf + pos, p, bsize);
+                ret = bsize;
+            } else {
+                ret = lz4_decompress_block(p, bsize, dec->buf + pos,
+                        hdr.block_max, dec->buf + hist);
+                if (ret < 0)
+                    return ret;
+            }
+
+            if (hdr.flg & LZ4_FLG_CONTENT_CSUM)
+                xxh32_update(&xs, dec->buf + pos, ret);
+
+            pos += ret;
+            frame_out += ret;
+            p += bsize;
+            if (hdr.flg & LZ4_FLG_BLOCK_CSUM)
+                p += 4;
+        }
+
+        if (hdr.flg & LZ4_FLG_CONTENT_CSUM) {
+            if (end - p < 4)
+                return ERR_BAD_LEN;
+            if (xxh32_digest(&xs) != lz4_le32(p))
+                return ERR_CHECKSUM_FAIL;
+            p += 4;
+        }
+
+        if ((hdr.flg & LZ4_FLG_CONTENT_SIZE) && frame_out != hdr.content_size)
+            return ERR_BAD_LEN;
+    }
+
+    if (p != end)
+        return ERR_BAD_LEN;
+
+    return lz4_dec_flush(dec, &pos, &start, &hist, 1);
+}
@@ -23,76 +23,104 @@
 
 #include "minip-internal.h"
 
-/* XXX alternate implementation, merge */
+#if MINIP_CHKSUM_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+ * The one's complement sum is the same whatever the word size it is
+ * accumulated in, as long as the carries are added back in, so sum 64
+ * bits at a time and fold down to 16 at the end. The NEON path
+ * accumulates pairs of 32 bit words into 64 bit lanes, which cannot
+ * overflow for any packet sized buffer.
+ */
 uint16_t ones_sum16(uint32_t sum, const void *_buf, int len)
 {
-    const uint16_t *buf = _buf;
+    const uint8_t *buf = _buf;
+    uint64_t acc = sum;
+    uint64_t w;
+
+#if MINIP_CHKSUM_NEON
+    if (len >= 64) {
+        uint64x2_t a0 = vdupq_n_u64(0);
+        uint64x2_t a1 = vdupq_n_u64(0);
+
+        for (; len >= 32; len -= 32, buf += 32) {
+            a0 = vpadalq_u32(a0, vreinterpretq_u32_u8(vld1q_u8(buf)));
+            a1 = vpadalq_u32(a1, vreinterpretq_u32_u8(vld1q_u8(buf + 16)));
+        }
+        a0 = vaddq_u64(a0, a1);
+        acc += vgetq_lane_u64(a0, 0);
+        acc += vgetq_lane_u64(a0, 1);
+    }
+#endif
+
+    for (; len >= 8; len -= 8, buf += 8) {
+        memcpy(&w, buf, 8);
+        acc += w;
+        acc += (acc < w);
+    }
+
+    if (len >= 4) {
+        uint32_t w32;
+
+        memcpy(&w32, buf, 4);
+        acc += w32;
+        acc += (acc < w32);
+        buf += 4;
+        len -= 4;
+    }
+
+    if (len >= 2) {
+        uint16_t w16;
 
-    while (len >= 2) {
-        sum += *buf++;
-        if (sum & 0x80000000)
-            sum = (sum & 0xffff) + (sum >> 16);
+        memcpy(&w16, buf, 2);
+        acc += w16;
+        acc += (acc < w16);
+        buf += 2;
         len -= 2;
     }
 
     if (len) {
-        uint16_t temp = htons((*(uint8_t *)buf) << 8);
-        sum += temp;
+        uint16_t temp = htons(*buf << 8);
+        acc += temp;
+        acc += (acc < temp);
     }
 
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    while (acc >> 16)
+        acc = (acc & 0xffff) + (acc >> 16);
 
-    return sum;
+    return acc;
 }
 
 uint16_t rfc1701_chksum(const uint8_t *buf, size_t len)
 {
-    uint32_t total = 0;
-    uint16_t chksum = 0;
-    const uint16_t *p = (const uint16_t *) buf;
-
-    // Length is in bytes
-    for (size_t i = 0; i < len / 2; i++ ) {
-        total += p[i];
-    }
-
-    chksum = (total & 0xFFFF) + (total >> 16);
-    chksum = ~chksum;
-
-    return chksum;
+    return ~ones_sum16(0, buf, len);
 }
 
 #if MINIP_USE_UDP_CHECKSUM
 uint16_t rfc768_chksum(struct ipv4_hdr *ipv4, struct udp_hdr *udp)
 {
-    uint32_t total = 0;
-    uint16_t chksum = 0;
-    size_t len = ntohs(udp->len);
-    uint16_t *p;
-
-    p = (uint16_t *)ipv4->src_addr;
-    total += htons(p[0]);
-    total += htons(p[1]);
-
-    p = (uint16_t *)ipv4->dst_addr;
-    total += htons(p[0]);
-    total += htons(p[1]);
-
-    p = (const uint16_t *)udp->data;
-    for (size_t i = 0; i < len / 2; i++ ) {
-        total += p[i];
-    }
-
-    total += IP_PROTO_UDP;
-    total += udp->len;
-    total += udp->src_port;
-    total += udp->dst_port;
-    total += ipv4->len;
-
-    chksum = (total & 0xFFFF) + (total >> 16);
-    chksum = ~chksum;
-
-    return chksum;
+    struct {
+        uint32_t src_addr;
+        uint32_t dst_addr;
+        uint8_t zero;
+        uint8_t proto;
+        uint16_t len;
+    } __PACKED pheader;
+    uint16_t chksum;
+
+    pheader.src_addr = ipv4->src_addr;
+    pheader.dst_addr = ipv4->dst_addr;
+    pheader.zero = 0;
+    pheader.proto = IP_PROTO_UDP;
+    pheader.len = udp->len;
+
+    chksum = ones_sum16(0, &pheader, sizeof(pheader));
+    chksum = ~ones_sum16(chksum, udp, ntohs(udp->len));
+
+    /* zero means no checksum was computed */
+    return chksum ? chksum : 0xffff;
 }
 #endif
@@ -50,6 +50,11 @@ void minip_init_dhcp(tx_func_t tx_func, void *tx_arg);
 /* packet rx hook to hand to ethernet driver */
 void minip_rx_driver_callback(pktbuf_t *p);
 
+/* what the ethernet driver can do for us, set before traffic starts */
+#define MINIP_OFFLOAD_TX_CKSUM (1<<0) /* honours PKTBUF_FLAG_CKSUM_PARTIAL */
+void minip_set_offloads(uint32_t offloads);
+uint32_t minip_get_offloads(void);
+
 /* global configuration state */
 void minip_get_macaddr(uint8_t *addr);
 void minip_set_macaddr(const uint8_t *addr);
@@ -49,6 +49,8 @@ typedef struct pktbuf {
     paddr_t phys_base;
     struct list_node list;
     u32 flags;
+    u16 csum_start;  // with CKSUM_PARTIAL, offset from buffer of the area to checksum
+    u16 csum_offset; // and of the checksum field within it
     pktbuf_free_callback cb;
     void *cb_args;
     u8 *buffer;
@@ -66,6 +68,8 @@ typedef struct pktbuf_pool_object {
 #define PKTBUF_FLAG_CKSUM_UDP_GOOD (1<<2)
 #define PKTBUF_FLAG_EOF            (1<<3)
 #define PKTBUF_FLAG_CACHED         (1<<4)
+/* the nic has to finish the checksum, the field holds the pseudo header sum */
+#define PKTBUF_FLAG_CKSUM_PARTIAL  (1<<5)
 
 /* Return the physical address offset of data in the packet */
 static inline u32 pktbuf_data_phys(pktbuf_t *p)
@@ -165,8 +165,147 @@ minip_usage:
     return 0;
 }
 
+/* the 16 bit at a time fold ones_sum16() used to be, for comparison */
+static uint16_t net_bench_sum16_ref(const void *_buf, int len)
+{
+    const uint16_t *buf = _buf;
+    uint32_t sum = 0;
+
+    while (len >= 2) {
+        sum += *buf++;
+        if (sum & 0x80000000)
+            sum = (sum & 0xffff) + (sum >> 16);
+        len -= 2;
+    }
+
+    if (len) {
+        uint16_t temp = htons((*(uint8_t *)buf) << 8);
+        sum += temp;
+    }
+
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return sum;
+}
+
+static void net_bench_report(const char *what, uint64_t bytes, lk_bigtime_t us)
+{
+    if (us == 0)
+        us = 1;
+    printf("%-10s %llu bytes in %llu us, %llu KB/s\n", what, bytes, us,
+           bytes * 1000000 / us / 1024);
+}
+
+static int net_bench_cksum(uint32_t len, uint32_t iters)
+{
+    uint8_t *buf;
+    lk_bigtime_t t;
+    uint16_t ref = 0, sum = 0;
+
+    buf = malloc(len + 1);
+    if (!buf)
+        return ERR_NO_MEMORY;
+
+    for (uint32_t i = 0; i < len + 1; i++)
+        buf[i] = rand();
+
+    /* odd start address too, packet payloads rarely are word aligned */
+    for (int off = 0; off < 2; off++) {
+        t = current_time_hires();
+        for (uint32_t i = 0; i < iters; i++)
+            ref += net_bench_sum16_ref(buf + off, len - off);
+        net_bench_report(off ? "ref+1" : "ref", (uint64_t)len * iters, current_time_hires() - t);
+
+        t = current_time_hires();
+        for (uint32_t i = 0; i < iters; i++)
+            sum += ones_sum16(0, buf + off, len - off);
+        net_bench_report(off ? "sum16+1" : "sum16", (uint64_t)len * iters, current_time_hires() - t);
+
+        if (sum != ref) {
+            printf("ERROR checksum mismatch, 0x%x != 0x%x\n", sum, ref);
+            free(buf);
+            return ERR_GENERIC;
+        }
+    }
+
+    free(buf);
+    return NO_ERROR;
+}
+
+/* accept one connection and throw away what it sends until it closes */
+static int net_bench_tcp(uint16_t port)
+{
+    tcp_socket_t *listen, *s;
+    status_t err;
+    uint8_t *buf;
+    uint64_t total = 0;
+    lk_bigtime_t t;
+
+#define BUFSIZE (64 * 1024)
+    buf = malloc(BUFSIZE);
+    if (!buf)
+        return ERR_NO_MEMORY;
+
+    err = tcp_open_listen(&listen, port);
+    if (err < 0) {
+        printf("tcp_open_listen returns %d\n", err);
+        free(buf);
+        return err;
+    }
+
+    printf("waiting on %u.%u.%u.%u:%u, e.g. 'dd if=/dev/zero bs=1M count=256 | nc <host> %u'\n",
+           IPV4_SPLIT(minip_get_ipaddr()), port, port);
+
+    err = tcp_accept(listen, &s);
+    if (err < 0) {
+        printf("tcp_accept returns %d\n", err);
+        goto out;
+    }
+
+    t = current_time_hires();
+    for (;;) {
+        ssize_t len = tcp_read(s, buf, BUFSIZE);
+        if (len <= 0)
+            break;
+        total += len;
+    }
+    net_bench_report("tcp rx", total, current_time_hires() - t);
+
+    tcp_close(s);
+out:
+    tcp_close(listen);
+    free(buf);
+#undef BUFSIZE
+    return err;
+}
+
+static int cmd_net(int argc, const cmd_args *argv)
+{
+    if (argc < 3 || strcmp(argv[1].str, "bench")) {
+net_usage:
+        printf("net bench cksum [len] [iters]   checksum speed against the 16 bit reference\n");
+        printf("net bench tcp <port>            receive throughput of one tcp connection\n");
+        return ERR_INVALID_ARGS;
+    }
+
+    if (!strcmp(argv[2].str, "cksum")) {
+        uint32_t len = (argc > 3) ? argv[3].u : 1500;
+        uint32_t iters = (argc > 4) ? argv[4].u : 10000;
+
+        if (len < 2 || iters == 0)
+            goto net_usage;
+        return net_bench_cksum(len, iters);
+    } else if (!strcmp(argv[2].str, "tcp") && argc > 3) {
+        return net_bench_tcp(argv[3].u);
+    }
+
+    goto net_usage;
+}
+
 STATIC_COMMAND_START
 STATIC_COMMAND("arp", "arp commands", &cmd_arp)
 STATIC_COMMAND("mi", "minip commands", &cmd_minip)
+STATIC_COMMAND("net", "network benchmarks", &cmd_net)
 STATIC_COMMAND_END(minip);
 #endif
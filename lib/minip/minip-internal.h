@@ -63,6 +63,13 @@ struct ipv4_hdr {
     uint8_t  data[];
 };
 
+struct udp_hdr {
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t len;
+    uint16_t chksum;
+};
+
 struct icmp_pkt {
     uint8_t  type;
     uint8_t  code;
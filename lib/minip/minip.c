@@ -53,6 +53,8 @@ static uint8_t minip_mac[6] = {0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC};
 
 static char minip_hostname[32] = "";
 
+static uint32_t minip_offloads;
+
 static void dump_mac_address(const uint8_t *mac);
 static void dump_ipv4_addr(uint32_t addr);
 
@@ -61,6 +63,16 @@ void minip_set_hostname(const char *name)
     strlcpy(minip_hostname, name, sizeof(minip_hostname));
 }
 
+void minip_set_offloads(uint32_t offloads)
+{
+    minip_offloads = offloads;
+}
+
+uint32_t minip_get_offloads(void)
+{
+    return minip_offloads;
+}
+
 const char *minip_get_hostname(void)
 {
     return minip_hostname;
@@ -18,4 +18,8 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/tcp.c \
 	$(LOCAL_DIR)/udp.c
 
+ifeq ($(ARCH),arm64)
+MODULE_DEFINES += MINIP_CHKSUM_NEON=1
+endif
+
 include make/module.mk
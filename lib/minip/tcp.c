@@ -28,6 +28,7 @@
 #include <compiler.h>
 #include <stdlib.h>
 #include <err.h>
+#include <pow2.h>
 #include <string.h>
 #include <sys/types.h>
 #include <lib/console.h>
@@ -66,6 +67,13 @@ typedef struct tcp_mss_option {
     uint16_t mss;
 } __PACKED tcp_mss_option_t;
 
+typedef struct tcp_wscale_option {
+    uint8_t nop;   /* 0x1, pads the option to a word */
+    uint8_t kind;  /* 0x3 */
+    uint8_t len;   /* 0x3 */
+    uint8_t shift;
+} __PACKED tcp_wscale_option_t;
+
 typedef enum tcp_state {
     STATE_CLOSED,
     STATE_LISTEN,
@@ -107,15 +115,17 @@ typedef struct tcp_socket {
     uint32_t rx_win_size;
     uint32_t rx_win_low;
     uint32_t rx_win_high;
+    uint8_t  rx_win_shift; // scale of the window we advertise
     uint8_t  *rx_buffer_raw;
     cbuf_t   rx_buffer;
     event_t  rx_event;
-    int      rx_full_mss_count; // number of packets we have received in a row with a full mss
+    uint     rx_full_mss_count; // number of packets we have received in a row with a full mss
     net_timer_t ack_delay_timer;
 
     /* tx */
     uint32_t tx_win_low;  // low side of the acked window
     uint32_t tx_win_high; // tx_win_low + their advertised window size
+    uint8_t  tx_win_shift; // scale of the window they advertise
     uint32_t tx_highest_seq; // highest sequence we have txed them
     uint8_t  *tx_buffer;  // our outgoing buffer
     uint32_t tx_buffer_size; // size of tx_buffer
@@ -131,9 +141,24 @@ typedef struct tcp_socket {
 } tcp_socket_t;
 
 #define DEFAULT_MSS (1460)
-#define DEFAULT_RX_WINDOW_SIZE (8192)
 #define DEFAULT_TX_BUFFER_SIZE (8192)
 
+/*
+ * receive buffer of new sockets, must be a power of two. Every accepted
+ * socket mallocs one, projects with the RAM for fast bulk transfers
+ * raise it.
+ */
+#ifndef MINIP_TCP_RX_BUFFER_SIZE
+#define MINIP_TCP_RX_BUFFER_SIZE (8192)
+#endif
+
+/* full sized segments received before an ack goes out without waiting */
+#define DEFAULT_ACK_SEGMENTS (8)
+
+/* RFC 7323 */
+#define MAX_WINDOW_SHIFT (14)
+#define MAX_UNSCALED_WINDOW (0xffff)
+
 #define RETRANSMIT_TIMEOUT (50)
 #define DELAYED_ACK_TIMEOUT (50)
 #define TIME_WAIT_TIMEOUT (60000) // 1 minute
@@ -149,6 +174,8 @@ static mutex_t tcp_socket_list_lock = MUTEX_INITIAL_VALUE(tcp_socket_list_lock);
 static struct list_node tcp_socket_list = LIST_INITIAL_VALUE(tcp_socket_list);
 
 static bool tcp_debug = false;
+static uint32_t tcp_rx_buffer_size = MINIP_TCP_RX_BUFFER_SIZE;
+static uint tcp_ack_segments = DEFAULT_ACK_SEGMENTS;
 
 /* local routines */
 static tcp_socket_t *lookup_socket(ipv4_addr remote_ip, ipv4_addr local_ip, uint16_t remote_port, uint16_t local_port);
@@ -223,16 +250,61 @@ static void dump_socket(tcp_socket_t *s)
            s, s->state, tcp_state_to_string(s->state),
            s->local_ip, s->local_port, s->remote_ip, s->remote_port, s->ref);
     if (s->state == STATE_ESTABLISHED || s->state == STATE_CLOSE_WAIT) {
-        printf("\trx: wsize %u wlo %u whi %u (%u)\n",
+        printf("\trx: wsize %u wlo %u whi %u (%u) wshift %u\n",
                s->rx_win_size, s->rx_win_low, s->rx_win_high,
-               s->rx_win_high - s->rx_win_low);
-        printf("\ttx: wlo %u whi %u (%u) highest_seq %u (%u) bufsize %u bufoff %u\n",
-               s->tx_win_low, s->tx_win_high, s->tx_win_high - s->tx_win_low,
+               s->rx_win_high - s->rx_win_low, s->rx_win_shift);
+        printf("\ttx: wlo %u whi %u (%u) wshift %u highest_seq %u (%u) bufsize %u bufoff %u\n",
+               s->tx_win_low, s->tx_win_high, s->tx_win_high - s->tx_win_low, s->tx_win_shift,
                s->tx_highest_seq, s->tx_highest_seq - s->tx_win_low,
                s->tx_buffer_size, s->tx_buffer_offset);
     }
 }
 
+/* pick out the mss and window scale options of a SYN, returns the shift or -1 if they can't scale */
+static int parse_syn_options(const tcp_header_t *header, size_t header_len, uint32_t *mss)
+{
+    const uint8_t *opt = (const uint8_t *)(header + 1);
+    size_t len = header_len - sizeof(tcp_header_t);
+    int shift = -1;
+
+    while (len > 0) {
+        if (opt[0] == 0) {
+            /* end of options */
+            break;
+        } else if (opt[0] == 1) {
+            /* nop */
+            opt++;
+            len--;
+            continue;
+        }
+
+        if (len < 2 || opt[1] < 2 || opt[1] > len)
+            break;
+
+        if (opt[0] == 2 && opt[1] == 4) {
+            *mss = (opt[2] << 8) | opt[3];
+        } else if (opt[0] == 3 && opt[1] == 3) {
+            shift = MIN(opt[2], MAX_WINDOW_SHIFT);
+        }
+
+        len -= opt[1];
+        opt += opt[1];
+    }
+
+    return shift;
+}
+
+/* smallest shift that lets the whole receive buffer be advertised */
+static uint8_t rx_window_shift(uint32_t win_size)
+{
+    uint8_t shift = 0;
+
+    while (shift < MAX_WINDOW_SHIFT && (win_size >> shift) > MAX_UNSCALED_WINDOW)
+        shift++;
+
+    return shift;
+}
+
 static tcp_socket_t *lookup_socket(ipv4_addr remote_ip, ipv4_addr local_ip, uint16_t remote_port, uint16_t local_port)
 {
     LTRACEF("remote ip 0x%x local ip 0x%x remote port %u local port %u\n", remote_ip, local_ip, remote_port, local_port);
@@ -447,8 +519,12 @@ void tcp_input(pktbuf_t *p, uint32_t src_ip, uint32_t dst_ip)
 
             /* make a new accept socket */
             tcp_socket_t *accept_socket = create_tcp_socket(true);
-            if (!accept_socket)
+            if (!accept_socket) {
+                /* out of memory, refuse the connection instead of going silent */
+                tcp_send(src_ip, header->source_port, dst_ip, header->dest_port,
+                         NULL, 0, PKT_RST | PKT_ACK, NULL, 0, header->seq_num + 1, 0, 0);
                 goto done;
+            }
 
             /* set it up */
             accept_socket->local_ip = minip_get_ipaddr();
@@ -465,18 +541,35 @@ void tcp_input(pktbuf_t *p, uint32_t src_ip, uint32_t dst_ip)
             accept_socket->rx_win_low = header->seq_num + 1;
             accept_socket->rx_win_high = accept_socket->rx_win_low + accept_socket->rx_win_size - 1;
 
+            /* window scaling is only used if both sides offer it */
+            uint32_t their_mss = s->mss;
+            int their_shift = parse_syn_options(header, header_len, &their_mss);
+            accept_socket->mss = MIN(s->mss, their_mss);
+            if (their_shift >= 0) {
+                accept_socket->tx_win_shift = their_shift;
+                accept_socket->rx_win_shift = rx_window_shift(accept_socket->rx_win_size);
+            }
+
             /* save this socket and wake anyone up that is waiting to accept */
             s->accepted = accept_socket;
             sem_post(&s->accept_sem, true);
 
-            /* set up a mss option for sending back */
-            tcp_mss_option_t mss_option;
-            mss_option.kind = 0x2;
-            mss_option.len = 0x4;
-            mss_option.mss = ntohs(s->mss); // XXX make sure we fit in their mss
+            /* set up the mss and window scale options for sending back */
+            struct {
+                tcp_mss_option_t mss;
+                tcp_wscale_option_t wscale;
+            } __PACKED syn_options;
+            syn_options.mss.kind = 0x2;
+            syn_options.mss.len = 0x4;
+            syn_options.mss.mss = htons(s->mss);
+            syn_options.wscale.nop = 0x1;
+            syn_options.wscale.kind = 0x3;
+            syn_options.wscale.len = 0x3;
+            syn_options.wscale.shift = accept_socket->rx_win_shift;
 
             /* send a response */
-            tcp_socket_send(accept_socket, NULL, 0, PKT_ACK|PKT_SYN, &mss_option, sizeof(mss_option),
+            tcp_socket_send(accept_socket, NULL, 0, PKT_ACK|PKT_SYN, &syn_options,
+                            (their_shift >= 0) ? sizeof(syn_options) : sizeof(syn_options.mss),
                             accept_socket->tx_win_low);
 
             /* SYN consumed a sequence */
@@ -498,7 +591,7 @@ void tcp_input(pktbuf_t *p, uint32_t src_ip, uint32_t dst_ip)
                     goto send_reset;
                 }
 
-                s->tx_win_high = s->tx_win_low + header->win_size;
+                s->tx_win_high = s->tx_win_low + ((uint32_t)header->win_size << s->tx_win_shift);
                 s->tx_highest_seq = s->tx_win_low;
 
                 s->state = STATE_ESTABLISHED;
@@ -511,7 +604,7 @@ void tcp_input(pktbuf_t *p, uint32_t src_ip, uint32_t dst_ip)
         case STATE_ESTABLISHED:
             if (packet_flags & PKT_ACK) {
                 /* they're acking us */
-                handle_ack(s, header->ack_num, header->win_size);
+                handle_ack(s, header->ack_num, (uint32_t)header->win_size << s->tx_win_shift);
             }
 
             if (data_len > 0) {
@@ -537,7 +630,7 @@ void tcp_input(pktbuf_t *p, uint32_t src_ip, uint32_t dst_ip)
         case STATE_CLOSE_WAIT:
             if (packet_flags & PKT_ACK) {
                 /* they're acking us */
-                handle_ack(s, header->ack_num, header->win_size);
+                handle_ack(s, header->ack_num, (uint32_t)header->win_size << s->tx_win_shift);
             }
             if (packet_flags & PKT_FIN) {
                 /* they must have missed our ack, ack them again */
@@ -630,7 +723,7 @@ static void handle_data(tcp_socket_t *s, const void *data, size_t len, uint32_t
         /* it intersects the bottom of our window, so it's in order */
 
         /* copy the data we need to our cbuf */
-        size_t offset = sequence - s->rx_win_low;
+        size_t offset = s->rx_win_low - sequence;
         size_t copy_len = MIN(s->rx_win_high - s->rx_win_low, len - offset);
 
         DEBUG_ASSERT(offset < len);
@@ -649,8 +742,11 @@ static void handle_data(tcp_socket_t *s, const void *data, size_t len, uint32_t
             s->rx_full_mss_count = 0;
         }
 
-        /* immediately ack if we're more than halfway into our buffer or they've sent 2 or more full packets */
-        if (s->rx_full_mss_count >= 2 ||
+        /*
+         * immediately ack if we're more than halfway into our buffer or they've sent a batch of
+         * full packets, a bulk sender then sees one ack per batch instead of one per two segments
+         */
+        if (s->rx_full_mss_count >= tcp_ack_segments ||
                 (int)(s->rx_win_low + s->rx_win_size - s->rx_win_high) > (int)s->rx_win_size / 2) {
             send_ack(s);
             s->rx_full_mss_count = 0;
@@ -679,16 +775,19 @@ static status_t tcp_socket_send(tcp_socket_t *s, const void *data, size_t len, t
     LTRACEF("rx_win_low %u rx_win_size %u read_buf_len %zu, new win high %u\n",
             s->rx_win_low, s->rx_win_size, cbuf_space_used(&s->rx_buffer), rx_win_high);
 
-    uint16_t win_size;
+    // if the window size has shrunk we can't move the
+    // right edge of the window backwards
     if (SEQUENCE_GTE(rx_win_high, s->rx_win_high)) {
         s->rx_win_high = rx_win_high;
-        win_size = rx_win_high - s->rx_win_low;
-    } else {
-        // the window size has shrunk, but we can't move the
-        // right edge of the window backwards
-        win_size = s->rx_win_high - s->rx_win_low;
     }
 
+    // the window of a SYN is never scaled
+    uint32_t win_size = s->rx_win_high - s->rx_win_low;
+    if (!(flags & PKT_SYN)) {
+        win_size >>= s->rx_win_shift;
+    }
+    win_size = MIN(win_size, MAX_UNSCALED_WINDOW);
+
     // we are piggybacking a pending ACK, so clear the delayed ACK timer
     if (flags & PKT_ACK) {
         tcp_timer_cancel(s, &s->ack_delay_timer);
@@ -741,16 +840,20 @@ static status_t tcp_send(ipv4_addr dest_ip, uint16_t dest_port, ipv4_addr src_ip
     if (len > 0)
         pktbuf_append_data(p, buf, len);
 
-    /* compute the checksum */
-    /* XXX get the tx ckecksum capability from the nic */
-    if (FORCE_TCP_CHECKSUM || true) {
-        tcp_pseudo_header_t pheader;
-        pheader.source_addr = src_ip;
-        pheader.dest_addr = dest_ip;
-        pheader.zero = 0;
-        pheader.protocol = IP_PROTO_TCP;
-        pheader.tcp_length = htons(p->dlen);
-
+    /* compute the checksum, or leave it to the nic */
+    tcp_pseudo_header_t pheader;
+    pheader.source_addr = src_ip;
+    pheader.dest_addr = dest_ip;
+    pheader.zero = 0;
+    pheader.protocol = IP_PROTO_TCP;
+    pheader.tcp_length = htons(p->dlen);
+
+    if (!FORCE_TCP_CHECKSUM && (minip_get_offloads() & MINIP_OFFLOAD_TX_CKSUM)) {
+        header->checksum = ones_sum16(0, &pheader, sizeof(pheader));
+        p->flags |= PKTBUF_FLAG_CKSUM_PARTIAL;
+        p->csum_start = (uint8_t *)header - p->buffer;
+        p->csum_offset = offsetof(tcp_header_t, checksum);
+    } else {
         header->checksum = cksum_pheader(&pheader, p->data, p->dlen);
     }
 
@@ -950,14 +1053,16 @@ static tcp_socket_t *create_tcp_socket(bool alloc_buffers)
     tcp_socket_t *s;
 
     s = calloc(1, sizeof(tcp_socket_t));
-    if (!s)
+    if (!s) {
+        TRACEF("failed to allocate socket\n");
         return NULL;
+    }
 
     mutex_init(&s->lock);
     s->ref = 1; // start with the ref already bumped
 
     s->state = STATE_CLOSED;
-    s->rx_win_size = DEFAULT_RX_WINDOW_SIZE;
+    s->rx_win_size = tcp_rx_buffer_size;
     event_init(&s->rx_event, false, 0);
 
     s->mss = DEFAULT_MSS;
@@ -968,12 +1073,20 @@ static tcp_socket_t *create_tcp_socket(bool alloc_buffers)
     event_init(&s->tx_event, true, 0);
 
     if (alloc_buffers) {
-        // XXX check for error
         s->rx_buffer_raw = malloc(s->rx_win_size);
-        cbuf_initialize_etc(&s->rx_buffer, s->rx_win_size, s->rx_buffer_raw);
-
         s->tx_buffer_size = DEFAULT_TX_BUFFER_SIZE;
         s->tx_buffer = malloc(s->tx_buffer_size);
+        if (!s->rx_buffer_raw || !s->tx_buffer) {
+            TRACEF("failed to allocate %u byte receive buffer\n", s->rx_win_size);
+            event_destroy(&s->tx_event);
+            event_destroy(&s->rx_event);
+            free(s->rx_buffer_raw);
+            free(s->tx_buffer);
+            free(s);
+            return NULL;
+        }
+
+        cbuf_initialize_etc(&s->rx_buffer, s->rx_win_size, s->rx_buffer_raw);
     }
 
     sem_init(&s->accept_sem, 0);
@@ -1233,6 +1346,8 @@ usage:
         printf("usage: %s listenclose <port>\n", argv[0].str);
         printf("usage: %s listen <port>\n", argv[0].str);
         printf("usage: %s debug\n", argv[0].str);
+        printf("usage: %s rxbuf [bytes]\n", argv[0].str);
+        printf("usage: %s acks [segments]\n", argv[0].str);
         return ERR_INVALID_ARGS;
     }
 
@@ -1299,6 +1414,23 @@ usage:
     } else if (!strcmp(argv[1].str, "debug")) {
         tcp_debug = !tcp_debug;
         printf("tcp debug now %u\n", tcp_debug);
+    } else if (!strcmp(argv[1].str, "rxbuf")) {
+        /* applies to sockets accepted from now on */
+        if (argc >= 3) {
+            if (argv[2].u < 2 * DEFAULT_MSS) {
+                printf("ERROR receive buffer must be at least %u bytes\n", 2 * DEFAULT_MSS);
+                return ERR_INVALID_ARGS;
+            }
+            tcp_rx_buffer_size = 1U << log2_uint(argv[2].u);
+            if (tcp_rx_buffer_size < argv[2].u)
+                tcp_rx_buffer_size <<= 1;
+        }
+        printf("tcp receive buffer %u bytes, window shift %u\n",
+               tcp_rx_buffer_size, rx_window_shift(tcp_rx_buffer_size));
+    } else if (!strcmp(argv[1].str, "acks")) {
+        if (argc >= 3)
+            tcp_ack_segments = MAX(argv[2].u, 1U);
+        printf("tcp acks every %u full segments\n", tcp_ack_segments);
     } else {
         printf("ERROR unknown command\n");
         goto usage;
@@ -51,13 +51,6 @@ typedef struct udp_socket {
     const uint8_t *mac;
 } udp_socket_t;
 
-typedef struct udp_hdr {
-    uint16_t src_port;
-    uint16_t dst_port;
-    uint16_t len;
-    uint16_t chksum;
-} __PACKED udp_hdr_t;
-
 
 int udp_listen(uint16_t port, udp_callback_t cb, void *arg)
 {
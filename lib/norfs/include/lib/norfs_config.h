@@ -45,4 +45,19 @@
 
 #define NORFS_DELETED_MASK 1
 
+/*
+ * Checkpoints of the index are kept in pages following the blocks.  The
+ * bank has to have room for them past the blocks, mount goes without
+ * checkpoints otherwise.
+ */
+#define NORFS_CHECKPOINT_SLOTS 2
+#define NORFS_CHECKPOINT_OFFSET NORFS_NVRAM_SIZE
+#define NORFS_CHECKPOINT_SIZE (FLASH_PAGE_SIZE * NORFS_CHECKPOINT_SLOTS)
+/*
+ * Bytes of objects put between checkpoints, bounds what mount has to replay.
+ * Writing this much wears the blocks by about one erase each, the same as
+ * the checkpoint wears each of its slots.
+ */
+#define NORFS_CHECKPOINT_BYTES (FLASH_PAGE_SIZE * NORFS_NUM_BLOCKS / NORFS_CHECKPOINT_SLOTS)
+
 #endif
@@ -63,6 +63,33 @@ struct norfs_header {
     uint16_t crc;
 };
 
+/*
+ * Checkpoint of the inode list.  Every object in a block up to block_end was
+ * written before the checkpoint, mount only replays what follows.  Blocks
+ * free at the time have a block_end of 0.  Checkpoints are invalidated
+ * before any block is erased, so the objects they point to stay in place.
+ */
+#define NORFS_CHECKPOINT_MAGIC 0x504b434e /* "NCKP" */
+
+struct norfs_checkpoint {
+    uint32_t magic;
+    /* crc32 of everything following it, entries included. */
+    uint32_t crc;
+    uint32_t generation;
+    uint32_t count;
+    uint32_t total_remaining_space;
+    uint32_t block_end[NORFS_NUM_BLOCKS];
+};
+
+struct norfs_checkpoint_entry {
+    uint32_t location;
+    uint32_t reference_count;
+};
+
+#define NORFS_CHECKPOINT_MAX_ENTRIES ((FLASH_PAGE_SIZE - \
+            sizeof(struct norfs_checkpoint)) / \
+        sizeof(struct norfs_checkpoint_entry))
+
 /* Block header written after successful erase. */
 FRIEND_TEST const unsigned char NORFS_BLOCK_HEADER[4] = {'T', 'O', 'F', 'U'};
 /* Block header to indicate garbage collection has started. */
@@ -81,8 +108,17 @@ static struct list_node inode_list;
 
 static bool block_free[NORFS_NUM_BLOCKS];
 
+/* Slot of the valid checkpoint, -1 if there is none. */
+static int8_t checkpoint_slot = -1;
+/* The checkpoint slots fit in the bank after the blocks. */
+static bool checkpoints_fit;
+static uint32_t checkpoint_generation;
+FRIEND_TEST uint32_t bytes_since_checkpoint;
+
 static status_t collect_garbage(void);
 static status_t load_and_verify_obj(uint32_t *ptr, struct norfs_header *header);
+static status_t write_checkpoint(void);
+static void invalidate_checkpoints(void);
 
 FRIEND_TEST uint8_t block_num(uint32_t flash_pointer)
 {
@@ -614,6 +650,12 @@ status_t norfs_put_obj_iovec(uint32_t key, const iovec_t *iov,
         initialize_next_block(&write_pointer);
     }
 
+    if (!status) {
+        bytes_since_checkpoint += NORFS_FLASH_SIZE(len);
+        if (bytes_since_checkpoint >= NORFS_CHECKPOINT_BYTES)
+            write_checkpoint();
+    }
+
     flash_nor_end(NORFS_BANK);
     return status;
 }
@@ -694,6 +736,8 @@ static status_t erase_block(uint8_t block)
         return status;
     }
 
+    invalidate_checkpoints();
+
     bytes_erased = nvram_erase_pages(loc, FLASH_PAGE_SIZE);
     if (bytes_erased != FLASH_PAGE_SIZE) {
         flash_nor_end(NORFS_BANK);
@@ -831,7 +875,7 @@ status_t read_block_verification(uint32_t *ptr)
 
 static status_t mount_next_obj(void)
 {
-    uint16_t curr_obj_loc;
+    uint32_t curr_obj_loc;
     uint16_t inode_version, inode_len;
     curr_obj_loc = write_pointer;
     struct norfs_inode *inode;
@@ -886,44 +930,285 @@ static void purge_unreferenced_inodes(void)
     }
 }
 
-status_t norfs_mount_fs(uint32_t offset)
+static void remove_all_inodes(void)
 {
-    if (fs_mounted) {
-        TRACEF("Filesystem already mounted.\n");
-        return ERR_ALREADY_MOUNTED;
+    struct list_node *curr_lnode, *temp_node;
+    struct norfs_inode *curr_inode;
+    list_for_every_safe(&inode_list, curr_lnode, temp_node) {
+        curr_inode = containerof(curr_lnode, struct norfs_inode, lnode);
+        remove_inode(curr_inode);
     }
-    status_t status = 0;
-    norfs_nvram_offset = offset;
+}
 
-    list_initialize(&inode_list);
-    flash_nor_begin(NORFS_BANK);
-    srand(current_time());
+static uint32_t checkpoint_location(uint8_t slot)
+{
+    return NORFS_CHECKPOINT_OFFSET + slot * FLASH_PAGE_SIZE;
+}
+
+static uint32_t checkpoint_crc(const struct norfs_checkpoint *cp,
+                               const struct norfs_checkpoint_entry *entries)
+{
+    uint32_t crc = crc32(0, (const unsigned char *)&cp->generation,
+                         sizeof(*cp) - offsetof(struct norfs_checkpoint, generation));
+    return crc32(crc, (const unsigned char *)entries, cp->count * sizeof(*entries));
+}
+
+/* Return the checkpoint in a slot if it is intact, otherwise NULL. */
+static const struct norfs_checkpoint *verify_checkpoint(uint8_t slot)
+{
+    const struct norfs_checkpoint *cp;
+    cp = (const struct norfs_checkpoint *)nvram_flash_pointer(checkpoint_location(slot));
+
+    if (cp->magic != NORFS_CHECKPOINT_MAGIC ||
+            cp->count > NORFS_CHECKPOINT_MAX_ENTRIES) {
+        return NULL;
+    }
+    if (checkpoint_crc(cp, (const struct norfs_checkpoint_entry *)(cp + 1)) != cp->crc) {
+        TRACEF("Checkpoint in slot %d failed CRC check.\n", slot);
+        return NULL;
+    }
+    return cp;
+}
+
+static void invalidate_checkpoints(void)
+{
+    uint32_t zero = 0;
+    for (uint8_t slot = 0; checkpoints_fit && slot < NORFS_CHECKPOINT_SLOTS; slot++) {
+        if (verify_checkpoint(slot)) {
+            nvram_write(checkpoint_location(slot), sizeof(zero), &zero);
+        }
+    }
+    checkpoint_slot = -1;
+}
+
+/*
+ * Write the inode list to the slot not holding the current checkpoint, then
+ * invalidate the current one.  If the list does not fit, mount keeps
+ * replaying from the previous checkpoint.
+ */
+static status_t write_checkpoint(void)
+{
+    struct norfs_checkpoint *cp;
+    struct norfs_checkpoint_entry *entries;
+    struct norfs_inode *inode;
+    struct list_node *curr_lnode;
+    uint32_t count = 0;
+    uint32_t zero = 0;
+    uint8_t slot;
+    ssize_t bytes;
+    size_t len;
+
+    if (!checkpoints_fit) {
+        bytes_since_checkpoint = 0;
+        return ERR_NOT_SUPPORTED;
+    }
+
+    list_for_every(&inode_list, curr_lnode) {
+        count++;
+    }
+    if (count > NORFS_CHECKPOINT_MAX_ENTRIES) {
+        TRACEF("Too many objects to checkpoint: %d\n", count);
+        /* Retry after another interval, not on every put. */
+        bytes_since_checkpoint = 0;
+        return ERR_TOO_BIG;
+    }
+
+    len = sizeof(*cp) + count * sizeof(*entries);
+    cp = malloc(len);
+    if (!cp)
+        return ERR_NO_MEMORY;
+    entries = (struct norfs_checkpoint_entry *)(cp + 1);
+
+    cp->magic = NORFS_CHECKPOINT_MAGIC;
+    cp->generation = checkpoint_generation + 1;
+    cp->count = count;
+    cp->total_remaining_space = total_remaining_space;
+    /* Only the block being written grows, the others are never appended to. */
+    for (uint8_t i = 0; i < NORFS_NUM_BLOCKS; i++) {
+        if (block_free[i])
+            cp->block_end[i] = 0;
+        else if (i == block_num(write_pointer))
+            cp->block_end[i] = write_pointer;
+        else
+            cp->block_end[i] = (i + 1) * FLASH_PAGE_SIZE;
+    }
+    count = 0;
+    list_for_every(&inode_list, curr_lnode) {
+        inode = containerof(curr_lnode, struct norfs_inode, lnode);
+        entries[count].location = inode->location;
+        entries[count].reference_count = inode->reference_count;
+        count++;
+    }
+    cp->crc = checkpoint_crc(cp, entries);
+
+    /* Rotate by generation, not by the current slot: that is gone after
+     * garbage collection and would put every checkpoint in slot 0. */
+    slot = cp->generation % NORFS_CHECKPOINT_SLOTS;
+    if (slot == checkpoint_slot)
+        slot = (slot + 1) % NORFS_CHECKPOINT_SLOTS;
+    bytes = nvram_erase_pages(checkpoint_location(slot), FLASH_PAGE_SIZE);
+    if (bytes != FLASH_PAGE_SIZE) {
+        TRACEF("Failed to erase checkpoint slot %d.\n", slot);
+        free(cp);
+        return ERR_IO;
+    }
+
+    /* Magic goes last, a torn checkpoint is never mistaken for one. */
+    bytes = nvram_write(checkpoint_location(slot) + sizeof(cp->magic),
+                        len - sizeof(cp->magic), &cp->crc);
+    if (bytes >= 0) {
+        bytes = nvram_write(checkpoint_location(slot), sizeof(cp->magic),
+                            &cp->magic);
+    }
+    free(cp);
+    if (bytes < 0) {
+        TRACEF("Failed to write checkpoint.  Status: %d\n", bytes);
+        return bytes;
+    }
+
+    if (checkpoint_slot >= 0) {
+        nvram_write(checkpoint_location(checkpoint_slot), sizeof(zero), &zero);
+    }
+    checkpoint_slot = slot;
+    checkpoint_generation++;
+    bytes_since_checkpoint = 0;
+
+    return NO_ERROR;
+}
+
+/* Load the inode list of the newest intact checkpoint. */
+static status_t load_checkpoint(struct norfs_checkpoint *cp)
+{
+    const struct norfs_checkpoint *stored = NULL;
+    const struct norfs_checkpoint *curr;
+    const struct norfs_checkpoint_entry *entries;
+    struct norfs_inode *inode;
+
+    checkpoint_slot = -1;
+    if (!checkpoints_fit)
+        return ERR_NOT_FOUND;
+
+    for (uint8_t slot = 0; slot < NORFS_CHECKPOINT_SLOTS; slot++) {
+        curr = verify_checkpoint(slot);
+        if (curr && (!stored ||
+                     (int32_t)(curr->generation - stored->generation) > 0)) {
+            stored = curr;
+            checkpoint_slot = slot;
+        }
+    }
+    if (!stored)
+        return ERR_NOT_FOUND;
+
+    memcpy(cp, stored, sizeof(*cp));
+    checkpoint_generation = cp->generation;
+
+    entries = (const struct norfs_checkpoint_entry *)(stored + 1);
+    for (uint32_t i = 0; i < cp->count; i++) {
+        inode = malloc(sizeof(struct norfs_inode));
+        if (!inode) {
+            remove_all_inodes();
+            return ERR_NO_MEMORY;
+        }
+        inode->location = entries[i].location;
+        inode->reference_count = entries[i].reference_count;
+        list_add_tail(&inode_list, &inode->lnode);
+    }
+    total_remaining_space = cp->total_remaining_space;
+
+    return NO_ERROR;
+}
+
+/*
+ * Verify every block and mount the objects in it, starting past the ones the
+ * checkpoint already holds.  What is replayed counts towards the next
+ * checkpoint.  Fails with ERR_NOT_VALID if the blocks do not match the
+ * checkpoint.
+ */
+static status_t mount_blocks(const struct norfs_checkpoint *cp,
+                             uint32_t *mounted)
+{
+    status_t status;
+    uint32_t start;
 
-    total_remaining_space = NORFS_AVAILABLE_SPACE;
-    num_free_blocks = 0;
-    TRACEF("Mounting NOR file system.\n");
     for (uint8_t i = 0; i < NORFS_NUM_BLOCKS; i++) {
         write_pointer = i * FLASH_PAGE_SIZE;
         status = read_block_verification(&write_pointer);
         if (status == ERR_BAD_STATE) {
+            if (cp && cp->block_end[i])
+                return ERR_NOT_VALID;
             erase_block(i);
             continue;
         } else if (status == ERR_NOT_CONFIGURED) {
+            if (cp && cp->block_end[i])
+                return ERR_NOT_VALID;
             /* Valid empty block. */
             block_free[i] = true;
             num_free_blocks++;
             continue;
         } else if (status != NO_ERROR) {
             TRACEF("Unexpected status: %d.  Exiting.\n", status);
-            flash_nor_end(NORFS_BANK);
             return status;
         }
         block_free[i] = false;
+        if (cp && cp->block_end[i] > write_pointer)
+            write_pointer = cp->block_end[i];
+        start = write_pointer;
         while (!block_full(i, write_pointer)) {
             status = mount_next_obj();
             if (status)
                 break;
+            (*mounted)++;
         }
+        bytes_since_checkpoint += write_pointer - start;
+    }
+    return NO_ERROR;
+}
+
+status_t norfs_mount_fs(uint32_t offset)
+{
+    if (fs_mounted) {
+        TRACEF("Filesystem already mounted.\n");
+        return ERR_ALREADY_MOUNTED;
+    }
+    status_t status = 0;
+    struct norfs_checkpoint cp;
+    bool checkpointed;
+    uint32_t mounted = 0;
+    const struct flash_nor_bank *bank;
+    norfs_nvram_offset = offset;
+
+    /* A bank laid out before checkpoints may end right after the blocks,
+     * then every mount scans all objects.
+     */
+    bank = flash_nor_get_bank(NORFS_BANK);
+    checkpoints_fit = bank &&
+                      offset + NORFS_NVRAM_SIZE + NORFS_CHECKPOINT_SIZE <= bank->len;
+    if (!checkpoints_fit)
+        TRACEF("No room for checkpoints after the blocks.\n");
+
+    list_initialize(&inode_list);
+    flash_nor_begin(NORFS_BANK);
+    srand(current_time());
+
+    total_remaining_space = NORFS_AVAILABLE_SPACE;
+    num_free_blocks = 0;
+    bytes_since_checkpoint = 0;
+    TRACEF("Mounting NOR file system.\n");
+    checkpointed = load_checkpoint(&cp) == NO_ERROR;
+    status = mount_blocks(checkpointed ? &cp : NULL, &mounted);
+    if (status == ERR_NOT_VALID) {
+        TRACEF("Checkpoint does not match flash, scanning all objects.\n");
+        remove_all_inodes();
+        total_remaining_space = NORFS_AVAILABLE_SPACE;
+        num_free_blocks = 0;
+        bytes_since_checkpoint = 0;
+        checkpointed = false;
+        status = mount_blocks(NULL, &mounted);
+    }
+    if (status) {
+        remove_all_inodes();
+        flash_nor_end(NORFS_BANK);
+        return status;
     }
 
     purge_unreferenced_inodes();
@@ -936,7 +1221,14 @@ status_t norfs_mount_fs(uint32_t offset)
         return status;
     }
 
-    TRACEF("NOR filesystem successfully mounted.\n");
+    /* Replace a missing checkpoint, or one that leaves more to replay than
+     * puts would before writing the next. */
+    if (!checkpointed || checkpoint_slot < 0 ||
+            bytes_since_checkpoint >= NORFS_CHECKPOINT_BYTES)
+        write_checkpoint();
+
+    TRACEF("NOR filesystem successfully mounted, %s, %d objects replayed.\n",
+           checkpointed ? "from checkpoint" : "full scan", mounted);
     flash_nor_end(NORFS_BANK);
     fs_mounted = true;
     return NO_ERROR;
@@ -945,22 +1237,17 @@ status_t norfs_mount_fs(uint32_t offset)
 void norfs_unmount_fs(void)
 {
     TRACEF("Unmounting NOR file system\n");
-    struct list_node *curr_lnode;
-    struct norfs_inode *curr_inode;
-    struct list_node *temp_node;
 
     if (!fs_mounted) {
         TRACEF("Filesystem not mounted.\n");
         return;
     }
-    if (!list_is_empty(&inode_list)) {
-        list_for_every_safe(&inode_list, curr_lnode, temp_node) {
-            if (curr_lnode) {
-                curr_inode = containerof(curr_lnode, struct norfs_inode, lnode);
-                remove_inode(curr_inode);
-            }
-        }
+    if (bytes_since_checkpoint) {
+        flash_nor_begin(NORFS_BANK);
+        write_checkpoint();
+        flash_nor_end(NORFS_BANK);
     }
+    remove_all_inodes();
     write_pointer = rand() % NORFS_NVRAM_SIZE;
     total_remaining_space = NORFS_AVAILABLE_SPACE;
     num_free_blocks = 0;
@@ -974,7 +1261,8 @@ void norfs_wipe_fs(void)
 {
     norfs_unmount_fs();
     flash_nor_begin(0);
-    nvram_erase_pages(0, 8 * FLASH_PAGE_SIZE);
+    nvram_erase_pages(0, NORFS_NVRAM_SIZE +
+                      (checkpoints_fit ? NORFS_CHECKPOINT_SIZE : 0));
     flash_nor_end(0);
     norfs_mount_fs(norfs_nvram_offset);
 }
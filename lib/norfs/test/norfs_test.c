@@ -35,6 +35,7 @@
 
 extern uint32_t total_remaining_space;
 extern uint8_t num_free_blocks;
+extern uint32_t bytes_since_checkpoint;
 
 static uint8_t *norfs_test_bank;
 static uint8_t norfs_test_bank_len;
@@ -711,6 +712,81 @@ static void init_tests(void)
     wipe_fs();
 }
 
+static bool check_checkpoint_objects(uint32_t count)
+{
+    BEGIN_TEST;
+    uint32_t value;
+    size_t bytes_read;
+    status_t status;
+
+    status = norfs_read_obj(0, (unsigned char *)&value, sizeof(value),
+                            &bytes_read, 0);
+    EXPECT_EQ(NO_ERROR, status, "Object put after checkpoint not found");
+    EXPECT_EQ(0xabcd, value, "Object put after checkpoint not current");
+    status = norfs_read_obj(1, (unsigned char *)&value, sizeof(value),
+                            &bytes_read, 0);
+    EXPECT_EQ(ERR_NOT_FOUND, status,
+              "Object removed after checkpoint still found");
+    for (uint32_t key = 2; key < count; key++) {
+        status = norfs_read_obj(key, (unsigned char *)&value, sizeof(value),
+                                &bytes_read, 0);
+        EXPECT_EQ(NO_ERROR, status, "Object not found");
+        EXPECT_EQ(key * 3, value, "Object not correct value");
+    }
+    END_TEST;
+}
+
+static bool test_checkpoint_mount(void)
+{
+    BEGIN_TEST;
+    /* Leave room in a checkpoint page for every inode. */
+    uint32_t count = MIN(2000, NORFS_AVAILABLE_SPACE / NORFS_FLASH_SIZE(4) / 4);
+    uint32_t value;
+    uint32_t zero = 0;
+    status_t status;
+    lk_bigtime_t t;
+
+    wipe_fs();
+    norfs_mount_fs(norfs_nvram_offset);
+    for (uint32_t key = 0; key < count; key++) {
+        value = key * 3;
+        status = norfs_put_obj(key, (unsigned char *)&value, sizeof(value), 0);
+        EXPECT_EQ(NO_ERROR, status, "Failed to put object");
+    }
+    norfs_unmount_fs();
+
+    t = current_time_hires();
+    EXPECT_EQ(NO_ERROR, norfs_mount_fs(norfs_nvram_offset), "Error during mount");
+    t = current_time_hires() - t;
+    printf("\n%u objects, mount from checkpoint: %llu us\n", count, t);
+
+    /* Lose power before the next checkpoint, mount replays these. */
+    value = 0xabcd;
+    status = norfs_put_obj(0, (unsigned char *)&value, sizeof(value), 0);
+    EXPECT_EQ(NO_ERROR, status, "Failed to put object");
+    EXPECT_EQ(NO_ERROR, norfs_remove_obj(1), "Failed to remove object");
+    bytes_since_checkpoint = 0;
+    norfs_unmount_fs();
+
+    EXPECT_EQ(NO_ERROR, norfs_mount_fs(norfs_nvram_offset), "Error during mount");
+    EXPECT_TRUE(check_checkpoint_objects(count), "Replay after checkpoint failed");
+    norfs_unmount_fs();
+
+    /* Without a valid checkpoint mount falls back to scanning everything. */
+    for (uint8_t slot = 0; slot < NORFS_CHECKPOINT_SLOTS; slot++) {
+        flash_nor_write(0, norfs_nvram_offset + NORFS_CHECKPOINT_OFFSET +
+                        slot * FLASH_PAGE_SIZE, sizeof(zero), &zero);
+    }
+    t = current_time_hires();
+    EXPECT_EQ(NO_ERROR, norfs_mount_fs(norfs_nvram_offset), "Error during mount");
+    t = current_time_hires() - t;
+    printf("%u objects, mount scanning all objects: %llu us\n", count, t);
+    EXPECT_TRUE(check_checkpoint_objects(count), "Full scan after checkpoint failed");
+
+    wipe_fs();
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(norfs_tests);
 init_tests();
 RUN_TEST(test_basic_read_write);
@@ -723,4 +799,5 @@ RUN_TEST(test_total_remaining_space);
 RUN_TEST(test_thrash_fs);
 RUN_TEST(test_wrapping);
 RUN_TEST(test_overflow_filesystem);
+RUN_TEST(test_checkpoint_mount);
 END_TEST_CASE(norfs_tests);
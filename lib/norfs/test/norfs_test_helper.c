@@ -22,6 +22,7 @@
  */
 #include <norfs_test_helper.h>
 #include <lib/norfs.h>
+#include <lib/norfs_config.h>
 #include <dev/flash_nor.h>
 #include <platform/flash_nor_config.h>
 #include <debug.h>
@@ -44,6 +45,7 @@ void wipe_fs(void)
 {
     norfs_unmount_fs();
     flash_nor_begin(0);
-    flash_nor_erase_pages(0, 0 + norfs_nvram_offset, 8 * FLASH_PAGE_SIZE);
+    flash_nor_erase_pages(0, 0 + norfs_nvram_offset,
+                          NORFS_NVRAM_SIZE + NORFS_CHECKPOINT_SIZE);
     flash_nor_end(0);
 }
@@ -36,11 +36,23 @@
 
 /* implementation of system parameter block, stored on a block device */
 /* sysparams are simple name/value pairs, with the data unstructured */
+
+/*
+ * The block is a log: changed parameters are appended as new records and
+ * removed ones as tombstones, a later record of a name replaces the earlier
+ * ones when the log is scanned. The area is only erased and rewritten with
+ * the live parameters once the log reaches its end.
+ */
 #define LOCAL_TRACE 0
 
 #define SYSPARAM_MAGIC 'SYSP'
 
 #define SYSPARAM_FLAG_LOCK 0x1
+#define SYSPARAM_FLAG_DELETED 0x2 /* tombstone, no data */
+
+#ifndef SYSPARAM_HASH_BUCKETS
+#define SYSPARAM_HASH_BUCKETS 64
+#endif
 
 struct sysparam_phys {
     uint32_t magic;
@@ -60,9 +72,15 @@ struct sysparam_phys {
 /* a copy we keep in memory */
 struct sysparam {
     struct list_node node;
+    struct sysparam *hash_next;
 
     uint32_t flags;
 
+    /* not written since it changed */
+    bool dirty;
+    /* the log has a live record of this name, if only an older one */
+    bool stored;
+
     char *name;
 
     size_t datalen;
@@ -75,17 +93,29 @@ struct sysparam {
 /* global state */
 static struct {
     struct list_node list;
+    struct sysparam *hash[SYSPARAM_HASH_BUCKETS];
+
+    /* tombstones of removed parameters, not written yet */
+    struct list_node deleted;
 
     bool dirty;
 
     bdev_t *bdev;
     off_t offset;
     size_t len;
+
+    /* end of the log, where the next records go */
+    size_t tail;
+    /* everything past the tail is erased, so it can be appended to */
+    bool tail_clean;
+
+    struct sysparam_stats stats;
 } params;
 
 static void sysparam_init(uint level)
 {
     list_initialize(&params.list);
+    list_initialize(&params.deleted);
 }
 
 LK_INIT_HOOK(sysparam, &sysparam_init, LK_INIT_LEVEL_THREADING);
@@ -116,13 +146,55 @@ static inline uint32_t sysparam_crc32(const struct sysparam_phys *sp)
     return sum;
 }
 
+static inline uint sysparam_hash(const char *name, size_t namelen)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < namelen; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+
+    return hash % SYSPARAM_HASH_BUCKETS;
+}
+
+static void sysparam_hash_add(struct sysparam *param)
+{
+    uint bucket = sysparam_hash(param->name, strlen(param->name));
+
+    param->hash_next = params.hash[bucket];
+    params.hash[bucket] = param;
+}
+
+static void sysparam_hash_remove(struct sysparam *param)
+{
+    struct sysparam **prev = &params.hash[sysparam_hash(param->name, strlen(param->name))];
+
+    while (*prev != param) {
+        DEBUG_ASSERT(*prev);
+        prev = &(*prev)->hash_next;
+    }
+    *prev = param->hash_next;
+}
+
+static void sysparam_free(struct sysparam *param)
+{
+    free(param->name);
+    free(param->data);
+    free(param);
+}
+
 static struct sysparam *sysparam_create(const char *name, size_t namelen, const void *data, size_t datalen, uint32_t flags)
 {
     struct sysparam *param = malloc(sizeof(struct sysparam));
     if (!param)
         return NULL;
 
+    param->hash_next = NULL;
     param->flags = flags;
+    param->dirty = false;
+    param->stored = false;
     param->memlen = sizeof(struct sysparam);
 
     param->name = malloc(namelen + 1);
@@ -156,17 +228,67 @@ static struct sysparam *sysparam_read_phys(const struct sysparam_phys *sp)
     return sysparam_create((const char *)sp->namedata, sp->namelen, sp->namedata + ROUNDUP(sp->namelen, 4), sp->datalen, sp->flags);
 }
 
-static struct sysparam *sysparam_find(const char *name)
+static struct sysparam *sysparam_find_len(const char *name, size_t namelen)
 {
     struct sysparam *param;
-    list_for_every_entry(&params.list, param, struct sysparam, node) {
-        if (strcmp(name, param->name) == 0)
+    for (param = params.hash[sysparam_hash(name, namelen)]; param; param = param->hash_next) {
+        if (strncmp(name, param->name, namelen) == 0 && param->name[namelen] == '\0')
             return param;
     }
 
     return NULL;
 }
 
+static inline struct sysparam *sysparam_find(const char *name)
+{
+    return sysparam_find_len(name, strlen(name));
+}
+
+/* drop the in-memory copy of everything */
+static void sysparam_release(void)
+{
+    struct sysparam *param;
+    struct sysparam *temp;
+    list_for_every_entry_safe(&params.list, param, temp, struct sysparam, node) {
+        list_delete(&param->node);
+        sysparam_free(param);
+    }
+    list_for_every_entry_safe(&params.deleted, param, temp, struct sysparam, node) {
+        list_delete(&param->node);
+        sysparam_free(param);
+    }
+
+    memset(params.hash, 0, sizeof(params.hash));
+    params.dirty = false;
+}
+
+/* apply a record of the log to the in-memory copy */
+static status_t sysparam_replay(const struct sysparam_phys *sp)
+{
+    struct sysparam *param;
+
+    /* a later record replaces the earlier ones */
+    param = sysparam_find_len((const char *)sp->namedata, sp->namelen);
+    if (param) {
+        sysparam_hash_remove(param);
+        list_delete(&param->node);
+        sysparam_free(param);
+    }
+
+    if (sp->flags & SYSPARAM_FLAG_DELETED)
+        return NO_ERROR;
+
+    param = sysparam_read_phys(sp);
+    if (!param)
+        return ERR_NO_MEMORY;
+
+    param->stored = true;
+    list_add_tail(&params.list, &param->node);
+    sysparam_hash_add(param);
+
+    return NO_ERROR;
+}
+
 status_t sysparam_scan(bdev_t *bdev, off_t offset, size_t len)
 {
     status_t err = NO_ERROR;
@@ -179,10 +301,13 @@ status_t sysparam_scan(bdev_t *bdev, off_t offset, size_t len)
     DEBUG_ASSERT(offset + (unsigned int) len <= bdev->total_size);
     DEBUG_ASSERT((offset % bdev->block_size) == 0);
 
+    sysparam_release();
+
     params.bdev = bdev;
     params.offset = offset;
     params.len = len;
-    params.dirty = false;
+    params.tail = 0;
+    params.tail_clean = false;
 
     /* allocate a len sized block */
     uint8_t *buf = malloc(len);
@@ -195,6 +320,7 @@ status_t sysparam_scan(bdev_t *bdev, off_t offset, size_t len)
         err = ERR_IO;
         goto err;
     }
+    err = NO_ERROR;
 
     LTRACEF("looking for sysparams in block:\n");
     if (LOCAL_TRACE)
@@ -213,7 +339,7 @@ status_t sysparam_scan(bdev_t *bdev, off_t offset, size_t len)
 
         /* looks valid, see if length is sane */
         size_t splen = sysparam_len(sp);
-        if (pos + splen > offset + len) {
+        if (pos + splen > len) {
             /* length exceeds the size of the area */
             LTRACEF("param at 0x%x: bad length\n",(unsigned int) pos);
             break;
@@ -232,15 +358,25 @@ status_t sysparam_scan(bdev_t *bdev, off_t offset, size_t len)
 
         LTRACEF("got param at offset 0x%zx\n", pos - splen);
 
-        struct sysparam *param = sysparam_read_phys(sp);
-        if (!param) {
+        params.tail = pos;
+
+        err = sysparam_replay(sp);
+        if (err < 0) {
             LTRACEF("param at 0x%x: failed to make memory copy\n", (unsigned int) pos - (unsigned int) splen);
-            err = ERR_NO_MEMORY;
             break;
         }
+    }
 
-        list_add_tail(&params.list, &param->node);
+    /* a torn append or the zero fill of the old format past the log means
+     * it has to be erased before anything is appended */
+    params.tail_clean = true;
+    for (pos = params.tail; pos < len; pos++) {
+        if (buf[pos] != bdev->erase_byte) {
+            params.tail_clean = false;
+            break;
+        }
     }
+    LTRACEF("log tail 0x%zx, %s\n", params.tail, params.tail_clean ? "clean" : "dirty");
 
 
 err:
@@ -257,23 +393,22 @@ status_t sysparam_reload(void)
     if (params.len == 0)
         return ERR_INVALID_ARGS;
 
-    /* wipe out the existing memory entries */
-    struct sysparam *param;
-    struct sysparam *temp;
-    list_for_every_entry_safe(&params.list, param, temp, struct sysparam, node) {
-        list_delete(&param->node);
+    /* the existing memory entries are wiped out by the scan */
+    status_t err = sysparam_scan(params.bdev, params.offset, params.len);
 
-        free(param->name);
-        free(param->data);
-        free(param);
-    }
+    return err;
+}
 
-    /* reset the list back to scratch */
-    params.dirty = false;
+status_t sysparam_get_area(bdev_t **bdev, off_t *offset, size_t *len)
+{
+    if (params.bdev == NULL)
+        return ERR_NOT_FOUND;
 
-    status_t err = sysparam_scan(params.bdev, params.offset, params.len);
+    *bdev = params.bdev;
+    *offset = params.offset;
+    *len = params.len;
 
-    return err;
+    return NO_ERROR;
 }
 
 ssize_t sysparam_read(const char *name, void *data, size_t len)
@@ -319,35 +454,82 @@ status_t sysparam_get_ptr(const char *name, const void **ptr, size_t *len)
 
 #if SYSPARAM_ALLOW_WRITE
 
-/* write all of the parameters in memory to the space reserved in flash */
-status_t sysparam_write(void)
+static size_t sysparam_phys_len(const struct sysparam *param)
+{
+    return sizeof(struct sysparam_phys) + ROUNDUP(strlen(param->name), 4) + ROUNDUP(param->datalen, 4);
+}
+
+/* serialize a parameter into buf, returns the length of the record */
+static size_t sysparam_serialize(const struct sysparam *param, uint8_t *buf)
+{
+    struct sysparam_phys *sp = (struct sysparam_phys *)buf;
+    size_t namelen = strlen(param->name);
+    size_t len = sysparam_phys_len(param);
+
+    memset(buf, 0, len);
+
+    sp->magic = SYSPARAM_MAGIC;
+    sp->flags = param->flags;
+    sp->namelen = namelen;
+    sp->datalen = param->datalen;
+
+    memcpy(sp->namedata, param->name, namelen);
+    if (param->datalen)
+        memcpy(sp->namedata + ROUNDUP(namelen, 4), param->data, param->datalen);
+
+    /* crc of the entire thing + padding */
+    sp->crc32 = sysparam_crc32(sp);
+
+    return len;
+}
+
+/* everything written is stored now, pending tombstones are done with */
+static void sysparam_written(void)
+{
+    struct sysparam *param;
+    struct sysparam *temp;
+    list_for_every_entry(&params.list, param, struct sysparam, node) {
+        param->dirty = false;
+        param->stored = true;
+    }
+    list_for_every_entry_safe(&params.deleted, param, temp, struct sysparam, node) {
+        list_delete(&param->node);
+        sysparam_free(param);
+    }
+
+    params.dirty = false;
+}
+
+/*
+ * Erase the area and write the live parameters to the start of it, the
+ * rest filled with erase_byte. On UFS the erase is an UNMAP and what reads
+ * back from unmapped blocks is up to the device, stale records past the
+ * tail could be replayed if only the blocks holding the log were written.
+ */
+status_t sysparam_write_full(void)
 {
     if (params.bdev == NULL)
         return ERR_INVALID_ARGS;
     if (params.len == 0)
         return ERR_INVALID_ARGS;
 
-    if (!params.dirty)
-        return NO_ERROR;
-
     /* preflight the length, make sure we have enough space */
     struct sysparam *param;
-    off_t total_len = 0;
+    size_t total_len = 0;
     list_for_every_entry(&params.list, param, struct sysparam, node) {
-        total_len += sizeof(struct sysparam_phys);
-        total_len += ROUNDUP(strlen(param->name), 4);
-        total_len += ROUNDUP(param->datalen, 4);
+        total_len += sysparam_phys_len(param);
     }
 
-    if (total_len > (off_t) params.len)
+    if (total_len > params.len)
         return ERR_NO_MEMORY;
 
     /* allocate a buffer to stage it */
-    uint8_t *buf = calloc(1, params.len);
+    uint8_t *buf = malloc(params.len);
     if (!buf) {
         TRACEF("error allocating buffer to stage write\n");
         return ERR_NO_MEMORY;
     }
+    memset(buf, params.bdev->erase_byte, params.len);
 
     /* erase the block device area this covers */
     ssize_t err = bio_erase(params.bdev, params.offset, params.len);
@@ -356,51 +538,101 @@ status_t sysparam_write(void)
         free(buf);
         return ERR_IO;
     }
+    params.stats.bytes_erased += params.len;
+
+    /* nothing can be appended to a partly written area */
+    params.tail = 0;
+    params.tail_clean = false;
 
     /* serialize all of the parameters */
-    off_t pos = 0;
+    size_t pos = 0;
     list_for_every_entry(&params.list, param, struct sysparam, node) {
-        struct sysparam_phys phys;
-
-        /* start filling out a struct */
-        phys.magic = SYSPARAM_MAGIC;
-        phys.crc32 = 0;
-        phys.flags = param->flags;
-        phys.namelen = strlen(param->name);
-        phys.datalen = param->datalen;
-
-        /* calculate the crc of the entire thing + padding */
-        uint32_t zero = 0;
-        uint32_t sum = crc32(0, (const void *)&phys.flags, 8);
-        sum = crc32(sum, (const void *)param->name, strlen(param->name));
-        if (strlen(param->name) % 4)
-            sum = crc32(sum, (const void *)&zero, 4 - (strlen(param->name) % 4));
-        sum = crc32(sum, (const void *)param->data, ROUNDUP(param->datalen, 4));
-        phys.crc32 = sum;
-
-        /* structure portion */
-        memcpy(buf + pos, &phys, sizeof(struct sysparam_phys));
-        pos += sizeof(struct sysparam_phys);
-
-        /* name portion */
-        memcpy(buf + pos, param->name, strlen(param->name));
-        pos += ROUNDUP(strlen(param->name), 2);
-        if (pos % 4) {
-            /* write 2 zeros to realign */
-            pos += 2;
-        }
+        pos += sysparam_serialize(param, buf + pos);
+    }
+
+    /* write the whole area out */
+    err = bio_write(params.bdev, buf, params.offset, params.len);
+    free(buf);
+    if (err < (ssize_t)params.len) {
+        TRACEF("error writing sysparam area\n");
+        return ERR_IO;
+    }
+    params.stats.bytes_written += params.len;
+
+    params.tail = total_len;
+    params.tail_clean = true;
+    sysparam_written();
+
+    return NO_ERROR;
+}
+
+status_t sysparam_compact(void)
+{
+    status_t err = sysparam_write_full();
+    if (err < 0)
+        return err;
+
+    params.stats.compactions++;
+
+    return NO_ERROR;
+}
+
+/* append the changed parameters and tombstones to the log */
+status_t sysparam_write(void)
+{
+    if (params.bdev == NULL)
+        return ERR_INVALID_ARGS;
+    if (params.len == 0)
+        return ERR_INVALID_ARGS;
+
+    if (!params.dirty)
+        return NO_ERROR;
 
-        /* data portion */
-        memcpy(buf + pos, param->data, param->datalen);
-        pos += ROUNDUP(param->datalen, 4);
+    struct sysparam *param;
+    size_t append_len = 0;
+    list_for_every_entry(&params.deleted, param, struct sysparam, node) {
+        append_len += sysparam_phys_len(param);
+    }
+    list_for_every_entry(&params.list, param, struct sysparam, node) {
+        if (param->dirty)
+            append_len += sysparam_phys_len(param);
     }
 
-    /* write the block out */
-    bio_write(params.bdev, buf, params.offset, params.len);
+    /* out of log, start over with only the live parameters */
+    if (!params.tail_clean || params.tail + append_len > params.len) {
+        LTRACEF("compacting, tail 0x%zx append 0x%zx\n", params.tail, append_len);
+        return sysparam_compact();
+    }
 
+    uint8_t *buf = malloc(append_len);
+    if (!buf) {
+        TRACEF("error allocating buffer to stage write\n");
+        return ERR_NO_MEMORY;
+    }
+
+    size_t pos = 0;
+    list_for_every_entry(&params.deleted, param, struct sysparam, node) {
+        pos += sysparam_serialize(param, buf + pos);
+    }
+    list_for_every_entry(&params.list, param, struct sysparam, node) {
+        if (param->dirty)
+            pos += sysparam_serialize(param, buf + pos);
+    }
+    DEBUG_ASSERT(pos == append_len);
+
+    ssize_t err = bio_write(params.bdev, buf, params.offset + params.tail, append_len);
     free(buf);
+    if (err < (ssize_t)append_len) {
+        /* whatever made it is garbage past the tail now */
+        TRACEF("error appending to sysparam area\n");
+        params.tail_clean = false;
+        return ERR_IO;
+    }
+    params.stats.bytes_written += append_len;
+    params.stats.appends++;
 
-    params.dirty = false;
+    params.tail += append_len;
+    sysparam_written();
 
     return NO_ERROR;
 }
@@ -417,7 +649,20 @@ status_t sysparam_add(const char *name, const void *value, size_t len)
     if (!param)
         return ERR_NO_MEMORY;
 
+    /* the new record replaces the old one, no need for a tombstone */
+    struct sysparam *tomb;
+    list_for_every_entry(&params.deleted, tomb, struct sysparam, node) {
+        if (strcmp(name, tomb->name) == 0) {
+            list_delete(&tomb->node);
+            sysparam_free(tomb);
+            param->stored = true;
+            break;
+        }
+    }
+
+    param->dirty = true;
     list_add_tail(&params.list, &param->node);
+    sysparam_hash_add(param);
 
     params.dirty = true;
 
@@ -435,11 +680,21 @@ status_t sysparam_remove(const char *name)
     if (sysparam_is_locked(param))
         return ERR_NOT_ALLOWED;
 
+    sysparam_hash_remove(param);
     list_delete(&param->node);
 
-    free(param->name);
+    if (!param->stored) {
+        /* never made it to the log */
+        sysparam_free(param);
+        return NO_ERROR;
+    }
+
+    /* keep the name around as a tombstone until the next write */
     free(param->data);
-    free(param);
+    param->data = NULL;
+    param->datalen = 0;
+    param->flags = SYSPARAM_FLAG_DELETED;
+    list_add_tail(&params.deleted, &param->node);
 
     params.dirty = true;
 
@@ -457,12 +712,20 @@ status_t sysparam_lock(const char *name)
     /* set the lock bit if it isn't already */
     if (!sysparam_is_locked(param)) {
         param->flags |= SYSPARAM_FLAG_LOCK;
+        param->dirty = true;
         params.dirty = true;
     }
 
     return NO_ERROR;
 }
 
+void sysparam_get_stats(struct sysparam_stats *stats)
+{
+    *stats = params.stats;
+    stats->log_used = params.tail;
+    stats->log_size = params.len;
+}
+
 #endif // SYSPARAM_ALLOW_WRITE
 
 #define MAX_DUMP_LEN  16
@@ -499,6 +762,8 @@ void sysparam_dump(bool show_all)
     }
 
     printf("total in-memory usage: %zu bytes\n", total_memlen);
+    printf("log: %zu of %zu bytes used%s\n", params.tail, params.len,
+           params.tail_clean ? "" : ", needs compaction");
 }
 
 #if WITH_LIB_CONSOLE
@@ -552,6 +817,7 @@ usage:
         printf("usage: %s remove <param>\n", argv[0].str);
         printf("usage: %s lock <param>\n", argv[0].str);
         printf("usage: %s write\n", argv[0].str);
+        printf("usage: %s compact\n", argv[0].str);
 #endif
         printf("usage: %s length <param>\n", argv[0].str);
         printf("usage: %s read <param>\n", argv[0].str);
@@ -650,9 +916,24 @@ usage:
         err = sysparam_lock(argv[2].str);
     } else if (!strcmp(argv[1].str, "write")) {
         err = sysparam_write();
+    } else if (!strcmp(argv[1].str, "compact")) {
+        err = sysparam_compact();
     } else if (!strcmp(argv[1].str, "nuke")) {
         ssize_t err = bio_erase(params.bdev, params.offset, params.len);
         printf("erase returns %d\n", (int)err);
+
+        /* the log is gone, the memory copy is all there is */
+        struct sysparam *param;
+        struct sysparam *temp;
+        list_for_every_entry(&params.list, param, struct sysparam, node) {
+            param->stored = false;
+        }
+        list_for_every_entry_safe(&params.deleted, param, temp, struct sysparam, node) {
+            list_delete(&param->node);
+            sysparam_free(param);
+        }
+        params.tail = 0;
+        params.tail_clean = (err >= (ssize_t)params.len);
 #endif // SYSPARAM_ALLOW_WRITE
     } else if (!strcmp(argv[1].str, "length")) {
         if (argc < 3) goto notenoughargs;
@@ -24,13 +24,38 @@
 #pragma once
 
 #include <compiler.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 __BEGIN_CDECLS
 
+// Called with each block of a transfer in order, and with NULL once it
+// is over. Returning a negative value aborts the transfer.
 typedef int (*tftp_callback_t)(void *data, size_t len, void *arg);
 
 int tftp_server_init(void *arg);
 
+// Accept writes of |file_name| from tftp clients into |cb|.
 int tftp_set_write_client(const char *file_name, tftp_callback_t cb, void *arg);
 
+// Stop accepting writes of |file_name|, cancelling a transfer in
+// progress. Once it returns the callback is not called again.
+int tftp_clear_write_client(const char *file_name);
+
+// Fetch |file_name| from the tftp server at |host| into |cb|. Blocks
+// until done, returns the number of bytes received or a negative error.
+int tftp_get(uint32_t host, const char *file_name, tftp_callback_t cb, void *arg);
+
+// A sink that streams the blocks of a transfer into a bio device or
+// partition from |offset| on, the writes overlap with the transfer.
+// Use tftp_bio_sink_callback() with the sink as the callback arg. Every
+// transfer into the sink starts over at |offset|.
+typedef struct tftp_bio_sink tftp_bio_sink_t;
+
+tftp_bio_sink_t *tftp_bio_sink_open(const char *device, off_t offset);
+int tftp_bio_sink_callback(void *data, size_t len, void *arg);
+// Bytes written by the last transfer or a negative error.
+ssize_t tftp_bio_sink_result(tftp_bio_sink_t *sink);
+void tftp_bio_sink_close(tftp_bio_sink_t *sink);
+
 __END_CDECLS
@@ -3,9 +3,11 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 MODULE := $(LOCAL_DIR)
 
 MODULE_DEPS := \
+  lib/bio \
   lib/minip \
 
 MODULE_SRCS += \
   $(LOCAL_DIR)/tftp.c \
+  $(LOCAL_DIR)/tftp_bio.c \
 
 include make/module.mk
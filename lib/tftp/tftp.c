@@ -24,12 +24,17 @@
 #include <err.h>
 #include <trace.h>
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <list.h>
 #include <compiler.h>
 #include <endian.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <kernel/event.h>
+#include <kernel/mutex.h>
 #include <lib/minip.h>
 #include <platform.h>
 
@@ -43,6 +48,7 @@
 #define TFTP_OPCODE_DATA  3UL
 #define TFTP_OPCODE_ACK   4UL
 #define TFTP_OPCODE_ERROR 5UL
+#define TFTP_OPCODE_OACK  6UL
 
 // TFTP Errors:
 #define TFTP_ERROR_UNDEF        0UL
@@ -53,13 +59,31 @@
 #define TFTP_ERROR_UNKNOWN_XFER 4UL
 #define TFTP_ERROR_EXISTS       6UL
 #define TFTP_ERROR_NO_SUCH_USER 7UL
+#define TFTP_ERROR_OPTION       8UL
 
 #define TFTP_PORT 69
 
+// Block size without the blksize option (RFC 1350).
+#define TFTP_DEFAULT_BLKSIZE 512
+// Largest block that fits an ethernet frame, minip does not fragment.
+#define TFTP_MAX_BLKSIZE 1468
+#define TFTP_MIN_BLKSIZE 8
+// Blocks per ack (RFC 7440), bounded by the nic rx ring.
+#define TFTP_MAX_WINDOWSIZE 64
+// What we ask for as a client.
+#define TFTP_CLIENT_WINDOWSIZE 32
+
+// Client side, per retry.
+#define TFTP_TIMEOUT 1000
+#define TFTP_MAX_RETRIES 5
+
 #define RD_U16(ptr) \
     (uint16_t)(((uint16_t)*((uint8_t*)(ptr)+1)<<8)|(uint16_t)*(uint8_t*)(ptr))
 
 static struct list_node tftp_list = LIST_INITIAL_VALUE(tftp_list);
+// Serializes tftp_list and the server side jobs on it between the minip
+// rx thread and the threads that (un)register write clients.
+static mutex_t tftp_lock = MUTEX_INITIAL_VALUE(tftp_lock);
 
 // Represents tftp jobs and clients of them. If |socket| is not null the
 // job is in progress and members below it are valid.
@@ -74,7 +98,22 @@ typedef struct {
     uint32_t src_addr;
     uint16_t src_port;
     uint16_t listen_port;
-    uint16_t pkt_count;
+    uint16_t pkt_count;     // last block received in order
+    // Negotiated options.
+    uint16_t blksize;
+    uint16_t windowsize;
+    uint16_t window_count;  // blocks received since the last ack
+    bool gap_acked;         // the gap after pkt_count was already counted
+    // Stats.
+    lk_bigtime_t start_time;
+    uint64_t bytes;
+    uint32_t windows;
+    uint32_t retransmits;
+    // Client side.
+    mutex_t lock;
+    event_t done_event;
+    bool done;
+    int status;
 } tftp_job_t;
 
 uint16_t next_port = 2224;
@@ -104,6 +143,90 @@ static void send_error(udp_socket_t *socket, uint16_t code)
     }
 }
 
+// Returns the string following the one at |p|, or NULL if |p| does not
+// hold a terminated string before |end|.
+static const char *next_string(const char *p, const char *end)
+{
+    const char *nul = memchr(p, '\0', end - p);
+    return nul ? nul + 1 : NULL;
+}
+
+// Appends "name\0value\0" to an option list.
+static size_t put_option(char *buf, size_t len, size_t size, const char *name, uint value)
+{
+    int n = snprintf(buf + len, size - len, "%s%c%u", name, '\0', value);
+    if (n < 0 || (size_t)n + 1 > size - len) {
+        return len;
+    }
+    return len + n + 1;
+}
+
+// Applies the blksize (RFC 2348) and windowsize (RFC 7440) options in
+// [opt, end). With |oack| set the accepted values are appended to it,
+// which is what a server answers. A client only accepts values no
+// larger than it asked for. Returns the length written to |oack|, or a
+// negative value if an option was refused.
+static ssize_t apply_options(tftp_job_t *job, const char *opt, const char *end,
+                             char *oack, size_t oack_size, bool client)
+{
+    size_t oack_len = 0;
+
+    while (opt && opt < end) {
+        const char *val = next_string(opt, end);
+        if (!val || val >= end || !next_string(val, end)) {
+            break;
+        }
+
+        uint value = strtoul(val, NULL, 10);
+        if (strcasecmp(opt, "blksize") == 0) {
+            if (value < TFTP_MIN_BLKSIZE || (client && value > job->blksize)) {
+                return -1;
+            }
+            job->blksize = MIN(value, TFTP_MAX_BLKSIZE);
+            if (oack) {
+                oack_len = put_option(oack, oack_len, oack_size, "blksize", job->blksize);
+            }
+        } else if (strcasecmp(opt, "windowsize") == 0) {
+            if (value < 1 || (client && value > job->windowsize)) {
+                return -1;
+            }
+            job->windowsize = MIN(value, TFTP_MAX_WINDOWSIZE);
+            if (oack) {
+                oack_len = put_option(oack, oack_len, oack_size, "windowsize", job->windowsize);
+            }
+        } else if (client) {
+            // A server may only acknowledge options we sent.
+            return -1;
+        }
+        opt = next_string(val, end);
+    }
+
+    return oack_len;
+}
+
+static void start_job(tftp_job_t *job)
+{
+    job->pkt_count = 0UL;
+    job->blksize = TFTP_DEFAULT_BLKSIZE;
+    job->windowsize = 1;
+    job->window_count = 0;
+    job->gap_acked = false;
+    job->start_time = current_time_hires();
+    job->bytes = 0;
+    job->windows = 0;
+    job->retransmits = 0;
+}
+
+static void report_job(const tftp_job_t *job)
+{
+    lk_bigtime_t us = current_time_hires() - job->start_time;
+
+    printf("tftp: %s, %llu bytes in %llu ms (%llu KB/s), blksize %u windowsize %u, "
+           "%u windows, %u retransmitted\n",
+           job->file_name, job->bytes, us / 1000, job->bytes * 1000000 / MAX(us, 1ULL) / 1024,
+           job->blksize, job->windowsize, job->windows, job->retransmits);
+}
+
 static void end_transfer(tftp_job_t *job, bool do_callback)
 {
     udp_listen(job->listen_port, NULL, NULL);
@@ -115,56 +238,122 @@ static void end_transfer(tftp_job_t *job, bool do_callback)
     }
 }
 
+// Handles a DATA packet of an accepted transfer. Returns true once the
+// transfer is over, successfully or not.
+static bool handle_data(tftp_job_t *job, void *data, size_t len)
+{
+    // Packet is [3][block][data]. All packets but the last have
+    // blksize bytes of data, including zero data.
+    char *data_c = data;
+    uint16_t block = ntohs(RD_U16(&data_c[2]));
+    size_t data_len = len - 4;
+
+    if (block != (uint16_t)(job->pkt_count + 1)) {
+        // Lost or reordered block, or a window resent because our ack
+        // got lost. Acking the last block received in order makes the
+        // sender restart the window from there (RFC 7440). The rest of
+        // the window is still on its way, so that ack goes out once; if
+        // another whole window arrives without the expected block the
+        // ack got lost and is sent again.
+        if (!job->gap_acked) {
+            LTRACEF("expected block %u, got %u\n", job->pkt_count + 1, block);
+            job->gap_acked = true;
+            job->retransmits++;
+        } else if (++job->window_count < job->windowsize) {
+            return false;
+        }
+        send_ack(job->socket, job->pkt_count);
+        job->window_count = 0;
+        return false;
+    }
+
+    job->pkt_count = block;
+    job->gap_acked = false;
+
+    if (job->callback(&data_c[4], data_len, job->arg) < 0) {
+        // The client wants to abort.
+        send_error(job->socket, TFTP_ERROR_FULL);
+        job->status = ERR_IO;
+        return true;
+    }
+    job->bytes += data_len;
+
+    // The last packet has always less than blksize bytes of payload.
+    bool last = data_len < job->blksize;
+    if (++job->window_count == job->windowsize || last) {
+        send_ack(job->socket, block);
+        job->window_count = 0;
+        job->windows++;
+    }
+
+    if (last) {
+        report_job(job);
+        job->status = NO_ERROR;
+    }
+    return last;
+}
+
+// Whether |job| is still registered. Called with tftp_lock held.
+static bool job_is_listed(const tftp_job_t *job)
+{
+    tftp_job_t *entry;
+    list_for_every_entry(&tftp_list, entry, tftp_job_t, list) {
+        if (entry == job) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void udp_wrq_callback(void *data, size_t len,
                              uint32_t srcaddr, uint16_t srcport,
                              void *arg)
 {
-    // Packet is [3][count][data]. All packets but the last have 512
-    // bytes of data, including zero data.
     char *data_c = data;
     tftp_job_t *job = arg;
-    job->pkt_count++;
 
     if (len < 4) {
         // Not to spec. Ignore.
         return;
     }
 
+    mutex_acquire(&tftp_lock);
+
+    // The job may have been cleared while this packet was on its way
+    // up, in which case |job| is gone and must not be touched.
+    if (!job_is_listed(job)) {
+        goto out;
+    }
+
     if (!job->socket) {
         // It is possible to have the client sent another packet
         // after we called end_transfer().
-        return;
+        goto out;
     }
 
     if ((srcaddr != job->src_addr) || (srcport != job->src_port)) {
         LTRACEF("invalid source\n");
         send_error(job->socket, TFTP_ERROR_UNKNOWN_XFER);
         end_transfer(job, true);
-        return;
+        goto out;
     }
 
     if (RD_U16(data_c) != htons(TFTP_OPCODE_DATA)) {
         LTRACEF("invalid opcode\n");
         send_error(job->socket, TFTP_ERROR_ILLEGAL_OP);
         end_transfer(job, true);
-        return;
+        goto out;
     }
 
-    send_ack(job->socket, job->pkt_count);
-
-    if (job->callback(&data_c[4], len - 4, job->arg) < 0) {
-        // The client wants to abort.
-        send_error(job->socket, TFTP_ERROR_FULL);
+    if (handle_data(job, data, len)) {
         end_transfer(job, true);
     }
 
-    // 512 bytes payload plus 4 of fixed header. The last packet.
-    // has always less than 512 bytes of payload.
-    if (len != 516) {
-        end_transfer(job, true);
-    }
+out:
+    mutex_release(&tftp_lock);
 }
 
+// Called with tftp_lock held.
 static tftp_job_t *get_job_by_name(const char *file_name)
 {
     DEBUG_ASSERT(file_name);
@@ -186,6 +375,10 @@ static void udp_svc_callback(void *data, size_t len,
     udp_socket_t *socket;
     tftp_job_t *job;
 
+    if (len < 4) {
+        return;
+    }
+
     st = udp_open(srcaddr, next_port, srcport, &socket);
     if (st < 0) {
         LTRACEF("error opening send socket %d\n", st);
@@ -202,16 +395,29 @@ static void udp_svc_callback(void *data, size_t len,
         return;
     }
 
-    // Look for a client that can hadle the file. TODO: |data|
-    // needs to be null terminated. A malicious client can crash us.
-    job = get_job_by_name(((char *)data) + 2);
+    // Request is [2][file name][0][mode][0] followed by options.
+    const char *end = (const char *)data + len;
+    const char *file_name = (const char *)data + 2;
+    const char *mode = next_string(file_name, end);
+    const char *options = mode ? next_string(mode, end) : NULL;
+    if (!options) {
+        LTRACEF("malformed request\n");
+        send_error(socket, TFTP_ERROR_ILLEGAL_OP);
+        udp_close(socket);
+        return;
+    }
+
+    mutex_acquire(&tftp_lock);
+
+    // Look for a client that can hadle the file.
+    job = get_job_by_name(file_name);
 
     if (!job) {
         // Nobody claims to handle that file.
         LTRACEF("no client registered for file\n");
         send_error(socket, TFTP_ERROR_UNKNOWN_XFER);
         udp_close(socket);
-        return;
+        goto out;
     }
 
     if (job->socket) {
@@ -221,27 +427,48 @@ static void udp_svc_callback(void *data, size_t len,
         LTRACEF("existing job in progress\n");
         send_error(socket, TFTP_ERROR_EXISTS);
         udp_close(socket);
-        return;
+        goto out;
     }
 
-    LTRACEF("write op accepted, port %d\n", srcport);
+    start_job(job);
+
+    // The options we take are acknowledged with an OACK instead of
+    // the ack of block 0 (RFC 2347).
+    char oack[64];
+    ssize_t oack_len = apply_options(job, options, end, oack + 2, sizeof(oack) - 2, false);
+    if (oack_len < 0) {
+        LTRACEF("options refused\n");
+        send_error(socket, TFTP_ERROR_OPTION);
+        udp_close(socket);
+        goto out;
+    }
+
+    LTRACEF("write op accepted, port %d, blksize %u, windowsize %u\n",
+            srcport, job->blksize, job->windowsize);
     // Request accepted. The rest of the transfer happens between
     // next_port <----> srcport via udp_wrq_callback().
 
     job->socket = socket;
     job->src_addr = srcaddr;
     job->src_port = srcport;
-    job->pkt_count = 0UL;
     job->listen_port = next_port;
 
     st = udp_listen(job->listen_port, &udp_wrq_callback, job);
     if (st < 0) {
         LTRACEF("error listening on port\n");
-        return;
+        goto out;
     }
 
-    send_ack(socket, 0UL);
+    if (oack_len > 0) {
+        *(uint16_t *)oack = htons(TFTP_OPCODE_OACK);
+        udp_send(oack, oack_len + 2, socket);
+    } else {
+        send_ack(socket, 0UL);
+    }
     next_port++;
+
+out:
+    mutex_release(&tftp_lock);
 }
 
 int tftp_set_write_client(const char *file_name, tftp_callback_t cb, void *arg)
@@ -251,6 +478,8 @@ int tftp_set_write_client(const char *file_name, tftp_callback_t cb, void *arg)
 
     tftp_job_t *job;
 
+    mutex_acquire(&tftp_lock);
+
     list_for_every_entry(&tftp_list, job, tftp_job_t, list) {
         if (strcmp(file_name, job->file_name) == 0) {
             list_delete(&job->list);
@@ -258,11 +487,13 @@ int tftp_set_write_client(const char *file_name, tftp_callback_t cb, void *arg)
                 // There is a job in progress. It will be cancelled silently.
                 end_transfer(job, false);
             }
+            mutex_release(&tftp_lock);
             return 0;
         }
     }
 
     if ((job = malloc(sizeof(tftp_job_t))) == NULL) {
+        mutex_release(&tftp_lock);
         return -1;
     }
 
@@ -272,12 +503,209 @@ int tftp_set_write_client(const char *file_name, tftp_callback_t cb, void *arg)
     job->arg = arg;
 
     list_add_tail(&tftp_list, &job->list);
+    mutex_release(&tftp_lock);
     return 0;
 }
 
+int tftp_clear_write_client(const char *file_name)
+{
+    DEBUG_ASSERT(file_name);
+
+    tftp_job_t *job;
+
+    // With the lock held no packet of the job is being handled, and
+    // once it is unlinked none will be.
+    mutex_acquire(&tftp_lock);
+
+    list_for_every_entry(&tftp_list, job, tftp_job_t, list) {
+        if (strcmp(file_name, job->file_name) == 0) {
+            list_delete(&job->list);
+            if (job->socket) {
+                // The job is cancelled silently, its callback is not
+                // called again.
+                end_transfer(job, false);
+            }
+            mutex_release(&tftp_lock);
+            free(job);
+            return 0;
+        }
+    }
+
+    mutex_release(&tftp_lock);
+    return ERR_NOT_FOUND;
+}
+
 int tftp_server_init(void *arg)
 {
     status_t st = udp_listen(TFTP_PORT, &udp_svc_callback, 0);
     return st;
 }
 
+static void client_finish(tftp_job_t *job, int status)
+{
+    job->status = status;
+    job->done = true;
+    event_signal(&job->done_event, true);
+}
+
+static void udp_rrq_callback(void *data, size_t len,
+                             uint32_t srcaddr, uint16_t srcport,
+                             void *arg)
+{
+    char *data_c = data;
+    tftp_job_t *job = arg;
+
+    if (len < 4 || srcaddr != job->src_addr) {
+        return;
+    }
+
+    mutex_acquire(&job->lock);
+
+    if (job->done) {
+        goto out;
+    }
+
+    if (!job->socket) {
+        // The first answer comes from the port the server picked for
+        // the transfer, the rest of it happens there.
+        if (udp_open(srcaddr, job->listen_port, srcport, &job->socket) < 0) {
+            goto out;
+        }
+        job->src_port = srcport;
+
+        // A server that ignores our options starts sending right away
+        // with the RFC 1350 defaults.
+        if (ntohs(RD_U16(data_c)) == TFTP_OPCODE_DATA) {
+            job->blksize = TFTP_DEFAULT_BLKSIZE;
+            job->windowsize = 1;
+        }
+    } else if (srcport != job->src_port) {
+        LTRACEF("invalid source port %u\n", srcport);
+        goto out;
+    }
+
+    switch (ntohs(RD_U16(data_c))) {
+        case TFTP_OPCODE_OACK:
+            if (job->pkt_count != 0 ||
+                    apply_options(job, &data_c[2], data_c + len, NULL, 0, true) < 0) {
+                send_error(job->socket, TFTP_ERROR_OPTION);
+                client_finish(job, ERR_NOT_SUPPORTED);
+                break;
+            }
+            LTRACEF("blksize %u, windowsize %u\n", job->blksize, job->windowsize);
+            send_ack(job->socket, 0UL);
+            break;
+        case TFTP_OPCODE_DATA:
+            if (handle_data(job, data, len)) {
+                client_finish(job, job->status);
+            }
+            break;
+        case TFTP_OPCODE_ERROR:
+            printf("tftp: server error %u: %.*s\n", ntohs(RD_U16(&data_c[2])),
+                   (int)(len - 4), &data_c[4]);
+            client_finish(job, ERR_NOT_FOUND);
+            break;
+        default:
+            send_error(job->socket, TFTP_ERROR_ILLEGAL_OP);
+            client_finish(job, ERR_IO);
+            break;
+    }
+
+out:
+    mutex_release(&job->lock);
+}
+
+int tftp_get(uint32_t host, const char *file_name, tftp_callback_t cb, void *arg)
+{
+    DEBUG_ASSERT(file_name);
+    DEBUG_ASSERT(cb);
+
+    tftp_job_t *job;
+    udp_socket_t *req_socket;
+    status_t st;
+
+    if ((job = calloc(1, sizeof(tftp_job_t))) == NULL) {
+        return ERR_NO_MEMORY;
+    }
+
+    job->file_name = file_name;
+    job->callback = cb;
+    job->arg = arg;
+    job->src_addr = host;
+    job->listen_port = next_port++;
+    mutex_init(&job->lock);
+    event_init(&job->done_event, false, 0);
+    start_job(job);
+
+    // Ask for the largest blocks and a window, the server answers with
+    // what it takes.
+    job->blksize = TFTP_MAX_BLKSIZE;
+    job->windowsize = TFTP_CLIENT_WINDOWSIZE;
+
+    // Request is [1][file name][0]["octet"][0] followed by options.
+    char req[128];
+    size_t req_len = 2 + strlen(file_name) + 1 + sizeof("octet");
+    if (req_len > sizeof(req)) {
+        st = ERR_INVALID_ARGS;
+        goto err_free;
+    }
+    *(uint16_t *)req = htons(TFTP_OPCODE_RRQ);
+    strcpy(req + 2, file_name);
+    strcpy(req + 2 + strlen(file_name) + 1, "octet");
+    req_len = put_option(req, req_len, sizeof(req), "blksize", job->blksize);
+    req_len = put_option(req, req_len, sizeof(req), "windowsize", job->windowsize);
+
+    st = udp_open(host, job->listen_port, TFTP_PORT, &req_socket);
+    if (st < 0) {
+        goto err_free;
+    }
+
+    st = udp_listen(job->listen_port, &udp_rrq_callback, job);
+    if (st < 0) {
+        goto err_close;
+    }
+
+    uint retries = 0;
+    uint16_t last_count = 0;
+    uint64_t last_bytes = 0;
+    udp_send(req, req_len, req_socket);
+    while (event_wait_timeout(&job->done_event, TFTP_TIMEOUT) == ERR_TIMED_OUT) {
+        mutex_acquire(&job->lock);
+        if (job->bytes != last_bytes || job->pkt_count != last_count) {
+            retries = 0;
+        } else if (++retries > TFTP_MAX_RETRIES) {
+            printf("tftp: %s timed out after block %u\n", file_name, job->pkt_count);
+            client_finish(job, ERR_TIMED_OUT);
+        } else if (!job->socket) {
+            // Nothing heard back yet.
+            udp_send(req, req_len, req_socket);
+        } else {
+            // The rest of the window got lost, have it sent again.
+            send_ack(job->socket, job->pkt_count);
+            job->window_count = 0;
+            job->retransmits++;
+        }
+        last_bytes = job->bytes;
+        last_count = job->pkt_count;
+        mutex_release(&job->lock);
+    }
+
+    // Stop the rx path from touching the job before it goes away.
+    mutex_acquire(&job->lock);
+    udp_listen(job->listen_port, NULL, NULL);
+    mutex_release(&job->lock);
+
+    st = job->status;
+    job->callback(NULL, 0UL, job->arg);
+    if (st >= 0) {
+        st = job->bytes > INT_MAX ? INT_MAX : (int)job->bytes;
+    }
+
+    udp_close(job->socket);
+err_close:
+    udp_close(req_socket);
+err_free:
+    event_destroy(&job->done_event);
+    free(job);
+    return st;
+}
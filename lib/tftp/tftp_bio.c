@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  Stream tftp transfers into a block device
+ *
+ * Blocks are gathered in a staging buffer that is a multiple of the
+ * device block size. A full buffer goes to a writer thread while the
+ * other one fills, so the device writes while the network receives.
+ */
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <kernel/event.h>
+#include <kernel/thread.h>
+#include <lib/bio.h>
+#include <lib/tftp.h>
+
+#define LOCAL_TRACE 0
+
+#define TFTP_BIO_SINK_BUF_SIZE (512 * 1024)
+
+struct tftp_bio_sink {
+    bdev_t *dev;
+    off_t start;
+    off_t offset;       // device offset of buf[cur]
+    uint8_t *buf[2];
+    size_t buf_size;
+    size_t fill;        // bytes in buf[cur]
+    int cur;
+
+    thread_t *writer;
+    event_t full;       // a write is queued
+    event_t idle;       // the writer is done with the last one
+    const uint8_t *write_buf;
+    off_t write_offset;
+    size_t write_len;
+    bool quit;
+
+    // Of the transfer in progress.
+    status_t err;
+    uint64_t written;
+
+    ssize_t result;
+};
+
+static int tftp_bio_writer(void *arg)
+{
+    tftp_bio_sink_t *sink = arg;
+
+    for (;;) {
+        event_wait(&sink->full);
+        if (sink->quit)
+            break;
+
+        ssize_t err = bio_write(sink->dev, sink->write_buf, sink->write_offset, sink->write_len);
+        if (err != (ssize_t)sink->write_len) {
+            TRACEF("bio_write of %zu bytes at 0x%llx returns %ld\n",
+                   sink->write_len, sink->write_offset, err);
+            if (sink->err == NO_ERROR)
+                sink->err = (err < 0) ? err : ERR_IO;
+        } else {
+            sink->written += sink->write_len;
+        }
+
+        event_signal(&sink->idle, true);
+    }
+
+    return 0;
+}
+
+/* hand buf[cur] to the writer and go on with the other buffer */
+static void tftp_bio_sink_queue(tftp_bio_sink_t *sink)
+{
+    event_wait(&sink->idle);
+
+    sink->write_buf = sink->buf[sink->cur];
+    sink->write_offset = sink->offset;
+    sink->write_len = sink->fill;
+    event_signal(&sink->full, true);
+
+    sink->offset += sink->fill;
+    sink->fill = 0;
+    sink->cur ^= 1;
+}
+
+/* wait for the last write to complete */
+static void tftp_bio_sink_drain(tftp_bio_sink_t *sink)
+{
+    event_wait(&sink->idle);
+    event_signal(&sink->idle, false);
+}
+
+int tftp_bio_sink_callback(void *data, size_t len, void *arg)
+{
+    tftp_bio_sink_t *sink = arg;
+    const uint8_t *src = data;
+
+    DEBUG_ASSERT(sink);
+
+    if (!data) {
+        /* the transfer is over, write the tail and start over */
+        if (sink->fill && sink->err == NO_ERROR)
+            tftp_bio_sink_queue(sink);
+        tftp_bio_sink_drain(sink);
+
+        sink->result = (sink->err < 0) ? sink->err : (ssize_t)sink->written;
+        printf("tftp: %s, wrote %llu bytes at 0x%llx, status %d\n",
+               sink->dev->name, sink->written, sink->start, sink->err);
+
+        sink->offset = sink->start;
+        sink->fill = 0;
+        sink->err = NO_ERROR;
+        sink->written = 0;
+        return 0;
+    }
+
+    if (sink->err < 0)
+        return -1;
+
+    if (sink->offset + (off_t)(sink->fill + len) > sink->dev->total_size) {
+        TRACEF("transfer does not fit %s\n", sink->dev->name);
+        sink->err = ERR_TOO_BIG;
+        return -1;
+    }
+
+    while (len > 0) {
+        size_t n = MIN(len, sink->buf_size - sink->fill);
+
+        memcpy(sink->buf[sink->cur] + sink->fill, src, n);
+        sink->fill += n;
+        src += n;
+        len -= n;
+
+        if (sink->fill == sink->buf_size)
+            tftp_bio_sink_queue(sink);
+    }
+
+    return 0;
+}
+
+tftp_bio_sink_t *tftp_bio_sink_open(const char *device, off_t offset)
+{
+    tftp_bio_sink_t *sink;
+    bdev_t *dev;
+
+    dev = bio_open(device);
+    if (!dev) {
+        printf("tftp: no device %s\n", device);
+        return NULL;
+    }
+
+    /* aligned staging buffers keep every write but the last whole blocks */
+    if (offset < 0 || offset >= dev->total_size || (offset % dev->block_size) != 0) {
+        printf("tftp: bad offset 0x%llx for %s\n", offset, device);
+        goto err_close;
+    }
+
+    sink = calloc(1, sizeof(tftp_bio_sink_t));
+    if (!sink)
+        goto err_close;
+
+    sink->dev = dev;
+    sink->start = offset;
+    sink->offset = offset;
+    sink->buf_size = MAX(ROUNDDOWN(TFTP_BIO_SINK_BUF_SIZE, dev->block_size), dev->block_size);
+    sink->buf[0] = memalign(CACHE_LINE, sink->buf_size);
+    sink->buf[1] = memalign(CACHE_LINE, sink->buf_size);
+    if (!sink->buf[0] || !sink->buf[1])
+        goto err_free;
+
+    event_init(&sink->full, false, EVENT_FLAG_AUTOUNSIGNAL);
+    event_init(&sink->idle, true, EVENT_FLAG_AUTOUNSIGNAL);
+
+    sink->writer = thread_create("tftp_bio", &tftp_bio_writer, sink, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+    if (!sink->writer) {
+        event_destroy(&sink->full);
+        event_destroy(&sink->idle);
+        goto err_free;
+    }
+    thread_resume(sink->writer);
+
+    return sink;
+
+err_free:
+    free(sink->buf[0]);
+    free(sink->buf[1]);
+    free(sink);
+err_close:
+    bio_close(dev);
+    return NULL;
+}
+
+ssize_t tftp_bio_sink_result(tftp_bio_sink_t *sink)
+{
+    return sink->result;
+}
+
+void tftp_bio_sink_close(tftp_bio_sink_t *sink)
+{
+    if (!sink)
+        return;
+
+    tftp_bio_sink_drain(sink);
+
+    sink->quit = true;
+    event_signal(&sink->full, true);
+    thread_join(sink->writer, NULL, INFINITE_TIME);
+
+    event_destroy(&sink->full);
+    event_destroy(&sink->idle);
+    free(sink->buf[0]);
+    free(sink->buf[1]);
+    bio_close(sink->dev);
+    free(sink);
+}
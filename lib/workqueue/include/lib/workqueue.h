@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIB_WORKQUEUE_H__
+#define __LIB_WORKQUEUE_H__
+
+#include <list.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <kernel/event.h>
+
+/*
+ * Work queue and parallel for
+ *
+ * Every cpu has a worker thread pinned to it and a bounded queue. Work
+ * goes to the queue of the submitting cpu and idle workers take it from
+ * the other queues. A full queue runs the work in the submitter instead
+ * of blocking it. Without SMP, or before the workers are up, all work
+ * runs inline.
+ */
+
+/* Entries per cpu queue */
+#define WORKQUEUE_DEPTH         32
+
+typedef int (*work_func_t)(void *arg);
+typedef void (*parallel_for_func_t)(void *arg, size_t start, size_t end);
+
+/* Counts down to zero, then releases every waiter */
+struct work_completion {
+    volatile int pending;
+    event_t event;
+};
+
+/* A unit of work and the future of its result, owned by the submitter */
+struct work {
+    struct list_node node;
+    work_func_t func;
+    void *arg;
+    /* queue the work sits in, -1 if none */
+    int cpu;
+    int result;
+    struct work_completion done;
+};
+
+struct workqueue_stats {
+    u64 executed;
+    u64 stolen;
+    u64 inline_runs;
+};
+
+void work_completion_init(struct work_completion *c, int count);
+void work_completion_signal(struct work_completion *c);
+status_t work_completion_wait(struct work_completion *c, lk_time_t timeout);
+void work_completion_destroy(struct work_completion *c);
+
+void work_init(struct work *w, work_func_t func, void *arg);
+/* Once w is neither queued nor running */
+void work_destroy(struct work *w);
+/* Queue w, it may have run by the time this returns */
+void work_submit(struct work *w);
+/* Take w back if no worker started it yet, returns true if it did */
+bool work_cancel(struct work *w);
+/*
+ * Wait for w and store what func returned in result. Work that no
+ * worker started yet runs in the caller. Returns ERR_TIMED_OUT or
+ * NO_ERROR, after which w can be reused or freed.
+ */
+status_t work_wait(struct work *w, lk_time_t timeout, int *result);
+
+/*
+ * Call fn on [start, end) split in chunks of grain, from the workers
+ * and the caller, and return once every chunk is done. Chunks run in
+ * no particular order.
+ */
+void parallel_for(size_t start, size_t end, size_t grain,
+        parallel_for_func_t fn, void *arg);
+
+/* Cpus that take part in parallel_for, the caller included */
+uint workqueue_concurrency(void);
+void workqueue_get_stats(struct workqueue_stats *stats);
+
+#endif  /* __LIB_WORKQUEUE_H__ */
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arch/ops.h>
+#include <kernel/mp.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <lk/init.h>
+#include <lib/workqueue.h>
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+#endif
+
+#define LOCAL_TRACE 0
+
+/* Keeps the chunk index of parallel_for within an int */
+#define PARALLEL_FOR_MAX_CHUNKS (1 << 20)
+
+struct workqueue_cpu {
+    spin_lock_t lock;
+    struct list_node queue;
+    int count;
+    /* the worker found nothing to do and is about to sleep */
+    volatile bool idle;
+    event_t event;
+    thread_t *worker;
+    struct workqueue_stats stats;
+} __CPU_ALIGN;
+
+static struct workqueue_cpu wq_cpus[SMP_MAX_CPUS];
+static bool wq_ready;
+
+void work_completion_init(struct work_completion *c, int count)
+{
+    c->pending = count;
+    event_init(&c->event, count <= 0, 0);
+}
+
+void work_completion_signal(struct work_completion *c)
+{
+    if (atomic_add(&c->pending, -1) == 1)
+        event_signal(&c->event, true);
+}
+
+/*
+ * pending may reach zero while the signaler is still in event_signal(),
+ * so the event, not the counter, says when c can go away.
+ */
+status_t work_completion_wait(struct work_completion *c, lk_time_t timeout)
+{
+    return event_wait_timeout(&c->event, timeout);
+}
+
+void work_completion_destroy(struct work_completion *c)
+{
+    event_destroy(&c->event);
+}
+
+void work_init(struct work *w, work_func_t func, void *arg)
+{
+    list_clear_node(&w->node);
+    w->func = func;
+    w->arg = arg;
+    w->cpu = -1;
+    w->result = 0;
+    work_completion_init(&w->done, 1);
+}
+
+void work_destroy(struct work *w)
+{
+    DEBUG_ASSERT(w->cpu < 0);
+
+    work_completion_destroy(&w->done);
+}
+
+/* Nothing may touch w once it is signaled, the owner can free it */
+static void work_run(struct work *w)
+{
+    w->result = w->func(w->arg);
+    work_completion_signal(&w->done);
+}
+
+static void work_run_inline(struct work *w)
+{
+    wq_cpus[arch_curr_cpu_num()].stats.inline_runs++;
+    work_run(w);
+}
+
+static struct work *wq_pop_locked(struct workqueue_cpu *q)
+{
+    struct work *w = list_remove_head_type(&q->queue, struct work, node);
+
+    if (w) {
+        q->count--;
+        w->cpu = -1;
+    }
+
+    return w;
+}
+
+/* Wake a sleeping worker of another cpu to take work from cpu */
+static void wq_wake_idle(uint cpu)
+{
+#if WITH_SMP
+    for (uint i = 1; i < SMP_MAX_CPUS; i++) {
+        uint c = (cpu + i) % SMP_MAX_CPUS;
+
+        if (wq_cpus[c].worker && wq_cpus[c].idle && mp_is_cpu_active(c)) {
+            event_signal(&wq_cpus[c].event, false);
+            return;
+        }
+    }
+#endif
+}
+
+void work_submit(struct work *w)
+{
+    spin_lock_saved_state_t state;
+    struct workqueue_cpu *q;
+    bool busy;
+    uint cpu;
+
+    DEBUG_ASSERT(w->cpu < 0);
+
+    w->done.pending = 1;
+    event_unsignal(&w->done.event);
+
+    if (!wq_ready) {
+        work_run_inline(w);
+        return;
+    }
+
+    cpu = arch_curr_cpu_num();
+    q = &wq_cpus[cpu];
+
+    spin_lock_irqsave(&q->lock, state);
+    if (q->count == WORKQUEUE_DEPTH) {
+        spin_unlock_irqrestore(&q->lock, state);
+        LTRACEF("queue of cpu %u is full, running %p inline\n", cpu, w);
+        work_run_inline(w);
+        return;
+    }
+    list_add_tail(&q->queue, &w->node);
+    q->count++;
+    w->cpu = cpu;
+    busy = q->count > 1 || !q->idle;
+    spin_unlock_irqrestore(&q->lock, state);
+
+    event_signal(&q->event, false);
+    if (busy)
+        wq_wake_idle(cpu);
+}
+
+bool work_cancel(struct work *w)
+{
+    spin_lock_saved_state_t state;
+    struct workqueue_cpu *q;
+    bool taken = false;
+    int cpu = w->cpu;
+
+    if (cpu < 0)
+        return false;
+
+    q = &wq_cpus[cpu];
+    spin_lock_irqsave(&q->lock, state);
+    /* a worker may have taken it meanwhile */
+    if (w->cpu == cpu) {
+        list_delete(&w->node);
+        q->count--;
+        w->cpu = -1;
+        taken = true;
+    }
+    spin_unlock_irqrestore(&q->lock, state);
+
+    return taken;
+}
+
+status_t work_wait(struct work *w, lk_time_t timeout, int *result)
+{
+    status_t err;
+
+    /* rather than waiting for a worker to get to it */
+    if (work_cancel(w))
+        work_run_inline(w);
+
+    err = work_completion_wait(&w->done, timeout);
+    if (err == NO_ERROR && result)
+        *result = w->result;
+
+    return err;
+}
+
+static struct work *wq_take(uint cpu)
+{
+    struct workqueue_cpu *q = &wq_cpus[cpu];
+    spin_lock_saved_state_t state;
+    struct work *w;
+
+    spin_lock_irqsave(&q->lock, state);
+    w = wq_pop_locked(q);
+    if (!w) {
+        /* under the lock, so a submit after this signals again */
+        event_unsignal(&q->event);
+        q->idle = true;
+    }
+    spin_unlock_irqrestore(&q->lock, state);
+
+    if (w)
+        return w;
+
+    for (uint i = 1; i < SMP_MAX_CPUS; i++) {
+        struct workqueue_cpu *victim = &wq_cpus[(cpu + i) % SMP_MAX_CPUS];
+
+        if (!victim->count)
+            continue;
+
+        spin_lock_irqsave(&victim->lock, state);
+        w = wq_pop_locked(victim);
+        spin_unlock_irqrestore(&victim->lock, state);
+
+        if (w) {
+            q->idle = false;
+            q->stats.stolen++;
+            return w;
+        }
+    }
+
+    return NULL;
+}
+
+static int wq_worker(void *arg)
+{
+    uint cpu = (uint)(uintptr_t)arg;
+    struct workqueue_cpu *q = &wq_cpus[cpu];
+    struct work *w;
+
+    for (;;) {
+        w = wq_take(cpu);
+        if (!w) {
+            event_wait(&q->event);
+            q->idle = false;
+            continue;
+        }
+
+        LTRACEF("cpu %u runs %p\n", cpu, w);
+        q->stats.executed++;
+        work_run(w);
+    }
+
+    return 0;
+}
+
+uint workqueue_concurrency(void)
+{
+#if WITH_SMP
+    if (wq_ready)
+        return __builtin_popcount(mp.active_cpus);
+#endif
+    return 1;
+}
+
+void workqueue_get_stats(struct workqueue_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        stats->executed += wq_cpus[i].stats.executed;
+        stats->stolen += wq_cpus[i].stats.stolen;
+        stats->inline_runs += wq_cpus[i].stats.inline_runs;
+    }
+}
+
+struct parallel_for_state {
+    parallel_for_func_t fn;
+    void *arg;
+    size_t start;
+    size_t end;
+    size_t grain;
+    volatile int next;
+    int chunks;
+};
+
+static int parallel_for_run(void *arg)
+{
+    struct parallel_for_state *p = arg;
+    int i;
+
+    while ((i = atomic_add(&p->next, 1)) < p->chunks) {
+        size_t start = p->start + (size_t)i * p->grain;
+
+        p->fn(p->arg, start, MIN(start + p->grain, p->end));
+    }
+
+    return 0;
+}
+
+void parallel_for(size_t start, size_t end, size_t grain,
+        parallel_for_func_t fn, void *arg)
+{
+    struct work helpers[SMP_MAX_CPUS];
+    struct parallel_for_state p;
+    size_t chunks;
+    uint count;
+
+    if (end <= start)
+        return;
+
+    grain = MAX(grain, 1);
+    chunks = (end - start - 1) / grain + 1;
+    if (chunks > PARALLEL_FOR_MAX_CHUNKS) {
+        grain = (end - start - 1) / PARALLEL_FOR_MAX_CHUNKS + 1;
+        chunks = (end - start - 1) / grain + 1;
+    }
+
+    p.fn = fn;
+    p.arg = arg;
+    p.start = start;
+    p.end = end;
+    p.grain = grain;
+    p.next = 0;
+    p.chunks = chunks;
+
+    /* the caller takes chunks as well, so one helper less than cpus */
+    count = MIN(chunks, workqueue_concurrency()) - 1;
+
+    for (uint i = 0; i < count; i++) {
+        work_init(&helpers[i], parallel_for_run, &p);
+        work_submit(&helpers[i]);
+    }
+
+    parallel_for_run(&p);
+
+    /* helpers nobody picked up yet find no chunks left and return */
+    for (uint i = 0; i < count; i++) {
+        work_wait(&helpers[i], INFINITE_TIME, NULL);
+        work_destroy(&helpers[i]);
+    }
+}
+
+static void workqueue_init(uint level)
+{
+#if WITH_SMP
+    char name[16];
+
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        struct workqueue_cpu *q = &wq_cpus[i];
+
+        spin_lock_init(&q->lock);
+        list_initialize(&q->queue);
+        event_init(&q->event, false, 0);
+
+        snprintf(name, sizeof(name), "worker %u", i);
+        q->worker = thread_create(name, wq_worker, (void *)(uintptr_t)i,
+                DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+        if (!q->worker) {
+            dprintf(CRITICAL, "workqueue: no worker for cpu %u\n", i);
+            continue;
+        }
+        thread_set_pinned_cpu(q->worker, i);
+        thread_detach_and_resume(q->worker);
+    }
+
+    wq_ready = true;
+#endif
+}
+
+LK_INIT_HOOK(workqueue, workqueue_init, LK_INIT_LEVEL_THREADING);
+
+#if WITH_LIB_CONSOLE
+static int cmd_wq(int argc, const cmd_args *argv)
+{
+    struct workqueue_stats total;
+
+    printf("concurrency %u, queue depth %d\n", workqueue_concurrency(), WORKQUEUE_DEPTH);
+    for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+        struct workqueue_cpu *q = &wq_cpus[i];
+
+        if (!q->worker)
+            continue;
+        printf("cpu %u: queued %d, executed %llu, stolen %llu, inline %llu\n",
+                i, q->count, q->stats.executed, q->stats.stolen,
+                q->stats.inline_runs);
+    }
+
+    workqueue_get_stats(&total);
+    printf("total: executed %llu, stolen %llu, inline %llu\n",
+            total.executed, total.stolen, total.inline_runs);
+
+    return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("wq", "work queue statistics", &cmd_wq)
+STATIC_COMMAND_END(workqueue);
+#endif
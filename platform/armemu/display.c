@@ -68,6 +68,9 @@ status_t display_get_framebuffer(struct display_framebuffer *fb)
     fb->image.stride = display_w;
     fb->image.rowbytes = display_w * 4;
     fb->flush = NULL;
+    fb->flush_rect = NULL;
+    fb->pan_rows = 0;
+    fb->pan = NULL;
     fb->format = DISPLAY_FORMAT_RGB_x888;
 
     return NO_ERROR;
@@ -0,0 +1,156 @@
+/*
+ * Copyright@ Samsung Electronics Co. LTD
+ *
+ * This software is proprietary of Samsung Electronics.
+ * No part of this software, either material or conceptual may be copied or distributed, transmitted,
+ * transcribed, stored in a retrieval system or translated into any human or computer language in any form by any means,
+ * electronic, mechanical, manual or otherwise, or disclosed
+ * to third parties without the express written permission of Samsung Electronics.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <part.h>
+#include <platform/ab_update.h>
+#include <platform/ab_state.h>
+#include <platform/bootloader_message.h>
+
+#define AB_STATE_SIZE		sizeof(struct bootloader_message_ab)
+
+static struct ab_state {
+	void *part;
+	/*
+	 * Working copy, modified by the ab_update code. Both copies are
+	 * padded up to the storage block size with what is on storage, as
+	 * the partition layer only writes whole blocks.
+	 */
+	struct bootloader_message_ab *bm;
+	/* What is known to be on storage */
+	struct bootloader_message_ab *shadow;
+	unsigned int block_size;
+	unsigned int size;
+	int loaded;
+} ab_state;
+
+int ab_state_load(void)
+{
+	struct ab_state *s = &ab_state;
+
+	if (s->loaded)
+		return 0;
+
+	s->part = part_get(AB_SLOTINFO_PART_NAME);
+	if (!s->part) {
+		printf("ab_state: no '%s' partition\n", AB_SLOTINFO_PART_NAME);
+		return ERR_NOT_FOUND;
+	}
+
+	if (!s->bm) {
+		s->block_size = MAX(part_get_block_size(), (u32)PART_SECTOR_SIZE);
+		s->size = ROUNDUP(AB_STATE_SIZE, s->block_size);
+		s->bm = memalign(0x1000, s->size);
+		s->shadow = memalign(0x1000, s->size);
+		if (!s->bm || !s->shadow) {
+			free(s->bm);
+			free(s->shadow);
+			s->bm = NULL;
+			s->shadow = NULL;
+			return ERR_NO_MEMORY;
+		}
+	}
+
+	/* The slot info is all in the first 4KB, no need for the whole partition */
+	if (part_read_partial(s->part, s->bm, 0, s->size)) {
+		printf("ab_state: failed to read '%s'\n", AB_SLOTINFO_PART_NAME);
+		return ERR_IO;
+	}
+	memcpy(s->shadow, s->bm, s->size);
+	s->loaded = 1;
+
+	return 0;
+}
+
+void ab_state_invalidate(void)
+{
+	ab_state.loaded = 0;
+}
+
+int ab_state_reload(void)
+{
+	ab_state_invalidate();
+
+	return ab_state_load();
+}
+
+ExynosSlotInfo *ab_state_slots(void)
+{
+	if (ab_state_load())
+		return NULL;
+
+	return (ExynosSlotInfo *)ab_state.bm->slot_suffix;
+}
+
+int ab_state_check(void)
+{
+	ExynosSlotInfo *a = ab_state_slots();
+	ExynosSlotInfo *b;
+
+	if (!a)
+		return AB_ERROR_NOT_SUPPORT;
+	b = a + 1;
+
+	if (memcmp(a->magic, "EXBC", 4) || memcmp(b->magic, "EXBC", 4))
+		return AB_ERROR_INVALID_MAGIC;
+	if (a->is_active == 1 && b->is_active == 1)
+		return AB_ERROR_SLOT_ALL_ACTIVE;
+	if (a->is_active != 1 && b->is_active != 1)
+		return AB_ERROR_SLOT_ALL_INACTIVE;
+
+	return 0;
+}
+
+int ab_state_sync(void)
+{
+	struct ab_state *s = &ab_state;
+	unsigned int i, off;
+	int written = 0;
+
+	if (!s->loaded)
+		return 0;
+
+	/* Only blocks that changed are written, each as a whole block */
+	for (i = 0; i < s->size / s->block_size; i++) {
+		off = i * s->block_size;
+		if (!memcmp((u8 *)s->bm + off, (u8 *)s->shadow + off, s->block_size))
+			continue;
+
+		if (part_write_partial(s->part, (u8 *)s->bm + off, off, s->block_size)) {
+			printf("ab_state: failed to write block %u of '%s'\n",
+					i, AB_SLOTINFO_PART_NAME);
+			/* Storage content is unknown now, read it again next time */
+			s->loaded = 0;
+			return ERR_IO;
+		}
+		memcpy((u8 *)s->shadow + off, (u8 *)s->bm + off, s->block_size);
+		written++;
+	}
+
+	return written;
+}
+
+void ab_state_print(void)
+{
+	ExynosSlotInfo *a = ab_state_slots();
+	ExynosSlotInfo *b;
+
+	if (!a)
+		return;
+	b = a + 1;
+
+	printf("_a bootable: %d, is_active %d, boot_successful %d, tries_remaining %d\n",
+			a->bootable, a->is_active, a->boot_successful, a->tries_remaining);
+	printf("_b bootable: %d, is_active %d, boot_successful %d, tries_remaining %d\n",
+			b->bootable, b->is_active, b->boot_successful, b->tries_remaining);
+}
@@ -32,10 +32,12 @@
 #include <platform/fastboot.h>
 #include <platform/bootimg.h>
 #include <platform/fdt.h>
+#include <platform/dt_fixup.h>
 #include <platform/chip_id.h>
 #include <platform/gpio.h>
 #include <part.h>
 #include <dev/scsi.h>
+#include <dev/ufs.h>
 
 /* Memory node */
 #define SIZE_2GB 	(0x80000000)
@@ -87,7 +89,8 @@ static struct bootargs_prop prop[64] = { { {0, }, {0, } }, };
 static int prop_cnt = 0;
 extern char dtbo_idx[4];
 
-static int bootargs_init(void)
+/* Split the bootargs of the dtb plus the boot image cmdline into prop[] */
+static int bootargs_init(const char *cmdline)
 {
 	u32 i = 0;
 	u32 len = 0;
@@ -95,24 +98,25 @@ static int bootargs_init(void)
 	u32 cnt = 0;
 	u32 is_val = 0;
 	char bootargs[BUFFER_SIZE];
-	int len2;
-	const char *np;
+	const void *fdt = dt_fixup_tree();
+	const char *np = NULL;
 	int noff;
 	int ret;
 
-	ret = fdt_check_header(fdt_dtb);
+	ret = fdt_check_header(fdt);
 	if (ret) {
 		printf("libfdt fdt_check_header(): %s\n", fdt_strerror(ret));
 		return ret;
 	}
 
-	memset(bootargs, 0, BUFFER_SIZE);
-	noff = fdt_path_offset(fdt_dtb, "/chosen");
-	if (noff >= 0) {
-		np = fdt_getprop(fdt_dtb, noff, "bootargs", &len2);
-		if (len2 >= 0)
-			memcpy(bootargs, np, len2);
-	}
+	noff = fdt_path_offset(fdt, "/chosen");
+	if (noff >= 0)
+		np = fdt_getprop(fdt, noff, "bootargs", NULL);
+
+	if (np && cmdline)
+		snprintf(bootargs, BUFFER_SIZE, "%s %s", np, cmdline);
+	else
+		snprintf(bootargs, BUFFER_SIZE, "%s", np ? np : cmdline ? cmdline : "");
 
 	printf("default bootargs: %s\n", bootargs[0] ? bootargs : "<null>");
 
@@ -199,7 +203,7 @@ static void bootargs_update(void)
 
 	printf("updated bootargs: %s\n", bootargs);
 
-	set_fdt_val("/chosen", "bootargs", bootargs);
+	dt_fixup_setprop_string("/chosen", "bootargs", bootargs);
 }
 
 static int add_val(const char *key, const char *val)
@@ -261,44 +265,6 @@ static void print_val(void)
 	}
 }
 
-/*
- * Remove_string_from_bootargs
- * This function is will be depricated
- */
-static void remove_string_from_bootargs(const char *str)
-{
-	char bootargs[BUFFER_SIZE];
-	const char *np;
-	int noff;
-	int bootargs_len;
-	int str_len;
-	int i;
-	int flag = 0;
-
-	noff = fdt_path_offset(fdt_dtb, "/chosen");
-	np = fdt_getprop(fdt_dtb, noff, "bootargs", &bootargs_len);
-
-	str_len = strlen(str);
-
-	for (i = 0; i <= bootargs_len - str_len; i++) {
-		if(!strncmp(str, (np + i), str_len)) {
-			flag = 1;
-			break;
-		}
-	}
-
-	if (!flag) {
-		printf("%sis not in bootargs\n", str);
-		return;
-	}
-
-	memset(bootargs, 0, BUFFER_SIZE);
-	memcpy(bootargs, np, i);
-	memcpy(bootargs + i, np + i + str_len, bootargs_len - i - str_len);
-
-	fdt_setprop(fdt_dtb, noff, "bootargs", bootargs, strlen(bootargs) + 1);
-}
-
 static int bootargs_process_linux(void)
 {
 	if (add_val("root", "/dev/mmcblk0p12")) {
@@ -431,6 +397,9 @@ static void configure_dtb(void)
 	bool is_upstream_dtb;
 
 	const char *np;
+	const char *cmdline = NULL;
+	const void *fdt;
+	u32 initrd_end;
 	int len, noff;
 	struct boot_img_hdr *b_hdr = (struct boot_img_hdr *)BOOT_BASE;
 	struct boot_img_hdr_v2 *b_hdr_v2 = (struct boot_img_hdr_v2 *)BOOT_BASE;
@@ -457,6 +426,12 @@ static void configure_dtb(void)
 	printf("DTB type: %supstream\n", is_upstream_dtb ? "" : "not ");
 	printf("ramdisk is %spresent\n", rd_size ? "" : "not ");
 
+	/*
+	 * Every change below is queued on the fixup builder and written to
+	 * the dtb by dt_fixup_apply() at the end.
+	 */
+	dt_fixup_begin(fdt_dtb);
+
 	/*
 	 * Handle case when DTB is upstream one:
 	 *   - skip merging DTBO
@@ -464,7 +439,6 @@ static void configure_dtb(void)
 	 *   - if ramdisk is not present: skip setting initrd* in /chosen
 	 */
 	if (is_upstream_dtb) {
-		resize_dt(SZ_4K);
 		if (rd_size > 0) {
 			printf("RootFS: Using ramdisk from boot part\n");
 			goto ramdisk_setup;
@@ -480,8 +454,6 @@ static void configure_dtb(void)
 	 * And if you modify bootargs, you will modify in set_bootargs label.
 	 */
 	merge_dto_to_main_dtb();
-	resize_dt(SZ_4K);
-
 
 	/* Get Secure DRAM information */
 	soc_ver = exynos_smc(SMC_CMD_GET_SOC_INFO, SOC_INFO_TYPE_VERSION, 0, 0);
@@ -562,31 +534,31 @@ static void configure_dtb(void)
 	/*
 	 * 1st DRAM node
 	 */
-	add_dt_memory_node(DRAM_BASE,
+	dt_fixup_memory_node(DRAM_BASE,
 				sec_dram_base - DRAM_BASE);
 	/*
 	 * 2nd DRAM node
 	 */
 	if (sec_pt_base && sec_pt_size) {
-		add_dt_memory_node(sec_dram_end,
+		dt_fixup_memory_node(sec_dram_end,
 		                   sec_pt_base - sec_dram_end);
 
 		if (dram_size >= SIZE_2GB) {
-			add_dt_memory_node(sec_pt_end,
+			dt_fixup_memory_node(sec_pt_end,
 			                   (DRAM_BASE + SIZE_2GB)
 			                   - sec_pt_end);
 		} else {
-			add_dt_memory_node(sec_pt_end,
+			dt_fixup_memory_node(sec_pt_end,
 			                   (DRAM_BASE + dram_size)
 			                   - sec_pt_end);
 		}
 	} else {
 		if (dram_size >= SIZE_2GB) {
-			add_dt_memory_node(sec_dram_end,
+			dt_fixup_memory_node(sec_dram_end,
 			                   (DRAM_BASE + SIZE_2GB)
 			                   - sec_dram_end);
 		} else {
-			add_dt_memory_node(sec_dram_end,
+			dt_fixup_memory_node(sec_dram_end,
 			                   (DRAM_BASE + dram_size)
 			                   - sec_dram_end);
 		}
@@ -600,36 +572,32 @@ static void configure_dtb(void)
 
 	for (u64 i = 0; i < dram_size - SIZE_2GB; i += SIZE_500MB) {
 		/* add 500MB mem node */
-		add_dt_memory_node(DRAM_BASE2 + i, SIZE_500MB);
+		dt_fixup_memory_node(DRAM_BASE2 + i, SIZE_500MB);
 	}
 
 mem_node_out:
-	sprintf(str, "<0x%x>", ECT_BASE);
-	set_fdt_val("/ect", "parameter_address", str);
-
-	sprintf(str, "<0x%x>", ECT_SIZE);
-	set_fdt_val("/ect", "parameter_size", str);
+	dt_fixup_setprop_u32("/ect", "parameter_address", ECT_BASE);
+	dt_fixup_setprop_u32("/ect", "parameter_size", ECT_SIZE);
 
 ramdisk_setup:
 	/* add initrd-start end value */
-	memset(str, 0, BUFFER_SIZE);
-	sprintf(str, "<0x%x>", RAMDISK_BASE);
-	set_fdt_val("/chosen", "linux,initrd-start", str);
-	printf("initrd-start: %s\n", str);
+	dt_fixup_setprop_u32("/chosen", "linux,initrd-start", RAMDISK_BASE);
+	printf("initrd-start: <0x%x>\n", RAMDISK_BASE);
 
-	memset(str, 0, BUFFER_SIZE);
 	if(b_hdr->header_version == 3)
-		sprintf(str, "<0x%x>", RAMDISK_BASE + vb_hdr->vendor_ramdisk_size + b_hdr_v3->ramdisk_size);
+		initrd_end = RAMDISK_BASE + vb_hdr->vendor_ramdisk_size + b_hdr_v3->ramdisk_size;
 	else
-		sprintf(str, "<0x%x>", RAMDISK_BASE + b_hdr_v2->ramdisk_size);
+		initrd_end = RAMDISK_BASE + b_hdr_v2->ramdisk_size;
 
-	set_fdt_val("/chosen", "linux,initrd-end", str);
-	printf("initrd-end: %s\n", str);
+	dt_fixup_setprop_u32("/chosen", "linux,initrd-end", initrd_end);
+	printf("initrd-end: <0x%x>\n", initrd_end);
 
 rmem_setup:
-	noff = fdt_path_offset(fdt_dtb, "/reserved-memory/cp_rmem");
+	/* the dtb with the overlay merged, without the queued changes */
+	fdt = dt_fixup_tree();
+	noff = fdt_path_offset(fdt, "/reserved-memory/cp_rmem");
 	if (noff >= 0) {
-		np = fdt_getprop(fdt_dtb, noff, "reg", &len);
+		np = fdt_getprop(fdt, noff, "reg", &len);
 		if (len >= 0) {
 			void *part = part_get_ab("modem");
 			u32 addr_s;
@@ -644,34 +612,18 @@ rmem_setup:
 			part_read_partial(part, (void *)addr_r, 0, 8 * 1024);
 		}
 	}
+	/* the boot image cmdline goes after the bootargs of the dtb */
 	if (b_hdr->header_version == 3) {
-		if (b_hdr_v3->cmdline[0] && (!b_hdr_v3->cmdline[BOOT_ARGS_SIZE - 1])) {
-			noff = fdt_path_offset(fdt_dtb, "/chosen");
-			np = fdt_getprop(fdt_dtb, noff, "bootargs", &len);
-			if (!np)
-				snprintf(str, BUFFER_SIZE, "%s", b_hdr_v3->cmdline);
-			else
-				snprintf(str, BUFFER_SIZE, "%s %s", np, b_hdr_v3->cmdline);
-			fdt_setprop(fdt_dtb, noff, "bootargs", str, strlen(str) + 1);
-		}
+		if (b_hdr_v3->cmdline[0] && (!b_hdr_v3->cmdline[BOOT_ARGS_SIZE - 1]))
+			cmdline = (const char *)b_hdr_v3->cmdline;
 	}
 	else{
-		if (b_hdr_v2->cmdline[0] && (!b_hdr_v2->cmdline[BOOT_ARGS_SIZE - 1])) {
-			noff = fdt_path_offset(fdt_dtb, "/chosen");
-			np = fdt_getprop(fdt_dtb, noff, "bootargs", &len);
-			if (!np)
-				snprintf(str, BUFFER_SIZE, "%s", b_hdr_v2->cmdline);
-			else
-				snprintf(str, BUFFER_SIZE, "%s %s", np, b_hdr_v2->cmdline);
-			fdt_setprop(fdt_dtb, noff, "bootargs", str, strlen(str) + 1);
-		}
+		if (b_hdr_v2->cmdline[0] && (!b_hdr_v2->cmdline[BOOT_ARGS_SIZE - 1]))
+			cmdline = (const char *)b_hdr_v2->cmdline;
 	}
 
 set_bootargs:
-	noff = fdt_path_offset(fdt_dtb, "/chosen");
-	np = fdt_getprop(fdt_dtb, noff, "bootargs", &len);
-	printf("bootargs: %s\n", np);
-	bootargs_init();
+	bootargs_init(cmdline);
 	update_or_add_val("console", "ttySAC0,115200n8");
 	add_val("printk.devkmsg", "on");
 	if (rd_size == 0)
@@ -683,7 +635,8 @@ set_bootargs:
 	/* bootargs can be checked with print_val() */
 	bootargs_update();
 
-	resize_dt(0);
+	/* one pass: overlay copy-out, sizing, and all queued changes */
+	dt_fixup_apply();
 }
 
 int cmd_scatter_load_boot(int argc, const cmd_args *argv);
@@ -798,6 +751,33 @@ int load_boot_images(void)
 	return 0;
 }
 
+/*
+ * Fetch UFS HPB map of partitions read during verified boot, so that
+ * scattered reads of footers, descriptors and hashtree are served
+ * with HPB READ.
+ */
+static void load_hpb_map(void)
+{
+	static const char *hpb_parts[] = {
+		"vbmeta", "dtbo", "boot", "vendor_boot",
+	};
+	void *part;
+	u32 i;
+
+	if (part_get_dev() != DEV_UFS)
+		return;
+
+	for (i = 0; i < countof(hpb_parts); i++) {
+		part = part_get_ab(hpb_parts[i]);
+		if (!part)
+			continue;
+
+		if (ufs_hpb_load(part_get_lun(part), part_get_start_in_blks(part),
+				part_get_size_in_bytes(part) / part_get_block_size()))
+			break;
+	}
+}
+
 extern void decon_stop(void);
 int cmd_boot(int argc, const cmd_args *argv)
 {
@@ -844,6 +824,8 @@ int cmd_boot(int argc, const cmd_args *argv)
 	}
 #endif
 
+	load_hpb_map();
+
 	err = load_boot_images();
 	if (err)
 		return err;
@@ -8,6 +8,7 @@
  * to third parties without the express written permission of Samsung Electronics.
  */
 
+#include <err.h>
 #include <string.h>
 #include <stdlib.h>
 #include <part.h>
@@ -21,6 +22,7 @@
 #include <platform/gpio.h>
 #include <platform/pmic_s2mpu12.h>
 #include <platform/mmu/mmu_func.h>
+#include <dev/ufs.h>
 #include "../fastboot/fastboot.h"
 
 #ifdef CONFIG_OFFLINE_RAMDUMP
@@ -68,6 +70,7 @@ int debug_store_ramdump(void)
 	u64 dram_write_size;
 	u64 dram_ptr;
 	u32 reboot_reason;
+	int wb = ERR_NOT_SUPPORTED;
 	int ret = 0;
 
 	if (!g_is_enabled) {
@@ -111,6 +114,9 @@ int debug_store_ramdump(void)
 
 	print_lcd_update(FONT_GREEN, FONT_BLACK, "WAIT for storing ramdump...");
 
+	/* Bulk write, WriteBooster buffer is flushed before reset */
+	wb = ufs_wb_begin();
+
 	if (dram_size > DRAM_WRITE_SIZE_DEFAULT) {
 		dram_write_size = DRAM_WRITE_SIZE_DEFAULT;
 		dram_ptr = DRAM_BASE;
@@ -157,6 +163,7 @@ int debug_store_ramdump(void)
 	printf("%s: Finish storing ramdump!\n", __func__);
 	printf("%s: Wait for 1 second for storing ramdump data\n", __func__);
 	u_delay(1000000);
+	ufs_wb_end(wb);
 
 #ifdef DEBUG_STORE_RAMDUMP_TEST
 	goto store_out;
@@ -172,6 +179,7 @@ int debug_store_ramdump(void)
 	} while(1);
 
 store_out:
+	ufs_wb_end(wb);
 	return ret;
 }
 
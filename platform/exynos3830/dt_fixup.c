@@ -0,0 +1,545 @@
+/*
+ * Copyright@ Samsung Electronics Co. LTD
+ *
+ * This software is proprietary of Samsung Electronics.
+ * No part of this software, either material or conceptual may be copied or distributed, transmitted,
+ * transcribed, stored in a retrieval system or translated into any human or computer language in any form by any means,
+ * electronic, mechanical, manual or otherwise, or disclosed
+ * to third parties without the express written permission of Samsung Electronics.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libfdt.h>
+#include <ufdt_overlay.h>
+#include <lib/console.h>
+#include <platform.h>
+#include <platform/fdt.h>
+#include <platform/sizes.h>
+#include <platform/dt_fixup.h>
+
+#define DT_FIXUP_MAX_DEPTH	16
+
+struct dt_fixup_node {
+	const char *path;
+	/* path components, 0 for the root */
+	int depth;
+	/* index of the parent for nodes to create, -1 for existing ones */
+	int parent;
+	const char *name;
+	int offset;
+};
+
+struct dt_fixup_prop {
+	int node;
+	const char *name;
+	const void *val;
+	int len;
+};
+
+static struct dt_fixup {
+	struct fdt_header *fdt;
+	/* result of the overlay merge, copied to fdt by apply */
+	void *scratch;
+
+	struct dt_fixup_node node[DT_FIXUP_MAX_NODES];
+	unsigned int nodes;
+	struct dt_fixup_prop prop[DT_FIXUP_MAX_PROPS];
+	unsigned int props;
+
+	char data[DT_FIXUP_DATA_SIZE];
+	size_t used;
+	/* bytes the queued changes can add to the blob at most */
+	size_t grow;
+
+	struct dt_fixup_stats stats;
+} dtf;
+
+void dt_fixup_begin(struct fdt_header *fdt)
+{
+	free(dtf.scratch);
+	dtf.scratch = NULL;
+	dtf.fdt = fdt;
+	dtf.nodes = 0;
+	dtf.props = 0;
+	dtf.used = 0;
+	dtf.grow = 0;
+	memset(&dtf.stats, 0, sizeof(dtf.stats));
+}
+
+const void *dt_fixup_tree(void)
+{
+	return dtf.scratch ? dtf.scratch : dtf.fdt;
+}
+
+static void *dt_fixup_alloc(size_t len)
+{
+	void *p;
+
+	if (dtf.used + len > DT_FIXUP_DATA_SIZE) {
+		printf("dt_fixup: out of data space (%zu bytes wanted)\n", len);
+		return NULL;
+	}
+
+	p = dtf.data + dtf.used;
+	dtf.used = ALIGN(dtf.used + len, 4);
+
+	return p;
+}
+
+static const char *dt_fixup_strdup(const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *p = dt_fixup_alloc(len);
+
+	if (p)
+		memcpy(p, str, len);
+
+	return p;
+}
+
+/* Index of the entry for path, the table is also the offset cache */
+static int dt_fixup_node_get(const char *path)
+{
+	struct dt_fixup_node *n;
+	const char *p;
+	unsigned int i;
+
+	for (i = 0; i < dtf.nodes; i++) {
+		if (!strcmp(dtf.node[i].path, path))
+			return i;
+	}
+
+	if (dtf.nodes == DT_FIXUP_MAX_NODES) {
+		printf("dt_fixup: too many nodes, dropping %s\n", path);
+		return ERR_NO_RESOURCES;
+	}
+
+	n = &dtf.node[dtf.nodes];
+	n->path = dt_fixup_strdup(path);
+	if (!n->path)
+		return ERR_NO_MEMORY;
+
+	n->depth = 0;
+	for (p = path; *p; p++) {
+		if (*p == '/' && p[1])
+			n->depth++;
+	}
+	n->parent = -1;
+	n->name = strrchr(n->path, '/') + 1;
+	n->offset = -FDT_ERR_NOTFOUND;
+
+	return dtf.nodes++;
+}
+
+int dt_fixup_overlay(void *overlay, size_t size)
+{
+	struct fdt_header *main_fdt = (struct fdt_header *)dt_fixup_tree();
+	struct fdt_header *merged;
+	lk_bigtime_t t = current_time_hires();
+	int ret;
+
+	ret = fdt_check_header(overlay);
+	if (ret < 0) {
+		printf("dt_fixup: overlay: %s\n", fdt_strerror(ret));
+		return ERR_INVALID_ARGS;
+	}
+
+	merged = ufdt_apply_overlay(main_fdt, fdt_totalsize(main_fdt), overlay, size);
+	if (!merged)
+		return ERR_GENERIC;
+
+	free(dtf.scratch);
+	dtf.scratch = merged;
+	dtf.stats.overlay_us += current_time_hires() - t;
+
+	return NO_ERROR;
+}
+
+int dt_fixup_add_node(const char *parent, const char *name)
+{
+	char path[256];
+	int p, n;
+
+	snprintf(path, sizeof(path), "%s/%s", strcmp(parent, "/") ? parent : "", name);
+
+	p = dt_fixup_node_get(parent);
+	if (p < 0)
+		return p;
+	n = dt_fixup_node_get(path);
+	if (n < 0)
+		return n;
+
+	if (dtf.node[n].parent < 0) {
+		dtf.node[n].parent = p;
+		dtf.grow += 2 * FDT_TAGSIZE + ALIGN(strlen(name) + 1, FDT_TAGSIZE);
+	}
+
+	return NO_ERROR;
+}
+
+int dt_fixup_setprop(const char *path, const char *name, const void *val, int len)
+{
+	struct dt_fixup_prop *prop;
+	void *data;
+	int n;
+
+	if (dtf.props == DT_FIXUP_MAX_PROPS) {
+		printf("dt_fixup: too many properties, dropping %s %s\n", path, name);
+		return ERR_NO_RESOURCES;
+	}
+
+	n = dt_fixup_node_get(path);
+	if (n < 0)
+		return n;
+
+	prop = &dtf.prop[dtf.props];
+	prop->name = dt_fixup_strdup(name);
+	data = dt_fixup_alloc(len);
+	if (!prop->name || !data)
+		return ERR_NO_MEMORY;
+	memcpy(data, val, len);
+
+	prop->node = n;
+	prop->val = data;
+	prop->len = len;
+	dtf.props++;
+	dtf.grow += sizeof(struct fdt_property) + ALIGN(len, FDT_TAGSIZE) + strlen(name) + 1;
+
+	return NO_ERROR;
+}
+
+int dt_fixup_setprop_string(const char *path, const char *name, const char *str)
+{
+	return dt_fixup_setprop(path, name, str, strlen(str) + 1);
+}
+
+int dt_fixup_setprop_cells(const char *path, const char *name, const u32 *cells, int count)
+{
+	fdt32_t be[8];
+	int i;
+
+	if (count > (int)countof(be))
+		return ERR_INVALID_ARGS;
+
+	for (i = 0; i < count; i++)
+		be[i] = cpu_to_fdt32(cells[i]);
+
+	return dt_fixup_setprop(path, name, be, count * sizeof(fdt32_t));
+}
+
+int dt_fixup_setprop_u32(const char *path, const char *name, u32 val)
+{
+	return dt_fixup_setprop_cells(path, name, &val, 1);
+}
+
+int dt_fixup_memory_node(unsigned long base, unsigned int size)
+{
+	char name[32];
+	char path[34];
+	u32 reg[3];
+	int ret;
+
+	snprintf(name, sizeof(name), "memory@%lx", base);
+	snprintf(path, sizeof(path), "/%s", name);
+	reg[0] = (u64)base >> 32;
+	reg[1] = base & 0xffffffff;
+	reg[2] = size;
+
+	ret = dt_fixup_add_node("/", name);
+	if (!ret)
+		ret = dt_fixup_setprop_cells(path, "reg", reg, 3);
+	if (!ret)
+		ret = dt_fixup_setprop_string(path, "device_type", "memory");
+
+	return ret;
+}
+
+/*
+ * Same rule as fdt_path_offset(): a component without a unit address
+ * also matches a node that has one.
+ */
+static bool dt_fixup_path_match(const char *path, const char **names, const int *lens, int depth)
+{
+	const char *p = path + 1;
+	int i, len;
+
+	for (i = 0; i < depth; i++) {
+		const char *end = strchr(p, '/');
+
+		len = end ? end - p : (int)strlen(p);
+		if (len > lens[i] || memcmp(p, names[i], len))
+			return false;
+		if (len != lens[i] && (names[i][len] != '@' || memchr(p, '@', len)))
+			return false;
+		p += len + 1;
+	}
+
+	return true;
+}
+
+/* Find every queued path in one walk of the tree */
+static void dt_fixup_resolve(const void *fdt)
+{
+	const char *names[DT_FIXUP_MAX_DEPTH];
+	int lens[DT_FIXUP_MAX_DEPTH];
+	unsigned int i, pending = 0;
+	int offset = 0, depth = 0;
+
+	for (i = 0; i < dtf.nodes; i++) {
+		if (dtf.node[i].depth == 0) {
+			dtf.node[i].offset = 0;
+		} else {
+			dtf.node[i].offset = -FDT_ERR_NOTFOUND;
+			pending++;
+		}
+	}
+
+	while (pending) {
+		offset = fdt_next_node(fdt, offset, &depth);
+		if (offset < 0 || depth <= 0)
+			break;
+		if (depth > DT_FIXUP_MAX_DEPTH)
+			continue;
+
+		names[depth - 1] = fdt_get_name(fdt, offset, &lens[depth - 1]);
+		if (!names[depth - 1])
+			continue;
+
+		for (i = 0; i < dtf.nodes; i++) {
+			struct dt_fixup_node *n = &dtf.node[i];
+
+			if (n->offset >= 0 || n->depth != depth)
+				continue;
+			if (dt_fixup_path_match(n->path, names, lens, depth)) {
+				n->offset = offset;
+				pending--;
+			}
+		}
+	}
+}
+
+/* Offset a node is edited at, created nodes go in with their parent */
+static int dt_fixup_key(unsigned int i)
+{
+	while (dtf.node[i].offset < 0 && dtf.node[i].parent >= 0)
+		i = dtf.node[i].parent;
+
+	return dtf.node[i].offset;
+}
+
+static void dt_fixup_apply_node(struct fdt_header *fdt, unsigned int i)
+{
+	struct dt_fixup_node *n = &dtf.node[i];
+	unsigned int j;
+	int ret;
+
+	if (n->offset < 0 && n->parent >= 0 && dtf.node[n->parent].offset >= 0)
+		n->offset = fdt_add_subnode(fdt, dtf.node[n->parent].offset, n->name);
+
+	if (n->offset < 0) {
+		printf("dt_fixup: %s: %s\n", n->path, fdt_strerror(n->offset));
+		return;
+	}
+
+	for (j = 0; j < dtf.props; j++) {
+		struct dt_fixup_prop *prop = &dtf.prop[j];
+
+		if (prop->node != (int)i)
+			continue;
+		ret = fdt_setprop(fdt, n->offset, prop->name, prop->val, prop->len);
+		if (ret < 0)
+			printf("dt_fixup: %s %s: %s\n", n->path, prop->name, fdt_strerror(ret));
+	}
+}
+
+int dt_fixup_apply(void)
+{
+	const struct fdt_header *src = dt_fixup_tree();
+	unsigned char order[DT_FIXUP_MAX_NODES];
+	int key[DT_FIXUP_MAX_NODES];
+	unsigned int i, j;
+	lk_bigtime_t t;
+	size_t size, src_size;
+	int ret;
+
+	ret = fdt_check_header(src);
+	if (ret) {
+		printf("dt_fixup: fdt_check_header(): %s\n", fdt_strerror(ret));
+		return ERR_BAD_STATE;
+	}
+
+	/* sized once, this is also the copy out of the overlay scratch */
+	t = current_time_hires();
+	size = ALIGN(sizeof(struct fdt_header), 8) +
+		(fdt_num_mem_rsv(src) + 1) * sizeof(struct fdt_reserve_entry) +
+		fdt_size_dt_struct(src) + fdt_size_dt_strings(src);
+	size = ALIGN(size + dtf.grow + DT_FIXUP_SLACK, 4);
+	src_size = fdt_totalsize(src);
+	ret = fdt_open_into(src, dtf.fdt, size);
+	if (ret) {
+		printf("dt_fixup: fdt_open_into(): %s\n", fdt_strerror(ret));
+		return ERR_NO_MEMORY;
+	}
+	free(dtf.scratch);
+	dtf.scratch = NULL;
+
+	dt_fixup_resolve(dtf.fdt);
+	dtf.stats.resolve_us = current_time_hires() - t;
+
+	/*
+	 * Highest offset first: a change only moves what follows it, so the
+	 * offsets of the nodes still to be done stay valid.
+	 */
+	t = current_time_hires();
+	for (i = 0; i < dtf.nodes; i++) {
+		key[i] = dt_fixup_key(i);
+		for (j = i; j > 0 && key[order[j - 1]] < key[i]; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	for (i = 0; i < dtf.nodes; i++)
+		dt_fixup_apply_node(dtf.fdt, order[i]);
+	dtf.stats.apply_us = current_time_hires() - t;
+
+	dtf.stats.nodes = dtf.nodes;
+	dtf.stats.props = dtf.props;
+	dtf.stats.grown = size - src_size;
+
+	dprintf(INFO, "dt_fixup: %u nodes, %u props, size %u, overlay %llu us, resolve %llu us, apply %llu us\n",
+			dtf.stats.nodes, dtf.stats.props, fdt_totalsize(dtf.fdt),
+			dtf.stats.overlay_us, dtf.stats.resolve_us, dtf.stats.apply_us);
+
+	return fdt_totalsize(dtf.fdt);
+}
+
+const struct dt_fixup_stats *dt_fixup_last_stats(void)
+{
+	return &dtf.stats;
+}
+
+/*
+ * dtbprof: the fixups configure_dtb() makes, once with the per call
+ * helpers of fdt.c and once through the builder, on copies of the dtb.
+ */
+#define DTBPROF_ROUNDS		16
+#define DTBPROF_HEADROOM	(64 * 1024)
+#define DTBPROF_BOOTARGS	2048
+
+static const unsigned long dtbprof_mem[][2] = {
+	{ 0x80000000, 0x3c000000 },
+	{ 0xc0000000, 0x20000000 },
+	{ 0x880000000, 0x20000000 },
+	{ 0x8a0000000, 0x20000000 },
+};
+
+static void dtbprof_bootargs(const void *fdt, char *buf, size_t len)
+{
+	const char *np = NULL;
+	int noff;
+
+	noff = fdt_path_offset(fdt, "/chosen");
+	if (noff >= 0)
+		np = fdt_getprop(fdt, noff, "bootargs", NULL);
+	snprintf(buf, len, "%s console=ttySAC0,115200n8 printk.devkmsg=on "
+			"androidboot.bootreason=reboot androidboot.slot_suffix=_a "
+			"androidboot.serialno=0123456789abcdef", np ? np : "");
+}
+
+static void dtbprof_legacy(struct fdt_header *fdt, const char *bootargs)
+{
+	struct fdt_header *saved = fdt_dtb;
+	char str[64];
+	unsigned int i;
+
+	fdt_dtb = fdt;
+
+	resize_dt(SZ_4K);
+	for (i = 0; i < countof(dtbprof_mem); i++)
+		add_dt_memory_node(dtbprof_mem[i][0], dtbprof_mem[i][1]);
+	sprintf(str, "<0x%x>", 0x84000000);
+	set_fdt_val("/chosen", "linux,initrd-start", str);
+	sprintf(str, "<0x%x>", 0x84800000);
+	set_fdt_val("/chosen", "linux,initrd-end", str);
+	set_fdt_val("/chosen", "bootargs", bootargs);
+	resize_dt(0);
+
+	fdt_dtb = saved;
+}
+
+static void dtbprof_builder(struct fdt_header *fdt, const char *bootargs)
+{
+	unsigned int i;
+
+	dt_fixup_begin(fdt);
+	for (i = 0; i < countof(dtbprof_mem); i++)
+		dt_fixup_memory_node(dtbprof_mem[i][0], dtbprof_mem[i][1]);
+	dt_fixup_setprop_u32("/chosen", "linux,initrd-start", 0x84000000);
+	dt_fixup_setprop_u32("/chosen", "linux,initrd-end", 0x84800000);
+	dt_fixup_setprop_string("/chosen", "bootargs", bootargs);
+	dt_fixup_apply();
+}
+
+static int cmd_dtbprof(int argc, const cmd_args *argv)
+{
+	const struct dt_fixup_stats *s = &dtf.stats;
+	struct dt_fixup_stats saved = dtf.stats;
+	unsigned int rounds = argc > 1 ? argv[1].u : DTBPROF_ROUNDS;
+	lk_bigtime_t t, t_legacy = 0, t_builder = 0;
+	char *bootargs, *buf;
+	size_t len;
+	unsigned int i;
+
+	if (s->nodes || s->props)
+		printf("last boot: %u nodes, %u props, +%u bytes, overlay %llu us, resolve %llu us, apply %llu us\n",
+				s->nodes, s->props, s->grown, s->overlay_us, s->resolve_us, s->apply_us);
+
+	if (!fdt_dtb || fdt_check_header(fdt_dtb)) {
+		printf("no valid dtb loaded\n");
+		return -1;
+	}
+	if (rounds == 0)
+		rounds = 1;
+
+	len = fdt_totalsize(fdt_dtb);
+	buf = malloc(len + DTBPROF_HEADROOM);
+	bootargs = malloc(DTBPROF_BOOTARGS);
+	if (!buf || !bootargs) {
+		free(buf);
+		free(bootargs);
+		return ERR_NO_MEMORY;
+	}
+	dtbprof_bootargs(fdt_dtb, bootargs, DTBPROF_BOOTARGS);
+
+	for (i = 0; i < rounds; i++) {
+		memcpy(buf, fdt_dtb, len);
+		t = current_time_hires();
+		dtbprof_legacy((struct fdt_header *)buf, bootargs);
+		t_legacy += current_time_hires() - t;
+
+		memcpy(buf, fdt_dtb, len);
+		t = current_time_hires();
+		dtbprof_builder((struct fdt_header *)buf, bootargs);
+		t_builder += current_time_hires() - t;
+	}
+
+	printf("dtb %zu bytes, %u rounds\n", len, rounds);
+	printf("  per call: %llu us\n", t_legacy / rounds);
+	printf("  builder:  %llu us (resolve %llu us, apply %llu us)\n",
+			t_builder / rounds, s->resolve_us, s->apply_us);
+
+	/* keep the report of the real boot */
+	dtf.stats = saved;
+
+	free(bootargs);
+	free(buf);
+
+	return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("dtbprof", "time dtb fixups: dtbprof [rounds]", &cmd_dtbprof)
+STATIC_COMMAND_END(dtbprof);
@@ -164,7 +164,12 @@ static void cache_flush(void)
 #endif
 }
 
-/* connection call back function and input board data */
+/*
+ * connection call back function and input board data
+ *
+ * host->irq is left 0 on both channels: the MMC interrupt lines of this
+ * SoC are not described in this tree, so data phases stay polled.
+ */
 int dwmci_board_get_host(struct dw_mci *host, int channel)
 {
 	switch(channel) {
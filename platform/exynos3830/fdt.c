@@ -17,7 +17,7 @@
 #include <lib/console.h>
 #include <platform/fdt.h>
 #include <platform/fastboot.h>
-#include <ufdt_overlay.h>
+#include <platform/dt_fixup.h>
 #include <ctype.h>
 
 #define BUFFER_SIZE 4096
@@ -30,9 +30,14 @@ unsigned long simple_strtoul(const char *cp,char **endp,unsigned int base);
 
 char dtbo_idx[4] = {0,};
 
+/*
+ * Queue the overlay of this board on the fixup builder, dt_fixup_begin()
+ * must have been called. The overlay is used where it was loaded and is
+ * modified by the merge, dtbo.img is read again for every boot.
+ */
 void merge_dto_to_main_dtb(void)
 {
-	void *fdto, *merged_fdt;
+	void *fdto;
 	struct dt_table_entry *dt_entry;
 	u32 i;
 	int ret;
@@ -68,27 +73,18 @@ void merge_dto_to_main_dtb(void)
 		return;
 	}
 
-	fdto = malloc(fdt32_to_cpu(dt_entry->dt_size));
-	memcpy((void *)fdto, (void *)((unsigned long)dtbo_table + fdt32_to_cpu(dt_entry->dt_offset)),
-			fdt32_to_cpu(dt_entry->dt_size));
+	fdto = (void *)((unsigned long)dtbo_table + fdt32_to_cpu(dt_entry->dt_offset));
 
 	ret = fdt_check_header(fdto);
 	if (ret < 0) {
 		printf("DTBO: overlay dtbo: %s", fdt_strerror(ret));
-		goto fdto_magic_err;
+		return;
 	}
 
-	merged_fdt = ufdt_apply_overlay(fdt_dtb, fdt_totalsize(fdt_dtb),
-			fdto, fdt_totalsize(fdto));
-	if (!merged_fdt)
-		goto fdto_magic_err;
-
-	memcpy(fdt_dtb, merged_fdt, fdt_totalsize(merged_fdt));
-	printf("DTBO: Merge Complete (size:%d)!\n", fdt_totalsize(fdt_dtb));
+	if (dt_fixup_overlay(fdto, fdt_totalsize(fdto)))
+		return;
 
-	free(merged_fdt);
-fdto_magic_err:
-	free(fdto);
+	printf("DTBO: Merge Complete (size:%d)!\n", fdt_totalsize(dt_fixup_tree()));
 }
 
 int resize_dt(unsigned int sz)
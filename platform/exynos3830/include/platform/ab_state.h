@@ -0,0 +1,38 @@
+/*
+ * Copyright@ Samsung Electronics Co. LTD
+ *
+ * This software is proprietary of Samsung Electronics.
+ * No part of this software, either material or conceptual may be copied or distributed, transmitted,
+ * transcribed, stored in a retrieval system or translated into any human or computer language in any form by any means,
+ * electronic, mechanical, manual or otherwise, or disclosed
+ * to third parties without the express written permission of Samsung Electronics.
+ */
+
+#ifndef __AB_STATE_H__
+#define __AB_STATE_H__
+
+#include <sys/types.h>
+#include <platform/ab_slotinfo.h>
+
+/*
+ * In-memory copy of the bootloader_message_ab kept in the slot info
+ * partition. It is read once on first use and every A/B query is
+ * served from it; ab_state_sync() writes back only the storage blocks
+ * that differ from what is on storage.
+ */
+
+/* Read slot info from storage unless it is already cached */
+int ab_state_load(void);
+/* Drop the cached copy, e.g. after the partition was flashed or erased */
+void ab_state_invalidate(void);
+/* Drop the cached copy and read it again */
+int ab_state_reload(void);
+/* Slot array (_a, _b) of the cached copy, NULL if it cannot be loaded */
+ExynosSlotInfo *ab_state_slots(void);
+/* 0 if the cached slots are consistent, AB_ERROR_* otherwise */
+int ab_state_check(void);
+/* Write back dirty blocks, returns the number of blocks written or ERR_* */
+int ab_state_sync(void);
+void ab_state_print(void);
+
+#endif	/* __AB_STATE_H__ */
@@ -0,0 +1,63 @@
+/*
+ * Copyright@ Samsung Electronics Co. LTD
+ *
+ * This software is proprietary of Samsung Electronics.
+ * No part of this software, either material or conceptual may be copied or distributed, transmitted,
+ * transcribed, stored in a retrieval system or translated into any human or computer language in any form by any means,
+ * electronic, mechanical, manual or otherwise, or disclosed
+ * to third parties without the express written permission of Samsung Electronics.
+ */
+
+#ifndef __DT_FIXUP_H__
+#define __DT_FIXUP_H__
+
+#include <sys/types.h>
+#include <libfdt.h>
+
+/*
+ * Device tree fixup builder
+ *
+ * Boot code queues every node and property change instead of editing
+ * the blob directly. dt_fixup_apply() sizes the blob once, resolves all
+ * node paths in a single walk of the tree and writes the changes from
+ * the end of the blob backwards, so no change moves a node that is
+ * still to be edited. A queued overlay is merged into a scratch blob
+ * that is copied to its destination by the same pass.
+ */
+
+#define DT_FIXUP_MAX_NODES	32
+#define DT_FIXUP_MAX_PROPS	64
+#define DT_FIXUP_DATA_SIZE	(8 * 1024)
+/* Left free after apply for edits made with set_fdt_val() later */
+#define DT_FIXUP_SLACK		(4 * 1024)
+
+struct dt_fixup_stats {
+	lk_bigtime_t overlay_us;
+	lk_bigtime_t resolve_us;
+	lk_bigtime_t apply_us;
+	unsigned int nodes;
+	unsigned int props;
+	unsigned int grown;
+};
+
+/* Start collecting changes for fdt, the blob is updated in place */
+void dt_fixup_begin(struct fdt_header *fdt);
+/* Merge an overlay, it is modified by the merge */
+int dt_fixup_overlay(void *overlay, size_t size);
+/* Tree as it will be before the queued changes, for reading */
+const void *dt_fixup_tree(void);
+
+int dt_fixup_add_node(const char *parent, const char *name);
+int dt_fixup_setprop(const char *path, const char *name, const void *val, int len);
+int dt_fixup_setprop_string(const char *path, const char *name, const char *str);
+/* Cells are given in cpu order */
+int dt_fixup_setprop_cells(const char *path, const char *name, const u32 *cells, int count);
+int dt_fixup_setprop_u32(const char *path, const char *name, u32 val);
+/* memory@base node with a <base_hi base_lo size> reg */
+int dt_fixup_memory_node(unsigned long base, unsigned int size);
+
+/* Write everything out, returns the new size of the blob or ERR_* */
+int dt_fixup_apply(void);
+const struct dt_fixup_stats *dt_fixup_last_stats(void);
+
+#endif	/* __DT_FIXUP_H__ */
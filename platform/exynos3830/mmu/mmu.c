@@ -17,6 +17,7 @@
  */
 
 #include <assert.h>
+#include <arch/dma_sync.h>
 #include <platform/mmu/mmu.h>
 #include <platform/mmu/cpu_a.h>
 #include <platform/mmu/types.h>
@@ -410,6 +411,10 @@ static void s5e9630_mmu_table_init(void)
 	set_tt_entry((u64 *)0xF9800000, (u64 *)0xFD3FFFFF, (u64 *)0xF9800000, TT_NONCACHEBLE);
 	set_tt_entry((u64 *)0xFD400000, (u64 *)0xFFFFFFFF, (u64 *)0xFD400000, TT_RAM);
 	set_tt_entry((u64 *)0x880000000, (u64 *)0xAFFFFFFFF, (u64 *)0x880000000, TT_RAM);
+
+	/* DMA buffers in the non-cacheable windows need no maintenance */
+	dma_sync_add_uncached(0xF0000000, 0x00200000);
+	dma_sync_add_uncached(0xF9800000, 0x03C00000);
 }
 
 void cpu_common_init(void)
@@ -24,6 +24,7 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/pmic/if_pmic_s2mu106.c \
 	$(LOCAL_DIR)/pmic/fg_s2mu106.c \
 	$(LOCAL_DIR)/ab_update/ab_update.c \
+	$(LOCAL_DIR)/ab_update/ab_state.c \
 	$(LOCAL_DIR)/gpio_init.S \
 	$(LOCAL_DIR)/gpio.c \
 	$(LOCAL_DIR)/dpu_cal/decon_reg.c \
@@ -31,6 +32,7 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/dpu_cal/dsim_reg.c \
 	$(LOCAL_DIR)/wdt/wdt_recovery.c \
 	$(LOCAL_DIR)/fdt.c \
+	$(LOCAL_DIR)/dt_fixup.c \
 	$(LOCAL_DIR)/dram_training/dram_training.c \
 	$(LOCAL_DIR)/mmu/cpu_a.S \
 	$(LOCAL_DIR)/mmu/mmu.c \
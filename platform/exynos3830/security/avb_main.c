@@ -17,6 +17,7 @@
 #include <platform/cm_api.h>
 #include <platform/bootimg.h>
 #include <dev/rpmb.h>
+#include <kernel/ktrace.h>
 #include <string.h>
 #include <part.h>
 #if defined(CONFIG_AVB_LCD_LOG)
@@ -314,6 +315,7 @@ uint32_t avb_main(const char *suffix, char *cmdline, char *verifiedbootstate, ui
 		flags = AVB_SLOT_VERIFY_FLAGS_NONE;
 
 	/* slot verify */
+	KTRACE_BEGIN(KTRACE_AVB, "avb_slot_verify", recovery_mode);
 	if ((recovery_mode == 1) && (!ab_update_support()))
 		ret = avb_slot_verify(ops, partition_recovery, suffix,
 				flags,
@@ -324,6 +326,7 @@ uint32_t avb_main(const char *suffix, char *cmdline, char *verifiedbootstate, ui
 				flags,
 				AVB_HASHTREE_ERROR_MODE_RESTART_AND_INVALIDATE,
 				&ctx_ptr);
+	KTRACE_END(KTRACE_AVB, "avb_slot_verify");
 
 	/* get color */
 	if (unlock) {
@@ -336,8 +336,15 @@ void phy_usb_exynos_system_init(int num_phy_port, bool en)
 /* Fastboot command related function */
 #include <dev/rpmb.h>
 #include <dev/scsi.h>
+#include <dev/ufs.h>
 void platform_prepare_reboot(void)
 {
+	/*
+	 * Migrate data written through WriteBooster buffer
+	 * before reset. Failure should not affect reboot sequence.
+	 */
+	ufs_wb_flush();
+
 	/*
 	 * Send SSU to UFS. Something wrong on SSU should not
 	 * affect reboot sequence.
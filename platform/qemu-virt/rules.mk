@@ -38,6 +38,7 @@ GLOBAL_DEFINES += \
     MEMBASE=$(MEMBASE) \
     MEMSIZE=$(MEMSIZE) \
     PLATFORM_SUPPORTS_PANIC_SHELL=1 \
+    ARM_PMU_INT=23 \
     CONSOLE_HAS_INPUT_BUFFER=1
 
 GLOBAL_DEFINES += MMU_WITH_TRAMPOLINE=1 \
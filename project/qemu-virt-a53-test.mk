@@ -1,6 +1,12 @@
 # main project for qemu-aarch64
 MODULES += \
-	app/shell
+	app/shell \
+	app/fastboot_tcp \
+	lib/workqueue
+
+# fastboot over tcp and "net bench tcp" want a large receive window
+GLOBAL_DEFINES += \
+	MINIP_TCP_RX_BUFFER_SIZE=2097152
 
 include project/virtual/test.mk
 include project/virtual/fs.mk
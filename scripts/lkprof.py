@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 Samsung Electronics Co., Ltd.
+#
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files
+# (the "Software"), to deal in the Software without restriction,
+# including without limitation the rights to use, copy, modify, merge,
+# publish, distribute, sublicense, and/or sell copies of the Software,
+# and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+# CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+"""Host side of the arm64 sampling profiler (arch/arm64/profiler.c)
+
+  lkprof.py symblob [--nm NM] lk.elf lk.elf.syms
+      Write the symbol blob the on-device report reads ('prof syms').
+
+  lkprof.py report [--nm NM] [--top N] lk.elf console.log
+      Symbolize the samples of 'prof dump' captured from the console.
+"""
+
+import argparse
+import bisect
+import collections
+import re
+import struct
+import subprocess
+import sys
+
+SYMBLOB_MAGIC = 0x59534b4c  # "LKSY"
+SYMBLOB_VERSION = 1
+
+SAMPLE_RE = re.compile(r'^\s*(\d+) ([0-9a-fA-F]+) ([0-9a-fA-F]+)\s*$')
+
+
+def read_symbols(nm, elf):
+    """Function symbols sorted by address, as (addr, size, name)"""
+    out = subprocess.check_output([nm, '-n', '-S', '--defined-only', '-C', elf],
+                                  universal_newlines=True)
+    syms = []
+    for line in out.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) == 4:
+            addr, size, kind, name = fields
+        elif len(fields) == 3:
+            addr, kind, name = fields
+            size = '0'
+        else:
+            continue
+        if kind not in 'tTwW':
+            continue
+        syms.append((int(addr, 16), int(size, 16), name))
+    return syms
+
+
+def write_symblob(syms, path):
+    strtab = bytearray()
+    entries = bytearray()
+    offsets = {}
+    for addr, size, name in syms:
+        if name not in offsets:
+            offsets[name] = len(strtab)
+            strtab += name.encode() + b'\0'
+        entries += struct.pack('<QII', addr, size, offsets[name])
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IIII', SYMBLOB_MAGIC, SYMBLOB_VERSION, len(syms), len(strtab)))
+        f.write(entries)
+        f.write(strtab)
+
+
+def read_samples(path):
+    """Samples between the last 'prof: begin' and 'prof: end' of a log"""
+    samples = []
+    event = None
+    inside = False
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith('prof: begin'):
+                samples = []
+                event = line[len('prof: begin'):].strip()
+                inside = True
+            elif line.startswith('prof: end'):
+                inside = False
+            elif inside:
+                m = SAMPLE_RE.match(line)
+                if m:
+                    samples.append((int(m.group(1)), int(m.group(2), 16), int(m.group(3), 16)))
+    return event, samples
+
+
+def symbolize(syms, addrs, addr):
+    i = bisect.bisect_right(addrs, addr) - 1
+    if i < 0:
+        return None
+    start, size, name = syms[i]
+    if size and addr >= start + size:
+        return None
+    return name
+
+
+def print_top(title, counts, total, top):
+    print('\n%s\n  samples       %%  symbol' % title)
+    for name, count in counts.most_common(top):
+        print('  %7u %6.2f  %s' % (count, count * 100.0 / total, name))
+
+
+def report(args):
+    syms = read_symbols(args.nm, args.elf)
+    addrs = [s[0] for s in syms]
+    event, samples = read_samples(args.log)
+    if not samples:
+        sys.exit('no samples in %s, run "prof dump" after "prof stop"' % args.log)
+
+    flat = collections.Counter()
+    callers = collections.Counter()
+    cpus = collections.Counter()
+    for cpu, pc, lr in samples:
+        flat[symbolize(syms, addrs, pc) or '0x%x' % pc] += 1
+        callers[symbolize(syms, addrs, lr) or '0x%x' % lr] += 1
+        cpus[cpu] += 1
+
+    print('%s, %u samples (%s)' % (event, len(samples),
+          ', '.join('cpu %u: %u' % c for c in sorted(cpus.items()))))
+    print_top('flat profile', flat, len(samples), args.top)
+    print_top('callers (lr)', callers, len(samples), args.top)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='cmd')
+
+    p = sub.add_parser('symblob', help='generate the on-device symbol blob')
+    p.add_argument('--nm', default='nm')
+    p.add_argument('elf')
+    p.add_argument('out')
+
+    p = sub.add_parser('report', help='symbolize a captured "prof dump"')
+    p.add_argument('--nm', default='nm')
+    p.add_argument('--top', type=int, default=20)
+    p.add_argument('elf')
+    p.add_argument('log')
+
+    args = parser.parse_args()
+    if args.cmd == 'symblob':
+        write_symblob(read_symbols(args.nm, args.elf), args.out)
+    elif args.cmd == 'report':
+        report(args)
+    else:
+        parser.print_help()
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -214,6 +214,9 @@ status_t display_get_framebuffer(struct display_framebuffer *fb)
     fb->image.stride = M4DISPLAY_WIDTH;
     fb->image.rowbytes = M4DISPLAY_WIDTH;
     fb->flush = s4lcd_flush;
+    fb->flush_rect = NULL;
+    fb->pan_rows = 0;
+    fb->pan = NULL;
     fb->format = DISPLAY_FORMAT_UNKNOWN; //TODO
 
     return NO_ERROR;
@@ -423,6 +423,9 @@ status_t display_get_framebuffer(struct display_framebuffer *fb)
     fb->image.height = BSP_LCD_GetYSize();
     fb->image.stride = BSP_LCD_GetXSize();
     fb->flush = NULL;
+    fb->flush_rect = NULL;
+    fb->pan_rows = 0;
+    fb->pan = NULL;
 
     return NO_ERROR;
 }
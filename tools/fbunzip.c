@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Decode a compressed "diskdump:SSSSSSSSNNNNNNNN:z" capture back into the
+ * raw image.
+ *
+ * The stream is a sequence of frames, see fb_stream_frame() in
+ * dev/usb/device/fastboot/fastboot-cmd.c: a 512 byte header block holding
+ * magic, type, raw_len and len (little endian), then len payload bytes
+ * padded up to 512. The payload is a zlib stream or the raw chunk.
+ *
+ *   fbunzip dump.fbz dump.img
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <lib/miniz.h>
+
+#define FRAME_ALIGN     512
+#define FRAME_MAGIC     0x46425a46  /* "FZBF" */
+#define FRAME_RAW       0
+#define FRAME_ZLIB      1
+
+/* Largest FB_STREAM_CHUNK_SIZE the decoder accepts */
+#define MAX_CHUNK       (64 * 1024 * 1024)
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t hdr[FRAME_ALIGN];
+    uint8_t *in = NULL, *out = NULL;
+    uint64_t total = 0;
+    unsigned frames = 0;
+    FILE *fin, *fout;
+    int ret = 1;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <capture> <image>\n", argv[0]);
+        return 1;
+    }
+
+    fin = fopen(argv[1], "rb");
+    if (!fin) {
+        fprintf(stderr, "error: cannot open '%s'\n", argv[1]);
+        return 1;
+    }
+    fout = fopen(argv[2], "wb");
+    if (!fout) {
+        fprintf(stderr, "error: cannot create '%s'\n", argv[2]);
+        fclose(fin);
+        return 1;
+    }
+
+    in = malloc(MAX_CHUNK + FRAME_ALIGN);
+    out = malloc(MAX_CHUNK);
+    if (!in || !out) {
+        fprintf(stderr, "error: out of memory\n");
+        goto done;
+    }
+
+    while (fread(hdr, 1, sizeof(hdr), fin) == sizeof(hdr)) {
+        uint32_t type = get32(hdr + 4);
+        uint32_t raw_len = get32(hdr + 8);
+        uint32_t len = get32(hdr + 12);
+        uint32_t padded = (len + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+        const uint8_t *data = in;
+
+        if (get32(hdr) != FRAME_MAGIC || raw_len > MAX_CHUNK || len > MAX_CHUNK) {
+            fprintf(stderr, "error: bad frame header at 0x%llx\n",
+                    (unsigned long long)ftell(fin) - FRAME_ALIGN);
+            goto done;
+        }
+        if (fread(in, 1, padded, fin) != padded) {
+            fprintf(stderr, "error: frame %u is truncated\n", frames);
+            goto done;
+        }
+
+        if (type == FRAME_ZLIB) {
+            size_t n = tinfl_decompress_mem_to_mem(out, raw_len, in, len,
+                                                   TINFL_FLAG_PARSE_ZLIB_HEADER);
+            if (n != raw_len) {
+                fprintf(stderr, "error: frame %u does not decompress\n", frames);
+                goto done;
+            }
+            data = out;
+        } else if (type != FRAME_RAW || len != raw_len) {
+            fprintf(stderr, "error: frame %u has unknown type %u\n", frames, type);
+            goto done;
+        }
+
+        if (fwrite(data, 1, raw_len, fout) != raw_len) {
+            fprintf(stderr, "error: cannot write '%s'\n", argv[2]);
+            goto done;
+        }
+        total += raw_len;
+        frames++;
+    }
+
+    printf("%u frames, %llu bytes\n", frames, (unsigned long long)total);
+    ret = 0;
+
+done:
+    free(in);
+    free(out);
+    fclose(fin);
+    if (fclose(fout))
+        ret = 1;
+    return ret;
+}
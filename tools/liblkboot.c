@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
@@ -30,6 +31,7 @@
 #include <sys/types.h>
 
 #include "network.h"
+#include "lz4block.h"
 #include "../app/lkboot/lkboot_protocol.h"
 
 static int readx(int s, void *_data, int len)
@@ -53,53 +55,72 @@ static int readx(int s, void *_data, int len)
     return 0;
 }
 
-static int upload(int s, int txfd, size_t txlen, int do_endian_swap)
-{
-    int err = 0;
-    msg_hdr_t hdr;
+#define CHUNK_SIZE 65536
 
-    char *buf = malloc(txlen);
-    if (!buf)
-        return -1;
+static int compress = 0;
 
-    if (readx(txfd, buf, txlen)) {
-        fprintf(stderr, "error: reading from file\n");
-        err = -1;
-        goto done;
-    }
+void lkboot_set_compress(int enable)
+{
+    compress = enable;
+}
 
-    /* 4 byte swap data if requested */
-    if (do_endian_swap) {
-        size_t i;
-        for (i = 0; i < txlen; i += 4) {
-            char temp = buf[i];
-            buf[i] = buf[i + 3];
-            buf[i + 3] = temp;
-
-            temp = buf[i + 1];
-            buf[i + 1] = buf[i + 2];
-            buf[i + 2] = temp;
-        }
-    }
+/* read, convert and send the payload one chunk at a time */
+static int upload(int s, int txfd, size_t txlen, int do_endian_swap, int do_compress)
+{
+    static char buf[CHUNK_SIZE];
+    static uint8_t zbuf[LZ4_COMPRESS_BOUND(CHUNK_SIZE)];
+    msg_hdr_t hdr;
+    size_t sent = 0;
 
     size_t pos = 0;
     while (pos < txlen) {
-        size_t xfer = (txlen - pos > 65536) ? 65536 : txlen - pos;
+        size_t xfer = (txlen - pos > CHUNK_SIZE) ? CHUNK_SIZE : txlen - pos;
+        const void *data = buf;
+        size_t len = xfer;
+
+        if (readx(txfd, buf, xfer)) {
+            fprintf(stderr, "error: reading from file\n");
+            return -1;
+        }
+
+        /* 4 byte swap data if requested */
+        if (do_endian_swap) {
+            size_t i;
+            for (i = 0; i < xfer; i += 4) {
+                char temp = buf[i];
+                buf[i] = buf[i + 3];
+                buf[i + 3] = temp;
+
+                temp = buf[i + 1];
+                buf[i + 1] = buf[i + 2];
+                buf[i + 2] = temp;
+            }
+        }
 
         hdr.opcode = MSG_SEND_DATA;
         hdr.extra = 0;
-        hdr.length = xfer - 1;
+
+        /* chunks that do not shrink go as they are */
+        if (do_compress) {
+            size_t zlen = lz4_compress_block((const uint8_t *)buf, xfer, zbuf);
+            if (zlen < xfer) {
+                hdr.extra = MSG_DATA_LZ4;
+                data = zbuf;
+                len = zlen;
+            }
+        }
+
+        hdr.length = len - 1;
         if (write(s, &hdr, sizeof(hdr)) != sizeof(hdr)) {
             fprintf(stderr, "error: writing socket\n");
-            err = -1;
-            goto done;
+            return -1;
         }
-        if (write(s, buf + pos, xfer) != xfer) {
+        if (write(s, data, len) != len) {
             fprintf(stderr, "error: writing socket\n");
-            err = -1;
-            goto done;
+            return -1;
         }
         pos += xfer;
+        sent += len;
     }
 
     hdr.opcode = MSG_END_DATA;
@@ -107,14 +128,13 @@ static int upload(int s, int txfd, size_t txlen, int do_endian_swap)
     hdr.length = 0;
     if (write(s, &hdr, sizeof(hdr)) != sizeof(hdr)) {
         fprintf(stderr, "error: writing socket\n");
-        err = -1;
-        goto done;
+        return -1;
     }
 
-done:
-    free(buf);
+    if (do_compress)
+        fprintf(stderr, "sent %zu bytes as %zu\n", txlen, sent);
 
-    return err;
+    return 0;
 }
 
 static off_t trim_fpga_image(int fd, off_t len)
@@ -275,7 +295,10 @@ int lkboot_txn(const char *host, const char *_cmd, int txfd, const char *args)
         if (readx(fd_in, &hdr, sizeof(hdr))) goto iofail;
         switch (hdr.opcode) {
             case MSG_GO_AHEAD:
-                if (upload(fd_out, txfd, txlen, do_endian_swap)) {
+                if (compress && !(hdr.extra & MSG_GO_AHEAD_LZ4))
+                    fprintf(stderr, "warning: target does not take compressed data\n");
+                if (upload(fd_out, txfd, txlen, do_endian_swap,
+                           compress && (hdr.extra & MSG_GO_AHEAD_LZ4))) {
                     ret = -1;
                     goto out;
                 }
@@ -30,3 +30,7 @@ int lkboot_txn(const char *host, const char *cmd, int txfd, const char *args);
 // return number of bytes of data the last txn resulted in and if nonzero
 // set *ptr = the buffer (which remains valid until next lkboot_txn())
 unsigned lkboot_get_reply(void **ptr);
+
+// send payloads of later txns as lz4 compressed chunks, if the target
+// supports it
+void lkboot_set_compress(int enable);
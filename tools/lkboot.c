@@ -34,7 +34,7 @@
 void usage(void)
 {
     fprintf(stderr,
-            "usage: lkboot <hostname> <command> ...\n"
+            "usage: lkboot [-z] <hostname> <command> ...\n"
             "\n"
             "       lkboot <hostname> flash <partition> <filename>\n"
             "       lkboot <hostname> erase <partition>\n"
@@ -45,6 +45,8 @@ void usage(void)
             "       lkboot <hostname> reboot\n"
             "       lkboot <hostname> :<commandname> [ <arg>* ]\n"
             "\n"
+            "-z compresses the payload with lz4 on the way.\n"
+            "\n"
             "NOTE: If <hostname> is 'jtag', lkboot will attempt to use\n"
             "       a tool 'zynq-dcc' to communicate with the device.\n"
             "       Make sure it is in your path.\n"
@@ -72,6 +74,12 @@ printhex:
 
 int main(int argc, char **argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "-z")) {
+        lkboot_set_compress(1);
+        argc--;
+        argv++;
+    }
+
     const char *host = argv[1];
     const char *cmd = argv[2];
     const char *args = argv[3];
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * LZ4 block compressor shared by the image tools. Greedy with a single
+ * hash probe, so fast rather than tight.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lz4block.h"
+
+#define MINMATCH            4
+#define MFLIMIT             12
+#define LASTLITERALS        5
+#define MAX_DISTANCE        65535
+#define HASH_LOG            16
+#define HASH_PRIME          2654435761U
+
+static uint32_t hash_table[1 << HASH_LOG];
+
+static uint32_t read32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t *put_len(uint8_t *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+
+    return op;
+}
+
+static uint8_t *put_literals(uint8_t *op, uint8_t *token, const uint8_t *lit, size_t len)
+{
+    *token = (len >= 15 ? 15 : len) << 4;
+    if (len >= 15)
+        op = put_len(op, len - 15);
+    memcpy(op, lit, len);
+
+    return op + len;
+}
+
+size_t lz4_compress_block(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *iend = src + len;
+    const uint8_t *mflimit = iend - MFLIMIT;
+    const uint8_t *matchlimit = iend - LASTLITERALS;
+    uint8_t *op = dst;
+    uint8_t *token;
+
+    memset(hash_table, 0, sizeof(hash_table));
+
+    while (len > MFLIMIT && ip < mflimit) {
+        uint32_t h = (read32(ip) * HASH_PRIME) >> (32 - HASH_LOG);
+        uint32_t ref = hash_table[h];
+        const uint8_t *match = src + ref - 1;
+        size_t ml;
+
+        hash_table[h] = ip - src + 1;
+        if (!ref || ip - match > MAX_DISTANCE || read32(match) != read32(ip)) {
+            /* Skip faster through data that does not compress */
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        while (ip > anchor && match > src && ip[-1] == match[-1]) {
+            ip--;
+            match--;
+        }
+
+        ml = MINMATCH;
+        while (ip + ml < matchlimit && match[ml] == ip[ml])
+            ml++;
+
+        token = op++;
+        op = put_literals(op, token, anchor, ip - anchor);
+        *op++ = (ip - match) & 0xff;
+        *op++ = (ip - match) >> 8;
+
+        ml -= MINMATCH;
+        *token |= ml >= 15 ? 15 : ml;
+        if (ml >= 15)
+            op = put_len(op, ml - 15);
+
+        ip += ml + MINMATCH;
+        anchor = ip;
+    }
+
+    token = op++;
+    op = put_literals(op, token, anchor, iend - anchor);
+
+    return op - dst;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LZ4BLOCK_H
+#define __LZ4BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Worst case output of lz4_compress_block() for len bytes */
+#define LZ4_COMPRESS_BOUND(len) ((len) + (len) / 255 + 16)
+
+/*
+ * Compress src into a single independent LZ4 block at dst, which must
+ * hold LZ4_COMPRESS_BOUND(len) bytes. Returns the block length, which
+ * may exceed len for data that does not compress.
+ */
+size_t lz4_compress_block(const uint8_t *src, size_t len, uint8_t *dst);
+
+#endif
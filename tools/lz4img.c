@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Compress a raw partition image into an LZ4 frame for "fastboot flash".
+ *
+ * The frame declares its content size, so the bootloader can reject an
+ * image that does not fit the partition before writing anything, and
+ * carries a content checksum. Blocks are independent and up to 4MB.
+ *
+ *   lz4img boot.img boot.img.lz4
+ *   fastboot flash boot boot.img.lz4
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "lz4block.h"
+
+#define LZ4_FRAME_MAGIC     0x184D2204
+#define LZ4_FLG             0x6C    /* v1, independent blocks, content size, content checksum */
+#define LZ4_BD              0x70    /* 4MB blocks */
+#define LZ4_BLOCK_SIZE      (4 * 1024 * 1024)
+#define LZ4_BLOCK_UNCOMPRESSED 0x80000000
+
+#define PRIME32_1   2654435761U
+#define PRIME32_2   2246822519U
+#define PRIME32_3   3266489917U
+#define PRIME32_4   668265263U
+#define PRIME32_5   374761393U
+
+static uint32_t read32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t xxh32_round(uint32_t acc, uint32_t in)
+{
+    acc += in * PRIME32_2;
+    acc = rotl32(acc, 13);
+    return acc * PRIME32_1;
+}
+
+static uint32_t xxh32(const uint8_t *p, size_t len)
+{
+    const uint8_t *end = p + len;
+    uint32_t h;
+
+    if (len >= 16) {
+        uint32_t v1 = PRIME32_1 + PRIME32_2;
+        uint32_t v2 = PRIME32_2;
+        uint32_t v3 = 0;
+        uint32_t v4 = -PRIME32_1;
+
+        do {
+            v1 = xxh32_round(v1, read32(p));
+            v2 = xxh32_round(v2, read32(p + 4));
+            v3 = xxh32_round(v3, read32(p + 8));
+            v4 = xxh32_round(v4, read32(p + 12));
+            p += 16;
+        } while (end - p >= 16);
+
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        h = PRIME32_5;
+    }
+
+    h += (uint32_t)len;
+
+    while (end - p >= 4) {
+        h += read32(p) * PRIME32_3;
+        h = rotl32(h, 17) * PRIME32_4;
+        p += 4;
+    }
+    while (p < end) {
+        h += (*p++) * PRIME32_5;
+        h = rotl32(h, 11) * PRIME32_1;
+    }
+
+    h ^= h >> 15;
+    h *= PRIME32_2;
+    h ^= h >> 13;
+    h *= PRIME32_3;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static void *load_file(const char *fn, size_t *len)
+{
+    struct stat st;
+    uint8_t *buf;
+    size_t done = 0;
+    int fd;
+
+    fd = open(fn, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "error: cannot open '%s'\n", fn);
+        return NULL;
+    }
+
+    buf = malloc(st.st_size ? st.st_size : 1);
+    if (!buf) {
+        close(fd);
+        return NULL;
+    }
+
+    while (done < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + done, st.st_size - done);
+        if (n <= 0) {
+            fprintf(stderr, "error: cannot read '%s'\n", fn);
+            free(buf);
+            close(fd);
+            return NULL;
+        }
+        done += n;
+    }
+
+    close(fd);
+    *len = done;
+
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t hdr[4 + 2 + 8 + 1];
+    uint8_t word[4];
+    uint8_t *in, *out;
+    size_t len, pos, n;
+    uint64_t total = sizeof(hdr) + 8;
+    int fd;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <image> <image.lz4>\n", argv[0]);
+        return 1;
+    }
+
+    in = load_file(argv[1], &len);
+    if (!in)
+        return 1;
+
+    /* Worst case of a block is stored uncompressed */
+    out = malloc(LZ4_COMPRESS_BOUND(LZ4_BLOCK_SIZE));
+    if (!out)
+        return 1;
+
+    fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "error: cannot create '%s'\n", argv[2]);
+        return 1;
+    }
+
+    write32(hdr, LZ4_FRAME_MAGIC);
+    hdr[4] = LZ4_FLG;
+    hdr[5] = LZ4_BD;
+    write32(hdr + 6, (uint32_t)len);
+    write32(hdr + 10, (uint32_t)((uint64_t)len >> 32));
+    hdr[14] = (xxh32(hdr + 4, 10) >> 8) & 0xff;
+    if (write_all(fd, hdr, sizeof(hdr)))
+        goto fail;
+
+    for (pos = 0; pos < len; pos += n) {
+        size_t clen;
+
+        n = len - pos;
+        if (n > LZ4_BLOCK_SIZE)
+            n = LZ4_BLOCK_SIZE;
+
+        clen = lz4_compress_block(in + pos, n, out);
+        if (clen >= n) {
+            write32(word, n | LZ4_BLOCK_UNCOMPRESSED);
+            if (write_all(fd, word, 4) || write_all(fd, in + pos, n))
+                goto fail;
+            clen = n;
+        } else {
+            write32(word, clen);
+            if (write_all(fd, word, 4) || write_all(fd, out, clen))
+                goto fail;
+        }
+        total += 4 + clen;
+    }
+
+    /* EndMark and content checksum */
+    write32(word, 0);
+    if (write_all(fd, word, 4))
+        goto fail;
+    write32(word, xxh32(in, len));
+    if (write_all(fd, word, 4))
+        goto fail;
+
+    close(fd);
+
+    printf("%s: %zu -> %llu bytes (%.1f%%)\n", argv[2], len,
+           (unsigned long long)total, len ? total * 100.0 / len : 0.0);
+
+    return 0;
+
+fail:
+    fprintf(stderr, "error: cannot write '%s'\n", argv[2]);
+    close(fd);
+    unlink(argv[2]);
+    return 1;
+}
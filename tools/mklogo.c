@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2026 Samsung Electronics Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Pack BMP files into a logo partition image, see lib/logo_format.h.
+ *
+ *   mklogo -o logo.img boot=boot.bmp charging=charging.bmp
+ *   fastboot flash logo logo.img
+ *
+ * 24 bpp images are stored as BGR888 and 32 bpp ones as BGRA8888, in
+ * BMP row order. Each image is compressed with whichever of RLE and LZ4
+ * comes out smaller unless -c picks one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <lib/logo_format.h>
+
+#include "lz4block.h"
+
+#define COMP_AUTO   -1
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void *load_file(const char *fn, size_t *len)
+{
+    struct stat st;
+    uint8_t *buf;
+    size_t done = 0;
+    int fd;
+
+    fd = open(fn, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "error: cannot open '%s'\n", fn);
+        return NULL;
+    }
+
+    buf = malloc(st.st_size ? st.st_size : 1);
+    if (!buf) {
+        close(fd);
+        return NULL;
+    }
+
+    while (done < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + done, st.st_size - done);
+        if (n <= 0) {
+            fprintf(stderr, "error: cannot read '%s'\n", fn);
+            free(buf);
+            close(fd);
+            return NULL;
+        }
+        done += n;
+    }
+
+    close(fd);
+    *len = done;
+
+    return buf;
+}
+
+/* Unpadded pixels of a 24 or 32 bpp BMP, bottom row first */
+static uint8_t *load_bmp(const char *fn, unsigned int *width, unsigned int *height,
+                         unsigned int *bpp)
+{
+    uint8_t *file, *pixels;
+    size_t len, stride, row;
+    uint32_t offset, compression;
+    int32_t w, h;
+    unsigned int y;
+
+    file = load_file(fn, &len);
+    if (!file)
+        return NULL;
+
+    if (len < 54 || file[0] != 'B' || file[1] != 'M') {
+        fprintf(stderr, "error: '%s' is not a BMP file\n", fn);
+        goto fail;
+    }
+
+    offset = get32(file + 10);
+    w = (int32_t)get32(file + 18);
+    h = (int32_t)get32(file + 22);
+    *bpp = (file[28] | (file[29] << 8)) / 8;
+    compression = get32(file + 30);
+
+    /* BI_RGB, or BI_BITFIELDS which is used for 32 bpp with alpha */
+    if ((*bpp != 3 && *bpp != 4) || (compression != 0 && compression != 3)) {
+        fprintf(stderr, "error: '%s' has to be uncompressed 24 or 32 bpp\n", fn);
+        goto fail;
+    }
+    if (w <= 0 || w > 0xffff || h == 0 || h > 0xffff || h < -0xffff) {
+        fprintf(stderr, "error: '%s' has a bad size %dx%d\n", fn, w, h);
+        goto fail;
+    }
+
+    *width = w;
+    *height = h < 0 ? -h : h;
+    row = (size_t)*width * *bpp;
+    stride = (row + 3) & ~(size_t)3;
+    if (offset > len || (len - offset) / stride < *height) {
+        fprintf(stderr, "error: '%s' is truncated\n", fn);
+        goto fail;
+    }
+
+    pixels = malloc(row * *height);
+    if (!pixels)
+        goto fail;
+
+    /* A negative height is a top-down image */
+    for (y = 0; y < *height; y++) {
+        unsigned int src_y = h < 0 ? *height - 1 - y : y;
+
+        memcpy(pixels + y * row, file + offset + src_y * stride, row);
+    }
+
+    free(file);
+    return pixels;
+
+fail:
+    free(file);
+    return NULL;
+}
+
+static size_t rle_run(const uint8_t *p, size_t left, unsigned int bpp)
+{
+    size_t n = 1;
+
+    while (n < left && n < LOGO_RLE_MAX && !memcmp(p, p + n * bpp, bpp))
+        n++;
+
+    return n;
+}
+
+/* dst needs count * bpp + count / LOGO_RLE_MAX + 1 bytes */
+static size_t rle_compress(const uint8_t *src, size_t count, unsigned int bpp, uint8_t *dst)
+{
+    uint8_t *op = dst;
+    size_t i = 0, lit;
+
+    while (i < count) {
+        size_t run = rle_run(src + i * bpp, count - i, bpp);
+
+        if (run >= 2) {
+            *op++ = LOGO_RLE_RUN | (run - 1);
+            memcpy(op, src + i * bpp, bpp);
+            op += bpp;
+            i += run;
+            continue;
+        }
+
+        /* Literals up to the next run */
+        lit = 1;
+        while (i + lit < count && lit < LOGO_RLE_MAX &&
+               rle_run(src + (i + lit) * bpp, count - i - lit, bpp) < 2)
+            lit++;
+
+        *op++ = lit - 1;
+        memcpy(op, src + i * bpp, lit * bpp);
+        op += lit * bpp;
+        i += lit;
+    }
+
+    return op - dst;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c auto|none|rle|lz4] -o <logo.img> <name>=<file.bmp> ...\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *comp_names[] = { "none", "rle", "lz4" };
+    uint8_t header[LOGO_HEADER_SIZE];
+    uint8_t pad[LOGO_ALIGN];
+    const char *out = NULL;
+    int comp = COMP_AUTO;
+    uint32_t offset = LOGO_HEADER_SIZE;
+    unsigned int count = 0;
+    int fd, c;
+
+    while ((c = getopt(argc, argv, "c:o:")) != -1) {
+        switch (c) {
+        case 'c':
+            if (!strcmp(optarg, "auto"))
+                comp = COMP_AUTO;
+            else if (!strcmp(optarg, "none"))
+                comp = LOGO_COMP_NONE;
+            else if (!strcmp(optarg, "rle"))
+                comp = LOGO_COMP_RLE;
+            else if (!strcmp(optarg, "lz4"))
+                comp = LOGO_COMP_LZ4;
+            else
+                usage(argv[0]);
+            break;
+        case 'o':
+            out = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (!out || optind == argc)
+        usage(argv[0]);
+    if ((size_t)(argc - optind) > LOGO_MAX_IMAGES) {
+        fprintf(stderr, "error: at most %zu images\n", (size_t)LOGO_MAX_IMAGES);
+        return 1;
+    }
+
+    fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "error: cannot create '%s'\n", out);
+        return 1;
+    }
+
+    /* Images first, the directory is written last */
+    memset(header, 0, sizeof(header));
+    memset(pad, 0, sizeof(pad));
+    if (lseek(fd, LOGO_HEADER_SIZE, SEEK_SET) < 0)
+        goto fail_write;
+
+    for (; optind < argc; optind++, count++) {
+        char *name = argv[optind];
+        char *fn = strchr(name, '=');
+        uint8_t *entry = header + sizeof(struct logo_header) + count * sizeof(struct logo_entry);
+        unsigned int width, height, bpp;
+        uint8_t *pixels, *rle, *lz4, *data;
+        size_t raw_len, rle_len, lz4_len, len;
+        int use;
+
+        if (!fn || fn == name || fn - name >= LOGO_NAME_LEN) {
+            fprintf(stderr, "error: '%s' is not <name>=<file.bmp>\n", name);
+            goto fail;
+        }
+        *fn++ = '\0';
+
+        pixels = load_bmp(fn, &width, &height, &bpp);
+        if (!pixels)
+            goto fail;
+
+        raw_len = (size_t)width * height * bpp;
+        rle = malloc(raw_len + raw_len / LOGO_RLE_MAX + 1);
+        lz4 = malloc(LZ4_COMPRESS_BOUND(raw_len));
+        if (!rle || !lz4) {
+            fprintf(stderr, "error: out of memory\n");
+            goto fail;
+        }
+        rle_len = rle_compress(pixels, (size_t)width * height, bpp, rle);
+        lz4_len = lz4_compress_block(pixels, raw_len, lz4);
+
+        use = comp;
+        if (use == COMP_AUTO) {
+            use = LOGO_COMP_NONE;
+            if (rle_len < raw_len)
+                use = LOGO_COMP_RLE;
+            if (lz4_len < raw_len && lz4_len < rle_len)
+                use = LOGO_COMP_LZ4;
+        }
+        data = use == LOGO_COMP_RLE ? rle : use == LOGO_COMP_LZ4 ? lz4 : pixels;
+        len = use == LOGO_COMP_RLE ? rle_len : use == LOGO_COMP_LZ4 ? lz4_len : raw_len;
+
+        if (len > UINT32_MAX - offset) {
+            fprintf(stderr, "error: image too large\n");
+            goto fail;
+        }
+
+        memcpy(entry, name, strlen(name));
+        put32(entry + 16, offset);
+        put32(entry + 20, len);
+        put16(entry + 24, width);
+        put16(entry + 26, height);
+        entry[28] = bpp == 3 ? LOGO_FMT_BGR888 : LOGO_FMT_BGRA8888;
+        entry[29] = use;
+
+        if (write_all(fd, data, len) ||
+            write_all(fd, pad, (LOGO_ALIGN - len % LOGO_ALIGN) % LOGO_ALIGN))
+            goto fail_write;
+
+        printf("%-16s %4ux%-4u %u bpp  %-4s %zu -> %zu bytes\n", name, width, height,
+               bpp * 8, comp_names[use], raw_len, len);
+
+        offset += (len + LOGO_ALIGN - 1) / LOGO_ALIGN * LOGO_ALIGN;
+        free(pixels);
+        free(rle);
+        free(lz4);
+    }
+
+    memcpy(header, LOGO_MAGIC, 4);
+    put32(header + 4, LOGO_VERSION);
+    put32(header + 8, count);
+    if (lseek(fd, 0, SEEK_SET) < 0 || write_all(fd, header, sizeof(header)))
+        goto fail_write;
+
+    close(fd);
+
+    printf("%s: %u images, %u bytes\n", out, count, offset);
+
+    return 0;
+
+fail_write:
+    fprintf(stderr, "error: cannot write '%s'\n", out);
+fail:
+    close(fd);
+    unlink(out);
+    return 1;
+}